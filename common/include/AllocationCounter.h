@@ -0,0 +1,97 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        /* Heap activity of one thread, Bytes only sums the requested sizes */
+        struct AllocationCounters
+        {
+            std::uint64_t Allocations;
+            std::uint64_t Deallocations;
+            std::uint64_t Bytes;
+        };
+
+        /*!
+        *  \brief AllocationCounter
+        *
+        *  Per thread allocation counters. They are only updated by the replacement
+        *  operator new / delete of AllocationHook.h : a program which does not include
+        *  the hook keeps the default allocator and the counters stay at zero.
+        */
+        class AllocationCounter
+        {
+            public:
+
+                static AllocationCounters & GetThreadCounters()
+                {
+                    // Constant initialized, reading it never allocates
+                    static thread_local AllocationCounters s_Counters = { 0, 0, 0 };
+                    return s_Counters;
+                }
+
+                static void OnAllocation(std::size_t iSize)
+                {
+                    auto & Counters = GetThreadCounters();
+                    ++Counters.Allocations;
+                    Counters.Bytes += iSize;
+                }
+
+                static void OnDeallocation()
+                {
+                    ++GetThreadCounters().Deallocations;
+                }
+
+                /* True when the counting hook is linked in the program */
+                static bool IsHookInstalled()
+                {
+                    const auto Before = GetThreadCounters().Allocations;
+
+                    void * volatile pProbe = ::operator new(1);
+                    ::operator delete(pProbe);
+
+                    return GetThreadCounters().Allocations != Before;
+                }
+        };
+
+        /*!
+        *  \brief ScopedAllocationCounter
+        *
+        *  Allocations done by the calling thread since the construction of the counter.
+        */
+        class ScopedAllocationCounter
+        {
+            public:
+
+                ScopedAllocationCounter()
+                    :m_Start(AllocationCounter::GetThreadCounters())
+                {}
+
+                AllocationCounters GetCounters() const
+                {
+                    const auto & Current = AllocationCounter::GetThreadCounters();
+                    return AllocationCounters{ Current.Allocations - m_Start.Allocations,
+                                               Current.Deallocations - m_Start.Deallocations,
+                                               Current.Bytes - m_Start.Bytes };
+                }
+
+                std::uint64_t GetAllocations() const { return GetCounters().Allocations; }
+
+                void Reset() { m_Start = AllocationCounter::GetThreadCounters(); }
+
+            private:
+                AllocationCounters m_Start;
+        };
+
+    }
+}
@@ -0,0 +1,122 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+/*
+    Replacement of the global operator new / delete counting every heap allocation
+    in the AllocationCounter of the calling thread.
+
+    It is meant for tests and benchmarks : include this header in exactly ONE translation
+    unit of the program ( the one defining main ), the replacement then applies to the
+    whole program, standard library included. Memory still comes from malloc / free,
+    direct calls to malloc are not counted.
+*/
+
+#include <AllocationCounter.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    void * CountedAllocate(std::size_t iSize)
+    {
+        exchange::common::AllocationCounter::OnAllocation(iSize);
+
+        if (iSize == 0)
+        {
+            iSize = 1;
+        }
+
+        while (true)
+        {
+            if (void * pMemory = std::malloc(iSize))
+            {
+                return pMemory;
+            }
+
+            auto Handler = std::get_new_handler();
+            if (Handler == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            Handler();
+        }
+    }
+
+    void CountedDeallocate(void * pMemory) noexcept
+    {
+        if (pMemory != nullptr)
+        {
+            exchange::common::AllocationCounter::OnDeallocation();
+            std::free(pMemory);
+        }
+    }
+}
+
+void * operator new(std::size_t iSize)
+{
+    return CountedAllocate(iSize);
+}
+
+void * operator new[](std::size_t iSize)
+{
+    return CountedAllocate(iSize);
+}
+
+void * operator new(std::size_t iSize, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return CountedAllocate(iSize);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void * operator new[](std::size_t iSize, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return CountedAllocate(iSize);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void * pMemory) noexcept
+{
+    CountedDeallocate(pMemory);
+}
+
+void operator delete[](void * pMemory) noexcept
+{
+    CountedDeallocate(pMemory);
+}
+
+void operator delete(void * pMemory, std::size_t) noexcept
+{
+    CountedDeallocate(pMemory);
+}
+
+void operator delete[](void * pMemory, std::size_t) noexcept
+{
+    CountedDeallocate(pMemory);
+}
+
+void operator delete(void * pMemory, const std::nothrow_t &) noexcept
+{
+    CountedDeallocate(pMemory);
+}
+
+void operator delete[](void * pMemory, const std::nothrow_t &) noexcept
+{
+    CountedDeallocate(pMemory);
+}
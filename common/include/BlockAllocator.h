@@ -0,0 +1,60 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        /* Pages obtained for the blocks of a pool */
+        enum class BlockBacking : std::uint8_t
+        {
+            HEAP = 0,
+            HUGE_TLB,
+            TRANSPARENT_HUGE_PAGES,
+            SMALL_PAGES
+        };
+
+        const char * BlockBackingToString(BlockBacking iBacking);
+
+        /*!
+        *  \brief HeapBlockAllocator
+        *
+        *  Default MemoryPool backing : each block comes from operator new.
+        */
+        struct HeapBlockAllocator
+        {
+            static void * Allocate(std::size_t iSize) { return ::operator new(iSize); }
+
+            static void Release(void * pBlock, std::size_t /* iSize */) noexcept { ::operator delete(pBlock); }
+        };
+
+        /*!
+        *  \brief MappedBlockAllocator
+        *
+        *  MemoryPool backing mapping each block with mmap. Blocks whose size is a multiple of
+        *  HugePageSize are first asked to the hugetlb pool ( MAP_HUGETLB ), then mapped with
+        *  small pages and advised for transparent huge pages. Any other size gets small pages.
+        *  Mapped pages are only faulted on first touch, see MemoryPool::reserve.
+        */
+        struct MappedBlockAllocator
+        {
+            static constexpr std::size_t HugePageSize = 2 * 1024 * 1024;
+
+            static void * Allocate(std::size_t iSize);
+
+            static void Release(void * pBlock, std::size_t iSize) noexcept;
+
+            /* Blocks mapped with each backing since the start of the program, all pools included */
+            static std::uint64_t GetBlockCount(BlockBacking iBacking);
+        };
+
+    }
+}
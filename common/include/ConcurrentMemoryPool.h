@@ -0,0 +1,295 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace exchange
+{
+    namespace common
+    {
+        namespace detail
+        {
+            /* Free slots are chained through their first word, the first slot of a batch also holds the batch header */
+            struct PoolSlot
+            {
+                PoolSlot * Next;
+            };
+
+            struct PoolBatch
+            {
+                PoolSlot *   Next;
+                PoolBatch *  NextBatch;
+                std::size_t  Count;
+            };
+
+            /* Per thread cache : the magazine in use and the batches taken from the shared stack */
+            struct PoolThreadCache
+            {
+                PoolSlot *   Head;
+                std::size_t  Count;
+                PoolBatch *  Batches;
+                std::size_t  BatchSlots;
+                bool         Released;
+            };
+        }
+
+        /*!
+        *  \brief ConcurrentMemoryPool
+        *
+        *  Slots of one size shared by all the threads, meant for objects allocated on one thread
+        *  and released on another one. The gateway runs its sessions and the engine on a single thread :
+        *  today only the uncross pool threads release orders created elsewhere, the pool is ready for
+        *  gateway I/O threads.
+        *
+        *  Each thread allocates from and releases to its own magazine. A thread holding more than
+        *  two magazines of released slots publishes one of them as a batch on a lock-free stack,
+        *  a thread with an empty magazine takes every published batch at once ( exchange, no ABA ).
+        *  New blocks are only carved when no batch is available. Blocks are never given back to the
+        *  heap : the pool lives as long as the program.
+        */
+        template <typename T, std::size_t MagazineSize = 64>
+        class ConcurrentMemoryPool
+        {
+            static_assert(MagazineSize > 0, "MagazineSize must be positive");
+
+            using Slot  = detail::PoolSlot;
+            using Batch = detail::PoolBatch;
+            using Cache = detail::PoolThreadCache;
+
+            public:
+
+                static constexpr std::size_t SlotAlignment = alignof(T) > alignof(Batch) ? alignof(T) : alignof(Batch);
+                static constexpr std::size_t SlotSize      = ((sizeof(T) > sizeof(Batch) ? sizeof(T) : sizeof(Batch)) + SlotAlignment - 1) / SlotAlignment * SlotAlignment;
+                static constexpr std::size_t BlockSlots    = 16 * MagazineSize;
+
+                static_assert(SlotAlignment <= alignof(std::max_align_t), "Over aligned types are not supported");
+
+            public:
+
+                static void * Allocate()
+                {
+                    auto & rCache = GetCache();
+                    if (rCache.Head == nullptr && !Refill(rCache))
+                    {
+                        // Thread exit : the cache was already handed back
+                        return ::operator new(SlotSize);
+                    }
+
+                    Slot * pSlot = rCache.Head;
+                    rCache.Head = pSlot->Next;
+                    --rCache.Count;
+                    return pSlot;
+                }
+
+                static void Deallocate(void * pMemory) noexcept
+                {
+                    if (pMemory == nullptr)
+                    {
+                        return;
+                    }
+
+                    auto & rCache = GetCache();
+                    auto pSlot = static_cast<Slot *>(pMemory);
+
+                    if (rCache.Released)
+                    {
+                        Publish(MakeBatch(pSlot, pSlot, 1));
+                        return;
+                    }
+
+                    Register();
+                    pSlot->Next = rCache.Head;
+                    rCache.Head = pSlot;
+
+                    if (++rCache.Count >= 2 * MagazineSize)
+                    {
+                        PublishMagazine(rCache);
+                    }
+                }
+
+                /* Slots carved from the blocks, all threads included */
+                static std::size_t GetCapacity() { return GetShared().Capacity.load(std::memory_order_relaxed); }
+
+                /* Free slots kept by the calling thread */
+                static std::size_t GetThreadCachedCount()
+                {
+                    const auto & rCache = GetCache();
+                    return rCache.Count + rCache.BatchSlots;
+                }
+
+            private:
+
+                struct Shared
+                {
+                    std::atomic<Batch *>     Batches { nullptr };
+                    std::atomic<std::size_t> Capacity { 0 };
+                    std::mutex               BlocksMutex;
+                    std::vector<void *>      Blocks;
+                };
+
+                struct Releaser
+                {
+                    ~Releaser()
+                    {
+                        auto & rCache = GetCache();
+                        rCache.Released = true;
+
+                        if (rCache.Head != nullptr)
+                        {
+                            Slot * pLast = rCache.Head;
+                            while (pLast->Next != nullptr)
+                            {
+                                pLast = pLast->Next;
+                            }
+                            Publish(MakeBatch(rCache.Head, pLast, rCache.Count));
+                        }
+
+                        while (rCache.Batches != nullptr)
+                        {
+                            Batch * pBatch = rCache.Batches;
+                            rCache.Batches = pBatch->NextBatch;
+                            Publish(pBatch);
+                        }
+
+                        rCache.Head       = nullptr;
+                        rCache.Count      = 0;
+                        rCache.BatchSlots = 0;
+                    }
+                };
+
+                /* Never destroyed : slots may still be released by other threads during the program exit */
+                static Shared & GetShared()
+                {
+                    static Shared * s_pShared = new Shared();
+                    return *s_pShared;
+                }
+
+                static Cache & GetCache()
+                {
+                    static thread_local Cache s_Cache = { nullptr, 0, nullptr, 0, false };
+                    return s_Cache;
+                }
+
+                /* The releaser is built once per thread, the first time the thread touches the pool */
+                static void Register()
+                {
+                    static thread_local Releaser s_Releaser;
+                    (void)s_Releaser;
+                }
+
+                /* The chain pFirst .. pLast becomes a batch, its header lives in the first slot */
+                static Batch * MakeBatch(Slot * pFirst, Slot * pLast, std::size_t iCount)
+                {
+                    pLast->Next = nullptr;
+
+                    Slot * pNext = pFirst->Next;
+                    auto pBatch = reinterpret_cast<Batch *>(pFirst);
+                    pBatch->Next      = pNext;
+                    pBatch->NextBatch = nullptr;
+                    pBatch->Count     = iCount;
+                    return pBatch;
+                }
+
+                static void Publish(Batch * pBatch)
+                {
+                    auto & rBatches = GetShared().Batches;
+
+                    Batch * pHead = rBatches.load(std::memory_order_relaxed);
+                    do
+                    {
+                        pBatch->NextBatch = pHead;
+                    } while (!rBatches.compare_exchange_weak(pHead, pBatch, std::memory_order_release, std::memory_order_relaxed));
+                }
+
+                /* Keep one magazine, the other one is published */
+                static void PublishMagazine(Cache & rCache)
+                {
+                    Slot * pFirst = rCache.Head;
+                    Slot * pLast  = pFirst;
+                    for (std::size_t i = 1; i < MagazineSize; ++i)
+                    {
+                        pLast = pLast->Next;
+                    }
+
+                    rCache.Head   = pLast->Next;
+                    rCache.Count -= MagazineSize;
+
+                    Publish(MakeBatch(pFirst, pLast, MagazineSize));
+                }
+
+                /* Load the next batch in the magazine */
+                static void UseBatch(Cache & rCache)
+                {
+                    Batch * pBatch = rCache.Batches;
+                    rCache.Batches     = pBatch->NextBatch;
+                    rCache.BatchSlots -= pBatch->Count;
+
+                    // The header slot is handed out like any other slot
+                    auto pSlot  = reinterpret_cast<Slot *>(pBatch);
+                    pSlot->Next = pBatch->Next;
+
+                    rCache.Head  = pSlot;
+                    rCache.Count = pBatch->Count;
+                }
+
+                static bool Refill(Cache & rCache)
+                {
+                    if (rCache.Released)
+                    {
+                        return false;
+                    }
+                    Register();
+
+                    if (rCache.Batches == nullptr)
+                    {
+                        Batch * pBatches = GetShared().Batches.exchange(nullptr, std::memory_order_acquire);
+                        rCache.Batches = pBatches;
+                        for (Batch * pBatch = pBatches; pBatch != nullptr; pBatch = pBatch->NextBatch)
+                        {
+                            rCache.BatchSlots += pBatch->Count;
+                        }
+                    }
+
+                    if (rCache.Batches != nullptr)
+                    {
+                        UseBatch(rCache);
+                    }
+                    else
+                    {
+                        Carve(rCache);
+                    }
+                    return true;
+                }
+
+                static void Carve(Cache & rCache)
+                {
+                    auto pBlock = static_cast<char *>(::operator new(BlockSlots * SlotSize));
+
+                    auto & rShared = GetShared();
+                    {
+                        std::lock_guard<std::mutex> Lock(rShared.BlocksMutex);
+                        rShared.Blocks.push_back(pBlock);
+                    }
+                    rShared.Capacity.fetch_add(BlockSlots, std::memory_order_relaxed);
+
+                    // Chained in address order
+                    for (std::size_t i = BlockSlots; i > 0; --i)
+                    {
+                        auto pSlot  = reinterpret_cast<Slot *>(pBlock + (i - 1) * SlotSize);
+                        pSlot->Next = rCache.Head;
+                        rCache.Head = pSlot;
+                    }
+                    rCache.Count += BlockSlots;
+                }
+        };
+
+    }
+}
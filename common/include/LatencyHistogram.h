@@ -0,0 +1,170 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        /*!
+        *  \brief LatencyHistogram
+        *
+        *  Log-linear histogram ( HDR style ). Values are recorded in constant time,
+        *  each power of two range is split in 64 buckets so the reported values keep
+        *  a relative error below 1/64 whatever their magnitude.
+        */
+        class LatencyHistogram
+        {
+            public:
+
+                using value_type = std::uint64_t;
+
+            public:
+
+                LatencyHistogram()
+                    :m_Counts(BucketCount, 0)
+                {}
+
+                /**/
+                inline void Record(value_type iValue);
+
+                /**/
+                inline void Merge(const LatencyHistogram & iOther);
+
+                /**/
+                inline void Reset();
+
+                /* Highest value equivalent to the one found at iPercentile ( 0 to 100 ) */
+                inline value_type GetValueAtPercentile(double iPercentile) const;
+
+            public:
+
+                inline std::uint64_t GetCount() const { return m_Count; }
+                inline value_type    GetMin() const { return m_Count ? m_Min : 0; }
+                inline value_type    GetMax() const { return m_Max; }
+                inline double        GetMean() const { return m_Count ? m_Sum / m_Count : 0.0; }
+
+            private:
+
+                static constexpr unsigned SubBucketBits      = 7;
+                static constexpr unsigned SubBucketCount     = 1u << SubBucketBits;
+                static constexpr unsigned SubBucketHalfCount = SubBucketCount / 2;
+                static constexpr unsigned BucketCount        = SubBucketCount + (64 - SubBucketBits) * SubBucketHalfCount;
+
+                static inline unsigned MostSignificantBit(value_type iValue);
+                static inline size_t   GetIndex(value_type iValue);
+                static inline value_type GetHighestEquivalentValue(size_t iIndex);
+
+            private:
+                std::vector<std::uint64_t> m_Counts;
+                std::uint64_t              m_Count = 0;
+                value_type                 m_Min   = (std::numeric_limits<value_type>::max)();
+                value_type                 m_Max   = 0;
+                double                     m_Sum   = 0.0;
+        };
+
+        inline unsigned LatencyHistogram::MostSignificantBit(value_type iValue)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return 63 - __builtin_clzll(iValue);
+#else
+            unsigned Msb = 0;
+            while (iValue >>= 1)
+            {
+                ++Msb;
+            }
+            return Msb;
+#endif
+        }
+
+        inline size_t LatencyHistogram::GetIndex(value_type iValue)
+        {
+            if (iValue < SubBucketCount)
+            {
+                return static_cast<size_t>(iValue);
+            }
+
+            // Keep the SubBucketBits most significant bits of the value
+            const unsigned Shift = MostSignificantBit(iValue) - (SubBucketBits - 1);
+            const auto     SubBucket = static_cast<unsigned>(iValue >> Shift);
+
+            return SubBucketCount + (Shift - 1) * SubBucketHalfCount + (SubBucket - SubBucketHalfCount);
+        }
+
+        inline LatencyHistogram::value_type LatencyHistogram::GetHighestEquivalentValue(size_t iIndex)
+        {
+            if (iIndex < SubBucketCount)
+            {
+                return static_cast<value_type>(iIndex);
+            }
+
+            const auto Shift     = static_cast<unsigned>((iIndex - SubBucketCount) / SubBucketHalfCount + 1);
+            const auto SubBucket = static_cast<value_type>((iIndex - SubBucketCount) % SubBucketHalfCount + SubBucketHalfCount);
+
+            return ((SubBucket + 1) << Shift) - 1;
+        }
+
+        inline void LatencyHistogram::Record(value_type iValue)
+        {
+            ++m_Counts[GetIndex(iValue)];
+            ++m_Count;
+            m_Min  = (std::min)(m_Min, iValue);
+            m_Max  = (std::max)(m_Max, iValue);
+            m_Sum += static_cast<double>(iValue);
+        }
+
+        inline void LatencyHistogram::Merge(const LatencyHistogram & iOther)
+        {
+            for (size_t i = 0; i < BucketCount; ++i)
+            {
+                m_Counts[i] += iOther.m_Counts[i];
+            }
+            m_Count += iOther.m_Count;
+            m_Min    = (std::min)(m_Min, iOther.m_Min);
+            m_Max    = (std::max)(m_Max, iOther.m_Max);
+            m_Sum   += iOther.m_Sum;
+        }
+
+        inline void LatencyHistogram::Reset()
+        {
+            std::fill(m_Counts.begin(), m_Counts.end(), 0);
+            m_Count = 0;
+            m_Min   = (std::numeric_limits<value_type>::max)();
+            m_Max   = 0;
+            m_Sum   = 0.0;
+        }
+
+        inline LatencyHistogram::value_type LatencyHistogram::GetValueAtPercentile(double iPercentile) const
+        {
+            if (m_Count == 0)
+            {
+                return 0;
+            }
+
+            const auto Percentile = (std::min)((std::max)(iPercentile, 0.0), 100.0);
+            const auto Target     = (std::max)(static_cast<std::uint64_t>(std::ceil(Percentile / 100.0 * m_Count)), std::uint64_t(1));
+
+            std::uint64_t Total = 0;
+            for (size_t i = 0; i < BucketCount; ++i)
+            {
+                Total += m_Counts[i];
+                if (Total >= Target)
+                {
+                    return (std::min)(GetHighestEquivalentValue(i), m_Max);
+                }
+            }
+            return m_Max;
+        }
+
+    }
+}
@@ -0,0 +1,223 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <LatencyHistogram.h>
+#include <SpscRing.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iosfwd>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace exchange
+{
+    namespace common
+    {
+
+        /*!
+         * TraceStage
+         *
+         * Boundaries crossed by an order from the socket to the end of its processing
+         */
+        enum class TraceStage : std::uint8_t
+        {
+            SOCKET_READ = 0,
+            PARSED,
+            ENGINE_ENTRY,
+            MATCHED,
+            ENGINE_EXIT,
+            MAX_STAGE
+        };
+
+        const char * TraceStageToString(TraceStage iStage);
+
+        /* Time stamp counter, steady clock nanoseconds where it is not available */
+        inline std::uint64_t ReadTimestampCounter()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        /* Stamps of one traced order, 0 when the stage has not been crossed */
+        struct LatencyTraceRecord
+        {
+            std::uint64_t Stamps[static_cast<size_t>(TraceStage::MAX_STAGE)] = {};
+        };
+
+        /*!
+        *  \brief LatencyTracer
+        *
+        *  Producer side of the tracing, used by the engine thread only.
+        *  One order out of SampleRate is traced, its stamps are published to a lock-free ring
+        *  consumed by LatencyTraceAggregator.
+        */
+        class LatencyTracer
+        {
+            public:
+
+                using ring_type = SpscRing<LatencyTraceRecord, 16384>;
+
+            public:
+
+                /* A sample rate of 0 disables the tracing */
+                explicit LatencyTracer(std::uint32_t iSampleRate)
+                    :m_pRing(std::make_unique<ring_type>()), m_SampleRate(iSampleRate), m_Countdown(iSampleRate)
+                {}
+
+                ~LatencyTracer()
+                {
+                    if (Active() == &m_Current)
+                    {
+                        Active() = nullptr;
+                    }
+                }
+
+                LatencyTracer(const LatencyTracer &) = delete;
+                LatencyTracer & operator=(const LatencyTracer &) = delete;
+
+                /* Start the trace of an order read at iReadStamp if it is sampled */
+                inline bool Begin(std::uint64_t iReadStamp);
+
+                /* Stamp the trace active on the calling thread, if any */
+                static inline void Stamp(TraceStage iStage);
+
+                /* Publish the active trace if the order reached the engine */
+                inline void End();
+
+                ring_type &   GetRing() { return *m_pRing; }
+                std::uint64_t GetDroppedCounter() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+            private:
+
+                static inline LatencyTraceRecord *& Active()
+                {
+                    static thread_local LatencyTraceRecord * s_pActive = nullptr;
+                    return s_pActive;
+                }
+
+            private:
+                std::unique_ptr<ring_type>  m_pRing;
+                LatencyTraceRecord          m_Current;
+                std::uint32_t               m_SampleRate;
+                std::uint32_t               m_Countdown;
+                std::atomic<std::uint64_t>  m_Dropped { 0 };
+        };
+
+        inline bool LatencyTracer::Begin(std::uint64_t iReadStamp)
+        {
+            if (m_SampleRate == 0 || --m_Countdown != 0)
+            {
+                return false;
+            }
+            m_Countdown = m_SampleRate;
+
+            m_Current = LatencyTraceRecord();
+            m_Current.Stamps[static_cast<size_t>(TraceStage::SOCKET_READ)] = iReadStamp;
+            Active() = &m_Current;
+            return true;
+        }
+
+        inline void LatencyTracer::Stamp(TraceStage iStage)
+        {
+            if (auto pRecord = Active())
+            {
+                pRecord->Stamps[static_cast<size_t>(iStage)] = ReadTimestampCounter();
+            }
+        }
+
+        inline void LatencyTracer::End()
+        {
+            Active() = nullptr;
+
+            if (m_Current.Stamps[static_cast<size_t>(TraceStage::ENGINE_ENTRY)] == 0)
+            {
+                return;
+            }
+
+            if (!m_pRing->TryPush(m_Current))
+            {
+                m_Dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        /*!
+        *  \brief LatencyTraceAggregator
+        *
+        *  Consumer side of the tracing. A background thread drains the ring into one histogram
+        *  per stage ( time spent since the previous stamped stage, in nanoseconds ) and writes them
+        *  to the dump file every dump interval or when a dump is requested.
+        */
+        class LatencyTraceAggregator
+        {
+            public:
+
+                LatencyTraceAggregator(LatencyTracer & rTracer, std::string iDumpFile, std::chrono::seconds iDumpInterval);
+                ~LatencyTraceAggregator();
+
+                LatencyTraceAggregator(const LatencyTraceAggregator &) = delete;
+                LatencyTraceAggregator & operator=(const LatencyTraceAggregator &) = delete;
+
+            public:
+
+                /**/
+                void Start();
+
+                /**/
+                void Stop();
+
+                /* Only sets a flag, can be called from a signal handler */
+                void RequestDump() { m_bDumpRequested.store(true, std::memory_order_relaxed); }
+
+                /* Consume the pending traces on the calling thread, when the background thread is not running */
+                void Drain();
+
+                /**/
+                void Dump(std::ostream & oss) const;
+
+                /**/
+                LatencyHistogram GetStageLatencies(TraceStage iStage) const;
+
+                /**/
+                std::uint64_t GetTraceCounter() const;
+
+                double GetTicksPerNanosecond() const { return m_TicksPerNanosecond; }
+
+            private:
+
+                void Run();
+                void Aggregate(const LatencyTraceRecord & iRecord);
+                void WriteDumpFile() const;
+
+            private:
+                LatencyTracer &                 m_rTracer;
+                std::string                     m_DumpFile;
+                std::chrono::seconds            m_DumpInterval;
+                double                          m_TicksPerNanosecond = 1.0;
+
+                mutable std::mutex              m_Mutex;
+                std::vector<LatencyHistogram>   m_Stages;
+                LatencyHistogram                m_Total;
+
+                std::thread                     m_Thread;
+                std::atomic<bool>               m_bRunning { false };
+                std::atomic<bool>               m_bDumpRequested { false };
+        };
+
+    }
+}
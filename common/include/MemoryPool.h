@@ -25,7 +25,13 @@
 #include <climits>
 #include <cstddef>
 
-template <typename T, size_t BlockSize = 4096>
+#include <BlockAllocator.h>
+
+/*
+ * BlockAllocator provides the blocks : static Allocate(size) and Release(block, size),
+ * see exchange::common::HeapBlockAllocator and MappedBlockAllocator.
+ */
+template <typename T, size_t BlockSize = 4096, typename BlockAllocator = exchange::common::HeapBlockAllocator>
 class MemoryPool
 {
   public:
@@ -42,14 +48,14 @@ class MemoryPool
     typedef std::true_type  propagate_on_container_swap;
 
     template <typename U> struct rebind {
-      typedef MemoryPool<U> other;
+      typedef MemoryPool<U, BlockSize, BlockAllocator> other;
     };
 
     /* Member functions */
     MemoryPool() noexcept;
     MemoryPool(const MemoryPool& memoryPool) noexcept;
     MemoryPool(MemoryPool&& memoryPool) noexcept;
-    template <class U> MemoryPool(const MemoryPool<U>& memoryPool) noexcept;
+    template <class U> MemoryPool(const MemoryPool<U, BlockSize, BlockAllocator>& memoryPool) noexcept;
 
     ~MemoryPool() noexcept;
 
@@ -65,6 +71,16 @@ class MemoryPool
 
     size_type max_size() const noexcept;
 
+    // Number of elements currently allocated from the pool
+    size_type used() const noexcept { return usedSlots_; }
+
+    // Number of slots of the blocks obtained so far, and how many of them are not allocated
+    size_type capacity() const noexcept { return capacitySlots_; }
+    size_type available() const noexcept { return capacitySlots_ - usedSlots_; }
+
+    // Touch and keep n free slots : the next n allocations neither get a block nor page fault
+    void reserve(size_type n);
+
     template <class U, class... Args> void construct(U* p, Args&&... args);
     template <class U> void destroy(U* p);
 
@@ -85,6 +101,9 @@ class MemoryPool
     slot_pointer_ currentSlot_;
     slot_pointer_ lastSlot_;
     slot_pointer_ freeSlots_;
+    size_type usedSlots_;
+    size_type freeSlotCount_;
+    size_type capacitySlots_;
 
     size_type padPointer(data_pointer_ p, size_type align) const noexcept;
     void allocateBlock();
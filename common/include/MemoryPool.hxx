@@ -23,9 +23,9 @@
 
 #pragma once
 
-template <typename T, size_t BlockSize>
-inline typename MemoryPool<T, BlockSize>::size_type
-MemoryPool<T, BlockSize>::padPointer(data_pointer_ p, size_type align)
+template <typename T, size_t BlockSize, typename BlockAllocator>
+inline typename MemoryPool<T, BlockSize, BlockAllocator>::size_type
+MemoryPool<T, BlockSize, BlockAllocator>::padPointer(data_pointer_ p, size_type align)
 const noexcept
 {
   uintptr_t result = reinterpret_cast<uintptr_t>(p);
@@ -34,50 +34,56 @@ const noexcept
 
 
 
-template <typename T, size_t BlockSize>
-MemoryPool<T, BlockSize>::MemoryPool()
+template <typename T, size_t BlockSize, typename BlockAllocator>
+MemoryPool<T, BlockSize, BlockAllocator>::MemoryPool()
 noexcept
 {
   currentBlock_ = nullptr;
   currentSlot_ = nullptr;
   lastSlot_ = nullptr;
   freeSlots_ = nullptr;
+  usedSlots_ = 0;
+  freeSlotCount_ = 0;
+  capacitySlots_ = 0;
 }
 
 
 
-template <typename T, size_t BlockSize>
-MemoryPool<T, BlockSize>::MemoryPool(const MemoryPool& memoryPool)
+template <typename T, size_t BlockSize, typename BlockAllocator>
+MemoryPool<T, BlockSize, BlockAllocator>::MemoryPool(const MemoryPool& memoryPool)
 noexcept :
 MemoryPool()
 {}
 
 
 
-template <typename T, size_t BlockSize>
-MemoryPool<T, BlockSize>::MemoryPool(MemoryPool&& memoryPool)
+template <typename T, size_t BlockSize, typename BlockAllocator>
+MemoryPool<T, BlockSize, BlockAllocator>::MemoryPool(MemoryPool&& memoryPool)
 noexcept
 {
   currentBlock_ = memoryPool.currentBlock_;
   memoryPool.currentBlock_ = nullptr;
   currentSlot_ = memoryPool.currentSlot_;
   lastSlot_ = memoryPool.lastSlot_;
-  freeSlots_ = memoryPool.freeSlots;
+  freeSlots_ = memoryPool.freeSlots_;
+  usedSlots_ = memoryPool.usedSlots_;
+  freeSlotCount_ = memoryPool.freeSlotCount_;
+  capacitySlots_ = memoryPool.capacitySlots_;
 }
 
 
-template <typename T, size_t BlockSize>
+template <typename T, size_t BlockSize, typename BlockAllocator>
 template<class U>
-MemoryPool<T, BlockSize>::MemoryPool(const MemoryPool<U>& memoryPool)
+MemoryPool<T, BlockSize, BlockAllocator>::MemoryPool(const MemoryPool<U, BlockSize, BlockAllocator>& memoryPool)
 noexcept :
 MemoryPool()
 {}
 
 
 
-template <typename T, size_t BlockSize>
-MemoryPool<T, BlockSize>&
-MemoryPool<T, BlockSize>::operator=(MemoryPool&& memoryPool)
+template <typename T, size_t BlockSize, typename BlockAllocator>
+MemoryPool<T, BlockSize, BlockAllocator>&
+MemoryPool<T, BlockSize, BlockAllocator>::operator=(MemoryPool&& memoryPool)
 noexcept
 {
   if (this != &memoryPool)
@@ -85,30 +91,33 @@ noexcept
     std::swap(currentBlock_, memoryPool.currentBlock_);
     currentSlot_ = memoryPool.currentSlot_;
     lastSlot_ = memoryPool.lastSlot_;
-    freeSlots_ = memoryPool.freeSlots;
+    freeSlots_ = memoryPool.freeSlots_;
+    usedSlots_ = memoryPool.usedSlots_;
+    freeSlotCount_ = memoryPool.freeSlotCount_;
+    capacitySlots_ = memoryPool.capacitySlots_;
   }
   return *this;
 }
 
 
 
-template <typename T, size_t BlockSize>
-MemoryPool<T, BlockSize>::~MemoryPool()
+template <typename T, size_t BlockSize, typename BlockAllocator>
+MemoryPool<T, BlockSize, BlockAllocator>::~MemoryPool()
 noexcept
 {
   slot_pointer_ curr = currentBlock_;
   while (curr != nullptr) {
     slot_pointer_ prev = curr->next;
-    operator delete(reinterpret_cast<void*>(curr));
+    BlockAllocator::Release(reinterpret_cast<void*>(curr), BlockSize);
     curr = prev;
   }
 }
 
 
 
-template <typename T, size_t BlockSize>
-inline typename MemoryPool<T, BlockSize>::pointer
-MemoryPool<T, BlockSize>::address(reference x)
+template <typename T, size_t BlockSize, typename BlockAllocator>
+inline typename MemoryPool<T, BlockSize, BlockAllocator>::pointer
+MemoryPool<T, BlockSize, BlockAllocator>::address(reference x)
 const noexcept
 {
   return &x;
@@ -116,9 +125,9 @@ const noexcept
 
 
 
-template <typename T, size_t BlockSize>
-inline typename MemoryPool<T, BlockSize>::const_pointer
-MemoryPool<T, BlockSize>::address(const_reference x)
+template <typename T, size_t BlockSize, typename BlockAllocator>
+inline typename MemoryPool<T, BlockSize, BlockAllocator>::const_pointer
+MemoryPool<T, BlockSize, BlockAllocator>::address(const_reference x)
 const noexcept
 {
   return &x;
@@ -126,13 +135,13 @@ const noexcept
 
 
 
-template <typename T, size_t BlockSize>
+template <typename T, size_t BlockSize, typename BlockAllocator>
 void
-MemoryPool<T, BlockSize>::allocateBlock()
+MemoryPool<T, BlockSize, BlockAllocator>::allocateBlock()
 {
   // Allocate space for the new block and store a pointer to the previous one
   data_pointer_ newBlock = reinterpret_cast<data_pointer_>
-                           (operator new(BlockSize));
+                           (BlockAllocator::Allocate(BlockSize));
   reinterpret_cast<slot_pointer_>(newBlock)->next = currentBlock_;
   currentBlock_ = reinterpret_cast<slot_pointer_>(newBlock);
   // Pad block body to staisfy the alignment requirements for elements
@@ -141,17 +150,20 @@ MemoryPool<T, BlockSize>::allocateBlock()
   currentSlot_ = reinterpret_cast<slot_pointer_>(body + bodyPadding);
   lastSlot_ = reinterpret_cast<slot_pointer_>
               (newBlock + BlockSize - sizeof(slot_type_) + 1);
+  capacitySlots_ += (BlockSize - sizeof(slot_pointer_) - bodyPadding) / sizeof(slot_type_);
 }
 
 
 
-template <typename T, size_t BlockSize>
-inline typename MemoryPool<T, BlockSize>::pointer
-MemoryPool<T, BlockSize>::allocate(size_type /* n */, const_pointer /* hint */)
+template <typename T, size_t BlockSize, typename BlockAllocator>
+inline typename MemoryPool<T, BlockSize, BlockAllocator>::pointer
+MemoryPool<T, BlockSize, BlockAllocator>::allocate(size_type /* n */, const_pointer /* hint */)
 {
+  ++usedSlots_;
   if (freeSlots_ != nullptr) {
     pointer result = reinterpret_cast<pointer>(freeSlots_);
     freeSlots_ = freeSlots_->next;
+    --freeSlotCount_;
     return result;
   }
   else {
@@ -161,11 +173,13 @@ MemoryPool<T, BlockSize>::allocate(size_type /* n */, const_pointer /* hint */)
   }
 }
 
-template <typename T, size_t BlockSize>
+template <typename T, size_t BlockSize, typename BlockAllocator>
 inline void
-MemoryPool<T, BlockSize>::deallocate(pointer p, size_type /* n */)
+MemoryPool<T, BlockSize, BlockAllocator>::deallocate(pointer p, size_type /* n */)
 {
   if (p != nullptr) {
+    --usedSlots_;
+    ++freeSlotCount_;
     reinterpret_cast<slot_pointer_>(p)->next = freeSlots_;
     freeSlots_ = reinterpret_cast<slot_pointer_>(p);
   }
@@ -173,9 +187,26 @@ MemoryPool<T, BlockSize>::deallocate(pointer p, size_type /* n */)
 
 
 
-template <typename T, size_t BlockSize>
-inline typename MemoryPool<T, BlockSize>::size_type
-MemoryPool<T, BlockSize>::max_size()
+template <typename T, size_t BlockSize, typename BlockAllocator>
+void
+MemoryPool<T, BlockSize, BlockAllocator>::reserve(size_type n)
+{
+  // Slots taken from the blocks are written once, which faults their pages, then kept on the free list
+  while (freeSlotCount_ < n) {
+    if (currentSlot_ >= lastSlot_)
+      allocateBlock();
+    slot_pointer_ slot = currentSlot_++;
+    slot->next = freeSlots_;
+    freeSlots_ = slot;
+    ++freeSlotCount_;
+  }
+}
+
+
+
+template <typename T, size_t BlockSize, typename BlockAllocator>
+inline typename MemoryPool<T, BlockSize, BlockAllocator>::size_type
+MemoryPool<T, BlockSize, BlockAllocator>::max_size()
 const noexcept
 {
   size_type maxBlocks = -1 / BlockSize;
@@ -184,30 +215,30 @@ const noexcept
 
 
 
-template <typename T, size_t BlockSize>
+template <typename T, size_t BlockSize, typename BlockAllocator>
 template <class U, class... Args>
 inline void
-MemoryPool<T, BlockSize>::construct(U* p, Args&&... args)
+MemoryPool<T, BlockSize, BlockAllocator>::construct(U* p, Args&&... args)
 {
   new (p) U (std::forward<Args>(args)...);
 }
 
 
 
-template <typename T, size_t BlockSize>
+template <typename T, size_t BlockSize, typename BlockAllocator>
 template <class U>
 inline void
-MemoryPool<T, BlockSize>::destroy(U* p)
+MemoryPool<T, BlockSize, BlockAllocator>::destroy(U* p)
 {
   p->~U();
 }
 
 
 
-template <typename T, size_t BlockSize>
+template <typename T, size_t BlockSize, typename BlockAllocator>
 template <class... Args>
-inline typename MemoryPool<T, BlockSize>::pointer
-MemoryPool<T, BlockSize>::newElement(Args&&... args)
+inline typename MemoryPool<T, BlockSize, BlockAllocator>::pointer
+MemoryPool<T, BlockSize, BlockAllocator>::newElement(Args&&... args)
 {
   pointer result = allocate();
   construct<value_type>(result, std::forward<Args>(args)...);
@@ -216,9 +247,9 @@ MemoryPool<T, BlockSize>::newElement(Args&&... args)
 
 
 
-template <typename T, size_t BlockSize>
+template <typename T, size_t BlockSize, typename BlockAllocator>
 inline void
-MemoryPool<T, BlockSize>::deleteElement(pointer p)
+MemoryPool<T, BlockSize, BlockAllocator>::deleteElement(pointer p)
 {
   if (p != nullptr) {
     p->~value_type();
@@ -3,23 +3,31 @@
 #include <leveldb/db.h>
 
 #include <Logger.h>
+#include <StorageSerializer.h>
 
+#include <algorithm>
+#include <future>
+#include <iterator>
 #include <string>
-
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
+#include <utility>
+#include <vector>
 
 namespace exchange
 {
     namespace common
     {
 
-        template <typename ObjectType, typename UnderlyingStorage>
+        /*
+            Objects are written with the Serializer policy. Records of another format ( text archives of the
+            databases written before BinarySerializer ) are read as text archives and rewritten with the policy.
+        */
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer = BinarySerializer<ObjectType> >
         class NoSqlStorage
         {
         public:
 
-            using key_type = typename UnderlyingStorage::key_type;
+            using key_type        = typename UnderlyingStorage::key_type;
+            using serializer_type = Serializer;
 
         public:
 
@@ -35,48 +43,120 @@ namespace exchange
             template <typename TCallback>
             bool Load(const TCallback & callback);
 
+            /* Read every record, then decode them with up to threads threads. objects is in key order */
+            bool LoadAll(std::vector<ObjectType> & objects, unsigned threads);
+
             bool Get(const std::string & key, ObjectType & object);
 
             template <typename TKeyExtractor>
             bool Write(const ObjectType & object, const TKeyExtractor & extractor, bool bSync = true, bool overwrite = false);
 
+            /* Write [first, last) with a single batch, existing records are overwritten */
+            template <typename TIterator, typename TKeyExtractor>
+            bool WriteBatch(TIterator first, TIterator last, const TKeyExtractor & extractor, bool bSync = true);
+
+            /* Same without logging, the failure reason is returned in error_msg ( callers running off the engine thread ) */
+            template <typename TIterator, typename TKeyExtractor>
+            bool WriteBatch(TIterator first, TIterator last, const TKeyExtractor & extractor, bool bSync, std::string & error_msg);
+
+            /* Records converted to the Serializer format by Load and Get */
+            std::size_t GetMigratedCounter() const { return m_MigratedCounter; }
+
         protected:
 
             bool InitializeDB();
+            bool InitializeDB(std::string & error_msg);
+
+            /* oMigrated is set when the record is not in the Serializer format */
+            bool Decode(const char * data, std::size_t size, ObjectType & object, bool & oMigrated);
+
+            /* Rewrite the migrated records, synced once */
+            bool Migrate(const std::vector<std::pair<std::string, std::string> > & records);
 
         private:
             
             UnderlyingStorage  m_UdrStorage;
             std::string        m_DBFilePath;
+            std::size_t        m_MigratedCounter = 0;
         };
 
-        template <typename ObjectType, typename UnderlyingStorage>
-        bool NoSqlStorage<ObjectType, UnderlyingStorage>::InitializeDB()
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::InitializeDB()
         {
             return m_UdrStorage.InitializeDB();
         }
 
-        template <typename ObjectType, typename UnderlyingStorage>
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::InitializeDB(std::string & error_msg)
+        {
+            return m_UdrStorage.InitializeDB(error_msg);
+        }
+
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::Decode(const char * data, std::size_t size, ObjectType & object, bool & oMigrated)
+        {
+            oMigrated = !Serializer::IsEncoded(data, size);
+            if (oMigrated)
+            {
+                return TextArchiveSerializer<ObjectType>::Decode(data, size, object);
+            }
+            return Serializer::Decode(data, size, object);
+        }
+
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::Migrate(const std::vector<std::pair<std::string, std::string> > & records)
+        {
+            if (records.empty())
+            {
+                return true;
+            }
+
+            std::string error_msg;
+            if (!m_UdrStorage.DoWriteBatch(true, records, error_msg))
+            {
+                EXERR("NoSqlStorage::Migrate : Failed to write to DB. Reason[" << error_msg << "]");
+                return false;
+            }
+
+            m_MigratedCounter += records.size();
+            EXINFO("NoSqlStorage::Migrate : " << records.size() << " records converted in [" << m_DBFilePath << "]");
+            return true;
+        }
+
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
         template <typename TCallback>
-        bool NoSqlStorage<ObjectType, UnderlyingStorage>::Load(const TCallback & callback)
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::Load(const TCallback & callback)
         {
             if (InitializeDB())
             {
                 try
                 {
-                    auto object_handler = [&callback](const auto & value)
-                    {
-                        std::stringstream ss(value.ToString());
-                        boost::archive::text_iarchive ia(ss);
+                    std::vector<std::pair<std::string, std::string> > migrated;
+                    bool bCorrupted = false;
 
+                    auto object_handler = [this, &callback, &migrated, &bCorrupted](const auto & key, const auto & value)
+                    {
                         ObjectType object;
-                        ia >> object;
+                        bool bMigrated = false;
+
+                        if (!Decode(value.data(), value.size(), object, bMigrated))
+                        {
+                            EXERR("NoSqlStorage::Load : Invalid record [" << key.ToString() << "]");
+                            bCorrupted = true;
+                            return;
+                        }
+
+                        if (bMigrated)
+                        {
+                            migrated.emplace_back(key.ToString(), std::string());
+                            Serializer::Encode(object, migrated.back().second);
+                        }
 
                         callback(object);
                     };
 
                     m_UdrStorage.Iterate(object_handler);
-                    return true;
+                    return !bCorrupted && Migrate(migrated);
                 }
                 catch (const boost::archive::archive_exception & e)
                 {
@@ -90,8 +170,80 @@ namespace exchange
             return false;
         }
 
-        template <typename ObjectType, typename UnderlyingStorage>
-        bool NoSqlStorage<ObjectType, UnderlyingStorage>::Get(const std::string & key, ObjectType & object)
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::LoadAll(std::vector<ObjectType> & objects, unsigned threads)
+        {
+            if (InitializeDB())
+            {
+                try
+                {
+                    // The iteration is sequential, only the raw records are copied
+                    std::vector<std::pair<std::string, std::string> > records;
+                    m_UdrStorage.Iterate([&records](const auto & key, const auto & value)
+                    {
+                        records.emplace_back(key.ToString(), value.ToString());
+                    });
+
+                    objects.clear();
+                    objects.resize(records.size());
+
+                    using chunk_result = std::pair<bool, std::vector<std::pair<std::string, std::string> > >;
+
+                    // Contiguous chunks, each thread writes its own slice of objects
+                    auto decode_chunk = [this, &records, &objects](std::size_t first, std::size_t last)
+                    {
+                        chunk_result result(true, {});
+                        for (std::size_t i = first; i < last; ++i)
+                        {
+                            bool bMigrated = false;
+                            if (!Decode(records[i].second.data(), records[i].second.size(), objects[i], bMigrated))
+                            {
+                                EXERR("NoSqlStorage::LoadAll : Invalid record [" << records[i].first << "]");
+                                result.first = false;
+                            }
+                            else if (bMigrated)
+                            {
+                                result.second.emplace_back(records[i].first, std::string());
+                                Serializer::Encode(objects[i], result.second.back().second);
+                            }
+                        }
+                        return result;
+                    };
+
+                    const std::size_t chunks     = std::max<std::size_t>(1, std::min<std::size_t>(threads, records.size()));
+                    const std::size_t chunk_size = (records.size() + chunks - 1) / chunks;
+
+                    std::vector<std::future<chunk_result> > pending;
+                    for (std::size_t first = chunk_size; first < records.size(); first += chunk_size)
+                    {
+                        pending.push_back(std::async(std::launch::async, decode_chunk, first, std::min(first + chunk_size, records.size())));
+                    }
+
+                    // The calling thread decodes the first chunk
+                    auto result = decode_chunk(0, std::min(chunk_size, records.size()));
+                    for (auto && chunk : pending)
+                    {
+                        auto chunk_result = chunk.get();
+                        result.first = result.first && chunk_result.first;
+                        std::move(chunk_result.second.begin(), chunk_result.second.end(), std::back_inserter(result.second));
+                    }
+
+                    return result.first && Migrate(result.second);
+                }
+                catch (const boost::archive::archive_exception & e)
+                {
+                    EXERR("NoSqlStorage::LoadAll boost archive_exception : " << e.what());
+                }
+                catch (...)
+                {
+                    EXERR("NoSqlStorage::LoadAll Unknown exception raised");
+                }
+            }
+            return false;
+        }
+
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::Get(const std::string & key, ObjectType & object)
         {
             if (InitializeDB())
             {
@@ -101,10 +253,19 @@ namespace exchange
 
                 if (m_UdrStorage.DoRead(sqlkey, result))
                 {
-                    std::stringstream ss(result);
-                    boost::archive::text_iarchive ia(ss);
+                    bool bMigrated = false;
+                    if (!Decode(result.data(), result.size(), object, bMigrated))
+                    {
+                        EXERR("NoSqlStorage::Get : Invalid record [" << key << "]");
+                        return false;
+                    }
 
-                    ia >> object;
+                    if (bMigrated)
+                    {
+                        std::vector<std::pair<std::string, std::string> > migrated(1, std::make_pair(key, std::string()));
+                        Serializer::Encode(object, migrated.back().second);
+                        Migrate(migrated);
+                    }
                     return true;
                 }
                 return false;
@@ -112,20 +273,16 @@ namespace exchange
             return false;
         }
 
-        template <typename ObjectType, typename UnderlyingStorage>
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
         template <typename TKeyExtractor>
-        bool NoSqlStorage<ObjectType, UnderlyingStorage>::Write(const ObjectType & object, const TKeyExtractor & extractor, bool bSync, bool overwrite)
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::Write(const ObjectType & object, const TKeyExtractor & extractor, bool bSync, bool overwrite)
         {
             if (InitializeDB())
             {
-                std::stringstream stringstream;
-                boost::archive::text_oarchive oa(stringstream);
-
-                oa << object;
+                std::string svalue;
+                Serializer::Encode(object, svalue);
 
                 const key_type  key     = extractor(object);
-                const auto      svalue  = stringstream.str();
-
                 const key_type  value   = svalue;
 
                 if (overwrite == false)
@@ -152,6 +309,50 @@ namespace exchange
             return false;
         }
 
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
+        template <typename TIterator, typename TKeyExtractor>
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::WriteBatch(TIterator first, TIterator last, const TKeyExtractor & extractor, bool bSync)
+        {
+            const auto count = std::distance(first, last);
+
+            std::string error_msg;
+            if (!WriteBatch(first, last, extractor, bSync, error_msg))
+            {
+                EXERR("NoSqlStorage::WriteBatch : " << error_msg);
+                return false;
+            }
+
+            EXINFO("NoSqlStorage::WriteBatch : " << count << " records written in database");
+            return true;
+        }
+
+        template <typename ObjectType, typename UnderlyingStorage, typename Serializer>
+        template <typename TIterator, typename TKeyExtractor>
+        bool NoSqlStorage<ObjectType, UnderlyingStorage, Serializer>::WriteBatch(TIterator first, TIterator last, const TKeyExtractor & extractor, bool bSync, std::string & error_msg)
+        {
+            if (!InitializeDB(error_msg))
+            {
+                return false;
+            }
+
+            std::vector<std::pair<std::string, std::string> > records;
+            records.reserve(static_cast<std::size_t>(std::distance(first, last)));
+
+            for (; first != last; ++first)
+            {
+                records.emplace_back(extractor(*first), std::string());
+                Serializer::Encode(*first, records.back().second);
+            }
+
+            std::string status_msg;
+            if (!m_UdrStorage.DoWriteBatch(bSync, records, status_msg))
+            {
+                error_msg = "Failed to write to DB. Reason[" + status_msg + "]";
+                return false;
+            }
+            return true;
+        }
+
         class LevelDBStorage
         {
             public:
@@ -165,12 +366,16 @@ namespace exchange
                 {}
 
                 bool InitializeDB();
+                bool InitializeDB(std::string & status_msg);
 
                 template <typename TCallBack>
                 void Iterate(const TCallBack & callback);
 
                 bool IsExistingKey(const key_type & key);
                 bool DoWrite(bool bSync, const key_type & key, const key_type & value, std::string & status_msg);
+
+                /* Key / value pairs applied atomically with a single log write ( and a single sync ) */
+                bool DoWriteBatch(bool bSync, const std::vector<std::pair<std::string, std::string> > & records, std::string & status_msg);
                 bool DoRead(const key_type & key, std::string & value);
 
                 void Close();
@@ -193,7 +398,7 @@ namespace exchange
 
             for (it->SeekToFirst(); it->Valid(); it->Next())
             {
-                callback(it->value());
+                callback(it->key(), it->value());
             }
 
             delete it;
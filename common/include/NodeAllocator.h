@@ -0,0 +1,239 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace exchange
+{
+    namespace common
+    {
+        /*!
+        *  \brief DeferredNodes
+        *
+        *  Nodes released by a helper thread on behalf of their owner. While a thread defers its releases,
+        *  the single nodes it frees are queued here instead of filling its own free lists, which it would
+        *  never use again. The owner moves them to its free lists once the helper is done.
+        */
+        class DeferredNodes
+        {
+            public:
+
+                using release_type = void (*)(void *);
+
+                /* Queue of the calling thread, null when it releases to its own free lists */
+                static DeferredNodes *& GetCurrent()
+                {
+                    static thread_local DeferredNodes * s_pCurrent = nullptr;
+                    return s_pCurrent;
+                }
+
+                void Push(void * pMemory, release_type iRelease) { m_Nodes.emplace_back(pMemory, iRelease); }
+
+                /* Give every queued node to the free lists of the calling thread */
+                void Release()
+                {
+                    for (auto && Node : m_Nodes)
+                    {
+                        Node.second(Node.first);
+                    }
+                    m_Nodes.clear();
+                }
+
+                std::size_t GetCount() const { return m_Nodes.size(); }
+
+            private:
+
+                std::vector<std::pair<void *, release_type> > m_Nodes;
+        };
+
+        namespace detail
+        {
+            struct FreeNode
+            {
+                FreeNode * Next;
+            };
+
+            struct FreeListState
+            {
+                FreeNode *  Head;
+                std::size_t Count;
+                bool        Released;
+            };
+
+            /*
+            *  Per thread list of released nodes of one size class. The state is a POD :
+            *  it outlives the releaser, a node freed during the thread exit is given back to the heap.
+            */
+            template <std::size_t NodeSize>
+            class NodeFreeList
+            {
+                public:
+
+                    static void * Pop()
+                    {
+                        auto & State = GetState();
+                        if (State.Head == nullptr)
+                        {
+                            Register();
+                            return ::operator new(NodeSize);
+                        }
+
+                        FreeNode * pNode = State.Head;
+                        State.Head = pNode->Next;
+                        --State.Count;
+                        return pNode;
+                    }
+
+                    static void Push(void * pMemory)
+                    {
+                        if (auto pDeferred = DeferredNodes::GetCurrent())
+                        {
+                            pDeferred->Push(pMemory, &Push);
+                            return;
+                        }
+
+                        auto & State = GetState();
+                        if (State.Released)
+                        {
+                            ::operator delete(pMemory);
+                            return;
+                        }
+
+                        if (State.Head == nullptr)
+                        {
+                            Register();
+                        }
+
+                        auto pNode  = static_cast<FreeNode *>(pMemory);
+                        pNode->Next = State.Head;
+                        State.Head  = pNode;
+                        ++State.Count;
+                    }
+
+                    static std::size_t GetCount() { return GetState().Count; }
+
+                private:
+
+                    struct Releaser
+                    {
+                        ~Releaser()
+                        {
+                            auto & State = GetState();
+                            State.Released = true;
+                            while (State.Head != nullptr)
+                            {
+                                FreeNode * pNode = State.Head;
+                                State.Head = pNode->Next;
+                                ::operator delete(pNode);
+                            }
+                            State.Count = 0;
+                        }
+                    };
+
+                    static FreeListState & GetState()
+                    {
+                        static thread_local FreeListState s_State = { nullptr, 0, false };
+                        return s_State;
+                    }
+
+                    /* The releaser is built once per thread, the first time its list is empty */
+                    static void Register()
+                    {
+                        static thread_local Releaser s_Releaser;
+                        (void)s_Releaser;
+                    }
+            };
+        }
+
+        /*!
+        *  \brief NodeAllocator
+        *
+        *  Stateless allocator for node based containers ( boost multi_index, std::list, std::map ).
+        *  Single nodes are recycled through a per thread free list shared by all the containers
+        *  with the same node size : once a container reached its peak size, inserting and erasing
+        *  never touch the heap. Arrays ( hash buckets ) go to operator new.
+        */
+        template <typename T>
+        class NodeAllocator
+        {
+            public:
+
+                using value_type      = T;
+                using pointer         = T*;
+                using const_pointer   = const T*;
+                using reference       = T&;
+                using const_reference = const T&;
+                using size_type       = std::size_t;
+                using difference_type = std::ptrdiff_t;
+
+                using propagate_on_container_move_assignment = std::true_type;
+                using is_always_equal                        = std::true_type;
+
+                template <typename U>
+                struct rebind
+                {
+                    using other = NodeAllocator<U>;
+                };
+
+            public:
+
+                NodeAllocator() noexcept = default;
+
+                template <typename U>
+                NodeAllocator(const NodeAllocator<U> &) noexcept
+                {}
+
+                T * allocate(size_type n, const void * = nullptr)
+                {
+                    if (n == 1)
+                    {
+                        return static_cast<T *>(FreeList<>::type::Pop());
+                    }
+                    return static_cast<T *>(::operator new(n * sizeof(T)));
+                }
+
+                void deallocate(T * p, size_type n) noexcept
+                {
+                    if (n == 1)
+                    {
+                        FreeList<>::type::Push(p);
+                    }
+                    else
+                    {
+                        ::operator delete(p);
+                    }
+                }
+
+                /* Released nodes of this size kept by the calling thread */
+                static size_type GetFreeCount() { return FreeList<>::type::GetCount(); }
+
+            private:
+
+                /* Evaluated on use only : containers rebind the allocator to node types which are still incomplete */
+                template <typename U = T>
+                struct FreeList
+                {
+                    static_assert(alignof(U) <= alignof(std::max_align_t), "Over aligned nodes are not supported");
+
+                    static constexpr std::size_t NodeSize = ((sizeof(U) + sizeof(detail::FreeNode) - 1) / sizeof(detail::FreeNode)) * sizeof(detail::FreeNode);
+
+                    using type = detail::NodeFreeList<NodeSize>;
+                };
+        };
+
+        template <typename T, typename U>
+        inline bool operator==(const NodeAllocator<T> &, const NodeAllocator<U> &) noexcept { return true; }
+
+        template <typename T, typename U>
+        inline bool operator!=(const NodeAllocator<T> &, const NodeAllocator<U> &) noexcept { return false; }
+
+    }
+}
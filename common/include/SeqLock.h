@@ -0,0 +1,92 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        /*!
+        *  \brief SeqLock
+        *
+        *  Single writer, many readers snapshot of a trivially copyable value.
+        *  The writer never waits : the sequence is odd while a store is in progress and readers retry
+        *  until they copied the value between two identical even sequences.
+        *  It holds no pointer and can be placed in a shared memory segment read by another process.
+        */
+        template <typename T>
+        class alignas(64) SeqLock
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "SeqLock value must be trivially copyable");
+
+            public:
+
+                using value_type = T;
+
+            public:
+
+                SeqLock() : m_Value() {}
+
+                SeqLock(const SeqLock &) = delete;
+                SeqLock & operator=(const SeqLock &) = delete;
+
+                /* Writer side, a single thread at a time */
+                inline void Store(const T & iValue);
+
+                /* Reader side, false if no consistent copy was made within iMaxRetries */
+                inline bool TryLoad(T & oValue, std::uint32_t iMaxRetries = 1024) const;
+
+                /* Number of completed stores */
+                std::uint64_t GetVersion() const { return m_Sequence.load(std::memory_order_acquire) / 2; }
+
+            private:
+                std::atomic<std::uint64_t> m_Sequence { 0 };
+                T                          m_Value;
+        };
+
+        template <typename T>
+        inline void SeqLock<T>::Store(const T & iValue)
+        {
+            const auto Sequence = m_Sequence.load(std::memory_order_relaxed);
+
+            m_Sequence.store(Sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            std::memcpy(&m_Value, &iValue, sizeof(T));
+
+            m_Sequence.store(Sequence + 2, std::memory_order_release);
+        }
+
+        template <typename T>
+        inline bool SeqLock<T>::TryLoad(T & oValue, std::uint32_t iMaxRetries) const
+        {
+            for (std::uint32_t i = 0; i <= iMaxRetries; ++i)
+            {
+                const auto Before = m_Sequence.load(std::memory_order_acquire);
+                if (Before & 1)
+                {
+                    continue;
+                }
+
+                std::memcpy(&oValue, &m_Value, sizeof(T));
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_Sequence.load(std::memory_order_relaxed) == Before)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    }
+}
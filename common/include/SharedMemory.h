@@ -0,0 +1,63 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        /*!
+        *  \brief SharedMemorySegment
+        *
+        *  POSIX shared memory segment ( shm_open + mmap ) mapped for the lifetime of the object.
+        *  The owner creates and sizes the segment and unlinks it on destruction, readers map an
+        *  existing segment read only.
+        */
+        class SharedMemorySegment
+        {
+            public:
+
+                /* Create ( or truncate ) the segment iName with iSize zeroed bytes, mapped read write */
+                static SharedMemorySegment Create(const std::string & iName, size_t iSize);
+
+                /* Map the whole existing segment iName read only */
+                static SharedMemorySegment OpenReadOnly(const std::string & iName);
+
+            public:
+
+                SharedMemorySegment() = default;
+                ~SharedMemorySegment();
+
+                SharedMemorySegment(SharedMemorySegment && other) noexcept;
+                SharedMemorySegment & operator=(SharedMemorySegment && other) noexcept;
+
+                SharedMemorySegment(const SharedMemorySegment &) = delete;
+                SharedMemorySegment & operator=(const SharedMemorySegment &) = delete;
+
+            public:
+
+                bool               IsMapped() const { return m_pAddress != nullptr; }
+                void *             GetAddress() const { return m_pAddress; }
+                size_t             GetSize() const { return m_Size; }
+                const std::string& GetName() const { return m_Name; }
+
+            private:
+
+                void Release();
+
+            private:
+                std::string m_Name;
+                void *      m_pAddress = nullptr;
+                size_t      m_Size     = 0;
+                bool        m_bOwner   = false;
+        };
+
+    }
+}
@@ -0,0 +1,112 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        /*!
+        *  \brief SpscRing
+        *
+        *  Bounded lock-free ring for one producer thread and one consumer thread.
+        *  Each side caches the index of the other one and only reloads it when the ring looks full or empty,
+        *  both indexes live on their own cache line.
+        */
+        template <typename T, size_t Capacity>
+        class SpscRing
+        {
+            static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+            public:
+
+                using value_type = T;
+
+            public:
+
+                SpscRing() = default;
+
+                SpscRing(const SpscRing &) = delete;
+                SpscRing & operator=(const SpscRing &) = delete;
+
+                /* Producer side, false when the ring is full */
+                inline bool TryPush(const T & iValue);
+
+                /* Consumer side, false when the ring is empty */
+                inline bool TryPop(T & oValue);
+
+                /* Approximate when called concurrently */
+                inline size_t Size() const;
+
+                static constexpr size_t GetCapacity() { return Capacity; }
+
+            private:
+
+                static constexpr size_t CacheLineSize = 64;
+                static constexpr size_t Mask          = Capacity - 1;
+
+                std::atomic<size_t> m_Head       { 0 };
+                size_t              m_CachedTail = 0;
+                char                m_ProducerPadding[CacheLineSize - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+                std::atomic<size_t> m_Tail       { 0 };
+                size_t              m_CachedHead = 0;
+                char                m_ConsumerPadding[CacheLineSize - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+                std::array<T, Capacity> m_Buffer;
+        };
+
+        template <typename T, size_t Capacity>
+        inline bool SpscRing<T, Capacity>::TryPush(const T & iValue)
+        {
+            const auto Head = m_Head.load(std::memory_order_relaxed);
+
+            if (Head - m_CachedTail == Capacity)
+            {
+                m_CachedTail = m_Tail.load(std::memory_order_acquire);
+                if (Head - m_CachedTail == Capacity)
+                {
+                    return false;
+                }
+            }
+
+            m_Buffer[Head & Mask] = iValue;
+            m_Head.store(Head + 1, std::memory_order_release);
+            return true;
+        }
+
+        template <typename T, size_t Capacity>
+        inline bool SpscRing<T, Capacity>::TryPop(T & oValue)
+        {
+            const auto Tail = m_Tail.load(std::memory_order_relaxed);
+
+            if (Tail == m_CachedHead)
+            {
+                m_CachedHead = m_Head.load(std::memory_order_acquire);
+                if (Tail == m_CachedHead)
+                {
+                    return false;
+                }
+            }
+
+            oValue = m_Buffer[Tail & Mask];
+            m_Tail.store(Tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        template <typename T, size_t Capacity>
+        inline size_t SpscRing<T, Capacity>::Size() const
+        {
+            return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_acquire);
+        }
+
+    }
+}
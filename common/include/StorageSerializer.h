@@ -0,0 +1,251 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/mpl/bool.hpp>
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/version.hpp>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        /*!
+        *  \brief BinaryOArchive
+        *
+        *  Minimal saving archive for the boost serialize functions : arithmetic and enum values are appended
+        *  with their native size and byte order, strings are prefixed by their 32 bits length. The fields
+        *  of a class are appended in the order of its serialize function, nothing else is written.
+        */
+        class BinaryOArchive
+        {
+            public:
+
+                using is_saving  = boost::mpl::true_;
+                using is_loading = boost::mpl::false_;
+
+            public:
+
+                explicit BinaryOArchive(std::string & oBuffer) : m_rBuffer(oBuffer) {}
+
+                template <typename T>
+                BinaryOArchive & operator&(const T & iValue) { Save(iValue); return *this; }
+
+                template <typename T>
+                BinaryOArchive & operator<<(const T & iValue) { Save(iValue); return *this; }
+
+                /* Version given to the serialize functions */
+                template <typename T>
+                static unsigned int GetVersion() { return boost::serialization::version<T>::value; }
+
+            private:
+
+                template <typename T>
+                std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value> Save(const T & iValue)
+                {
+                    m_rBuffer.append(reinterpret_cast<const char*>(&iValue), sizeof(T));
+                }
+
+                void Save(const std::string & iValue)
+                {
+                    const auto Size = static_cast<std::uint32_t>(iValue.size());
+                    Save(Size);
+                    m_rBuffer.append(iValue.data(), iValue.size());
+                }
+
+                template <typename T>
+                std::enable_if_t<std::is_class<T>::value> Save(const T & iValue)
+                {
+                    boost::serialization::serialize_adl(*this, const_cast<T&>(iValue), GetVersion<T>());
+                }
+
+            private:
+
+                std::string & m_rBuffer;
+        };
+
+        /*!
+        *  \brief BinaryIArchive
+        *
+        *  Loading counterpart of BinaryOArchive, reads in place from a buffer it does not own.
+        *  Reading past the end sets the failed flag instead of throwing.
+        */
+        class BinaryIArchive
+        {
+            public:
+
+                using is_saving  = boost::mpl::false_;
+                using is_loading = boost::mpl::true_;
+
+            public:
+
+                BinaryIArchive(const char * iData, std::size_t iSize) : m_pData(iData), m_Size(iSize) {}
+
+                template <typename T>
+                BinaryIArchive & operator&(T & oValue) { Load(oValue); return *this; }
+
+                template <typename T>
+                BinaryIArchive & operator>>(T & oValue) { Load(oValue); return *this; }
+
+                /* Every byte was read */
+                bool IsComplete() const { return !m_bFailed && m_Offset == m_Size; }
+
+                bool HasFailed() const { return m_bFailed; }
+
+                /* Version of the top level object, read from the record */
+                void SetVersion(unsigned int iVersion) { m_Version = iVersion; }
+
+            private:
+
+                bool Reserve(std::size_t iBytes)
+                {
+                    if (m_bFailed || m_Size - m_Offset < iBytes)
+                    {
+                        m_bFailed = true;
+                        return false;
+                    }
+                    return true;
+                }
+
+                template <typename T>
+                std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value> Load(T & oValue)
+                {
+                    if (Reserve(sizeof(T)))
+                    {
+                        std::memcpy(&oValue, m_pData + m_Offset, sizeof(T));
+                        m_Offset += sizeof(T);
+                    }
+                }
+
+                void Load(std::string & oValue)
+                {
+                    std::uint32_t Size = 0;
+                    Load(Size);
+                    if (Reserve(Size))
+                    {
+                        oValue.assign(m_pData + m_Offset, Size);
+                        m_Offset += Size;
+                    }
+                }
+
+                /* The stored version applies to the top level object, nested objects use their current version */
+                template <typename T>
+                std::enable_if_t<std::is_class<T>::value> Load(T & oValue)
+                {
+                    const auto Version = (m_Depth == 0) ? m_Version : boost::serialization::version<T>::value;
+                    ++m_Depth;
+                    boost::serialization::serialize_adl(*this, oValue, Version);
+                    --m_Depth;
+                }
+
+            private:
+
+                const char *  m_pData;
+                std::size_t   m_Size;
+                std::size_t   m_Offset  = 0;
+                unsigned int  m_Version = 0;
+                unsigned int  m_Depth   = 0;
+                bool          m_bFailed = false;
+        };
+
+        /*!
+        *  \brief TextArchiveSerializer
+        *
+        *  Serializer policy of NoSqlStorage : boost text archives, the format of the databases written
+        *  before BinarySerializer. Decoding errors are reported by a boost::archive::archive_exception.
+        */
+        template <typename ObjectType>
+        struct TextArchiveSerializer
+        {
+            /* Every record is a text archive */
+            static bool IsEncoded(const char * /* iData */, std::size_t /* iSize */)
+            {
+                return true;
+            }
+
+            static void Encode(const ObjectType & iObject, std::string & oValue)
+            {
+                std::ostringstream Stream;
+                {
+                    boost::archive::text_oarchive Archive(Stream);
+                    Archive << iObject;
+                }
+                oValue = Stream.str();
+            }
+
+            static bool Decode(const char * iData, std::size_t iSize, ObjectType & oObject)
+            {
+                std::istringstream Stream(std::string(iData, iSize));
+                boost::archive::text_iarchive Archive(Stream);
+                Archive >> oObject;
+                return true;
+            }
+        };
+
+        /*!
+        *  \brief BinarySerializer
+        *
+        *  Serializer policy of NoSqlStorage : a 4 bytes tag ( "EXB" and the format version ), the 32 bits
+        *  class version of the object, then the fields written by BinaryOArchive. Records are decoded in
+        *  place, without copying the value in a stream first. A text archive starts with a digit and
+        *  is never mistaken for a binary record.
+        */
+        template <typename ObjectType>
+        struct BinarySerializer
+        {
+            static constexpr char          Tag[3]      = { 'E', 'X', 'B' };
+            static constexpr std::uint8_t  Format      = 1;
+            static constexpr std::size_t   HeaderSize  = sizeof(Tag) + sizeof(Format) + sizeof(std::uint32_t);
+
+            static bool IsEncoded(const char * iData, std::size_t iSize)
+            {
+                return iSize >= HeaderSize && std::memcmp(iData, Tag, sizeof(Tag)) == 0 && static_cast<std::uint8_t>(iData[sizeof(Tag)]) == Format;
+            }
+
+            static void Encode(const ObjectType & iObject, std::string & oValue)
+            {
+                const std::uint32_t Version = BinaryOArchive::GetVersion<ObjectType>();
+
+                oValue.clear();
+                oValue.append(Tag, sizeof(Tag));
+                oValue.push_back(static_cast<char>(Format));
+                oValue.append(reinterpret_cast<const char*>(&Version), sizeof(Version));
+
+                BinaryOArchive Archive(oValue);
+                boost::serialization::serialize_adl(Archive, const_cast<ObjectType&>(iObject), Version);
+            }
+
+            static bool Decode(const char * iData, std::size_t iSize, ObjectType & oObject)
+            {
+                if (!IsEncoded(iData, iSize))
+                {
+                    return false;
+                }
+
+                std::uint32_t Version = 0;
+                std::memcpy(&Version, iData + sizeof(Tag) + sizeof(Format), sizeof(Version));
+
+                BinaryIArchive Archive(iData + HeaderSize, iSize - HeaderSize);
+                Archive.SetVersion(Version);
+                Archive >> oObject;
+                return Archive.IsComplete();
+            }
+        };
+
+        template <typename ObjectType>
+        constexpr char BinarySerializer<ObjectType>::Tag[3];
+
+    }
+}
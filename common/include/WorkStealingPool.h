@@ -0,0 +1,98 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        /*!
+        *  \brief WorkStealingPool
+        *
+        *  Fixed set of threads running the indexes of a loop. Each thread starts on its own contiguous
+        *  slice of the indexes and takes them from the front. A thread whose slice is empty steals the back
+        *  half of the largest remaining slice, uneven tasks ( a few large books among many empty ones )
+        *  keep every thread busy until the end. The calling thread takes part in the loop.
+        *
+        *  A slice is a single 64 bits word ( begin and end ), taking and stealing are compare and swap.
+        */
+        class WorkStealingPool
+        {
+            public:
+
+                using task_type = std::function<void(std::size_t)>;
+
+            public:
+
+                /* iThreads includes the calling thread, 1 runs every loop on the calling thread */
+                explicit WorkStealingPool(unsigned iThreads);
+                ~WorkStealingPool();
+
+                WorkStealingPool(const WorkStealingPool &) = delete;
+                WorkStealingPool & operator=(const WorkStealingPool &) = delete;
+
+            public:
+
+                /* Call iTask for every index of [0, iCount), return once every call returned. Not reentrant */
+                void Run(std::size_t iCount, const task_type & iTask);
+
+                unsigned GetThreadCount() const { return static_cast<unsigned>(m_Workers.size()) + 1; }
+
+                /* Slices taken from another thread since the creation of the pool */
+                std::uint64_t GetStealCounter() const { return m_Steals.load(std::memory_order_relaxed); }
+
+            private:
+
+                static constexpr std::size_t CacheLineSize = 64;
+
+                /* Indexes [begin, end) left to a thread, padded to a cache line */
+                struct Slice
+                {
+                    std::atomic<std::uint64_t> Bounds { 0 };
+                    char                       Padding[CacheLineSize - sizeof(std::atomic<std::uint64_t>)];
+                };
+
+                static std::uint64_t MakeBounds(std::uint32_t iBegin, std::uint32_t iEnd) { return (static_cast<std::uint64_t>(iBegin) << 32) | iEnd; }
+                static std::uint32_t GetBegin(std::uint64_t iBounds) { return static_cast<std::uint32_t>(iBounds >> 32); }
+                static std::uint32_t GetEnd(std::uint64_t iBounds) { return static_cast<std::uint32_t>(iBounds); }
+
+                void WorkerLoop(unsigned iSlice);
+                void Work(unsigned iSlice);
+
+                /* Front index of the slice, false when it is empty */
+                bool Take(unsigned iSlice, std::uint32_t & oIndex);
+
+                /* Move the back half of the largest slice to iSlice, false when every slice is empty */
+                bool Steal(unsigned iSlice);
+
+            private:
+
+                std::unique_ptr<Slice[]>     m_pSlices;
+                std::vector<std::thread>     m_Workers;
+                const task_type *            m_pTask = nullptr;
+                std::atomic<std::uint64_t>   m_Steals { 0 };
+                /* A new loop is published by increasing the generation */
+                std::mutex                   m_Mutex;
+                std::condition_variable      m_StartCondition;
+                std::condition_variable      m_DoneCondition;
+                std::uint64_t                m_Generation = 0;
+                unsigned                     m_Pending    = 0;
+                bool                         m_Stop       = false;
+        };
+
+    }
+}
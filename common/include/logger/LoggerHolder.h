@@ -159,9 +159,6 @@ namespace exchange
 
             private:
 
-                /* Temporary Buffer */
-                std::ostringstream m_oss;
-
                 /* Boost.Fusion vector of logger */
                 Types m_Loggers;
 
@@ -186,6 +183,13 @@ namespace exchange
 
             private:
 
+                /* Message being streamed by the calling thread, only the write queue is shared */
+                static std::ostringstream & GetBuffer()
+                {
+                    static thread_local std::ostringstream s_Buffer;
+                    return s_Buffer;
+                }
+
                 void Write()
                 {
                     while (!m_Stopped)
@@ -305,17 +309,18 @@ namespace exchange
 
                 void Flush()
                 {
-                    m_oss << std::endl;
+                    auto & Buffer = GetBuffer();
+                    Buffer << std::endl;
                     std::unique_lock<std::mutex> lock(m_mutex);
-                    m_WriteQueue.push(m_oss.str());
-                    m_oss.str("");
+                    m_WriteQueue.push(Buffer.str());
+                    Buffer.str("");
                     m_cond.notify_one();
                 }
 
                 template <class U>
                 void Push(const U & message)
                 {
-                    m_oss << message;
+                    GetBuffer() << message;
                 }
 
                 template <class U>
@@ -0,0 +1,115 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <BlockAllocator.h>
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cassert>
+#include <new>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        namespace
+        {
+            std::atomic<std::uint64_t> & GetCounter(BlockBacking iBacking)
+            {
+                static std::atomic<std::uint64_t> s_Counters[4];
+                return s_Counters[static_cast<std::uint8_t>(iBacking)];
+            }
+
+            void * MapAnonymous(std::size_t iSize, int iExtraFlags)
+            {
+                void * pBlock = mmap(nullptr, iSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | iExtraFlags, -1, 0);
+                return pBlock == MAP_FAILED ? nullptr : pBlock;
+            }
+
+            /* Transparent huge pages only back aligned ranges : map one more huge page and trim both ends */
+            void * MapAligned(std::size_t iSize, std::size_t iAlignment)
+            {
+                auto pMapping = static_cast<char *>(MapAnonymous(iSize + iAlignment, 0));
+                if (pMapping == nullptr)
+                {
+                    return nullptr;
+                }
+
+                const auto Head = (iAlignment - reinterpret_cast<std::uintptr_t>(pMapping) % iAlignment) % iAlignment;
+                if (Head != 0)
+                {
+                    munmap(pMapping, Head);
+                }
+                munmap(pMapping + Head + iSize, iAlignment - Head);
+
+                return pMapping + Head;
+            }
+        }
+
+        const char * BlockBackingToString(BlockBacking iBacking)
+        {
+            switch (iBacking)
+            {
+                case BlockBacking::HEAP:
+                    return "heap";
+                case BlockBacking::HUGE_TLB:
+                    return "hugetlb";
+                case BlockBacking::TRANSPARENT_HUGE_PAGES:
+                    return "thp";
+                case BlockBacking::SMALL_PAGES:
+                    return "pages";
+                default:
+                    assert(false);
+                    return "unknown";
+            }
+        }
+
+        void * MappedBlockAllocator::Allocate(std::size_t iSize)
+        {
+            const bool bHugePages = iSize % HugePageSize == 0;
+
+#ifdef MAP_HUGETLB
+            if (bHugePages)
+            {
+                if (void * pBlock = MapAnonymous(iSize, MAP_HUGETLB))
+                {
+                    ++GetCounter(BlockBacking::HUGE_TLB);
+                    return pBlock;
+                }
+            }
+#endif
+
+            void * pBlock = bHugePages ? MapAligned(iSize, HugePageSize) : MapAnonymous(iSize, 0);
+            if (pBlock == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+
+#ifdef MADV_HUGEPAGE
+            if (bHugePages && madvise(pBlock, iSize, MADV_HUGEPAGE) == 0)
+            {
+                ++GetCounter(BlockBacking::TRANSPARENT_HUGE_PAGES);
+                return pBlock;
+            }
+#endif
+
+            ++GetCounter(BlockBacking::SMALL_PAGES);
+            return pBlock;
+        }
+
+        void MappedBlockAllocator::Release(void * pBlock, std::size_t iSize) noexcept
+        {
+            munmap(pBlock, iSize);
+        }
+
+        std::uint64_t MappedBlockAllocator::GetBlockCount(BlockBacking iBacking)
+        {
+            return GetCounter(iBacking).load();
+        }
+
+    }
+}
@@ -0,0 +1,189 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <LatencyTrace.h>
+
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+
+namespace exchange
+{
+    namespace common
+    {
+        namespace
+        {
+            constexpr size_t StageCount = static_cast<size_t>(TraceStage::MAX_STAGE);
+
+            /* Time stamp counter frequency, measured against the steady clock */
+            double CalibrateTicksPerNanosecond()
+            {
+                const auto StartTime  = std::chrono::steady_clock::now();
+                const auto StartTicks = ReadTimestampCounter();
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+                const auto EndTicks = ReadTimestampCounter();
+                const auto Elapsed  = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - StartTime).count();
+
+                return Elapsed > 0 ? static_cast<double>(EndTicks - StartTicks) / Elapsed : 1.0;
+            }
+        }
+
+        const char * TraceStageToString(TraceStage iStage)
+        {
+            switch (iStage)
+            {
+                case TraceStage::SOCKET_READ:
+                    return "SOCKET_READ";
+                case TraceStage::PARSED:
+                    return "PARSED";
+                case TraceStage::ENGINE_ENTRY:
+                    return "ENGINE_ENTRY";
+                case TraceStage::MATCHED:
+                    return "MATCHED";
+                case TraceStage::ENGINE_EXIT:
+                    return "ENGINE_EXIT";
+                default:
+                    assert(false);
+                    return "UNKNOWN";
+            }
+        }
+
+        LatencyTraceAggregator::LatencyTraceAggregator(LatencyTracer & rTracer, std::string iDumpFile, std::chrono::seconds iDumpInterval)
+            :m_rTracer(rTracer), m_DumpFile(std::move(iDumpFile)), m_DumpInterval(iDumpInterval),
+             m_TicksPerNanosecond(CalibrateTicksPerNanosecond()), m_Stages(StageCount)
+        {}
+
+        LatencyTraceAggregator::~LatencyTraceAggregator()
+        {
+            Stop();
+        }
+
+        void LatencyTraceAggregator::Start()
+        {
+            if (!m_bRunning.exchange(true))
+            {
+                m_Thread = std::thread(&LatencyTraceAggregator::Run, this);
+            }
+        }
+
+        void LatencyTraceAggregator::Stop()
+        {
+            if (m_bRunning.exchange(false))
+            {
+                m_Thread.join();
+
+                Drain();
+                WriteDumpFile();
+            }
+        }
+
+        void LatencyTraceAggregator::Run()
+        {
+            auto NextDump = std::chrono::steady_clock::now() + m_DumpInterval;
+
+            while (m_bRunning.load(std::memory_order_relaxed))
+            {
+                Drain();
+
+                const auto Now = std::chrono::steady_clock::now();
+                if (m_bDumpRequested.exchange(false) || (m_DumpInterval.count() > 0 && Now >= NextDump))
+                {
+                    WriteDumpFile();
+                    NextDump = Now + m_DumpInterval;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        void LatencyTraceAggregator::Drain()
+        {
+            LatencyTraceRecord Record;
+            while (m_rTracer.GetRing().TryPop(Record))
+            {
+                Aggregate(Record);
+            }
+        }
+
+        void LatencyTraceAggregator::Aggregate(const LatencyTraceRecord & iRecord)
+        {
+            const auto ToNanoseconds = [this](std::uint64_t iTicks)
+            {
+                return static_cast<LatencyHistogram::value_type>(iTicks / m_TicksPerNanosecond);
+            };
+
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+
+            // A stage latency is the time spent since the previous stamped stage
+            std::uint64_t First    = iRecord.Stamps[0];
+            std::uint64_t Previous = First;
+            for (size_t i = 1; i < StageCount; ++i)
+            {
+                const auto Stamp = iRecord.Stamps[i];
+                if (Stamp != 0 && Previous != 0)
+                {
+                    m_Stages[i].Record(Stamp > Previous ? ToNanoseconds(Stamp - Previous) : 0);
+                }
+                Previous = Stamp != 0 ? Stamp : Previous;
+            }
+
+            if (First != 0 && Previous > First)
+            {
+                m_Total.Record(ToNanoseconds(Previous - First));
+            }
+        }
+
+        void LatencyTraceAggregator::Dump(std::ostream & oss) const
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+
+            oss << "traces " << m_Total.GetCount() << " ; dropped " << m_rTracer.GetDroppedCounter()
+                << " ; ticks/ns " << std::fixed << std::setprecision(3) << m_TicksPerNanosecond << std::endl;
+
+            oss << std::left << std::setw(16) << "stage" << std::right << std::setw(10) << "count" << std::setw(10) << "p50"
+                << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(12) << "max" << std::endl;
+
+            const auto PrintLine = [&oss](const char * iName, const LatencyHistogram & iLatencies)
+            {
+                oss << std::left << std::setw(16) << iName << std::right << std::setw(10) << iLatencies.GetCount()
+                    << std::setw(10) << iLatencies.GetValueAtPercentile(50.0) << std::setw(10) << iLatencies.GetValueAtPercentile(99.0)
+                    << std::setw(10) << iLatencies.GetValueAtPercentile(99.9) << std::setw(12) << iLatencies.GetMax() << std::endl;
+            };
+
+            for (size_t i = 1; i < StageCount; ++i)
+            {
+                PrintLine(TraceStageToString(static_cast<TraceStage>(i)), m_Stages[i]);
+            }
+            PrintLine("TOTAL", m_Total);
+            oss << "latencies in nanoseconds since the previous stamped stage" << std::endl;
+        }
+
+        void LatencyTraceAggregator::WriteDumpFile() const
+        {
+            if (m_DumpFile.empty())
+            {
+                return;
+            }
+
+            std::ofstream Output(m_DumpFile, std::ios::trunc);
+            Dump(Output);
+        }
+
+        LatencyHistogram LatencyTraceAggregator::GetStageLatencies(TraceStage iStage) const
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            return m_Stages[static_cast<size_t>(iStage)];
+        }
+
+        std::uint64_t LatencyTraceAggregator::GetTraceCounter() const
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            return m_Total.GetCount();
+        }
+    }
+}
@@ -1,11 +1,24 @@
 #include <ScopedExit.h>
 #include <NoSqlStorage.h>
 
+#include <leveldb/write_batch.h>
+
 namespace exchange
 {
     namespace common
     {
         bool LevelDBStorage::InitializeDB()
+        {
+            std::string status_msg;
+            if (!InitializeDB(status_msg))
+            {
+                EXERR("InstrumentManager::InitializeDB : " << status_msg);
+                return false;
+            }
+            return true;
+        }
+
+        bool LevelDBStorage::InitializeDB(std::string & status_msg)
         {
             if (m_db == nullptr)
             {
@@ -16,8 +29,7 @@ namespace exchange
 
                 if (!status.ok())
                 {
-                    EXERR("InstrumentManager::InitializeDB : Failed to initialize DB ["<< m_DBFilePath <<"]."
-                            " Reason[" << status.ToString() << "]");
+                    status_msg = "Failed to initialize DB [" + m_DBFilePath + "]. Reason[" + status.ToString() + "]";
                     return false;
                 }
             }
@@ -50,6 +62,26 @@ namespace exchange
             return true;
         }
 
+        bool LevelDBStorage::DoWriteBatch(bool bSync, const std::vector<std::pair<std::string, std::string> > & records, std::string & status_msg)
+        {
+            leveldb::WriteBatch batch;
+            for (auto && record : records)
+            {
+                batch.Put(record.first, record.second);
+            }
+
+            leveldb::WriteOptions write_options;
+            write_options.sync = bSync;
+
+            auto status = m_db->Write(write_options, &batch);
+            if (!status.ok())
+            {
+                status_msg = status.ToString();
+                return false;
+            }
+            return true;
+        }
+
         void LevelDBStorage::Close()
         {
             delete m_db;
@@ -0,0 +1,125 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <SharedMemory.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        SharedMemorySegment SharedMemorySegment::Create(const std::string & iName, size_t iSize)
+        {
+            SharedMemorySegment Segment;
+
+            const int Fd = shm_open(iName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+            if (Fd < 0)
+            {
+                return Segment;
+            }
+
+            if (ftruncate(Fd, static_cast<off_t>(iSize)) == 0)
+            {
+                void * pAddress = mmap(nullptr, iSize, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+                if (pAddress != MAP_FAILED)
+                {
+                    Segment.m_Name     = iName;
+                    Segment.m_pAddress = pAddress;
+                    Segment.m_Size     = iSize;
+                    Segment.m_bOwner   = true;
+                }
+            }
+            close(Fd);
+
+            if (!Segment.IsMapped())
+            {
+                shm_unlink(iName.c_str());
+            }
+            return Segment;
+        }
+
+        SharedMemorySegment SharedMemorySegment::OpenReadOnly(const std::string & iName)
+        {
+            SharedMemorySegment Segment;
+
+            const int Fd = shm_open(iName.c_str(), O_RDONLY, 0);
+            if (Fd < 0)
+            {
+                return Segment;
+            }
+
+            struct stat Stat;
+            if (fstat(Fd, &Stat) == 0 && Stat.st_size > 0)
+            {
+                const auto Size = static_cast<size_t>(Stat.st_size);
+                void * pAddress = mmap(nullptr, Size, PROT_READ, MAP_SHARED, Fd, 0);
+                if (pAddress != MAP_FAILED)
+                {
+                    Segment.m_Name     = iName;
+                    Segment.m_pAddress = pAddress;
+                    Segment.m_Size     = Size;
+                }
+            }
+            close(Fd);
+
+            return Segment;
+        }
+
+        SharedMemorySegment::~SharedMemorySegment()
+        {
+            Release();
+        }
+
+        SharedMemorySegment::SharedMemorySegment(SharedMemorySegment && other) noexcept
+            :m_Name(std::move(other.m_Name)), m_pAddress(other.m_pAddress), m_Size(other.m_Size), m_bOwner(other.m_bOwner)
+        {
+            other.m_pAddress = nullptr;
+            other.m_Size     = 0;
+            other.m_bOwner   = false;
+        }
+
+        SharedMemorySegment & SharedMemorySegment::operator=(SharedMemorySegment && other) noexcept
+        {
+            if (this != &other)
+            {
+                Release();
+
+                m_Name     = std::move(other.m_Name);
+                m_pAddress = other.m_pAddress;
+                m_Size     = other.m_Size;
+                m_bOwner   = other.m_bOwner;
+
+                other.m_pAddress = nullptr;
+                other.m_Size     = 0;
+                other.m_bOwner   = false;
+            }
+            return *this;
+        }
+
+        void SharedMemorySegment::Release()
+        {
+            if (m_pAddress != nullptr)
+            {
+                munmap(m_pAddress, m_Size);
+                m_pAddress = nullptr;
+                m_Size     = 0;
+            }
+
+            if (m_bOwner)
+            {
+                shm_unlink(m_Name.c_str());
+                m_bOwner = false;
+            }
+        }
+
+    }
+}
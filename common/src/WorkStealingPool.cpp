@@ -0,0 +1,170 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <WorkStealingPool.h>
+
+#include <cassert>
+#include <limits>
+
+namespace exchange
+{
+    namespace common
+    {
+
+        WorkStealingPool::WorkStealingPool(unsigned iThreads)
+            :m_pSlices(new Slice[iThreads > 0 ? iThreads : 1])
+        {
+            for (unsigned i = 1; i < iThreads; ++i)
+            {
+                m_Workers.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+            }
+        }
+
+        WorkStealingPool::~WorkStealingPool()
+        {
+            {
+                std::lock_guard<std::mutex> Lock(m_Mutex);
+                m_Stop = true;
+            }
+            m_StartCondition.notify_all();
+
+            for (auto && Worker : m_Workers)
+            {
+                Worker.join();
+            }
+        }
+
+        void WorkStealingPool::Run(std::size_t iCount, const task_type & iTask)
+        {
+            assert(iCount <= std::numeric_limits<std::uint32_t>::max());
+
+            if (m_Workers.empty() || iCount < 2)
+            {
+                for (std::size_t i = 0; i < iCount; ++i)
+                {
+                    iTask(i);
+                }
+                return;
+            }
+
+            const auto Threads = GetThreadCount();
+            for (unsigned i = 0; i < Threads; ++i)
+            {
+                const auto Begin = static_cast<std::uint32_t>(iCount * i / Threads);
+                const auto End   = static_cast<std::uint32_t>(iCount * (i + 1) / Threads);
+                m_pSlices[i].Bounds.store(MakeBounds(Begin, End), std::memory_order_relaxed);
+            }
+            m_pTask = &iTask;
+
+            {
+                std::lock_guard<std::mutex> Lock(m_Mutex);
+                m_Pending = static_cast<unsigned>(m_Workers.size());
+                ++m_Generation;
+            }
+            m_StartCondition.notify_all();
+
+            Work(0);
+
+            std::unique_lock<std::mutex> Lock(m_Mutex);
+            m_DoneCondition.wait(Lock, [this]() { return m_Pending == 0; });
+            m_pTask = nullptr;
+        }
+
+        void WorkStealingPool::WorkerLoop(unsigned iSlice)
+        {
+            std::uint64_t Generation = 0;
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> Lock(m_Mutex);
+                    m_StartCondition.wait(Lock, [this, Generation]() { return m_Stop || m_Generation != Generation; });
+                    if (m_Stop)
+                    {
+                        return;
+                    }
+                    Generation = m_Generation;
+                }
+
+                Work(iSlice);
+
+                std::lock_guard<std::mutex> Lock(m_Mutex);
+                if (--m_Pending == 0)
+                {
+                    m_DoneCondition.notify_one();
+                }
+            }
+        }
+
+        void WorkStealingPool::Work(unsigned iSlice)
+        {
+            std::uint32_t Index = 0;
+            do
+            {
+                while (Take(iSlice, Index))
+                {
+                    (*m_pTask)(Index);
+                }
+            }
+            while (Steal(iSlice));
+        }
+
+        bool WorkStealingPool::Take(unsigned iSlice, std::uint32_t & oIndex)
+        {
+            auto & rBounds = m_pSlices[iSlice].Bounds;
+            auto Bounds = rBounds.load(std::memory_order_acquire);
+            while (GetBegin(Bounds) < GetEnd(Bounds))
+            {
+                if (rBounds.compare_exchange_weak(Bounds, MakeBounds(GetBegin(Bounds) + 1, GetEnd(Bounds)), std::memory_order_acq_rel))
+                {
+                    oIndex = GetBegin(Bounds);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool WorkStealingPool::Steal(unsigned iSlice)
+        {
+            const auto Threads = GetThreadCount();
+            while (true)
+            {
+                unsigned      Victim    = iSlice;
+                std::uint64_t Bounds    = 0;
+                std::uint32_t Remaining = 0;
+
+                for (unsigned i = 0; i < Threads; ++i)
+                {
+                    if (i == iSlice)
+                    {
+                        continue;
+                    }
+                    const auto Candidate = m_pSlices[i].Bounds.load(std::memory_order_acquire);
+                    if (GetBegin(Candidate) < GetEnd(Candidate) && GetEnd(Candidate) - GetBegin(Candidate) > Remaining)
+                    {
+                        Victim    = i;
+                        Bounds    = Candidate;
+                        Remaining = GetEnd(Candidate) - GetBegin(Candidate);
+                    }
+                }
+
+                if (Remaining == 0)
+                {
+                    return false;
+                }
+
+                // The victim keeps the front, a single index is taken whole
+                const auto Middle = GetBegin(Bounds) + Remaining / 2;
+                if (m_pSlices[Victim].Bounds.compare_exchange_strong(Bounds, MakeBounds(GetBegin(Bounds), Middle), std::memory_order_acq_rel))
+                {
+                    // An index is in one slice at most, equal bounds always mean the same indexes left ( no ABA )
+                    m_pSlices[iSlice].Bounds.store(MakeBounds(Middle, GetEnd(Bounds)), std::memory_order_release);
+                    m_Steals.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+
+    }
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <ConcurrentMemoryPool.h>
+#include <SpscRing.h>
+
+using namespace exchange::common;
+
+namespace
+{
+    /* Check is derived from the other fields, a slot handed out twice would break it */
+    template <int Tag>
+    struct Payload
+    {
+        std::uint64_t Producer;
+        std::uint64_t Sequence;
+        std::uint64_t Check;
+    };
+}
+
+TEST(ConcurrentMemoryPoolTest, Should_released_slots_be_reused_by_the_same_thread)
+{
+    using pool_type = ConcurrentMemoryPool<Payload<0> >;
+
+    std::vector<void *> Slots;
+    for (int i = 0; i < 1000; ++i)
+    {
+        Slots.push_back(pool_type::Allocate());
+    }
+    for (auto pSlot : Slots)
+    {
+        pool_type::Deallocate(pSlot);
+    }
+
+    const auto Capacity = pool_type::GetCapacity();
+    ASSERT_GE(Capacity, 1000u);
+
+    Slots.clear();
+    for (int i = 0; i < 1000; ++i)
+    {
+        Slots.push_back(pool_type::Allocate());
+    }
+    ASSERT_EQ(Capacity, pool_type::GetCapacity());
+
+    for (auto pSlot : Slots)
+    {
+        pool_type::Deallocate(pSlot);
+    }
+}
+
+TEST(ConcurrentMemoryPoolTest, Should_slots_released_by_an_exiting_thread_be_reused)
+{
+    using pool_type = ConcurrentMemoryPool<Payload<1> >;
+
+    std::vector<void *> Slots;
+    for (int i = 0; i < 500; ++i)
+    {
+        Slots.push_back(pool_type::Allocate());
+    }
+    const auto Capacity = pool_type::GetCapacity();
+
+    std::thread Releaser([&Slots]()
+    {
+        for (auto pSlot : Slots)
+        {
+            pool_type::Deallocate(pSlot);
+        }
+    });
+    Releaser.join();
+
+    // Slots left in the cache of this thread are used first, then the batches published by the exited thread
+    Slots.clear();
+    for (std::size_t i = 0; i < 500 + pool_type::GetThreadCachedCount(); ++i)
+    {
+        Slots.push_back(pool_type::Allocate());
+    }
+    ASSERT_EQ(Capacity, pool_type::GetCapacity());
+
+    for (auto pSlot : Slots)
+    {
+        pool_type::Deallocate(pSlot);
+    }
+}
+
+TEST(ConcurrentMemoryPoolTest, Should_objects_allocated_by_producers_be_released_by_the_consumer)
+{
+    using payload_type = Payload<2>;
+    using pool_type    = ConcurrentMemoryPool<payload_type>;
+    using ring_type    = SpscRing<payload_type *, 1024>;
+
+    constexpr std::uint64_t Producers = 4;
+    constexpr std::uint64_t Objects   = 200000;
+
+    std::vector<std::unique_ptr<ring_type> > Rings;
+    for (std::uint64_t p = 0; p < Producers; ++p)
+    {
+        Rings.push_back(std::make_unique<ring_type>());
+    }
+
+    std::vector<std::thread> Threads;
+    for (std::uint64_t p = 0; p < Producers; ++p)
+    {
+        Threads.emplace_back([p, &Rings]()
+        {
+            for (std::uint64_t i = 0; i < Objects; ++i)
+            {
+                auto pPayload = new (pool_type::Allocate()) payload_type{ p, i, p ^ (i * 2654435761u) };
+                while (!Rings[p]->TryPush(pPayload))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<std::uint64_t> Expected(Producers, 0);
+    std::uint64_t Received = 0;
+    bool bCorrupted = false;
+    while (Received < Producers * Objects)
+    {
+        for (std::uint64_t p = 0; p < Producers; ++p)
+        {
+            payload_type * pPayload = nullptr;
+            while (Rings[p]->TryPop(pPayload))
+            {
+                bCorrupted |= pPayload->Producer != p || pPayload->Sequence != Expected[p] ||
+                              pPayload->Check != (p ^ (pPayload->Sequence * 2654435761u));
+                ++Expected[p];
+                ++Received;
+
+                pPayload->Check = 0;
+                pool_type::Deallocate(pPayload);
+            }
+        }
+    }
+
+    for (auto & Thread : Threads)
+    {
+        Thread.join();
+    }
+
+    ASSERT_FALSE(bCorrupted);
+
+    // The producers reuse the slots released by the consumer instead of carving new blocks
+    ASSERT_LT(pool_type::GetCapacity(), Producers * Objects / 10);
+}
+
+int main(int argc, char ** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
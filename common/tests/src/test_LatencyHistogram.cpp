@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <LatencyHistogram.h>
+
+using namespace exchange::common;
+
+TEST(LatencyHistogramTest, Empty_histogram_should_report_zero)
+{
+    LatencyHistogram Histogram;
+
+    ASSERT_EQ(0u, Histogram.GetCount());
+    ASSERT_EQ(0u, Histogram.GetMin());
+    ASSERT_EQ(0u, Histogram.GetMax());
+    ASSERT_EQ(0u, Histogram.GetValueAtPercentile(50.0));
+}
+
+TEST(LatencyHistogramTest, Small_values_should_be_exact)
+{
+    LatencyHistogram Histogram;
+
+    for (std::uint64_t i = 1; i <= 100; ++i)
+    {
+        Histogram.Record(i);
+    }
+
+    ASSERT_EQ(100u, Histogram.GetCount());
+    ASSERT_EQ(1u, Histogram.GetMin());
+    ASSERT_EQ(100u, Histogram.GetMax());
+    ASSERT_EQ(50u, Histogram.GetValueAtPercentile(50.0));
+    ASSERT_EQ(99u, Histogram.GetValueAtPercentile(99.0));
+    ASSERT_EQ(100u, Histogram.GetValueAtPercentile(100.0));
+    ASSERT_DOUBLE_EQ(50.5, Histogram.GetMean());
+}
+
+TEST(LatencyHistogramTest, Large_values_should_keep_a_bounded_relative_error)
+{
+    LatencyHistogram Histogram;
+
+    for (std::uint64_t i = 1; i <= 100000; ++i)
+    {
+        Histogram.Record(i * 1000);
+    }
+
+    const auto Check = [&Histogram](double iPercentile, double iExpected)
+    {
+        const auto Value = static_cast<double>(Histogram.GetValueAtPercentile(iPercentile));
+        ASSERT_GE(Value, iExpected);
+        ASSERT_LE(Value, iExpected * (1.0 + 1.0 / 64));
+    };
+
+    Check(50.0, 50000000.0);
+    Check(99.0, 99000000.0);
+    Check(99.9, 99900000.0);
+
+    ASSERT_EQ(100000000u, Histogram.GetMax());
+    ASSERT_EQ(100000000u, Histogram.GetValueAtPercentile(100.0));
+}
+
+TEST(LatencyHistogramTest, Merge_should_sum_both_histograms)
+{
+    LatencyHistogram Fast;
+    LatencyHistogram Slow;
+
+    for (auto i = 0; i < 90; ++i)
+    {
+        Fast.Record(10);
+    }
+    for (auto i = 0; i < 10; ++i)
+    {
+        Slow.Record(5000);
+    }
+
+    Fast.Merge(Slow);
+
+    ASSERT_EQ(100u, Fast.GetCount());
+    ASSERT_EQ(10u, Fast.GetMin());
+    ASSERT_EQ(5000u, Fast.GetMax());
+    ASSERT_EQ(10u, Fast.GetValueAtPercentile(90.0));
+    ASSERT_EQ(5000u, Fast.GetValueAtPercentile(91.0));
+
+    Fast.Reset();
+    ASSERT_EQ(0u, Fast.GetCount());
+    ASSERT_EQ(0u, Fast.GetMax());
+}
+
+int main(int argc, char ** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+
+#include <LatencyTrace.h>
+#include <SpscRing.h>
+
+using namespace exchange::common;
+
+TEST(SpscRingTest, Values_should_be_popped_in_push_order_until_the_ring_is_full)
+{
+    SpscRing<int, 4> Ring;
+
+    ASSERT_TRUE(Ring.TryPush(1));
+    ASSERT_TRUE(Ring.TryPush(2));
+    ASSERT_TRUE(Ring.TryPush(3));
+    ASSERT_TRUE(Ring.TryPush(4));
+    ASSERT_FALSE(Ring.TryPush(5));
+    ASSERT_EQ(4u, Ring.Size());
+
+    int Value = 0;
+    ASSERT_TRUE(Ring.TryPop(Value));
+    ASSERT_EQ(1, Value);
+    ASSERT_TRUE(Ring.TryPush(5));
+
+    for (auto Expected : { 2, 3, 4, 5 })
+    {
+        ASSERT_TRUE(Ring.TryPop(Value));
+        ASSERT_EQ(Expected, Value);
+    }
+    ASSERT_FALSE(Ring.TryPop(Value));
+}
+
+TEST(SpscRingTest, Values_should_cross_threads_in_order)
+{
+    constexpr std::uint64_t Count = 1000000;
+    auto pRing = std::make_unique<SpscRing<std::uint64_t, 1024>>();
+
+    std::thread Producer([&pRing]()
+    {
+        for (std::uint64_t i = 1; i <= Count; ++i)
+        {
+            while (!pRing->TryPush(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::uint64_t Expected = 1;
+    std::uint64_t Value    = 0;
+    while (Expected <= Count)
+    {
+        if (pRing->TryPop(Value))
+        {
+            ASSERT_EQ(Expected, Value);
+            ++Expected;
+        }
+    }
+
+    Producer.join();
+}
+
+TEST(LatencyTraceTest, Only_sampled_orders_reaching_the_engine_should_be_aggregated)
+{
+    LatencyTracer          Tracer(2);
+    LatencyTraceAggregator Aggregator(Tracer, "", std::chrono::seconds(0));
+
+    // Stamps without an active trace are ignored
+    LatencyTracer::Stamp(TraceStage::PARSED);
+
+    for (auto i = 0; i < 10; ++i)
+    {
+        const bool bTraced = Tracer.Begin(ReadTimestampCounter());
+        ASSERT_EQ(i % 2 == 1, bTraced);
+
+        if (bTraced)
+        {
+            LatencyTracer::Stamp(TraceStage::PARSED);
+            LatencyTracer::Stamp(TraceStage::ENGINE_ENTRY);
+            if (i == 1)
+            {
+                LatencyTracer::Stamp(TraceStage::MATCHED);
+            }
+            LatencyTracer::Stamp(TraceStage::ENGINE_EXIT);
+            Tracer.End();
+        }
+    }
+
+    // Rejected before the engine : not published
+    ASSERT_FALSE(Tracer.Begin(ReadTimestampCounter()));
+    ASSERT_TRUE(Tracer.Begin(ReadTimestampCounter()));
+    LatencyTracer::Stamp(TraceStage::PARSED);
+    Tracer.End();
+
+    Aggregator.Drain();
+
+    ASSERT_EQ(5u, Aggregator.GetTraceCounter());
+    ASSERT_EQ(5u, Aggregator.GetStageLatencies(TraceStage::PARSED).GetCount());
+    ASSERT_EQ(5u, Aggregator.GetStageLatencies(TraceStage::ENGINE_ENTRY).GetCount());
+    ASSERT_EQ(1u, Aggregator.GetStageLatencies(TraceStage::MATCHED).GetCount());
+    ASSERT_EQ(5u, Aggregator.GetStageLatencies(TraceStage::ENGINE_EXIT).GetCount());
+    ASSERT_EQ(0u, Tracer.GetDroppedCounter());
+    ASSERT_GT(Aggregator.GetTicksPerNanosecond(), 0.0);
+
+    std::ostringstream Dump;
+    Aggregator.Dump(Dump);
+    ASSERT_NE(std::string::npos, Dump.str().find("ENGINE_EXIT"));
+}
+
+TEST(LatencyTraceTest, Background_aggregation_should_consume_the_ring)
+{
+    LatencyTracer          Tracer(1);
+    LatencyTraceAggregator Aggregator(Tracer, "", std::chrono::seconds(0));
+    Aggregator.Start();
+
+    constexpr auto Count = 50000u;
+    for (auto i = 0u; i < Count; ++i)
+    {
+        ASSERT_TRUE(Tracer.Begin(ReadTimestampCounter()));
+        LatencyTracer::Stamp(TraceStage::ENGINE_ENTRY);
+        LatencyTracer::Stamp(TraceStage::ENGINE_EXIT);
+        Tracer.End();
+    }
+
+    Aggregator.Stop();
+
+    ASSERT_EQ(Count, Aggregator.GetTraceCounter() + Tracer.GetDroppedCounter());
+}
+
+int main(int argc, char ** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <MemoryPool.h>
+
+using namespace exchange::common;
+
+namespace
+{
+    struct Element
+    {
+        std::uint64_t Values[8];
+    };
+}
+
+TEST(MemoryPoolTest, Should_report_capacity_used_and_available_slots)
+{
+    MemoryPool<Element, 4096> Pool;
+    ASSERT_EQ(0u, Pool.capacity());
+
+    std::vector<Element *> Elements;
+    Elements.push_back(Pool.newElement());
+
+    const auto SlotsPerBlock = Pool.capacity();
+    ASSERT_EQ((4096 - sizeof(void *)) / sizeof(Element), SlotsPerBlock);
+    ASSERT_EQ(1u, Pool.used());
+    ASSERT_EQ(SlotsPerBlock - 1, Pool.available());
+
+    while (Elements.size() <= SlotsPerBlock)
+    {
+        Elements.push_back(Pool.newElement());
+    }
+    ASSERT_EQ(2 * SlotsPerBlock, Pool.capacity());
+
+    for (auto pElement : Elements)
+    {
+        Pool.deleteElement(pElement);
+    }
+    ASSERT_EQ(0u, Pool.used());
+    ASSERT_EQ(Pool.capacity(), Pool.available());
+}
+
+TEST(MemoryPoolTest, Should_reserved_slots_be_allocated_without_new_blocks)
+{
+    using pool_type = MemoryPool<Element, MappedBlockAllocator::HugePageSize, MappedBlockAllocator>;
+
+    // Whatever pages the kernel gives, every block is counted under one backing
+    auto GetMappedBlocks = []()
+    {
+        return MappedBlockAllocator::GetBlockCount(BlockBacking::HUGE_TLB) +
+               MappedBlockAllocator::GetBlockCount(BlockBacking::TRANSPARENT_HUGE_PAGES) +
+               MappedBlockAllocator::GetBlockCount(BlockBacking::SMALL_PAGES);
+    };
+
+    const auto MappedBlocks  = GetMappedBlocks();
+    const auto SlotsPerBlock = (MappedBlockAllocator::HugePageSize - sizeof(void *)) / sizeof(Element);
+    const size_t Count       = 100000;
+
+    pool_type Pool;
+    Pool.reserve(Count);
+
+    const auto Capacity = Pool.capacity();
+    ASSERT_EQ((Count + SlotsPerBlock - 1) / SlotsPerBlock * SlotsPerBlock, Capacity);
+    ASSERT_EQ(MappedBlocks + Capacity / SlotsPerBlock, GetMappedBlocks());
+    ASSERT_EQ(0u, Pool.used());
+
+    for (size_t i = 0; i < Count; ++i)
+    {
+        auto pElement = Pool.newElement();
+        pElement->Values[7] = i;
+    }
+    ASSERT_EQ(Capacity, Pool.capacity());
+    ASSERT_EQ(Count, Pool.used());
+    ASSERT_EQ(MappedBlocks + Capacity / SlotsPerBlock, GetMappedBlocks());
+}
+
+int main(int argc, char ** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include <SeqLock.h>
+#include <SharedMemory.h>
+
+using namespace exchange::common;
+
+namespace
+{
+    /* Every field holds the same value, a torn read would mix two stores */
+    struct Snapshot
+    {
+        std::uint64_t Values[16];
+    };
+}
+
+TEST(SeqLockTest, Readers_should_never_observe_a_torn_value)
+{
+    SeqLock<Snapshot> Lock;
+    std::atomic<bool> bDone { false };
+    std::atomic<std::uint64_t> Reads { 0 };
+
+    std::thread Writer([&Lock, &bDone, &Reads]()
+    {
+        Snapshot Value;
+        for (std::uint64_t i = 1; i <= 200000; ++i)
+        {
+            std::fill(std::begin(Value.Values), std::end(Value.Values), i);
+            Lock.Store(Value);
+
+            // On a loaded host the reader could otherwise only see writes in progress
+            if (i % 1024 == 0 && Reads.load() == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        bDone.store(true);
+    });
+
+    std::uint64_t Previous = 0;
+    while (!bDone.load())
+    {
+        Snapshot Value;
+        if (Lock.TryLoad(Value))
+        {
+            for (auto Field : Value.Values)
+            {
+                ASSERT_EQ(Value.Values[0], Field);
+            }
+            ASSERT_GE(Value.Values[0], Previous);
+            Previous = Value.Values[0];
+            ++Reads;
+        }
+    }
+    Writer.join();
+
+    Snapshot Last;
+    ASSERT_TRUE(Lock.TryLoad(Last));
+    ASSERT_EQ(200000u, Last.Values[15]);
+    ASSERT_EQ(200000u, Lock.GetVersion());
+    ASSERT_GT(Reads, 0u);
+}
+
+TEST(SharedMemoryTest, Segment_should_be_visible_read_only_until_its_owner_is_destroyed)
+{
+    const std::string Name = "/exchange-test-segment";
+    {
+        auto Owner = SharedMemorySegment::Create(Name, 4096);
+        ASSERT_TRUE(Owner.IsMapped());
+        ASSERT_EQ(4096u, Owner.GetSize());
+        std::strcpy(static_cast<char *>(Owner.GetAddress()), "metrics");
+
+        auto Reader = SharedMemorySegment::OpenReadOnly(Name);
+        ASSERT_TRUE(Reader.IsMapped());
+        ASSERT_EQ(4096u, Reader.GetSize());
+        ASSERT_STREQ("metrics", static_cast<const char *>(Reader.GetAddress()));
+    }
+
+    ASSERT_FALSE(SharedMemorySegment::OpenReadOnly(Name).IsMapped());
+}
+
+int main(int argc, char ** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <WorkStealingPool.h>
+
+using namespace exchange::common;
+
+TEST(WorkStealingPoolTest, Should_every_index_be_run_exactly_once)
+{
+    WorkStealingPool Pool(4);
+    ASSERT_EQ(4u, Pool.GetThreadCount());
+
+    for (std::size_t Count : { 0u, 1u, 3u, 1000u, 100000u })
+    {
+        std::vector<std::atomic<int> > Calls(Count);
+        for (auto && Call : Calls)
+        {
+            Call.store(0);
+        }
+
+        Pool.Run(Count, [&Calls](std::size_t iIndex) { ++Calls[iIndex]; });
+
+        for (std::size_t i = 0; i < Count; ++i)
+        {
+            ASSERT_EQ(1, Calls[i].load()) << "Count[" << Count << "] Index[" << i << "]";
+        }
+    }
+}
+
+TEST(WorkStealingPoolTest, Should_idle_threads_steal_from_a_busy_slice)
+{
+    WorkStealingPool Pool(2);
+
+    // Every slow index is in the first slice, the second thread ends up stealing them
+    const std::size_t Count = 64;
+    std::vector<std::thread::id> Runners(Count);
+    Pool.Run(Count, [&Runners](std::size_t iIndex)
+    {
+        if (iIndex < Count / 2)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        Runners[iIndex] = std::this_thread::get_id();
+    });
+
+    EXPECT_GT(Pool.GetStealCounter(), 0u);
+
+    std::size_t StolenSlow = 0;
+    for (std::size_t i = 0; i < Count / 2; ++i)
+    {
+        StolenSlow += (Runners[i] != std::this_thread::get_id()) ? 1 : 0;
+    }
+    EXPECT_GT(StolenSlow, 0u);
+}
+
+TEST(WorkStealingPoolTest, Should_single_thread_pool_run_on_the_calling_thread)
+{
+    WorkStealingPool Pool(1);
+    ASSERT_EQ(1u, Pool.GetThreadCount());
+
+    std::vector<std::size_t> Order;
+    Pool.Run(5, [&Order](std::size_t iIndex) { Order.push_back(iIndex); });
+
+    ASSERT_EQ((std::vector<std::size_t>{ 0, 1, 2, 3, 4 }), Order);
+    EXPECT_EQ(0u, Pool.GetStealCounter());
+}
+
+int main(int argc, char ** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
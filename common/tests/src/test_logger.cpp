@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <vector>
+
 #include <Logger.h>
 
 typedef enum 
@@ -96,6 +99,27 @@ TEST(LoggerTest, Streaming)
 	EXLOG(Gateway, common::logger::INSANE, "Gateway::INSANE :Streaming from EXLOG");
 }
 
+TEST(LoggerTest, ConcurrentStreaming)
+{
+	// Each thread streams its messages in its own buffer, run it under -fsanitize=thread
+	std::vector<std::thread> Threads;
+	for (int i = 0; i < 4; ++i)
+	{
+		Threads.emplace_back([i]()
+		{
+			for (int j = 0; j < 1000; ++j)
+			{
+				EXINFO("Thread[" << i << "] ; Message[" << j << "]");
+			}
+		});
+	}
+
+	for (auto && Thread : Threads)
+	{
+		Thread.join();
+	}
+}
+
 int main(int argc, char ** argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,100 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <Engine_Order.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace exchange
+{
+    namespace engine
+    {
+
+        /*!
+         * CommandType
+         */
+        enum class CommandType : std::uint8_t
+        {
+            INSERT = 0,
+            IMMEDIATE_INSERT,
+            MODIFY,
+            DELETE,
+            MAX_COMMAND
+        };
+
+        /*!
+        *  \brief OrderCommand
+        *
+        *  One command of a batch given to MatchingEngine::ProcessBatch. Inserts and modifications
+        *  own their message, the other fields describe immediate inserts and deletions.
+        */
+        struct OrderCommand
+        {
+            using qty_type            = Order::qty_type;
+            using price_type          = Order::price_type;
+            using client_orderid_type = Order::client_orderid_type;
+            using client_id_type      = Order::client_id_type;
+
+            static OrderCommand MakeInsert(std::unique_ptr<Order> ipOrder, std::uint32_t iProductID)
+            {
+                OrderCommand Command(CommandType::INSERT, iProductID);
+                Command.pOrder = std::move(ipOrder);
+                return Command;
+            }
+
+            static OrderCommand MakeImmediateInsert(OrderType iType, OrderWay iWay, qty_type iQty, price_type iPrice, client_orderid_type iOrderID,
+                                                    client_id_type iClientID, TimeQualifier iQualifier, std::uint32_t iProductID)
+            {
+                OrderCommand Command(CommandType::IMMEDIATE_INSERT, iProductID);
+                Command.Type       = iType;
+                Command.Way        = iWay;
+                Command.Qty        = iQty;
+                Command.LimitPrice = iPrice;
+                Command.OrderID    = iOrderID;
+                Command.Client     = iClientID;
+                Command.Qualifier  = iQualifier;
+                return Command;
+            }
+
+            static OrderCommand MakeModify(std::unique_ptr<OrderReplace> ipOrderReplace, std::uint32_t iProductID)
+            {
+                OrderCommand Command(CommandType::MODIFY, iProductID);
+                Command.pReplace = std::move(ipOrderReplace);
+                return Command;
+            }
+
+            static OrderCommand MakeDelete(client_orderid_type iOrderID, client_id_type iClientID, OrderWay iWay, std::uint32_t iProductID)
+            {
+                OrderCommand Command(CommandType::DELETE, iProductID);
+                Command.Way     = iWay;
+                Command.OrderID = iOrderID;
+                Command.Client  = iClientID;
+                return Command;
+            }
+
+            OrderCommand(CommandType iCommand, std::uint32_t iProductID)
+                :Command(iCommand), ProductID(iProductID)
+            {}
+
+            CommandType                    Command;
+            std::uint32_t                  ProductID;
+
+            std::unique_ptr<Order>         pOrder;
+            std::unique_ptr<OrderReplace>  pReplace;
+
+            OrderType                      Type       = OrderType::LIMIT;
+            OrderWay                       Way        = OrderWay::MAX_WAY;
+            qty_type                       Qty        = qty_type(0);
+            price_type                     LimitPrice = price_type(0);
+            client_orderid_type            OrderID    = client_orderid_type(0);
+            client_id_type                 Client     = client_id_type(0);
+            TimeQualifier                  Qualifier  = TimeQualifier::DAY;
+        };
+
+    }
+}
@@ -39,6 +39,9 @@ namespace exchange
                 using client_orderid_type = Order::client_orderid_type;
                 using client_id_type      = Order::client_id_type;
 
+                /* InstrumentID_Timestamp_Counter, null terminated */
+                using reference_type      = std::array<char, 64>;
+
             public:
 
                 Deal(price_type iPrice, qty_type iQty, client_id_type iBuyerClientID, client_orderid_type iBuyerOrderID, client_id_type iSellerClientID, client_orderid_type iSellerOrderID);
@@ -69,11 +72,11 @@ namespace exchange
                 
                 inline TimestampType         GetTimeStamp() const;
 
-                inline const std::string &   GetReference() const;
-                inline void                  SetReference(std::string);
+                inline const char *          GetReference() const;
+                inline void                  SetReference(const char * iRef);
 
             protected:
-                std::string           m_Reference;
+                reference_type        m_Reference;
                 price_type            m_Price;
                 qty_type              m_Qty;
                 TimestampType         m_Timestamp;
@@ -145,14 +148,15 @@ namespace exchange
             m_SellerOrderID = std::move(iId);
         }
 
-        inline const std::string & Deal::GetReference() const
+        inline const char * Deal::GetReference() const
         {
-            return m_Reference;
+            return m_Reference.data();
         }
 
-        inline void Deal::SetReference(std::string iRef)
+        inline void Deal::SetReference(const char * iRef)
         {
-            m_Reference = std::move(iRef);
+            std::strncpy(m_Reference.data(), iRef, m_Reference.size() - 1);
+            m_Reference.back() = '\0';
         }
 
         inline Deal::TimestampType Deal::GetTimeStamp() const
@@ -19,5 +19,11 @@ namespace exchange
             static const auto  MinPrice = Price::min()    + 1_price;
             static const auto  MinQty   = Quantity::min() + 1_qty;
         }
+
+        /* Logger categories of the engine, traces of the hot path are only built when their category reports them */
+        enum EngineLogCategory : std::uint16_t
+        {
+            MATCHING_LOG = 0
+        };
     }
 }
@@ -0,0 +1,45 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace exchange
+{
+    namespace engine
+    {
+
+        /* One price level of a side, the quantity is the open quantity of its orders */
+        struct DepthLevel
+        {
+            std::uint32_t Price    = 0;
+            std::uint32_t Orders   = 0;
+            std::uint64_t Quantity = 0;
+        };
+
+        /*!
+        *  \brief BookDepth
+        *
+        *  Best MaxLevels price levels of each side of an order book, best first. Maintained by the order
+        *  container on every change of its indexes and published through a SeqLock once per command,
+        *  other threads copy it without touching the indexes.
+        */
+        struct BookDepth
+        {
+            static constexpr std::size_t MaxLevels = 10;
+
+            std::uint32_t BidLevels = 0;
+            std::uint32_t AskLevels = 0;
+            DepthLevel    Bids[MaxLevels];
+            DepthLevel    Asks[MaxLevels];
+        };
+
+        static_assert(std::is_trivially_copyable<BookDepth>::value, "BookDepth is published through a SeqLock");
+
+    }
+}
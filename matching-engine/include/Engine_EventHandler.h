@@ -14,8 +14,14 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 
+#include <boost/functional/hash.hpp>
+
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <vector>
 #include <MemoryPool.h>
+#include <NodeAllocator.h>
 
 namespace exchange
 {
@@ -41,6 +47,23 @@ namespace exchange
             TPool * _pool = nullptr;
         };
 
+        /* Deal references are null terminated strings stored in the deal */
+        struct ReferenceHasher
+        {
+            std::size_t operator()(const char * iReference) const noexcept
+            {
+                return boost::hash_range(iReference, iReference + std::strlen(iReference));
+            }
+        };
+
+        struct ReferenceEqual
+        {
+            bool operator()(const char * iLhs, const char * iRhs) const noexcept
+            {
+                return std::strcmp(iLhs, iRhs) == 0;
+            }
+        };
+
 
         template <typename TEventProcessor>
         class EventHandler
@@ -50,6 +73,8 @@ namespace exchange
                 using pool_type = MemoryPool<Deal, 65536>;
                 using pool_delete_type = pool_delete<pool_type>;
                 using deal_ptr_type = std::unique_ptr<Deal, pool_delete_type>;
+                using deal_span_type = std::vector<const Deal *>;
+                using order_span_type = std::vector<const Order *>;
 
             protected:
 
@@ -68,14 +93,15 @@ namespace exchange
                                         bmi::indexed_by
                                             <
                                                 bmi::hashed_unique<
-                                                bmi::tag<deal_id_tag>, bmi::const_mem_fun<Deal, const std::string &, &Deal::GetReference> >,
+                                                bmi::tag<deal_id_tag>, bmi::const_mem_fun<Deal, const char *, &Deal::GetReference>, ReferenceHasher, ReferenceEqual >,
 
                                                 bmi::hashed_non_unique<
                                                 bmi::tag<buyer_id_tag>, bmi::const_mem_fun<Deal, client_id_type, &Deal::GetBuyerClientID>, Hasher<client_id_type> >,
 
                                                 bmi::hashed_non_unique<
                                                 bmi::tag<seller_id_tag>, bmi::const_mem_fun<Deal, client_id_type, &Deal::GetSellerClientID>, Hasher<client_id_type> >
-                                            >
+                                            >,
+                                        common::NodeAllocator<deal_ptr_type>
                                     >;
 
             public:
@@ -89,37 +115,59 @@ namespace exchange
                 template <typename... Args>
                 deal_ptr_type CreateDeal(Args &&... args)
                 {
-                    return deal_ptr_type(m_pDealPool->newElement(std::forward<Args>(args)...), pool_delete_type(m_pDealPool.get()));
+                    auto & DealPool = GetDealPool();
+                    return deal_ptr_type(DealPool.newElement(std::forward<Args>(args)...), pool_delete_type(&DealPool));
                 }
 
-                /**/
-                void OnDeal(deal_ptr_type ipDeal);
+                /* Store a deal, its statistics are only processed by OnDeals */
+                const Deal * RecordDeal(deal_ptr_type ipDeal);
 
-                /**/
-                void OnUnsolicitedCancelledOrder(const Order* order);
+                /* Process once all the deals generated by one matching sweep */
+                void OnDeals(const deal_span_type & iDeals);
+
+                /* Every order cancelled by the book at once ( end of day ), the orders are deleted afterwards */
+                void OnUnsolicitedCancelledOrders(const order_span_type & iOrders);
+
+                /* An aggressive order has been stopped by the price collars */
+                void OnPriceCollarBreach();
+
+                /* Open quantity and order count added to a price level, negative when removed */
+                inline void OnLevelChange(OrderWay iWay, Price iPrice, std::int64_t iQuantity, std::int32_t iOrders);
 
                 /**/
                 inline void RehashDealIndexes(size_t size);
 
+                /*
+                *  Prepare the storage of iCount more deals : indexes are rehashed, deal slots
+                *  and index nodes are allocated once and kept by their pools for the next deals
+                */
+                void ReserveDeals(size_t iCount);
+
             public:
 
                 inline std::uint32_t   GetInstrumentID() const;
                 inline size_t          GetDealCounter() const;
 
-            
+                /* Deal slots in use, 0 before the first deal */
+                inline size_t          GetDealPoolUsed() const;
+
+            protected:
+
+                /* The pool and the indexes are only allocated with the first deal, most listed instruments never trade */
+                inline pool_type &         GetDealPool();
+                inline DealContainerType & GetDealContainer();
+
             protected:
-                std::unique_ptr<pool_type>  m_pDealPool;
-                DealContainerType           m_DealContainer;
-                std::uint32_t               m_InstrumentID;
+                std::unique_ptr<pool_type>          m_pDealPool;
+                std::unique_ptr<DealContainerType>  m_pDealContainer;
+                std::uint32_t                       m_InstrumentID;
         };
 
 
         template <typename TEventProcessor>
         EventHandler<TEventProcessor>::EventHandler(std::uint32_t iInstrumentID):
             m_InstrumentID(iInstrumentID)
-        {
-            m_pDealPool = std::make_unique<pool_type>();
-        }
+        {}
 
         template <typename TEventProcessor>
         EventHandler<TEventProcessor>::~EventHandler()
@@ -134,43 +182,109 @@ namespace exchange
         template <typename TEventProcessor>
         inline size_t EventHandler<TEventProcessor>::GetDealCounter() const
         {
-            return m_DealContainer.size();
+            return m_pDealContainer ? m_pDealContainer->size() : 0;
         }
 
         template <typename TEventProcessor>
-        void EventHandler<TEventProcessor>::OnDeal(deal_ptr_type ipDeal)
+        inline size_t EventHandler<TEventProcessor>::GetDealPoolUsed() const
         {
-            std::ostringstream  oss("");
-            oss << m_InstrumentID << "_" << ipDeal->GetTimeStamp().time_since_epoch().count();
-            oss << "_" << GetDealCounter()+1;
-            ipDeal->SetReference(oss.str());
+            return m_pDealPool ? m_pDealPool->used() : 0;
+        }
 
-            auto insertion = m_DealContainer.insert(std::move(ipDeal));
+        template <typename TEventProcessor>
+        inline typename EventHandler<TEventProcessor>::pool_type & EventHandler<TEventProcessor>::GetDealPool()
+        {
+            if (!m_pDealPool)
+            {
+                m_pDealPool = std::make_unique<pool_type>();
+            }
+            return *m_pDealPool;
+        }
 
-            if (insertion.second)
+        template <typename TEventProcessor>
+        inline typename EventHandler<TEventProcessor>::DealContainerType & EventHandler<TEventProcessor>::GetDealContainer()
+        {
+            if (!m_pDealContainer)
             {
-                auto pDeal = insertion.first->get();
-                static_cast<TEventProcessor*>(this)->ProcessDeal(pDeal);
+                m_pDealContainer = std::make_unique<DealContainerType>();
             }
-            else
+            return *m_pDealContainer;
+        }
+
+        template <typename TEventProcessor>
+        const Deal * EventHandler<TEventProcessor>::RecordDeal(deal_ptr_type ipDeal)
+        {
+            Deal::reference_type Reference;
+            std::snprintf(Reference.data(), Reference.size(), "%u_%lld_%zu", m_InstrumentID,
+                          static_cast<long long>(ipDeal->GetTimeStamp().time_since_epoch().count()), GetDealCounter() + 1);
+            ipDeal->SetReference(Reference.data());
+
+            auto insertion = GetDealContainer().insert(std::move(ipDeal));
+
+            if (!insertion.second)
             {
                 EXERR("EventHandler : Failed to insert and process deal [" << *(insertion.first->get()) );
                 assert(false);
+                return nullptr;
+            }
+            return insertion.first->get();
+        }
+
+        template <typename TEventProcessor>
+        void EventHandler<TEventProcessor>::OnDeals(const deal_span_type & iDeals)
+        {
+            if (!iDeals.empty())
+            {
+                static_cast<TEventProcessor*>(this)->ProcessDeals(iDeals);
             }
         }
 
         template <typename TEventProcessor>
-        void EventHandler<TEventProcessor>::OnUnsolicitedCancelledOrder(const Order * order)
+        void EventHandler<TEventProcessor>::OnUnsolicitedCancelledOrders(const order_span_type & iOrders)
         {
-            static_cast<TEventProcessor*>(this)->ProcessUnsolicitedCancelledOrder(order);
+            if (!iOrders.empty())
+            {
+                static_cast<TEventProcessor*>(this)->ProcessUnsolicitedCancelledOrders(iOrders);
+            }
+        }
+
+        template <typename TEventProcessor>
+        void EventHandler<TEventProcessor>::OnPriceCollarBreach()
+        {
+            static_cast<TEventProcessor*>(this)->ProcessPriceCollarBreach();
+        }
+
+        template <typename TEventProcessor>
+        inline void EventHandler<TEventProcessor>::OnLevelChange(OrderWay iWay, Price iPrice, std::int64_t iQuantity, std::int32_t iOrders)
+        {
+            static_cast<TEventProcessor*>(this)->ProcessLevelChange(iWay, iPrice, iQuantity, iOrders);
         }
 
         template <typename TEventProcessor>
         inline void EventHandler<TEventProcessor>::RehashDealIndexes(size_t size)
         {
-            bmi::get<deal_id_tag>(m_DealContainer).rehash(size);
-            bmi::get<seller_id_tag>(m_DealContainer).rehash(size);
-            bmi::get<buyer_id_tag>(m_DealContainer).rehash(size);
+            auto & DealContainer = GetDealContainer();
+            bmi::get<deal_id_tag>(DealContainer).rehash(size);
+            bmi::get<seller_id_tag>(DealContainer).rehash(size);
+            bmi::get<buyer_id_tag>(DealContainer).rehash(size);
+        }
+
+        template <typename TEventProcessor>
+        void EventHandler<TEventProcessor>::ReserveDeals(size_t iCount)
+        {
+            RehashDealIndexes(GetDealCounter() + iCount);
+
+            // The scratch container shares the node free list of the deal container, its deals go back to the pool
+            DealContainerType Scratch;
+            Deal::reference_type Reference;
+
+            for (size_t i = 0; i < iCount; ++i)
+            {
+                auto pDeal = CreateDeal(Deal::price_type(0), Deal::qty_type(0), client_id_type(0), Deal::client_orderid_type(0), client_id_type(0), Deal::client_orderid_type(0));
+                std::snprintf(Reference.data(), Reference.size(), "reserved_%zu", i);
+                pDeal->SetReference(Reference.data());
+                Scratch.insert(std::move(pDeal));
+            }
         }
     }
 }
@@ -14,6 +14,7 @@
 
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <boost/serialization/version.hpp>
 
 namespace exchange
 {
@@ -50,20 +51,32 @@ namespace exchange
             price_type          GetClosePrice() const { return m_closeprice; }
             std::uint32_t       GetProductId() const { return m_productid; }
 
+            /* Highest number of resting orders and of deals reached during the last trading day */
+            std::uint64_t       GetPeakOrders() const { return m_peakorders; }
+            std::uint64_t       GetPeakDeals() const { return m_peakdeals; }
+
             void                SetClosePrice(price_type iprice) { m_closeprice = iprice; }
+            void                SetPeaks(std::uint64_t iorders, std::uint64_t ideals) { m_peakorders = iorders; m_peakdeals = ideals; }
 
         private:
 
             friend class boost::serialization::access;
 
             template<class Archive>
-            void serialize(Archive & ar, const unsigned int /* version */)
+            void serialize(Archive & ar, const unsigned int version)
             {
                 ar & m_name;
                 ar & m_isin;
                 ar & m_currency;
                 ar & m_closeprice;
                 ar & m_productid;
+
+                // Instruments written before the peaks were recorded are still readable
+                if (version >= 1)
+                {
+                    ar & m_peakorders;
+                    ar & m_peakdeals;
+                }
             }
 
         private:
@@ -73,6 +86,8 @@ namespace exchange
             std::string        m_currency;
             price_type         m_closeprice;
             std::uint32_t      m_productid;
+            std::uint64_t      m_peakorders = 0;
+            std::uint64_t      m_peakdeals = 0;
                    
         };
 
@@ -85,7 +100,9 @@ namespace exchange
                     rhs.m_isin == m_isin       &&
                     rhs.m_currency == m_currency   &&
                     rhs.m_closeprice == m_closeprice &&
-                    rhs.m_productid == m_productid;
+                    rhs.m_productid == m_productid &&
+                    rhs.m_peakorders == m_peakorders &&
+                    rhs.m_peakdeals == m_peakdeals;
             }
             return true;
         }
@@ -94,7 +111,8 @@ namespace exchange
         std::ostream & operator<<(std::ostream &os, const Instrument<TOrder> &gp)
         {
             return os << "Name[" << gp.GetName() << "] Isin[" << gp.GetIsin() << "] Currency[" << gp.GetCurrency() << "] "
-                << "ClosePrice[" << gp.GetClosePrice() << "] ProductId[" << gp.GetProductId() << "]";
+                << "ClosePrice[" << gp.GetClosePrice() << "] ProductId[" << gp.GetProductId() << "] "
+                << "PeakOrders[" << gp.GetPeakOrders() << "] PeakDeals[" << gp.GetPeakDeals() << "]";
         }
         
 
@@ -113,4 +131,19 @@ namespace exchange
 
 
     }
-}
\ No newline at end of file
+}
+
+namespace boost
+{
+    namespace serialization
+    {
+        /* Version 1 : previous day peaks */
+        template <typename TOrder>
+        struct version< exchange::engine::Instrument<TOrder> >
+        {
+            typedef mpl::integral_c_tag tag;
+            typedef mpl::int_<1>        type;
+            BOOST_STATIC_CONSTANT(int, value = version::type::value);
+        };
+    }
+}
@@ -0,0 +1,176 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <SpscRing.h>
+
+#include <Engine_OrderFlow.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace exchange
+{
+    namespace engine
+    {
+
+#pragma pack(push, 1)
+
+        /*!
+        *  \brief JournalRecord
+        *
+        *  One accepted command as written in the journal : gap free sequence number, command and CRC32 of both.
+        */
+        struct JournalRecord
+        {
+            std::uint64_t   Sequence = 0;
+            OrderFlowRecord Command;
+            std::uint32_t   Crc      = 0;
+        };
+
+#pragma pack(pop)
+
+        static_assert(sizeof(JournalRecord) == 48, "JournalRecord is part of the journal file format");
+
+        /**/
+        std::uint32_t ComputeJournalCrc(const JournalRecord & iRecord);
+
+        /*!
+        *  \brief JournalWriter
+        *
+        *  Write-ahead journal of the commands accepted by the engine.
+        *
+        *  The engine thread only stamps the sequence and pushes the record in a ring, a dedicated thread
+        *  drains the ring, computes the CRCs and writes everything it found with a single write and a single
+        *  fdatasync ( group commit ). The engine thread only waits when the ring is full.
+        */
+        class JournalWriter
+        {
+            public:
+
+                static constexpr std::size_t RingCapacity = 65536;
+                static constexpr std::size_t MaxGroupSize = 4096;
+
+            public:
+
+                /* Records after iValidSize ( torn tail ) are dropped, a new journal is created when iValidSize is 0 */
+                JournalWriter(const std::string & iFileName, std::uint64_t iNextSequence, std::uint64_t iValidSize);
+                ~JournalWriter();
+
+                JournalWriter(const JournalWriter &) = delete;
+                JournalWriter & operator=(const JournalWriter &) = delete;
+
+            public:
+
+                /**/
+                bool IsOpen() const { return m_Fd != -1; }
+
+                /* Engine thread, sequence given to the record */
+                std::uint64_t Append(const OrderFlowRecord & iRecord);
+
+                /* Engine thread, sequence of the last appended record */
+                std::uint64_t GetLastSequence() const { return m_NextSequence - 1; }
+
+                /* Last sequence written and synced to the disk */
+                std::uint64_t GetDurableSequence() const { return m_DurableSequence.load(std::memory_order_acquire); }
+
+                /* Block until every appended record is durable, or the journal failed */
+                void Sync();
+
+                /* Any thread, block until the records up to iSequence are durable, false if the journal failed */
+                bool WaitDurable(std::uint64_t iSequence);
+
+                /**/
+                std::uint64_t GetGroupCommitCounter() const { return m_GroupCommits.load(std::memory_order_relaxed); }
+
+                /* Appends which found the ring full */
+                std::uint64_t GetStallCounter() const { return m_Stalls; }
+
+                /* A write failed, the records appended since then are lost */
+                bool HasFailed() const { return m_Failed.load(std::memory_order_acquire); }
+
+            private:
+
+                void Run();
+
+            private:
+
+                using ring_type = common::SpscRing<JournalRecord, RingCapacity>;
+
+                int                          m_Fd = -1;
+                std::unique_ptr<ring_type>   m_pRing;
+                std::uint64_t                m_NextSequence;
+                std::uint64_t                m_Stalls = 0;
+                std::atomic<std::uint64_t>   m_DurableSequence;
+                std::atomic<std::uint64_t>   m_GroupCommits { 0 };
+                std::atomic<bool>            m_Stop { false };
+                std::atomic<bool>            m_Failed { false };
+                /* Sync waits on the durable sequence */
+                std::mutex                   m_DurableMutex;
+                std::condition_variable      m_DurableCondition;
+                std::thread                  m_Writer;
+        };
+
+        /*!
+        *  \brief JournalReader
+        *
+        *  Sequential reader of a journal. Reading stops at the first torn or corrupted record,
+        *  everything before it is the state to recover.
+        */
+        class JournalReader
+        {
+            public:
+
+                static constexpr std::size_t BufferRecords = 16384;
+
+            public:
+
+                explicit JournalReader(const std::string & iFileName);
+
+            public:
+
+                /* False when the file does not exist */
+                bool IsOpen() const { return m_Stream.is_open(); }
+
+                /* False when the file is not a journal */
+                bool IsValid() const { return m_Valid; }
+
+                /* False at the end of the valid records */
+                bool Next(OrderFlowRecord & oRecord);
+
+                /* Before the first Next : go past the records up to iSequence, false if the journal does not hold it */
+                bool SkipTo(std::uint64_t iSequence);
+
+                /* Valid after the last call to Next */
+                std::uint64_t GetLastSequence() const { return m_LastSequence; }
+                std::uint64_t GetValidSize() const { return m_ValidSize; }
+                bool HasCorruptedTail() const { return m_CorruptedTail; }
+
+            private:
+
+                bool Fill();
+
+            private:
+                std::ifstream               m_Stream;
+                std::vector<JournalRecord>  m_Buffer;
+                std::size_t                 m_Position      = 0;
+                std::size_t                 m_Count         = 0;
+                std::uint64_t               m_LastSequence  = 0;
+                std::uint64_t               m_ValidSize     = 0;
+                bool                        m_Valid         = false;
+                bool                        m_CorruptedTail = false;
+                bool                        m_End           = false;
+        };
+
+    }
+}
@@ -0,0 +1,231 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <SpscRing.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace exchange
+{
+    namespace engine
+    {
+
+        enum class MarketDataEventType : std::uint8_t
+        {
+            LEVEL = 0,
+            TRADE,
+            PHASE,
+            CLEAR
+        };
+
+        /*!
+        *  \brief MarketDataEvent
+        *
+        *  Change of an order book pushed by the engine thread. A level event holds the change of the open
+        *  quantity and of the order count of a price level, the publisher keeps the levels themselves.
+        */
+        struct MarketDataEvent
+        {
+            std::uint32_t       ProductID = 0;
+            MarketDataEventType Type      = MarketDataEventType::LEVEL;
+            /* OrderWay of a level event */
+            std::uint8_t        Way       = 0;
+            /* TradingPhase of a phase event */
+            std::uint16_t       Phase     = 0;
+            std::uint32_t       Price     = 0;
+            std::int32_t        Orders    = 0;
+            std::int64_t        Quantity  = 0;
+        };
+
+        static_assert(sizeof(MarketDataEvent) == 24, "MarketDataEvent is copied through the ring");
+
+        enum class MarketDataAction : std::uint8_t
+        {
+            ADD = 0,
+            UPDATE,
+            DELETE,
+            TRADE,
+            PHASE
+        };
+
+#pragma pack(push, 1)
+
+        /*!
+        *  \brief MarketDataHeader
+        *
+        *  Start of a feed message : the updates of one book over one publication interval. The sequence
+        *  is gap free over the incremental messages of a connection, a snapshot message carries the
+        *  sequence of the last incremental message it includes.
+        */
+        struct MarketDataHeader
+        {
+            static constexpr std::uint8_t SnapshotFlag = 1;
+
+            std::uint64_t Sequence  = 0;
+            std::uint32_t ProductID = 0;
+            std::uint16_t Updates   = 0;
+            std::uint8_t  Flags     = 0;
+            std::uint8_t  Padding   = 0;
+        };
+
+        /* Levels are sent with their new state, a trade with its price and quantity */
+        struct MarketDataUpdate
+        {
+            MarketDataAction Action   = MarketDataAction::ADD;
+            std::uint8_t     Way      = 0;
+            std::uint16_t    Phase    = 0;
+            std::uint32_t    Price    = 0;
+            std::uint32_t    Orders   = 0;
+            std::uint32_t    Padding  = 0;
+            std::uint64_t    Quantity = 0;
+        };
+
+#pragma pack(pop)
+
+        static_assert(sizeof(MarketDataHeader) == 16, "MarketDataHeader is part of the feed format");
+        static_assert(sizeof(MarketDataUpdate) == 24, "MarketDataUpdate is part of the feed format");
+
+        /*!
+        *  \brief MarketDataPublisher
+        *
+        *  Incremental price level feed served to local TCP subscribers.
+        *
+        *  The engine thread only pushes events in a ring. The publisher thread applies them to its own copy
+        *  of the levels and, once per interval, conflates the changes of each book : a level changed many
+        *  times is sent once with its last state. The messages of an interval are serialized once in a
+        *  single buffer which is written to every subscriber. A new subscriber first receives a snapshot of
+        *  every book, then the incremental messages. A subscriber which falls too far behind is disconnected
+        *  and recovers with the snapshot of its next connection.
+        */
+        class MarketDataPublisher
+        {
+            public:
+
+                static constexpr std::size_t RingCapacity = 65536;
+                /* Pending bytes after which a subscriber is disconnected */
+                static constexpr std::size_t MaxBacklog   = 4 * 1024 * 1024;
+
+            public:
+
+                /* Listen on the loopback interface, iPort 0 picks a free port */
+                MarketDataPublisher(std::uint16_t iPort, std::chrono::milliseconds iInterval);
+                ~MarketDataPublisher();
+
+                MarketDataPublisher(const MarketDataPublisher &) = delete;
+                MarketDataPublisher & operator=(const MarketDataPublisher &) = delete;
+
+            public:
+
+                /**/
+                bool IsOpen() const { return m_ListenFd != -1; }
+
+                /* Port the subscribers connect to */
+                std::uint16_t GetPort() const { return m_Port; }
+
+                /* Engine thread */
+                void Push(const MarketDataEvent & iEvent);
+
+                /* Pushes which found the ring full */
+                std::uint64_t GetStallCounter() const { return m_Stalls; }
+
+                /* Sequence of the last incremental message */
+                std::uint64_t GetSequence() const { return m_PublishedSequence.load(std::memory_order_acquire); }
+
+                std::uint64_t GetSubscriberCounter() const { return m_SubscriberCount.load(std::memory_order_relaxed); }
+
+                /* Subscribers disconnected because their backlog was full */
+                std::uint64_t GetSlowSubscriberCounter() const { return m_SlowSubscribers.load(std::memory_order_relaxed); }
+
+                /* Failed accepts, the publisher thread does not log */
+                std::uint64_t GetAcceptErrorCounter() const { return m_AcceptErrors.load(std::memory_order_relaxed); }
+
+            private:
+
+                struct Level
+                {
+                    std::uint64_t Quantity = 0;
+                    std::uint32_t Orders   = 0;
+                };
+
+                /* Levels by price, the key of a change is ( way, price ) */
+                using level_map   = std::map<std::uint32_t, Level>;
+                using change_key  = std::uint64_t;
+
+                struct Book
+                {
+                    level_map                          Levels[2];
+                    std::uint16_t                      Phase        = 0;
+                    bool                               PhaseChanged = false;
+                    bool                               Dirty        = false;
+                    /* State of each changed level at the previous publication */
+                    std::map<change_key, Level>        Changes;
+                    std::vector<MarketDataUpdate>      Trades;
+                };
+
+                struct Subscriber
+                {
+                    int          Fd         = -1;
+                    std::string  Backlog;
+                    /* MaxBacklog on top of the snapshot sent at the connection */
+                    std::size_t  MaxBacklog = 0;
+                };
+
+            private:
+
+                void Run();
+
+                /* Apply an event to the levels, the changes are published at the next interval */
+                void Apply(const MarketDataEvent & iEvent);
+                void ApplyLevel(Book & ioBook, std::uint8_t iWay, std::uint32_t iPrice, std::int64_t iQuantity, std::int32_t iOrders);
+
+                /* Serialize the conflated changes of every dirty book and write them to the subscribers */
+                void Publish();
+
+                /* Accept the pending connections and send them the snapshot */
+                void AcceptSubscribers();
+                void EncodeSnapshot(std::string & oBuffer) const;
+
+                /* False once the subscriber is disconnected */
+                bool Send(Subscriber & ioSubscriber, const char * iData, std::size_t iSize);
+                bool Flush(Subscriber & ioSubscriber);
+
+                static change_key MakeChangeKey(std::uint8_t iWay, std::uint32_t iPrice) { return (static_cast<change_key>(iWay) << 32) | iPrice; }
+
+            private:
+
+                using ring_type = common::SpscRing<MarketDataEvent, RingCapacity>;
+
+                int                                      m_ListenFd = -1;
+                std::uint16_t                            m_Port     = 0;
+                std::chrono::milliseconds                m_Interval;
+                std::unique_ptr<ring_type>               m_pRing;
+                std::uint64_t                            m_Stalls   = 0;
+                /* Publisher thread state */
+                std::unordered_map<std::uint32_t, Book>  m_Books;
+                std::vector<std::uint32_t>               m_DirtyBooks;
+                std::vector<Subscriber>                  m_Subscribers;
+                std::string                              m_Buffer;
+                std::vector<MarketDataUpdate>            m_Updates;
+                std::uint64_t                            m_Sequence = 0;
+                std::atomic<std::uint64_t>               m_PublishedSequence { 0 };
+                std::atomic<std::uint64_t>               m_SubscriberCount { 0 };
+                std::atomic<std::uint64_t>               m_SlowSubscribers { 0 };
+                std::atomic<std::uint64_t>               m_AcceptErrors { 0 };
+                std::atomic<bool>                        m_Stop { false };
+                std::thread                              m_Thread;
+        };
+
+    }
+}
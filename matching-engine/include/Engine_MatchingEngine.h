@@ -9,12 +9,27 @@
 
 #include <logger/Logger.h>
 
+#include <Engine_Command.h>
+#include <Engine_Instrument.h>
+#include <Engine_Journal.h>
+#include <Engine_MarketData.h>
+#include <Engine_Metrics.h>
 #include <Engine_Order.h>
 #include <Engine_OrderBook.h>
+#include <Engine_ReferenceData.h>
+#include <Engine_Snapshot.h>
 #include <Engine_Status.h>
 
+#include <NodeAllocator.h>
+#include <WorkStealingPool.h>
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <cstdint>
 
@@ -37,6 +52,8 @@ namespace exchange
 
             using OrderBookList = std::unordered_set<OrderBookType*>;
             using PriceDevFactors = std::tuple<double, double>;
+            using DealListener = std::function<void(std::uint32_t, const Deal &)>;
+            using CommandBatch = std::vector<OrderCommand>;
 
         public:
 
@@ -52,12 +69,22 @@ namespace exchange
             /**/
             Status Insert(std::unique_ptr<Order> ipOrder, std::uint32_t iProductID);
 
+            /**/
+            Status ImmediateInsert(OrderType iType, OrderWay iWay, Order::qty_type iQty, Order::price_type iPrice, Order::client_orderid_type iOrderID,
+                                   Order::client_id_type iClientID, TimeQualifier iQualifier, std::uint32_t iProductID);
+
             /**/
             Status Modify(std::unique_ptr<OrderReplace> ipOrderReplace, std::uint32_t iProductID);
 
             /**/
             Status Delete(Order::client_orderid_type iOrderID, Order::client_id_type iClientID, OrderWay iWay, std::uint32_t iProductID);
 
+            /*
+                Apply a burst of commands, grouped by product and in arrival order within each book.
+                oStatuses[i] is the reply to ioCommands[i], the inserted and modified messages are consumed.
+            */
+            void ProcessBatch(CommandBatch & ioCommands, std::vector<Status> & oStatuses);
+
             /**/
             void EngineListen();
 
@@ -89,14 +116,59 @@ namespace exchange
             /**/
             void UpdateIntradayAuctionDuration();
 
+            /* Orders of a book cancelled by the engine, still valid during the call */
+            void OnUnsolicitedCancelledOrders(std::uint32_t iProductID, const std::vector<const Order *> & iOrders);
+
+            /* Deals generated by one matching sweep of an order book */
+            void OnDeals(std::uint32_t iProductID, const std::vector<const Deal *> & iDeals);
+
+            /* Change of the open quantity and of the order count of a price level */
+            inline void OnLevelChange(std::uint32_t iProductID, OrderWay iWay, Order::price_type iPrice, std::int64_t iQuantity, std::int32_t iOrders);
+
             /**/
-            void OnUnsolicitedCancelledOrder(const Order * order);
+            inline void OnTradingPhase(std::uint32_t iProductID, TradingPhase iPhase);
+
+            /* True on a thread uncrossing a book for UncrossOrderBooks, the books do not log there */
+            static bool IsUncrossing() { return GetStagedDeals() != nullptr; }
+
+            /* Observe every deal in generation order ( order flow replay ), empty to disable */
+            void SetDealListener(DealListener iListener) { m_DealListener = std::move(iListener); }
+
+            /* Copy the engine and order book statistics to the metrics segment, if configured */
+            void PublishMetrics();
+
+            /**/
+            bool IsPublishingMetrics() const { return m_pMetricsPublisher && m_pMetricsPublisher->IsOpen(); }
+
+            /* Write-ahead journal of the accepted commands, null when disabled */
+            JournalWriter * GetJournal() { return m_pJournal.get(); }
+
+            /* Encode the books changed since the previous snapshot and write all of them in the background */
+            bool TakeSnapshot();
+
+            /* Null when the snapshots are disabled */
+            SnapshotWriter * GetSnapshotWriter() { return m_pSnapshotWriter.get(); }
+
+            /* Wait for the close prices written in the background, if any, and log the outcome */
+            void WaitClosePrices();
+
+            /* Log the outcome of the close prices written in the background once known, true when no write is pending */
+            bool PollClosePrices();
+
+            /* Instrument image mapped at startup, null when disabled */
+            const ReferenceDataImage * GetReferenceData() const { return m_pReferenceData.get(); }
+
+            /* Price level feed, null when disabled */
+            MarketDataPublisher * GetMarketData() { return m_pMarketData.get(); }
 
         protected:
 
             /**/
             void UpdateInstrumentsPhase(TradingPhase iNewPhase);
 
+            /* Switch the books with resting orders on the uncross pool, then publish their deals in product ID order */
+            void UncrossOrderBooks(TradingPhase iNewPhase);
+
             /**/
             void CheckOrderBooks(const TimeType iTime);
 
@@ -110,11 +182,53 @@ namespace exchange
             bool LoadInstruments();
 
             /**/
+            bool OpenMetricsSegment();
+
+            /* Load the last snapshot and replay the journal after it, then reopen the journal for the new commands */
+            bool RecoverJournal();
+
+            /* Books and global phase of the snapshot, oSequence is 0 when there is no usable snapshot */
+            bool LoadSnapshot(std::uint64_t & oSequence);
+
+            /**/
+            Status ApplyJournalRecord(const OrderFlowRecord & iRecord);
+
+            /* Append an accepted command to the journal, the reply is returned unchanged */
+            inline Status JournalCommand(Status iStatus, const OrderFlowRecord & iRecord);
+
+            /* Save the close prices and the peaks of the day, read back by the next warm up */
             void SaveClosePrices();
 
+            /* Outcome of WriteInstruments, logged by the engine thread */
+            struct ClosePricesOutcome
+            {
+                bool         Written     = false;
+                std::string  Error;
+                std::size_t  Instruments = 0;
+                double       Seconds     = 0;
+            };
+
+            /* Single batch, single sync, then the image is exported again when iImagePath is set. Does not log : it may run in the background */
+            static ClosePricesOutcome WriteInstruments(const std::string & iDBPath, const std::string & iImagePath, const std::vector<Instrument<Order> > & iInstruments);
+
+            /**/
+            static void LogClosePrices(const ClosePricesOutcome & iOutcome);
+
+            /* Size every book from its previous day peaks and run a synthetic order flow before the opening */
+            void WarmUp();
+
             /**/
             int GetAuctionDurationOffset(int range);
 
+            /* Deals of the book uncrossed by the current thread, null outside of UncrossOrderBooks */
+            static std::vector<const Deal *> *& GetStagedDeals();
+
+            /* Market data events of the book uncrossed by the current thread, null outside of UncrossOrderBooks */
+            static std::vector<MarketDataEvent> *& GetStagedMarketData();
+
+            /* Push an event to the feed, or keep it aside on an uncross thread */
+            inline void PublishMarketData(const MarketDataEvent & iEvent);
+
 
         private:
 
@@ -144,6 +258,73 @@ namespace exchange
             TradingPhase           m_GlobalPhase;
             /* Path of the database which store instruments */
             std::string            m_InstrumentDBPath;
+            /* Image of the instrument database, read instead of the database when it is valid */
+            std::string            m_InstrumentImagePath;
+            std::unique_ptr<ReferenceDataImage>  m_pReferenceData;
+            /* Instruments as loaded, their close price and peaks are updated at the close */
+            std::vector<Instrument<Order> >  m_Instruments;
+            /* Close prices written by a background thread instead of the engine thread */
+            bool                   m_AsyncClosePrices;
+            std::future<ClosePricesOutcome>  m_ClosePricesSaved;
+            /* Threads decoding the instrument records at startup */
+            unsigned               m_InstrumentLoadThreads;
+            /* Threads uncrossing the books at the end of an auction, no pool when there is only one */
+            unsigned               m_UncrossThreads;
+            std::unique_ptr<common::WorkStealingPool>  m_pUncrossPool;
+            /* Book uncrossed by a pool thread, the deals and market data it generated, sorted by product ID.
+               The index nodes it freed go back to the free lists of the engine thread, the orders to their
+               ConcurrentMemoryPool */
+            struct UncrossEntry
+            {
+                OrderBookType *              pOrderBook;
+                std::vector<const Deal *>    Deals;
+                std::vector<MarketDataEvent> MarketData;
+                common::DeferredNodes        FreedNodes;
+            };
+            std::vector<UncrossEntry>              m_UncrossEntries;
+            /* Optional deal observer */
+            DealListener           m_DealListener;
+            /* Commands received for a product which is not loaded */
+            std::uint64_t          m_UnknownInstrumentCounter;
+            /* Shared memory segment name, empty when the metrics are not published */
+            std::string            m_MetricsSegmentName;
+            /* Minimal delay between two publications from EngineListen */
+            std::chrono::milliseconds                m_MetricsInterval;
+            std::chrono::steady_clock::time_point    m_NextMetricsPublication;
+            std::unique_ptr<MetricsPublisher>        m_pMetricsPublisher;
+            /* Order books sorted by product ID, index of their metrics slot */
+            std::vector<const OrderBookType *>       m_MetricsOrderBooks;
+            /* Position of a batch command, sorted by product, reused from one batch to the next */
+            struct BatchEntry
+            {
+                std::uint32_t ProductID;
+                std::uint32_t Index;
+            };
+            std::vector<BatchEntry>                  m_BatchEntries;
+            /* Journal file, empty when the journal is disabled */
+            std::string                              m_JournalPath;
+            std::unique_ptr<JournalWriter>           m_pJournal;
+            /* Records of the current batch, built before the messages are consumed */
+            std::vector<OrderFlowRecord>             m_BatchRecords;
+            /* Snapshot file, empty when the snapshots are disabled */
+            std::string                              m_SnapshotPath;
+            std::chrono::seconds                     m_SnapshotInterval;
+            std::chrono::steady_clock::time_point    m_NextSnapshot;
+            std::unique_ptr<SnapshotWriter>          m_pSnapshotWriter;
+            /* Last encoded image of each book, shared with the snapshot being written */
+            std::unordered_map<std::uint32_t, SnapshotWriter::image_type> m_SnapshotImages;
+            /* Pre opening warm up, disabled by default */
+            bool                   m_WarmUp;
+            /* Insert / amend / cancel / match cycles run on a scratch book */
+            std::uint32_t          m_WarmUpIterations;
+            /* Reservation of a book which traded the previous day : max( previous day peak * headroom, minimum ) */
+            std::uint64_t          m_WarmUpMinOrders;
+            std::uint64_t          m_WarmUpMinDeals;
+            double                 m_WarmUpHeadroom;
+            /* Price level feed, -1 when disabled and 0 for any free port */
+            int                                      m_MarketDataPort;
+            std::chrono::milliseconds                m_MarketDataInterval;
+            std::unique_ptr<MarketDataPublisher>     m_pMarketData;
         };
 
     }
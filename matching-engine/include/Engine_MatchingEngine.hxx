@@ -6,6 +6,8 @@
 #include <Engine_MatchingEngine.h>
 #include <Engine_Instrument.h>
 
+#include <ScopedExit.h>
+
 #include <random>
 #include <algorithm>
 
@@ -18,12 +20,20 @@ namespace exchange
             m_StartTime(), m_StopTime(), m_AuctionEnd(),
             m_RawIntradayAuctionDuration(0), m_AuctionDurationOffsetRange(0),
             m_IntradayAuctionDuration(0), m_OpeningAuctionDuration(0), m_ClosingAuctionDuration(0),
-            m_PriceDeviationFactor(), m_GlobalPhase(TradingPhase::CLOSE)
-        {}
+            m_PriceDeviationFactor(), m_GlobalPhase(TradingPhase::CLOSE), m_AsyncClosePrices(false), m_InstrumentLoadThreads(1), m_UncrossThreads(1), m_UnknownInstrumentCounter(0),
+            m_MetricsInterval(0), m_NextMetricsPublication(), m_SnapshotInterval(0), m_NextSnapshot(),
+            m_WarmUp(false), m_WarmUpIterations(0), m_WarmUpMinOrders(0), m_WarmUpMinDeals(0), m_WarmUpHeadroom(1),
+            m_MarketDataPort(-1), m_MarketDataInterval(0)
+        {
+            // Per sweep traces are off by default, LOW enables them
+            LoggerHolder::GetInstance().AddCategory(MATCHING_LOG, "Matching", exch_logger::MEDIUM);
+        }
 
         template <typename Clock>
         MatchingEngine<Clock>::~MatchingEngine()
-        {}
+        {
+            WaitClosePrices();
+        }
 
         template <typename Clock>
         bool MatchingEngine<Clock>::Configure(boost::property_tree::ptree & iConfig)
@@ -40,6 +50,39 @@ namespace exchange
                 return false;
             }
 
+            if (m_UncrossThreads > 1)
+            {
+                m_pUncrossPool = std::make_unique<common::WorkStealingPool>(m_UncrossThreads);
+            }
+
+            if (m_WarmUp)
+            {
+                WarmUp();
+            }
+
+            // Started before the recovery : the recovered books reach the feed as any other change
+            if (m_MarketDataPort >= 0)
+            {
+                m_pMarketData = std::make_unique<MarketDataPublisher>(static_cast<std::uint16_t>(m_MarketDataPort), m_MarketDataInterval);
+                if (!m_pMarketData->IsOpen())
+                {
+                    EXERR("Failed to open the market data feed");
+                    return false;
+                }
+            }
+
+            if (!RecoverJournal())
+            {
+                EXERR("Failed to recover the journal");
+                return false;
+            }
+
+            if (!OpenMetricsSegment())
+            {
+                EXERR("Failed to open the metrics segment");
+                return false;
+            }
+
             return true;
         }
 
@@ -63,6 +106,10 @@ namespace exchange
                 m_StopTime = today_midnight + boost::posix_time::duration_from_string(StopTime);
 
                 m_InstrumentDBPath       = iConfig.get<std::string>("Engine.instrument_db_path");
+                m_InstrumentImagePath    = iConfig.get<std::string>("Engine.instrument_image_path", "");
+                m_AsyncClosePrices       = iConfig.get<bool>("Engine.async_close_prices", false);
+                m_InstrumentLoadThreads  = iConfig.get<unsigned>("Engine.instrument_load_threads", std::max(1u, std::thread::hardware_concurrency()));
+                m_UncrossThreads         = iConfig.get<unsigned>("Engine.uncross_threads", std::max(1u, std::thread::hardware_concurrency()));
 
                 // TODO : Check that that this value is not greater than 100
                 auto MaxPriceDeviationPercentage = iConfig.get<double>("Engine.max_price_deviation")*0.01;
@@ -72,6 +119,30 @@ namespace exchange
                                                             1 + MaxPriceDeviationPercentage
                                                         );
 
+                m_MetricsSegmentName = iConfig.get<std::string>("Engine.metrics_segment", "");
+                m_MetricsInterval    = std::chrono::milliseconds(iConfig.get<int>("Engine.metrics_interval_ms", 100));
+
+                m_WarmUp           = iConfig.get<bool>("Engine.warmup", false);
+                m_WarmUpIterations = iConfig.get<std::uint32_t>("Engine.warmup_iterations", 10000);
+                m_WarmUpMinOrders  = iConfig.get<std::uint64_t>("Engine.warmup_min_orders", 1000);
+                m_WarmUpMinDeals   = iConfig.get<std::uint64_t>("Engine.warmup_min_deals", 1000);
+                m_WarmUpHeadroom   = iConfig.get<double>("Engine.warmup_headroom", 1.5);
+
+                m_JournalPath = iConfig.get<std::string>("Engine.journal_path", "");
+
+                m_SnapshotPath     = iConfig.get<std::string>("Engine.snapshot_path", "");
+                m_SnapshotInterval = std::chrono::seconds(iConfig.get<int>("Engine.snapshot_interval_s", 60));
+
+                m_MarketDataPort     = iConfig.get<int>("Engine.market_data_port", -1);
+                m_MarketDataInterval = std::chrono::milliseconds(iConfig.get<int>("Engine.market_data_interval_ms", 10));
+
+                // A snapshot alone would lose the commands accepted after it
+                if (!m_SnapshotPath.empty() && m_JournalPath.empty())
+                {
+                    EXERR("MatchingEngine::LoadConfiguration : snapshot_path requires journal_path");
+                    return false;
+                }
+
                 return LoadAuctionConfiguration(iConfig);
             }
             catch (const boost::property_tree::ptree_error & Error)
@@ -137,41 +208,151 @@ namespace exchange
         template <typename Clock>
         bool MatchingEngine<Clock>::LoadInstruments()
         {
-            struct CorruptedDBException : public std::runtime_error 
+            const auto Start = std::chrono::steady_clock::now();
+
+            m_Instruments.clear();
+            m_pReferenceData.reset();
+
+            if (!m_InstrumentImagePath.empty())
             {
-                CorruptedDBException(const std::string & msg) : std::runtime_error(msg) { }
-            };
+                m_pReferenceData = std::make_unique<ReferenceDataImage>(m_InstrumentImagePath);
+                if (m_pReferenceData->IsValid() &&
+                    m_pReferenceData->GetDatabaseFingerprint() != ReferenceDataImage::GetDatabaseFingerprint(m_InstrumentDBPath))
+                {
+                    // Edited since the export, the database is read and the image exported again
+                    EXWARN("MatchingEngine::LoadInstruments : Instrument image [" << m_InstrumentImagePath << "] is older than the database, reading the database");
+                    m_pReferenceData.reset();
+                }
+                else if (m_pReferenceData->IsValid())
+                {
+                    m_Instruments.reserve(m_pReferenceData->GetInstrumentCount());
+                    m_pReferenceData->VisitInstruments([this](const InstrumentRecord & iRecord)
+                    {
+                        m_Instruments.push_back(m_pReferenceData->ToInstrument(iRecord));
+                    });
+                }
+                else
+                {
+                    if (m_pReferenceData->IsOpen())
+                    {
+                        EXWARN("MatchingEngine::LoadInstruments : Invalid instrument image [" << m_InstrumentImagePath << "], reading the database");
+                    }
+                    m_pReferenceData.reset();
+                }
+            }
 
-            try
+            if (!m_pReferenceData)
             {
-                auto InstrumentHandler = [this](const Instrument<Order> & Instrument)
+                InstrumentManager<Order> Loader(m_InstrumentDBPath);
+                if (!Loader.LoadAll(m_Instruments, m_InstrumentLoadThreads))
+                {
+                    return false;
+                }
+
+                // The next startups map the image, the fingerprint is taken while the database is still locked
+                if (!m_InstrumentImagePath.empty() &&
+                    ReferenceDataImage::Export(m_InstrumentImagePath, m_Instruments, ReferenceDataImage::GetDatabaseFingerprint(m_InstrumentDBPath)))
                 {
-                    EXINFO("MatchingEngine::LoadInstruments : Adding Instrument : " << Instrument.GetName() <<
-                            " ; ProductID : " << Instrument.GetProductId());
+                    m_pReferenceData = std::make_unique<ReferenceDataImage>(m_InstrumentImagePath);
+                }
+            }
+
+            // Sized once, the books themselves stay empty until their first order
+            m_OrderBookContainer.reserve(m_Instruments.size());
+
+            for (auto && Instrument : m_Instruments)
+            {
 #ifdef __INTEL_COMPILER
-                    auto pIterator = m_OrderBookContainer.insert( std::make_pair(Instrument.GetProductId(),
-                                                                  std::make_unique<OrderBookType>(Instrument, *this)));
+                auto pIterator = m_OrderBookContainer.insert( std::make_pair(Instrument.GetProductId(),
+                                                              std::make_unique<OrderBookType>(Instrument, *this)));
 #else
-                    auto pIterator = m_OrderBookContainer.emplace(Instrument.GetProductId(),
-                                                                  std::make_unique<OrderBookType>(Instrument, *this));
+                auto pIterator = m_OrderBookContainer.emplace(Instrument.GetProductId(),
+                                                              std::make_unique<OrderBookType>(Instrument, *this));
 #endif
-                    if (!pIterator.second)
-                    {
-                        std::string ErrorMsg = "MatchingEngine::LoadInstruments : Corrupted database, failed to insert instrument : " + Instrument.GetName();
-                        EXERR(ErrorMsg);
-                        throw CorruptedDBException(ErrorMsg);
-                    }
-                };
+                if (!pIterator.second)
+                {
+                    EXERR("MatchingEngine::LoadInstruments : Corrupted database, failed to insert instrument : " << Instrument.GetName());
+                    return false;
+                }
+            }
 
-                InstrumentManager<Order> Loader(m_InstrumentDBPath);
+            const auto Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+            EXINFO("MatchingEngine::LoadInstruments : Instruments[" << m_Instruments.size() << "] ; Source[" <<
+                   (m_pReferenceData ? m_InstrumentImagePath : m_InstrumentDBPath) << "] ; Seconds[" << Seconds << "]");
+            return true;
+        }
+
+        template <typename Clock>
+        bool MatchingEngine<Clock>::OpenMetricsSegment()
+        {
+            if (m_MetricsSegmentName.empty())
+            {
+                return true;
+            }
 
-                return Loader.Load(InstrumentHandler);
+            m_MetricsOrderBooks.clear();
+            for (auto && OrderBookEntry : m_OrderBookContainer)
+            {
+                m_MetricsOrderBooks.push_back(OrderBookEntry.second.get());
             }
-            catch (const CorruptedDBException & Error)
+            std::sort(m_MetricsOrderBooks.begin(), m_MetricsOrderBooks.end(), [](const OrderBookType * a, const OrderBookType * b)
             {
-                EXERR("MatchingEngine::LoadInstruments : " << Error.what());
+                return a->GetInstrumentID() < b->GetInstrumentID();
+            });
+
+            m_pMetricsPublisher = std::make_unique<MetricsPublisher>(m_MetricsSegmentName, static_cast<std::uint32_t>(m_MetricsOrderBooks.size()));
+            if (!m_pMetricsPublisher->IsOpen())
+            {
+                EXERR("MatchingEngine::OpenMetricsSegment : Unable to create shared memory segment[" << m_MetricsSegmentName << "]");
+                m_pMetricsPublisher.reset();
                 return false;
             }
+
+            EXINFO("MatchingEngine::OpenMetricsSegment : Publishing metrics of " << m_MetricsOrderBooks.size() << " order books to [" << m_MetricsSegmentName << "]");
+            PublishMetrics();
+            return true;
+        }
+
+        template <typename Clock>
+        void MatchingEngine<Clock>::PublishMetrics()
+        {
+            if (!IsPublishingMetrics())
+            {
+                return;
+            }
+
+            EngineMetrics Engine;
+            OrderBookMetrics Book;
+
+            for (std::uint32_t i = 0; i < m_MetricsOrderBooks.size(); ++i)
+            {
+                Book = OrderBookMetrics();
+                m_MetricsOrderBooks[i]->FillMetrics(Book);
+                m_pMetricsPublisher->PublishOrderBook(i, Book);
+
+                const auto & Counters = Book.Counters;
+                const auto Received   = Counters.Inserts + Counters.ImmediateInserts + Counters.Modifies + Counters.Deletes;
+
+                Engine.OrdersIn           += Received;
+                Engine.OrdersAccepted     += Received - Counters.Rejects;
+                Engine.OrdersRejected     += Counters.Rejects;
+                Engine.UnsolicitedCancels += Counters.UnsolicitedCancels;
+                Engine.Deals              += Book.Deals;
+                Engine.RestingOrders      += Book.BidOrders + Book.AskOrders;
+                Engine.Turnover           += Book.Turnover;
+                Engine.DailyVolume        += Book.DailyVolume;
+            }
+
+            Engine.OrdersIn            += m_UnknownInstrumentCounter;
+            Engine.OrdersRejected      += m_UnknownInstrumentCounter;
+            Engine.UnknownInstrument    = m_UnknownInstrumentCounter;
+            Engine.OrderBookCount      = static_cast<std::uint32_t>(m_MetricsOrderBooks.size());
+            Engine.MonitoredOrderBooks = static_cast<std::uint32_t>(m_MonitoredOrderBook.size());
+            Engine.GlobalPhase         = static_cast<std::uint32_t>(m_GlobalPhase);
+            Engine.Timestamp           = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                                    std::chrono::system_clock::now().time_since_epoch()).count());
+
+            m_pMetricsPublisher->PublishEngine(Engine);
         }
 
         template <typename Clock>
@@ -180,10 +361,38 @@ namespace exchange
             auto OrderBookIt = m_OrderBookContainer.find(iProductID);
             if (OrderBookIt != m_OrderBookContainer.end())
             {
-                return OrderBookIt->second->Insert( std::move(ipOrder) );
+                if (!m_pJournal)
+                {
+                    return OrderBookIt->second->Insert( std::move(ipOrder) );
+                }
+
+                const auto Record = MakeInsertRecord(*ipOrder, iProductID);
+                return JournalCommand(OrderBookIt->second->Insert( std::move(ipOrder) ), Record);
+            }
+            else
+            {
+                ++m_UnknownInstrumentCounter;
+                return Status::InstrumentNotFound;
+            }
+        }
+
+        template <typename Clock>
+        Status MatchingEngine<Clock>::ImmediateInsert(OrderType iType, OrderWay iWay, Order::qty_type iQty, Order::price_type iPrice, Order::client_orderid_type iOrderID,
+                                                      Order::client_id_type iClientID, TimeQualifier iQualifier, std::uint32_t iProductID)
+        {
+            auto OrderBookIt = m_OrderBookContainer.find(iProductID);
+            if (OrderBookIt != m_OrderBookContainer.end())
+            {
+                const auto Reply = OrderBookIt->second->ImmediateInsert(iType, iWay, iQty, iPrice, iOrderID, iClientID, iQualifier);
+                if (m_pJournal)
+                {
+                    JournalCommand(Reply, MakeImmediateInsertRecord(iType, iWay, iQty, iPrice, iOrderID, iClientID, iQualifier, iProductID));
+                }
+                return Reply;
             }
             else
             {
+                ++m_UnknownInstrumentCounter;
                 return Status::InstrumentNotFound;
             }
         }
@@ -194,10 +403,17 @@ namespace exchange
             auto OrderBookIt = m_OrderBookContainer.find(iProductID);
             if (OrderBookIt != m_OrderBookContainer.end())
             {
-                return OrderBookIt->second->Modify( std::move(ipOrderReplace) );
+                if (!m_pJournal)
+                {
+                    return OrderBookIt->second->Modify( std::move(ipOrderReplace) );
+                }
+
+                const auto Record = MakeModifyRecord(*ipOrderReplace, iProductID);
+                return JournalCommand(OrderBookIt->second->Modify( std::move(ipOrderReplace) ), Record);
             }
             else
             {
+                ++m_UnknownInstrumentCounter;
                 return Status::InstrumentNotFound;
             }
         }
@@ -208,14 +424,93 @@ namespace exchange
             auto OrderBookIt = m_OrderBookContainer.find(iProductID);
             if (OrderBookIt != m_OrderBookContainer.end())
             {
-                return OrderBookIt->second->Delete(iOrderID, iClientID,iWay);
+                const auto Reply = OrderBookIt->second->Delete(iOrderID, iClientID,iWay);
+                if (m_pJournal)
+                {
+                    JournalCommand(Reply, MakeDeleteRecord(iOrderID, iClientID, iWay, iProductID));
+                }
+                return Reply;
             }
             else
             {
+                ++m_UnknownInstrumentCounter;
                 return Status::InstrumentNotFound;
             }
         }
 
+        template <typename Clock>
+        void MatchingEngine<Clock>::ProcessBatch(CommandBatch & ioCommands, std::vector<Status> & oStatuses)
+        {
+            oStatuses.resize(ioCommands.size());
+
+            if (m_pJournal)
+            {
+                m_BatchRecords.clear();
+                for (const auto & Command : ioCommands)
+                {
+                    m_BatchRecords.push_back(MakeCommandRecord(Command));
+                }
+            }
+
+            m_BatchEntries.clear();
+            for (std::uint32_t i = 0; i < ioCommands.size(); ++i)
+            {
+                m_BatchEntries.push_back(BatchEntry{ ioCommands[i].ProductID, i });
+            }
+
+            // The index breaks the ties : commands of one product keep their arrival order
+            std::sort(m_BatchEntries.begin(), m_BatchEntries.end(), [](const BatchEntry & iLhs, const BatchEntry & iRhs)
+            {
+                return iLhs.ProductID < iRhs.ProductID || (iLhs.ProductID == iRhs.ProductID && iLhs.Index < iRhs.Index);
+            });
+
+            const auto pEnd = m_BatchEntries.data() + m_BatchEntries.size();
+            auto pFirst     = m_BatchEntries.data();
+            while (pFirst != pEnd)
+            {
+                auto pLast = pFirst;
+                while (pLast != pEnd && pLast->ProductID == pFirst->ProductID)
+                {
+                    ++pLast;
+                }
+
+                auto OrderBookIt = m_OrderBookContainer.find(pFirst->ProductID);
+                if (OrderBookIt != m_OrderBookContainer.end())
+                {
+                    OrderBookIt->second->ProcessBatch(ioCommands.data(), pFirst, pLast, oStatuses.data());
+                }
+                else
+                {
+                    for (auto pEntry = pFirst; pEntry != pLast; ++pEntry)
+                    {
+                        oStatuses[pEntry->Index] = Status::InstrumentNotFound;
+                    }
+                    m_UnknownInstrumentCounter += static_cast<std::uint64_t>(pLast - pFirst);
+                }
+
+                pFirst = pLast;
+            }
+
+            // Books are independent : the arrival order is enough to rebuild them
+            if (m_pJournal)
+            {
+                for (std::size_t i = 0; i < m_BatchRecords.size(); ++i)
+                {
+                    JournalCommand(oStatuses[i], m_BatchRecords[i]);
+                }
+            }
+        }
+
+        template <typename Clock>
+        inline Status MatchingEngine<Clock>::JournalCommand(Status iStatus, const OrderFlowRecord & iRecord)
+        {
+            if (iStatus == Status::Ok)
+            {
+                m_pJournal->Append(iRecord);
+            }
+            return iStatus;
+        }
+
         template <typename Clock>
         bool MatchingEngine<Clock>::SetGlobalPhase(TradingPhase iNewPhase)
         {
@@ -252,41 +547,354 @@ namespace exchange
         }
 
         template <typename Clock>
-        void MatchingEngine<Clock>::SaveClosePrices()
+        bool MatchingEngine<Clock>::RecoverJournal()
         {
-            InstrumentManager<Order> InstrumentManager(m_InstrumentDBPath);
+            if (m_JournalPath.empty())
+            {
+                return true;
+            }
 
-            auto update_close_price = [&InstrumentManager](const std::string & SecurityName, Order::price_type NewClosePrice)
+            std::uint64_t NextSequence = 1;
+            std::uint64_t ValidSize    = 0;
             {
-                auto key_extractor = [](const Instrument<Order> & Instrument) -> const std::string &
+                JournalReader Reader(m_JournalPath);
+                if (Reader.IsOpen() && !Reader.IsValid())
                 {
-                    return Instrument.GetName();
-                };
+                    EXERR("MatchingEngine::RecoverJournal : [" << m_JournalPath << "] is not a journal");
+                    return false;
+                }
 
-                Instrument<Order> Instrument;
+                // The deals of the recovered commands were published before the crash
+                DealListener Listener;
+                std::swap(Listener, m_DealListener);
+                auto restore_listener = common::make_scope_exit([this, &Listener]() { m_DealListener = std::move(Listener); });
 
-                if (InstrumentManager.Get(SecurityName, Instrument))
+                // Only the tail of the journal is replayed after a snapshot
+                std::uint64_t SnapshotSequence = 0;
+                if (!LoadSnapshot(SnapshotSequence))
+                {
+                    return false;
+                }
+                if (!Reader.SkipTo(SnapshotSequence))
                 {
-                    Instrument.SetClosePrice(NewClosePrice);
-                    if (!InstrumentManager.Write(Instrument, key_extractor, true, true))
+                    EXERR("MatchingEngine::RecoverJournal : [" << m_JournalPath << "] does not hold the snapshot sequence[" << SnapshotSequence << "]");
+                    return false;
+                }
+
+                std::uint64_t Commands = 0;
+                std::uint64_t Rejected = 0;
+                const auto Start = std::chrono::steady_clock::now();
+
+                OrderFlowRecord Record;
+                while (Reader.Next(Record))
+                {
+                    ++Commands;
+                    if (ApplyJournalRecord(Record) != Status::Ok)
                     {
-                        EXERR("MatchingEngine::SaveClosePrices : Unable to write instrument with SecurityName[" << SecurityName << "]");
+                        ++Rejected;
                     }
                 }
-                else
+
+                const auto Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+                if (Reader.HasCorruptedTail())
+                {
+                    EXWARN("MatchingEngine::RecoverJournal : Dropping the torn tail after sequence[" << Reader.GetLastSequence() << "]");
+                }
+                if (Rejected > 0)
+                {
+                    EXERR("MatchingEngine::RecoverJournal : " << Rejected << " journaled commands were rejected, the books differ from the journaled ones");
+                }
+                EXINFO("MatchingEngine::RecoverJournal : Commands[" << Commands << "] ; Seconds[" << Seconds << "] ; Phase[" << TradingPhaseToString(m_GlobalPhase) << "]");
+
+                NextSequence = Reader.GetLastSequence() + 1;
+                ValidSize    = Reader.GetValidSize();
+            }
+
+            m_pJournal = std::make_unique<JournalWriter>(m_JournalPath, NextSequence, ValidSize);
+            if (!m_pJournal->IsOpen())
+            {
+                m_pJournal.reset();
+                return false;
+            }
+
+            if (!m_SnapshotPath.empty())
+            {
+                m_pSnapshotWriter = std::make_unique<SnapshotWriter>(m_SnapshotPath, *m_pJournal);
+                m_NextSnapshot    = std::chrono::steady_clock::now() + m_SnapshotInterval;
+            }
+            return true;
+        }
+
+        template <typename Clock>
+        bool MatchingEngine<Clock>::LoadSnapshot(std::uint64_t & oSequence)
+        {
+            oSequence = 0;
+            if (m_SnapshotPath.empty())
+            {
+                return true;
+            }
+
+            SnapshotReader Reader(m_SnapshotPath);
+            if (!Reader.IsOpen())
+            {
+                return true;
+            }
+            if (!Reader.IsValid())
+            {
+                // The whole journal is still there
+                EXWARN("MatchingEngine::LoadSnapshot : [" << m_SnapshotPath << "] is not a valid snapshot, replaying the whole journal");
+                return true;
+            }
+
+            const auto Start = std::chrono::steady_clock::now();
+
+            m_GlobalPhase = static_cast<TradingPhase>(Reader.GetGlobalPhase());
+            if (m_GlobalPhase == TradingPhase::OPENING_AUCTION)
+            {
+                m_AuctionEnd = Clock::local_time() + m_OpeningAuctionDuration;
+            }
+            if (m_GlobalPhase == TradingPhase::CLOSING_AUCTION)
+            {
+                m_AuctionEnd = Clock::local_time() + m_ClosingAuctionDuration;
+            }
+
+            // Books created since the snapshot only follow the global phase
+            for (auto && OrderBook : m_OrderBookContainer)
+            {
+                OrderBook.second->SetTradingPhase(m_GlobalPhase);
+            }
+
+            const BookSnapshotHeader * pHeader = nullptr;
+            const OrderSnapshotRecord * pOrders = nullptr;
+            std::uint64_t Orders = 0;
+            while (Reader.Next(pHeader, pOrders))
+            {
+                auto OrderBookIt = m_OrderBookContainer.find(pHeader->ProductID);
+                if (OrderBookIt == m_OrderBookContainer.end())
+                {
+                    EXERR("MatchingEngine::LoadSnapshot : Product[" << pHeader->ProductID << "] is not loaded");
+                    return false;
+                }
+                if (!OrderBookIt->second->LoadSnapshot(*pHeader, pOrders))
                 {
-                    EXERR("MatchingEngine::SaveClosePrices : Unable to load instrument with SecurityName[" << SecurityName << "]");
+                    return false;
                 }
+                Orders += pHeader->BidOrders + pHeader->AskOrders;
+            }
+
+            const auto Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+            EXINFO("MatchingEngine::LoadSnapshot : Sequence[" << Reader.GetSequence() << "] ; Books[" << Reader.GetBookCount() << "] ; Orders["
+                   << Orders << "] ; Seconds[" << Seconds << "] ; Phase[" << TradingPhaseToString(m_GlobalPhase) << "]");
+
+            oSequence = Reader.GetSequence();
+            return true;
+        }
+
+        template <typename Clock>
+        bool MatchingEngine<Clock>::TakeSnapshot()
+        {
+            if (!m_pSnapshotWriter || m_pSnapshotWriter->IsBusy())
+            {
+                return false;
+            }
+
+            std::vector<SnapshotWriter::image_type> Images;
+            Images.reserve(m_OrderBookContainer.size());
+
+            for (auto && OrderBook : m_OrderBookContainer)
+            {
+                auto & rImage = m_SnapshotImages[OrderBook.first];
+                if (!rImage || OrderBook.second->IsSnapshotDirty())
+                {
+                    // The previous image may still be read by the writer, it is replaced and not updated
+                    auto pImage = std::make_shared<std::vector<char> >();
+                    OrderBook.second->EncodeSnapshot(*pImage);
+                    OrderBook.second->ClearSnapshotDirty();
+                    rImage = std::move(pImage);
+                }
+                Images.push_back(rImage);
+            }
+
+            return m_pSnapshotWriter->Write(m_pJournal->GetLastSequence(), static_cast<std::uint32_t>(m_GlobalPhase), std::move(Images));
+        }
+
+        template <typename Clock>
+        Status MatchingEngine<Clock>::ApplyJournalRecord(const OrderFlowRecord & iRecord)
+        {
+            if (static_cast<OrderFlowCommand>(iRecord.Command) != OrderFlowCommand::BOOK_PHASE)
+            {
+                return ReplayRecord(*this, iRecord);
+            }
+
+            auto OrderBookIt = m_OrderBookContainer.find(iRecord.ProductID);
+            if (OrderBookIt == m_OrderBookContainer.end())
+            {
+                return Status::InstrumentNotFound;
+            }
+
+            auto pBook = OrderBookIt->second.get();
+            pBook->SetTradingPhase(static_cast<TradingPhase>(iRecord.Type));
+            m_MonitoredOrderBook.erase(pBook);
+            return Status::Ok;
+        }
+
+        template <typename Clock>
+        void MatchingEngine<Clock>::SaveClosePrices()
+        {
+            // Built from the books, the database is not read again
+            for (auto && Instrument : m_Instruments)
+            {
+                auto OrderBookIt = m_OrderBookContainer.find(Instrument.GetProductId());
+                if (OrderBookIt != m_OrderBookContainer.end())
+                {
+                    auto & OrderBook = OrderBookIt->second;
+                    Instrument.SetClosePrice(OrderBook->GetClosePrice());
+                    Instrument.SetPeaks(OrderBook->GetPeakOrders(), OrderBook->GetDealCounter());
+                }
+            }
+
+            if (m_AsyncClosePrices)
+            {
+                // One write at a time, the previous one holds the database
+                WaitClosePrices();
+                m_ClosePricesSaved = std::async(std::launch::async, [DBPath = m_InstrumentDBPath, ImagePath = m_InstrumentImagePath, Instruments = m_Instruments]()
+                {
+                    return WriteInstruments(DBPath, ImagePath, Instruments);
+                });
+            }
+            else
+            {
+                LogClosePrices(WriteInstruments(m_InstrumentDBPath, m_InstrumentImagePath, m_Instruments));
+            }
+        }
+
+        template <typename Clock>
+        void MatchingEngine<Clock>::WaitClosePrices()
+        {
+            if (m_ClosePricesSaved.valid())
+            {
+                LogClosePrices(m_ClosePricesSaved.get());
+            }
+        }
+
+        template <typename Clock>
+        bool MatchingEngine<Clock>::PollClosePrices()
+        {
+            if (m_ClosePricesSaved.valid() && m_ClosePricesSaved.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                return false;
+            }
+            WaitClosePrices();
+            return true;
+        }
+
+        template <typename Clock>
+        typename MatchingEngine<Clock>::ClosePricesOutcome MatchingEngine<Clock>::WriteInstruments(const std::string & iDBPath, const std::string & iImagePath,
+                                                                                                   const std::vector<Instrument<Order> > & iInstruments)
+        {
+            auto key_extractor = [](const Instrument<Order> & Instrument) -> const std::string &
+            {
+                return Instrument.GetName();
             };
 
+            const auto Start = std::chrono::steady_clock::now();
+
+            ClosePricesOutcome Outcome;
+            Outcome.Instruments = iInstruments.size();
+
+            InstrumentManager<Order> InstrumentManager(iDBPath);
+            std::string Error;
+            if (!InstrumentManager.WriteBatch(iInstruments.begin(), iInstruments.end(), key_extractor, true, Error))
+            {
+                Outcome.Error = "Unable to write the close prices : " + Error;
+                return Outcome;
+            }
+
+            // The mapped image of the day is left untouched, the next startup maps the new one
+            if (!iImagePath.empty() && !ReferenceDataImage::Export(iImagePath, iInstruments, ReferenceDataImage::GetDatabaseFingerprint(iDBPath), Error))
+            {
+                Outcome.Error = "Unable to export the instrument image : " + Error;
+                return Outcome;
+            }
+
+            Outcome.Written = true;
+            Outcome.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+            return Outcome;
+        }
+
+        template <typename Clock>
+        void MatchingEngine<Clock>::LogClosePrices(const ClosePricesOutcome & iOutcome)
+        {
+            if (!iOutcome.Written)
+            {
+                EXERR("MatchingEngine::SaveClosePrices : Instruments[" << iOutcome.Instruments << "] ; " << iOutcome.Error);
+                return;
+            }
+            EXINFO("MatchingEngine::SaveClosePrices : Instruments[" << iOutcome.Instruments << "] ; Seconds[" << iOutcome.Seconds << "]");
+        }
+
+        template <typename Clock>
+        void MatchingEngine<Clock>::WarmUp()
+        {
+            auto GetReservation = [this](std::uint64_t iPeak, std::uint64_t iMinimum)
+            {
+                return static_cast<size_t>(std::max<double>(iPeak * m_WarmUpHeadroom, iMinimum));
+            };
+
+            // A book which did not trade the previous day stays lazily allocated
+            size_t Books = 0, TotalOrders = 0, TotalDeals = 0;
             for (auto && OrderBookEntry : m_OrderBookContainer)
             {
-                auto & OrderBook          = OrderBookEntry.second;
-                const auto & SecurityName = OrderBook->GetSecurityName();
-                auto NewClosePrice        = OrderBook->GetClosePrice();
+                auto & pOrderBook = OrderBookEntry.second;
+
+                if (pOrderBook->GetPreviousPeakOrders() == 0 && pOrderBook->GetPreviousPeakDeals() == 0)
+                {
+                    continue;
+                }
+
+                const auto Orders = GetReservation(pOrderBook->GetPreviousPeakOrders(), m_WarmUpMinOrders);
+                const auto Deals  = GetReservation(pOrderBook->GetPreviousPeakDeals(), m_WarmUpMinDeals);
+                pOrderBook->Reserve(Orders, Deals);
+
+                ++Books;
+                TotalOrders += Orders;
+                TotalDeals  += Deals;
+            }
+
+            EXINFO("MatchingEngine::WarmUp : Books[" << Books << "/" << m_OrderBookContainer.size() << "] ; Orders[" << TotalOrders << "] ; Deals[" << TotalDeals << "]");
+
+            // The synthetic flow runs on a scratch book : the loaded books and the deal observer never see it
+            DealListener Listener;
+            std::swap(Listener, m_DealListener);
+            auto restore_listener = common::make_scope_exit([this, &Listener]() { m_DealListener = std::move(Listener); });
+
+            Instrument<Order> WarmUpInstrument("WarmUp", "WARMUP", "EUR", 0, 1000_price);
+            OrderBookType OrderBook(WarmUpInstrument, *this);
+            OrderBook.SetTradingPhase(TradingPhase::CONTINUOUS_TRADING);
+
+            // Every price stays inside the collars, the scratch book never switches to intraday auction
+            std::uint32_t OrderID = 0;
+            for (std::uint32_t i = 0; i < m_WarmUpIterations; ++i)
+            {
+                const auto BuyID  = ClientOrderID(++OrderID);
+                const auto SellID = ClientOrderID(++OrderID);
+                OrderBook.Insert(std::make_unique<Order>(OrderWay::BUY, 100_qty, 990_price, BuyID, 1_clientid));
+                OrderBook.Insert(std::make_unique<Order>(OrderWay::SELL, 100_qty, 1010_price, SellID, 2_clientid));
+
+                const auto AmendedID = ClientOrderID(++OrderID);
+                OrderBook.Modify(std::make_unique<OrderReplace>(OrderWay::BUY, 50_qty, 990_price, BuyID, AmendedID, 1_clientid));
+                OrderBook.Delete(AmendedID, 1_clientid, OrderWay::BUY);
+                OrderBook.Delete(SellID, 2_clientid, OrderWay::SELL);
 
-                update_close_price(SecurityName, NewClosePrice);
+                OrderBook.Insert(std::make_unique<Order>(OrderWay::SELL, 10_qty, 1000_price, ClientOrderID(++OrderID), 2_clientid));
+                OrderBook.Insert(std::make_unique<Order>(OrderWay::BUY, 10_qty, 1000_price, ClientOrderID(++OrderID), 1_clientid));
+
+                OrderBook.Insert(std::make_unique<Order>(OrderWay::BUY, 10_qty, 1000_price, ClientOrderID(++OrderID), 1_clientid));
+                OrderBook.ImmediateInsert(OrderType::LIMIT, OrderWay::SELL, 10_qty, 1000_price, ClientOrderID(++OrderID), 2_clientid, TimeQualifier::IOC);
             }
+
+            EXINFO("MatchingEngine::WarmUp : Iterations[" << m_WarmUpIterations << "] ; Deals[" << OrderBook.GetDealCounter() << "]");
         }
 
         template <typename Clock>
@@ -299,11 +907,112 @@ namespace exchange
 
                 m_GlobalPhase = iNewPhase;
 
-                for (auto && OrderBook : m_OrderBookContainer)
+                // Leaving an auction matches every book, nothing else is worth the pool
+                if (m_pUncrossPool && (iNewPhase == TradingPhase::CONTINUOUS_TRADING || iNewPhase == TradingPhase::CLOSE))
                 {
-                    OrderBook.second->SetTradingPhase(iNewPhase);
+                    UncrossOrderBooks(iNewPhase);
                 }
+                else
+                {
+                    for (auto && OrderBook : m_OrderBookContainer)
+                    {
+                        OrderBook.second->SetTradingPhase(iNewPhase);
+                    }
+                }
+
+                if (m_pJournal)
+                {
+                    m_pJournal->Append(MakePhaseRecord(iNewPhase));
+                }
+            }
+        }
+
+        template <typename Clock>
+        void MatchingEngine<Clock>::UncrossOrderBooks(TradingPhase iNewPhase)
+        {
+            const auto Start = std::chrono::steady_clock::now();
+
+            // Books without resting orders only change their phase
+            std::size_t Count = 0;
+            for (auto && OrderBook : m_OrderBookContainer)
+            {
+                auto pOrderBook = OrderBook.second.get();
+                if (pOrderBook->GetOrderCount() == 0)
+                {
+                    pOrderBook->SetTradingPhase(iNewPhase);
+                    continue;
+                }
+
+                if (Count == m_UncrossEntries.size())
+                {
+                    m_UncrossEntries.emplace_back();
+                }
+                m_UncrossEntries[Count].pOrderBook = pOrderBook;
+                m_UncrossEntries[Count].Deals.clear();
+                m_UncrossEntries[Count].MarketData.clear();
+                ++Count;
+            }
+
+            std::sort(m_UncrossEntries.begin(), m_UncrossEntries.begin() + Count, [](const UncrossEntry & iLhs, const UncrossEntry & iRhs)
+            {
+                return iLhs.pOrderBook->GetInstrumentID() < iRhs.pOrderBook->GetInstrumentID();
+            });
+
+            // A book only touches its own state, the deals are kept aside instead of reaching the listener
+            m_pUncrossPool->Run(Count, [this, iNewPhase](std::size_t iIndex)
+            {
+                auto & rEntry = m_UncrossEntries[iIndex];
+                GetStagedDeals()                  = &rEntry.Deals;
+                GetStagedMarketData()             = &rEntry.MarketData;
+                common::DeferredNodes::GetCurrent() = &rEntry.FreedNodes;
+                rEntry.pOrderBook->SetTradingPhase(iNewPhase);
+                GetStagedDeals()                  = nullptr;
+                GetStagedMarketData()             = nullptr;
+                common::DeferredNodes::GetCurrent() = nullptr;
+            });
+
+            std::size_t Deals = 0;
+            for (std::size_t i = 0; i < Count; ++i)
+            {
+                auto & rEntry = m_UncrossEntries[i];
+                // Kept by a pool thread, the nodes would only serve its next uncross
+                rEntry.FreedNodes.Release();
+                for (auto && rEvent : rEntry.MarketData)
+                {
+                    PublishMarketData(rEvent);
+                }
+                OnDeals(rEntry.pOrderBook->GetInstrumentID(), rEntry.Deals);
+                Deals += rEntry.Deals.size();
+            }
+
+            const auto Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+            EXINFO("MatchingEngine::UncrossOrderBooks : Phase[" << TradingPhaseToString(iNewPhase) << "] ; Books[" << Count << "] ; Deals[" << Deals << "] ; Threads[" << m_pUncrossPool->GetThreadCount() <<
+                   "] ; Milliseconds[" << Milliseconds << "]");
+        }
+
+        template <typename Clock>
+        std::vector<const Deal *> *& MatchingEngine<Clock>::GetStagedDeals()
+        {
+            static thread_local std::vector<const Deal *> * s_pStagedDeals = nullptr;
+            return s_pStagedDeals;
+        }
+
+        template <typename Clock>
+        std::vector<MarketDataEvent> *& MatchingEngine<Clock>::GetStagedMarketData()
+        {
+            static thread_local std::vector<MarketDataEvent> * s_pStagedMarketData = nullptr;
+            return s_pStagedMarketData;
+        }
+
+        template <typename Clock>
+        inline void MatchingEngine<Clock>::PublishMarketData(const MarketDataEvent & iEvent)
+        {
+            if (auto pStagedMarketData = GetStagedMarketData())
+            {
+                pStagedMarketData->push_back(iEvent);
+                return;
             }
+            m_pMarketData->Push(iEvent);
         }
 
         template <typename Clock>
@@ -316,6 +1025,10 @@ namespace exchange
                 if (Now > pBook->GetAuctionEnd())
                 {
                     pBook->SetTradingPhase(m_GlobalPhase);
+                    if (m_pJournal)
+                    {
+                        m_pJournal->Append(MakePhaseRecord(m_GlobalPhase, OrderFlowCommand::BOOK_PHASE, pBook->GetInstrumentID()));
+                    }
                     iterator = m_MonitoredOrderBook.erase(iterator);
                 }
                 else
@@ -376,6 +1089,29 @@ namespace exchange
                 default:
                     break;
             }
+
+            // A failed write is reported as soon as it ends, not at the next close
+            PollClosePrices();
+
+            if (m_pSnapshotWriter)
+            {
+                const auto SteadyNow = std::chrono::steady_clock::now();
+                if (SteadyNow >= m_NextSnapshot)
+                {
+                    TakeSnapshot();
+                    m_NextSnapshot = SteadyNow + m_SnapshotInterval;
+                }
+            }
+
+            if (m_pMetricsPublisher)
+            {
+                const auto SteadyNow = std::chrono::steady_clock::now();
+                if (SteadyNow >= m_NextMetricsPublication)
+                {
+                    PublishMetrics();
+                    m_NextMetricsPublication = SteadyNow + m_MetricsInterval;
+                }
+            }
         }
 
         template <typename Clock>
@@ -406,16 +1142,94 @@ namespace exchange
         template <typename Clock>
         void MatchingEngine<Clock>::CancelAllOrders()
         {
+            std::size_t Orders = 0;
             for (auto && OrderBook : m_OrderBookContainer)
             {
+                Orders += OrderBook.second->GetOrderCount();
                 OrderBook.second->CancelAllOrders();
             }
+
+            EXINFO("MatchingEngine::CancelAllOrders : Books[" << m_OrderBookContainer.size() << "] ; Orders[" << Orders << "]");
+
+            if (m_pJournal)
+            {
+                m_pJournal->Append(MakePhaseRecord(m_GlobalPhase, OrderFlowCommand::CANCEL_ALL));
+            }
+        }
+
+        template <typename Clock>
+        void MatchingEngine<Clock>::OnUnsolicitedCancelledOrders(std::uint32_t iProductID, const std::vector<const Order *> & iOrders)
+        {
+            EXLOG(MATCHING_LOG, exch_logger::LOW, "MatchingEngine::OnUnsolicitedCancelledOrders : ProductID[" << iProductID << "] ; Orders[" << iOrders.size() << "]");
+
+            // The batch holds every resting order of the book
+            if (m_pMarketData)
+            {
+                MarketDataEvent Event;
+                Event.ProductID = iProductID;
+                Event.Type      = MarketDataEventType::CLEAR;
+                PublishMarketData(Event);
+            }
         }
 
         template <typename Clock>
-        void MatchingEngine<Clock>::OnUnsolicitedCancelledOrder(const Order * order)
+        inline void MatchingEngine<Clock>::OnLevelChange(std::uint32_t iProductID, OrderWay iWay, Order::price_type iPrice, std::int64_t iQuantity, std::int32_t iOrders)
         {
-            EXINFO("MatchingEngine::OnUnsolicitedCancelledOrder : " << *order);
+            if (m_pMarketData)
+            {
+                MarketDataEvent Event;
+                Event.ProductID = iProductID;
+                Event.Type      = MarketDataEventType::LEVEL;
+                Event.Way       = static_cast<std::uint8_t>(iWay);
+                Event.Price     = static_cast<std::uint32_t>(iPrice);
+                Event.Orders    = iOrders;
+                Event.Quantity  = iQuantity;
+                PublishMarketData(Event);
+            }
+        }
+
+        template <typename Clock>
+        inline void MatchingEngine<Clock>::OnTradingPhase(std::uint32_t iProductID, TradingPhase iPhase)
+        {
+            if (m_pMarketData)
+            {
+                MarketDataEvent Event;
+                Event.ProductID = iProductID;
+                Event.Type      = MarketDataEventType::PHASE;
+                Event.Phase     = static_cast<std::uint16_t>(iPhase);
+                PublishMarketData(Event);
+            }
+        }
+
+        template <typename Clock>
+        void MatchingEngine<Clock>::OnDeals(std::uint32_t iProductID, const std::vector<const Deal *> & iDeals)
+        {
+            if (auto pStagedDeals = GetStagedDeals())
+            {
+                pStagedDeals->insert(pStagedDeals->end(), iDeals.begin(), iDeals.end());
+                return;
+            }
+
+            if (m_pMarketData)
+            {
+                MarketDataEvent Event;
+                Event.ProductID = iProductID;
+                Event.Type      = MarketDataEventType::TRADE;
+                for (auto pDeal : iDeals)
+                {
+                    Event.Price    = static_cast<std::uint32_t>(pDeal->GetPrice());
+                    Event.Quantity = static_cast<std::uint32_t>(pDeal->GetQuantity());
+                    m_pMarketData->Push(Event);
+                }
+            }
+
+            if (m_DealListener)
+            {
+                for (auto pDeal : iDeals)
+                {
+                    m_DealListener(iProductID, *pDeal);
+                }
+            }
         }
 
     }
@@ -0,0 +1,169 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <SeqLock.h>
+#include <SharedMemory.h>
+
+#include <cstdint>
+#include <string>
+
+namespace exchange
+{
+    namespace engine
+    {
+
+        /* Order entry counters maintained by each order book on the engine thread */
+        struct OrderBookCounters
+        {
+            std::uint64_t Inserts            = 0;
+            std::uint64_t ImmediateInserts   = 0;
+            std::uint64_t Modifies           = 0;
+            std::uint64_t Deletes            = 0;
+            std::uint64_t Rejects            = 0;
+            std::uint64_t UnsolicitedCancels = 0;
+        };
+
+        /*!
+        *  \brief OrderBookMetrics
+        *
+        *  Snapshot of one order book as published in the metrics segment.
+        *  Phase holds a TradingPhase, prices are in ticks.
+        */
+        struct OrderBookMetrics
+        {
+            char          SecurityName[32]   = {};
+            std::uint32_t ProductID          = 0;
+            std::uint32_t Phase              = 0;
+            OrderBookCounters Counters;
+            std::uint64_t Deals              = 0;
+            std::uint64_t Turnover           = 0;
+            std::uint64_t DailyVolume        = 0;
+            std::uint32_t LastPrice          = 0;
+            std::uint32_t OpenPrice          = 0;
+            std::uint32_t ClosePrice         = 0;
+            std::uint32_t BidOrders          = 0;
+            std::uint32_t AskOrders          = 0;
+            std::uint32_t BidLevels          = 0;
+            std::uint32_t AskLevels          = 0;
+            std::uint32_t Padding            = 0;
+            /* Deals currently allocated from the order book deal pool */
+            std::uint64_t DealPoolUsed       = 0;
+        };
+
+        /*!
+        *  \brief EngineMetrics
+        *
+        *  Engine wide totals. Orders in are all the commands received, orders out the replies
+        *  ( accepted + rejected ) and the unsolicited cancellations.
+        */
+        struct EngineMetrics
+        {
+            /* System clock nanoseconds of the publication */
+            std::uint64_t Timestamp           = 0;
+            std::uint64_t OrdersIn            = 0;
+            std::uint64_t OrdersAccepted      = 0;
+            std::uint64_t OrdersRejected      = 0;
+            std::uint64_t UnsolicitedCancels  = 0;
+            std::uint64_t UnknownInstrument   = 0;
+            std::uint64_t Deals               = 0;
+            std::uint64_t RestingOrders       = 0;
+            std::uint64_t Turnover            = 0;
+            std::uint64_t DailyVolume         = 0;
+            std::uint32_t OrderBookCount      = 0;
+            /* Order books waiting for the end of their intraday auction */
+            std::uint32_t MonitoredOrderBooks = 0;
+            std::uint32_t GlobalPhase         = 0;
+            std::uint32_t Padding             = 0;
+        };
+
+        /*!
+        *  \brief MetricsSegmentHeader
+        *
+        *  Layout of the segment : this header, then OrderBookCount SeqLock<OrderBookMetrics> slots.
+        */
+        struct MetricsSegmentHeader
+        {
+            static constexpr std::uint32_t CurrentVersion = 1;
+
+            char                   Magic[8]       = {};
+            std::uint32_t          Version        = 0;
+            std::uint32_t          OrderBookCount = 0;
+            common::SeqLock<EngineMetrics> Engine;
+        };
+
+        /*!
+        *  \brief MetricsPublisher
+        *
+        *  Writer side of the metrics segment, owned by the engine thread. A store is a plain copy
+        *  bracketed by two sequence increments : no syscall, no lock, no wait on the readers.
+        */
+        class MetricsPublisher
+        {
+            public:
+
+                MetricsPublisher(const std::string & iSegmentName, std::uint32_t iOrderBookCount);
+
+                MetricsPublisher(const MetricsPublisher &) = delete;
+                MetricsPublisher & operator=(const MetricsPublisher &) = delete;
+
+            public:
+
+                bool IsOpen() const { return m_pHeader != nullptr; }
+
+                /**/
+                void PublishEngine(const EngineMetrics & iMetrics);
+
+                /* iIndex is the order book slot, lower than GetOrderBookCount() */
+                void PublishOrderBook(std::uint32_t iIndex, const OrderBookMetrics & iMetrics);
+
+                std::uint32_t GetOrderBookCount() const { return IsOpen() ? m_pHeader->OrderBookCount : 0; }
+
+            private:
+                common::SharedMemorySegment            m_Segment;
+                MetricsSegmentHeader *                 m_pHeader     = nullptr;
+                common::SeqLock<OrderBookMetrics> *    m_pOrderBooks = nullptr;
+        };
+
+        /*!
+        *  \brief MetricsReader
+        *
+        *  Reader side, maps the segment read only. Reads never write to the segment and
+        *  never block the publisher, they retry while a store is in progress.
+        */
+        class MetricsReader
+        {
+            public:
+
+                explicit MetricsReader(const std::string & iSegmentName);
+
+                MetricsReader(const MetricsReader &) = delete;
+                MetricsReader & operator=(const MetricsReader &) = delete;
+
+            public:
+
+                /* Mapped, with the expected magic and version */
+                bool IsValid() const { return m_pHeader != nullptr; }
+
+                /**/
+                bool ReadEngine(EngineMetrics & oMetrics) const;
+
+                /**/
+                bool ReadOrderBook(std::uint32_t iIndex, OrderBookMetrics & oMetrics) const;
+
+                /* Number of completed engine publications */
+                std::uint64_t GetVersion() const { return IsValid() ? m_pHeader->Engine.GetVersion() : 0; }
+
+                std::uint32_t GetOrderBookCount() const { return IsValid() ? m_pHeader->OrderBookCount : 0; }
+
+            private:
+                common::SharedMemorySegment               m_Segment;
+                const MetricsSegmentHeader *              m_pHeader     = nullptr;
+                const common::SeqLock<OrderBookMetrics> * m_pOrderBooks = nullptr;
+        };
+
+    }
+}
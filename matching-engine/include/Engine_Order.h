@@ -7,6 +7,9 @@
 
 #include <type_traits>
 #include <iosfwd>
+
+#include <ConcurrentMemoryPool.h>
+
 #include <Engine_Types.h>
 
 namespace exchange
@@ -36,7 +39,30 @@ namespace exchange
             MAX_STATE
         };
 
+        /*!
+         * OrderType
+         */
+        enum class OrderType
+        {
+            LIMIT = 0,
+            MARKET,
+            MAX_TYPE
+        };
+
+        /*!
+         * TimeQualifier
+         */
+        enum class TimeQualifier
+        {
+            DAY = 0,
+            IOC,
+            FOK,
+            MAX_QUALIFIER
+        };
+
         const char * OrderWayToString(OrderWay iPhase);
+        const char * OrderTypeToString(OrderType iType);
+        const char * TimeQualifierToString(TimeQualifier iQualifier);
 
         /*!
         *  \brief Order
@@ -59,21 +85,31 @@ namespace exchange
             
             protected:
 
-                #pragma pack(1)
+                /*
+                *  Fields read by the matching loop ( price, open quantity, ID and way ) are stored first,
+                *  they are naturally aligned and fit in 16 bytes. The remaining fields are only
+                *  read when an order is created, amended or reported.
+                */
                 struct Layout
                 {
                     Layout(){}
                     Layout(OrderWay iWay, qty_type iQty, price_type iPrice, client_orderid_type iOrderID, client_id_type iClientID)
-                        :m_Way(iWay), m_Qty(iQty), m_Price(iPrice), m_OrderID(iOrderID), m_ClientID(iClientID)
+                        :m_Price(iPrice), m_OpenQty(iQty), m_OrderID(iOrderID), m_Way(iWay), m_Qty(iQty), m_ClientID(iClientID)
                     {}
 
-                    OrderWay              m_Way      = OrderWay::MAX_WAY;
-                    qty_type              m_Qty      = qty_type(0);
-                    price_type            m_Price    = price_type(0);
-                    client_orderid_type   m_OrderID  = client_orderid_type(0);
-                    client_id_type        m_ClientID = client_id_type(0);
+                    /* Hot part */
+                    price_type            m_Price        = price_type(0);
+                    qty_type              m_OpenQty      = qty_type(0);
+                    client_orderid_type   m_OrderID      = client_orderid_type(0);
+                    OrderWay              m_Way          = OrderWay::MAX_WAY;
+
+                    /* Cold part */
+                    qty_type              m_Qty          = qty_type(0);
+                    client_id_type        m_ClientID     = client_id_type(0);
+                    qty_type              m_ExecutedQty  = 0_qty;
+                    qty_type              m_CancelledQty = 0_qty;
+                    OrderState            m_OrderState   = OrderState::UNDEF;
                 };
-                #pragma pack()
 
             public:
 
@@ -86,6 +122,11 @@ namespace exchange
                 Order(const Order & rhs) = delete;
                 Order& operator=(const Order & rhs) = delete;
 
+                /* Created and mostly deleted on the engine thread, the uncross pool threads delete the orders they fill, see ConcurrentMemoryPool */
+                static void * operator new(std::size_t iSize);
+                static void   operator delete(void * pOrder, std::size_t iSize) noexcept;
+                static void * operator new(std::size_t, void * pPlace) noexcept { return pPlace; }
+
                 inline OrderWay            GetWay()               const;
                 inline OrderState          GetState()             const;
 
@@ -108,13 +149,29 @@ namespace exchange
 
             protected:
                 Layout      m_Layout;
-                OrderState  m_OrderState   = OrderState::UNDEF;
-                qty_type    m_ExecutedQty  = 0_qty;
-                qty_type    m_CancelledQty = 0_qty;
         };
 
         std::ostream& operator<<(std::ostream& o, const Order & x);
 
+        using OrderPool = common::ConcurrentMemoryPool<Order>;
+
+        inline void * Order::operator new(std::size_t iSize)
+        {
+            return iSize == sizeof(Order) ? OrderPool::Allocate() : ::operator new(iSize);
+        }
+
+        inline void Order::operator delete(void * pOrder, std::size_t iSize) noexcept
+        {
+            if (iSize == sizeof(Order))
+            {
+                OrderPool::Deallocate(pOrder);
+            }
+            else
+            {
+                ::operator delete(pOrder);
+            }
+        }
+
         inline OrderWay Order::GetWay() const
         {
             return m_Layout.m_Way;
@@ -122,7 +179,7 @@ namespace exchange
 
         inline OrderState Order::GetState() const
         {
-            return m_OrderState;
+            return m_Layout.m_OrderState;
         }
 
         inline Order::qty_type Order::GetQuantity() const
@@ -132,17 +189,17 @@ namespace exchange
 
         inline Order::qty_type Order::GetOpenQuantity() const
         {
-            return m_Layout.m_Qty - GetExecutedQuantity() - GetCancelledQuantity();
+            return m_Layout.m_OpenQty;
         }
 
         inline Order::qty_type Order::GetExecutedQuantity() const
         {
-            return m_ExecutedQty;
+            return m_Layout.m_ExecutedQty;
         }
 
         inline Order::qty_type Order::GetCancelledQuantity() const
         {
-            return m_CancelledQty;
+            return m_Layout.m_CancelledQty;
         }
 
         inline Order::price_type Order::GetPrice() const
@@ -162,7 +219,8 @@ namespace exchange
         
         inline void Order::SetQuantity(qty_type iQty)
         {
-            m_Layout.m_Qty = iQty;
+            m_Layout.m_Qty     = iQty;
+            m_Layout.m_OpenQty = iQty - GetExecutedQuantity() - GetCancelledQuantity();
         }
 
         inline void Order::SetOrderID(client_orderid_type iOrderID)
@@ -177,7 +235,8 @@ namespace exchange
 
         inline void Order::AddExecutedQuantity(qty_type iQty)
         {
-            m_ExecutedQty += iQty;
+            m_Layout.m_ExecutedQty += iQty;
+            m_Layout.m_OpenQty     -= iQty;
         }
 
         inline bool Order::operator==(const Order & rhs) const
@@ -355,5 +414,38 @@ namespace exchange
                 qty_type m_new_value;
         };
 
+        /*!
+        *  \brief Functor to amend the quantity and the ID of an order
+        *
+        *  The price is left untouched, so when this functor is provided to Index::modify
+        *  the order keeps its position ( and its time priority ) in the price index.
+        *
+        */
+        template <typename Order>
+        class AmendUpdater
+        {
+            public:
+
+                using OrderType           = std::remove_pointer_t<Order>;
+                using qty_type            = typename OrderType::qty_type;
+                using client_orderid_type = typename OrderType::client_orderid_type;
+
+            public:
+
+                AmendUpdater(qty_type NewQty, client_orderid_type NewOrderID) :m_new_qty(NewQty), m_new_order_id(NewOrderID){}
+
+                void operator()(Order& iOrder) const
+                {
+                    iOrder->SetQuantity(m_new_qty);
+                    iOrder->SetOrderID(m_new_order_id);
+                }
+
+            private:
+                /*!< New quantity to set */
+                qty_type            m_new_qty;
+                /*!< New order ID to set */
+                client_orderid_type m_new_order_id;
+        };
+
     }
 }
@@ -7,14 +7,19 @@
 
 #include <logger/Logger.h>
 
+#include <Engine_Command.h>
 #include <Engine_Order.h>
 #include <Engine_EventHandler.h>
 #include <Engine_OrderContainer.h>
 #include <Engine_Instrument.h>
+#include <Engine_Metrics.h>
+#include <Engine_Snapshot.h>
 #include <Engine_Status.h>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include <atomic>
+
 namespace exchange
 {
     namespace engine
@@ -54,9 +59,14 @@ namespace exchange
                 /**/
                 using OrderContainerType = OrderContainer<TOrder, OrderBook>;
                 using EventHandlerType = EventHandler<OrderBook<TOrder,TMatchingEngine> >;
+                using deal_span_type   = typename EventHandlerType::deal_span_type;
+                using order_span_type  = typename EventHandlerType::order_span_type;
 
-                using price_type = typename TOrder::price_type;
-                using TimeType   = boost::posix_time::ptime;
+                using price_type          = typename TOrder::price_type;
+                using qty_type            = typename TOrder::qty_type;
+                using client_orderid_type = typename TOrder::client_orderid_type;
+                using client_id_type      = typename TOrder::client_id_type;
+                using TimeType            = boost::posix_time::ptime;
 
             public:
 
@@ -80,6 +90,9 @@ namespace exchange
                 /**/
                 Status Insert(std::unique_ptr<TOrder> ipOrder);
 
+                /**/
+                Status ImmediateInsert(OrderType iType, OrderWay iWay, qty_type iQty, price_type iPrice, client_orderid_type iOrderID, client_id_type iClientID, TimeQualifier iQualifier);
+
                 /**/
                 template <typename TOrderReplace>
                 Status Modify(std::unique_ptr<TOrderReplace> ipOrderReplace);
@@ -87,11 +100,24 @@ namespace exchange
                 /**/
                 Status Delete(Order::client_orderid_type iOrderID, Order::client_id_type iClientID, OrderWay iWay);
 
-                /**/
-                void ProcessDeal(const Deal * ipDeal);
+                /*
+                    Commands of this book in arrival order, ioCommands[Entry.Index] for each entry : all of them are
+                    validated first, then applied. oStatuses[Entry.Index] receives the reply of each command.
+                */
+                template <typename TCommand, typename TEntry>
+                void ProcessBatch(TCommand * ioCommands, const TEntry * iFirst, const TEntry * iLast, Status * oStatuses);
 
-                /**/
-                void ProcessUnsolicitedCancelledOrder(const Order * order);
+                /* Update the book statistics once for all the deals of a matching sweep */
+                void ProcessDeals(const deal_span_type & iDeals);
+
+                /* Count the cancelled orders and notify the engine once for the whole book */
+                void ProcessUnsolicitedCancelledOrders(const order_span_type & iOrders);
+
+                /* Forward the change of a price level to the engine market data */
+                inline void ProcessLevelChange(OrderWay iWay, price_type iPrice, std::int64_t iQuantity, std::int32_t iOrders);
+
+                /* Switch the book to intraday auction, the collars prevented a deal */
+                void ProcessPriceCollarBreach();
 
                 /**/
                 TimeType GetAuctionEnd() const { return m_AuctionEnd; }
@@ -100,7 +126,32 @@ namespace exchange
                 void CancelAllOrders();
 
                 /**/
-                void RehashOrderIndexes(size_t size) { m_Orders.RehashIndexes(size); }
+                void RehashOrderIndexes(size_t size) { GetOrders().RehashIndexes(size); }
+
+                /* Pre fault the order index nodes and the deal slots before the opening */
+                void Reserve(size_t iOrders, size_t iDeals);
+
+                /* Append the statistics and the resting orders of the book to oImage, see BookSnapshotHeader */
+                void EncodeSnapshot(std::vector<char> & oImage) const;
+
+                /* Rebuild an empty book from a snapshot without matching, iOrders holds the bids then the asks */
+                bool LoadSnapshot(const BookSnapshotHeader & iHeader, const OrderSnapshotRecord * iOrders);
+
+                /* Set by every command and phase change, cleared once the book is encoded in a snapshot */
+                inline bool IsSnapshotDirty() const { return m_SnapshotDirty; }
+                inline void ClearSnapshotDirty() { m_SnapshotDirty = false; }
+
+                /* The resting orders are only allocated with the first order of the book */
+                inline bool IsMaterialized() const { return m_pOrders != nullptr; }
+
+                /* Resting orders, without allocating the container */
+                inline std::size_t GetOrderCount() const;
+
+                /*
+                    Best levels of the book as of the end of the last command, may be called from any thread.
+                    Empty until the first order, false if the engine thread kept the snapshot busy
+                */
+                bool LoadDepth(BookDepth & oDepth) const;
                 
             public:
 
@@ -115,13 +166,20 @@ namespace exchange
                 inline TradingPhase        GetTradingPhase() const { return m_Phase;                }
                 inline price_type          GetPostAuctionPrice() const { return m_PostAuctionPrice; }
                 inline const std::string & GetSecurityName() const { return m_SecurityName;         }
+                inline const OrderBookCounters & GetCounters() const { return m_Counters;           }
+                inline std::uint64_t       GetPeakOrders() const { return m_PeakOrders;             }
+                inline std::uint64_t       GetPreviousPeakOrders() const { return m_PreviousPeakOrders; }
+                inline std::uint64_t       GetPreviousPeakDeals() const { return m_PreviousPeakDeals;   }
+
+                /* Snapshot published in the metrics segment, only counters are read */
+                void FillMetrics(OrderBookMetrics & oMetrics) const;
 
                 inline void SetClosePrice(price_type iPrice) { m_ClosePrice = iPrice;                                   }
                 inline void SetLastPrice(price_type iPrice) { m_LastPrice = iPrice;                                     }
                 inline void SetTurnover(nominal_type iTurnOver) { m_Turnover = iTurnOver; }
                 inline void SetDailyVolume(volume_type iDailyVolume) { m_DailyVolume = iDailyVolume; }
                 inline void SetOpenPrice(price_type iOpenPrice) { m_OpenPrice = iOpenPrice;                             }
-                inline void SetPostAuctionPrice(price_type iPostAuctionPrice) { m_PostAuctionPrice = iPostAuctionPrice; }
+                inline void SetPostAuctionPrice(price_type iPostAuctionPrice) { m_PostAuctionPrice = iPostAuctionPrice; UpdatePriceCollars(); }
 
                 /*
                 */
@@ -133,17 +191,43 @@ namespace exchange
                 template <typename Msg>
                 Status CheckOrder(const std::unique_ptr<Msg> & ipMsg) const;
 
+                /**/
+                Status CheckOrder(qty_type iQty, price_type iPrice, OrderWay iWay) const;
+
+                /* Qualifier, type, quantity and price of an IOC / FOK order, the phase is checked when it is applied */
+                Status CheckImmediateOrder(OrderType iType, OrderWay iWay, qty_type iQty, price_type iPrice, TimeQualifier iQualifier) const;
+
+                static inline price_type GetImmediatePrice(OrderType iType, OrderWay iWay, price_type iPrice);
+
+                /* Apply an already checked command, iCheck is the result of the check */
+                Status ApplyInsert(std::unique_ptr<TOrder> ipOrder, Status iCheck);
+                Status ApplyImmediateInsert(OrderType iType, OrderWay iWay, qty_type iQty, price_type iPrice, client_orderid_type iOrderID,
+                                            client_id_type iClientID, TimeQualifier iQualifier, Status iCheck);
+                template <typename TOrderReplace>
+                Status ApplyModify(std::unique_ptr<TOrderReplace> ipOrderReplace, Status iCheck);
+
                 inline bool IsAuctionPhase(const TradingPhase iPhase) const;
                 inline bool IsValidPhase(const TradingPhase iPhase) const;
 
                 void HandleIntradayAuctionPhaseSwitching(const TradingPhase iNewPhase);
 
+                /* Compute the price collars from the post auction price, done once per reference price */
+                void UpdatePriceCollars();
+
+                /**/
+                inline Status CountReply(Status iStatus);
+
+                /* Allocate the order container on first use, most listed books never receive an order */
+                OrderContainerType & GetOrders();
+
             private:
 
                 TMatchingEngine&       m_rMatchingEngine;
                 std::string            m_SecurityName;
 
-                OrderContainerType     m_Orders;
+                std::unique_ptr<OrderContainerType> m_pOrders;
+                /* Published depth of m_pOrders, set once the container is allocated */
+                std::atomic<const common::SeqLock<BookDepth> *> m_pPublishedDepth;
                 TradingPhase           m_Phase;
 
                 TimeType               m_AuctionEnd;
@@ -155,6 +239,17 @@ namespace exchange
                 price_type             m_OpenPrice;
                 price_type             m_ClosePrice;
                 price_type             m_PostAuctionPrice;
+
+                OrderBookCounters      m_Counters;
+
+                /* Resting orders high water mark of the day, the previous day peaks come from the instrument */
+                std::uint64_t          m_PeakOrders;
+                std::uint64_t          m_PreviousPeakOrders;
+                std::uint64_t          m_PreviousPeakDeals;
+
+                bool                   m_SnapshotDirty;
+                /* Applied to the order container when it is allocated */
+                bool                   m_PriceCollarsSet;
         };
 
     }
@@ -6,6 +6,9 @@
 #include <Engine_Defines.h>
 #include <Engine_MatchingEngine.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace exchange
 {
     namespace engine
@@ -13,9 +16,11 @@ namespace exchange
 
         template <typename TOrder, typename TMatchingEngine>
         OrderBook<TOrder, TMatchingEngine>::OrderBook(const Instrument<TOrder> & iInstrument, TMatchingEngine& rMatchingEngine)
-            : EventHandlerType(iInstrument.GetProductId()), m_rMatchingEngine(rMatchingEngine), m_SecurityName(iInstrument.GetName()), m_Orders(*this),
+            : EventHandlerType(iInstrument.GetProductId()), m_rMatchingEngine(rMatchingEngine), m_SecurityName(iInstrument.GetName()), m_pOrders(), m_pPublishedDepth(nullptr),
             m_Phase(TradingPhase::CLOSE), m_AuctionEnd(), m_LastPrice(iInstrument.GetClosePrice()), m_Turnover(0), m_DailyVolume(0),
-            m_OpenPrice(0), m_ClosePrice(iInstrument.GetClosePrice()), m_PostAuctionPrice(iInstrument.GetClosePrice())
+            m_OpenPrice(0), m_ClosePrice(iInstrument.GetClosePrice()), m_PostAuctionPrice(iInstrument.GetClosePrice()),
+            m_Counters(), m_PeakOrders(0), m_PreviousPeakOrders(iInstrument.GetPeakOrders()), m_PreviousPeakDeals(iInstrument.GetPeakDeals()),
+            m_SnapshotDirty(true), m_PriceCollarsSet(false)
         {
         }
 
@@ -27,17 +32,23 @@ namespace exchange
         template <typename Msg>
         Status OrderBook<TOrder, TMatchingEngine>::CheckOrder(const std::unique_ptr<Msg> & ipMsg) const
         {
-            if (ipMsg->GetQuantity() < constants::MinQty || ipMsg->GetQuantity() > constants::MaxQty)
+            return CheckOrder(ipMsg->GetQuantity(), ipMsg->GetPrice(), ipMsg->GetWay());
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        Status OrderBook<TOrder, TMatchingEngine>::CheckOrder(qty_type iQty, price_type iPrice, OrderWay iWay) const
+        {
+            if (iQty < constants::MinQty || iQty > constants::MaxQty)
             {
                 return Status::InvalidQuantity;
             }
 
-            if (ipMsg->GetPrice() < constants::MinPrice || ipMsg->GetPrice() > constants::MaxPrice)
+            if (iPrice < constants::MinPrice || iPrice > constants::MaxPrice)
             {
                 return Status::InvalidPrice;
             }
 
-            if (ipMsg->GetWay() != OrderWay::BUY && ipMsg->GetWay() != OrderWay::SELL)
+            if (iWay != OrderWay::BUY && iWay != OrderWay::SELL)
             {
                 return Status::InvalidWay;
             }
@@ -55,12 +66,19 @@ namespace exchange
 
             if (IsValidPhase(iNewPhase))
             {
-                EXINFO("OrderBook::SetTradingPhase " << m_SecurityName << " : switching from phase " << TradingPhaseToString(m_Phase) <<
-                    " to phase " << TradingPhaseToString(iNewPhase) << "]");
+                // The uncross summary is logged by the engine thread
+                if (!TMatchingEngine::IsUncrossing())
+                {
+                    EXINFO("OrderBook::SetTradingPhase " << m_SecurityName << " : switching from phase " << TradingPhaseToString(m_Phase) <<
+                        " to phase " << TradingPhaseToString(iNewPhase) << "]");
+                }
 
                 if( IsAuctionPhase(m_Phase) && !IsAuctionPhase(iNewPhase) )
                 {
-                    m_Orders.MatchOrders();
+                    if (m_pOrders)
+                    {
+                        m_pOrders->MatchOrders();
+                    }
                     SetPostAuctionPrice(GetLastPrice());
                 }
 
@@ -76,7 +94,16 @@ namespace exchange
                     SetClosePrice(GetLastPrice());
                 }
 
+                // The engine configuration may have changed since the last reference price
+                if (iNewPhase == TradingPhase::CONTINUOUS_TRADING)
+                {
+                    UpdatePriceCollars();
+                }
+
                 m_Phase = iNewPhase;
+                m_SnapshotDirty = true;
+
+                m_rMatchingEngine.OnTradingPhase(this->GetInstrumentID(), m_Phase);
                 
                 return true;
             }
@@ -92,77 +119,270 @@ namespace exchange
         {
             assert(ipOrder != nullptr);
 
-            if (m_Phase != TradingPhase::CLOSE)
+            const auto Check = CheckOrder(ipOrder);
+            return ApplyInsert(std::move(ipOrder), Check);
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        Status OrderBook<TOrder, TMatchingEngine>::ApplyInsert(std::unique_ptr<TOrder> ipOrder, Status iCheck)
+        {
+            ++m_Counters.Inserts;
+
+            if (m_Phase == TradingPhase::CLOSE)
             {
-                auto status = CheckOrder(ipOrder);
-                if (Status::Ok == status)
-                {
-                    return m_Orders.Insert(std::move(ipOrder), TradingPhase::CONTINUOUS_TRADING == m_Phase);
-                }
-                else
-                {
-                    return status;
-                }
+                return CountReply(Status::MarketNotOpened);
+            }
+
+            if (Status::Ok != iCheck)
+            {
+                return CountReply(iCheck);
+            }
+
+            const auto status = GetOrders().Insert(std::move(ipOrder), TradingPhase::CONTINUOUS_TRADING == m_Phase);
+            m_PeakOrders = std::max<std::uint64_t>(m_PeakOrders, GetOrderCount());
+            return CountReply(status);
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        Status OrderBook<TOrder, TMatchingEngine>::CheckImmediateOrder(OrderType iType, OrderWay iWay, qty_type iQty, price_type iPrice, TimeQualifier iQualifier) const
+        {
+            if (iQualifier != TimeQualifier::IOC && iQualifier != TimeQualifier::FOK)
+            {
+                return Status::InvalidTimeQualifier;
+            }
+
+            if (iType != OrderType::LIMIT && iType != OrderType::MARKET)
+            {
+                return Status::InvalidOrderType;
+            }
+
+            return CheckOrder(iQty, GetImmediatePrice(iType, iWay, iPrice), iWay);
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        inline typename OrderBook<TOrder, TMatchingEngine>::price_type OrderBook<TOrder, TMatchingEngine>::GetImmediatePrice(OrderType iType, OrderWay iWay, price_type iPrice)
+        {
+            // A market order can be executed up to the worst price of the opposite side
+            if (iType == OrderType::MARKET)
+            {
+                return (iWay == OrderWay::BUY) ? constants::MaxPrice : constants::MinPrice;
+            }
+            return iPrice;
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        Status OrderBook<TOrder, TMatchingEngine>::ImmediateInsert(OrderType iType, OrderWay iWay, qty_type iQty, price_type iPrice,
+                                                                   client_orderid_type iOrderID, client_id_type iClientID, TimeQualifier iQualifier)
+        {
+            const auto Check = CheckImmediateOrder(iType, iWay, iQty, iPrice, iQualifier);
+            return ApplyImmediateInsert(iType, iWay, iQty, iPrice, iOrderID, iClientID, iQualifier, Check);
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        Status OrderBook<TOrder, TMatchingEngine>::ApplyImmediateInsert(OrderType iType, OrderWay iWay, qty_type iQty, price_type iPrice,
+                                                                        client_orderid_type iOrderID, client_id_type iClientID, TimeQualifier iQualifier, Status iCheck)
+        {
+            ++m_Counters.ImmediateInserts;
+
+            if (m_Phase == TradingPhase::CLOSE)
+            {
+                return CountReply(Status::MarketNotOpened);
+            }
+
+            // IOC and FOK orders are only accepted during continuous trading
+            if (m_Phase != TradingPhase::CONTINUOUS_TRADING)
+            {
+                return CountReply(Status::InvalidTimeQualifier);
+            }
+
+            if (Status::Ok != iCheck)
+            {
+                return CountReply(iCheck);
             }
-            return Status::MarketNotOpened;
+
+            return CountReply(GetOrders().ImmediateInsert(iWay, iQty, GetImmediatePrice(iType, iWay, iPrice), iOrderID, iClientID, iQualifier));
         }
 
         template <typename TOrder, typename TMatchingEngine>
         template <typename TOrderReplace>
         Status OrderBook<TOrder, TMatchingEngine>::Modify(std::unique_ptr<TOrderReplace> ipOrderReplace)
         {
+            const auto Check = CheckOrder(ipOrderReplace);
+            return ApplyModify(std::move(ipOrderReplace), Check);
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        template <typename TOrderReplace>
+        Status OrderBook<TOrder, TMatchingEngine>::ApplyModify(std::unique_ptr<TOrderReplace> ipOrderReplace, Status iCheck)
+        {
+            ++m_Counters.Modifies;
+
+            if (m_Phase == TradingPhase::CLOSE)
+            {
+                return CountReply(Status::MarketNotOpened);
+            }
+
+            if (Status::Ok != iCheck)
+            {
+                return CountReply(iCheck);
+            }
+
+            return CountReply(GetOrders().Modify(std::move(ipOrderReplace), TradingPhase::CONTINUOUS_TRADING == m_Phase));
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        Status OrderBook<TOrder, TMatchingEngine>::Delete(Order::client_orderid_type iOrderID, Order::client_id_type iClientID, OrderWay iWay)
+        {
+            ++m_Counters.Deletes;
+
             if (m_Phase != TradingPhase::CLOSE)
             {
-                auto status = CheckOrder(ipOrderReplace);
+                return CountReply(GetOrders().Delete(iOrderID, iClientID, iWay));
+            }
+            return CountReply(Status::MarketNotOpened);
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        template <typename TCommand, typename TEntry>
+        void OrderBook<TOrder, TMatchingEngine>::ProcessBatch(TCommand * ioCommands, const TEntry * iFirst, const TEntry * iLast, Status * oStatuses)
+        {
+            // Phase independent checks of the whole group first, the phase may change while the group is applied
+            for (auto pEntry = iFirst; pEntry != iLast; ++pEntry)
+            {
+                const auto & Command = ioCommands[pEntry->Index];
+                auto & rStatus       = oStatuses[pEntry->Index];
 
-                if (Status::Ok == status)
+                switch (Command.Command)
                 {
-                    return m_Orders.Modify(std::move(ipOrderReplace), TradingPhase::CONTINUOUS_TRADING == m_Phase);
+                    case CommandType::INSERT:
+                        rStatus = CheckOrder(Command.pOrder);
+                        break;
+                    case CommandType::IMMEDIATE_INSERT:
+                        rStatus = CheckImmediateOrder(Command.Type, Command.Way, Command.Qty, Command.LimitPrice, Command.Qualifier);
+                        break;
+                    case CommandType::MODIFY:
+                        rStatus = CheckOrder(Command.pReplace);
+                        break;
+                    case CommandType::DELETE:
+                        rStatus = Status::Ok;
+                        break;
+                    default:
+                        assert(false);
+                        rStatus = Status::InternalError;
+                        break;
                 }
-                else
+            }
+
+            for (auto pEntry = iFirst; pEntry != iLast; ++pEntry)
+            {
+                auto & Command = ioCommands[pEntry->Index];
+                auto & rStatus = oStatuses[pEntry->Index];
+
+                switch (Command.Command)
                 {
-                    return status;
+                    case CommandType::INSERT:
+                        rStatus = ApplyInsert(std::move(Command.pOrder), rStatus);
+                        break;
+                    case CommandType::IMMEDIATE_INSERT:
+                        rStatus = ApplyImmediateInsert(Command.Type, Command.Way, Command.Qty, Command.LimitPrice, Command.OrderID, Command.Client, Command.Qualifier, rStatus);
+                        break;
+                    case CommandType::MODIFY:
+                        rStatus = ApplyModify(std::move(Command.pReplace), rStatus);
+                        break;
+                    case CommandType::DELETE:
+                        rStatus = Delete(Command.OrderID, Command.Client, Command.Way);
+                        break;
+                    default:
+                        break;
                 }
             }
-            return Status::MarketNotOpened;
         }
 
         template <typename TOrder, typename TMatchingEngine>
-        Status OrderBook<TOrder, TMatchingEngine>::Delete(Order::client_orderid_type iOrderID, Order::client_id_type iClientID, OrderWay iWay)
+        void OrderBook<TOrder,TMatchingEngine>::ProcessDeals(const deal_span_type & iDeals)
         {
-            if (m_Phase != TradingPhase::CLOSE)
+            nominal_type SweepTurnover(0);
+            volume_type  SweepVolume(0);
+
+            // Price collars are enforced before matching, deals are always inside the band
+            for (auto pDeal : iDeals)
             {
-                return m_Orders.Delete(iOrderID, iClientID, iWay);
+                SweepTurnover += pDeal->GetQuantity()*pDeal->GetPrice();
+                SweepVolume   += pDeal->GetQuantity();
             }
-            return Status::MarketNotOpened;
+
+            EXLOG(MATCHING_LOG, exch_logger::LOW, "ProcessDeals : Deals[" << iDeals.size() << "] LastPrice[" << iDeals.back()->GetPrice() << "] Volume[" << SweepVolume << "]");
+
+            SetTurnover(GetTurnover() + SweepTurnover);
+            SetDailyVolume(GetDailyVolume() + SweepVolume);
+            SetLastPrice(iDeals.back()->GetPrice());
+
+            m_rMatchingEngine.OnDeals(this->GetInstrumentID(), iDeals);
         }
 
         template <typename TOrder, typename TMatchingEngine>
-        void OrderBook<TOrder,TMatchingEngine>::ProcessDeal(const Deal * ipDeal)
+        void OrderBook<TOrder,TMatchingEngine>::ProcessPriceCollarBreach()
         {
-            EXINFO("ProcessDeal : Price[" << ipDeal->GetPrice() << "] Quantity[" << ipDeal->GetQuantity() << "]");
+            if( !IsAuctionPhase(GetTradingPhase()) )
+            {
+                EXINFO("OrderBook::ProcessPriceCollarBreach " << m_SecurityName << " : MinPrice[" << m_pOrders->GetMinCollarPrice() <<
+                    "] MaxPrice[" << m_pOrders->GetMaxCollarPrice() << "]");
+
+                SetTradingPhase(TradingPhase::INTRADAY_AUCTION);
+                m_AuctionEnd = TMatchingEngine::ClockType::local_time() + m_rMatchingEngine.GetIntradayAuctionDuration();
+
+                m_rMatchingEngine.UpdateIntradayAuctionDuration();
 
-            SetTurnover(GetTurnover() + ipDeal->GetQuantity()*ipDeal->GetPrice());
-            SetDailyVolume( GetDailyVolume() + ipDeal->GetQuantity() );
-            SetLastPrice( ipDeal->GetPrice() );
+                m_rMatchingEngine.MonitorOrderBook(this);
+            }
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        void OrderBook<TOrder,TMatchingEngine>::UpdatePriceCollars()
+        {
+            m_PriceCollarsSet = true;
+            if (!m_pOrders)
+            {
+                return;
+            }
 
             auto && PriceDevFactors = m_rMatchingEngine.GetPriceDevFactors();
 
-            price_type min_price = GetPostAuctionPrice() * std::get<0>(PriceDevFactors);
-            price_type max_price = GetPostAuctionPrice() * std::get<1>(PriceDevFactors);
+            m_pOrders->SetPriceCollars(GetPostAuctionPrice() * std::get<0>(PriceDevFactors), GetPostAuctionPrice() * std::get<1>(PriceDevFactors));
+        }
 
-            if( ipDeal->GetPrice() > max_price || ipDeal->GetPrice() < min_price)
+        template <typename TOrder, typename TMatchingEngine>
+        typename OrderBook<TOrder, TMatchingEngine>::OrderContainerType & OrderBook<TOrder, TMatchingEngine>::GetOrders()
+        {
+            if (!m_pOrders)
             {
-                if( !IsAuctionPhase(GetTradingPhase()) )
+                m_pOrders = std::make_unique<OrderContainerType>(*this);
+                m_pPublishedDepth.store(&m_pOrders->GetPublishedDepth(), std::memory_order_release);
+                if (m_PriceCollarsSet)
                 {
-                    SetTradingPhase(TradingPhase::INTRADAY_AUCTION);
-                    m_AuctionEnd = TMatchingEngine::ClockType::local_time() + m_rMatchingEngine.GetIntradayAuctionDuration();
+                    UpdatePriceCollars();
+                }
+            }
+            return *m_pOrders;
+        }
 
-                    m_rMatchingEngine.UpdateIntradayAuctionDuration();
+        template <typename TOrder, typename TMatchingEngine>
+        inline std::size_t OrderBook<TOrder, TMatchingEngine>::GetOrderCount() const
+        {
+            return m_pOrders ? m_pOrders->GetBidOrderCount() + m_pOrders->GetAskOrderCount() : 0;
+        }
 
-                    m_rMatchingEngine.MonitorOrderBook(this);
-                }
+        template <typename TOrder, typename TMatchingEngine>
+        bool OrderBook<TOrder, TMatchingEngine>::LoadDepth(BookDepth & oDepth) const
+        {
+            // The container is never released before the book
+            const auto * pDepth = m_pPublishedDepth.load(std::memory_order_acquire);
+            if (!pDepth)
+            {
+                oDepth = BookDepth();
+                return true;
             }
+            return pDepth->TryLoad(oDepth);
         }
 
         template <typename TOrder, typename TMatchingEngine>
@@ -182,7 +402,11 @@ namespace exchange
         template <typename TOrder, typename TMatchingEngine>
         void OrderBook<TOrder, TMatchingEngine>::CancelAllOrders()
         {
-            m_Orders.CancelAllOrders();
+            if (m_pOrders)
+            {
+                m_pOrders->CancelAllOrders();
+            }
+            m_SnapshotDirty = true;
         }
 
         template <typename TOrder, typename TMatchingEngine>
@@ -204,9 +428,148 @@ namespace exchange
         }
         
         template <typename TOrder, typename TMatchingEngine>
-        void OrderBook<TOrder, TMatchingEngine>::ProcessUnsolicitedCancelledOrder(const Order * order)
+        void OrderBook<TOrder, TMatchingEngine>::ProcessUnsolicitedCancelledOrders(const order_span_type & iOrders)
+        {
+            m_Counters.UnsolicitedCancels += iOrders.size();
+            m_rMatchingEngine.OnUnsolicitedCancelledOrders(this->GetInstrumentID(), iOrders);
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        inline void OrderBook<TOrder, TMatchingEngine>::ProcessLevelChange(OrderWay iWay, price_type iPrice, std::int64_t iQuantity, std::int32_t iOrders)
+        {
+            m_rMatchingEngine.OnLevelChange(this->GetInstrumentID(), iWay, iPrice, iQuantity, iOrders);
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        inline Status OrderBook<TOrder, TMatchingEngine>::CountReply(Status iStatus)
+        {
+            // Every command ends here
+            m_SnapshotDirty = true;
+
+            if (iStatus != Status::Ok)
+            {
+                ++m_Counters.Rejects;
+            }
+            return iStatus;
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        void OrderBook<TOrder, TMatchingEngine>::Reserve(size_t iOrders, size_t iDeals)
         {
-            m_rMatchingEngine.OnUnsolicitedCancelledOrder(order);
+            GetOrders().Reserve(iOrders);
+            this->ReserveDeals(iDeals);
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        void OrderBook<TOrder, TMatchingEngine>::EncodeSnapshot(std::vector<char> & oImage) const
+        {
+            BookSnapshotHeader Header;
+            Header.ProductID        = this->GetInstrumentID();
+            Header.Phase            = static_cast<std::uint32_t>(m_Phase);
+            Header.LastPrice        = static_cast<std::uint32_t>(m_LastPrice);
+            Header.OpenPrice        = static_cast<std::uint32_t>(m_OpenPrice);
+            Header.PostAuctionPrice = static_cast<std::uint32_t>(m_PostAuctionPrice);
+            Header.BidOrders        = static_cast<std::uint32_t>(m_pOrders ? m_pOrders->GetBidOrderCount() : 0);
+            Header.AskOrders        = static_cast<std::uint32_t>(m_pOrders ? m_pOrders->GetAskOrderCount() : 0);
+            Header.Turnover         = static_cast<std::uint64_t>(m_Turnover);
+            Header.DailyVolume      = static_cast<std::uint64_t>(m_DailyVolume);
+
+            const auto Start = oImage.size();
+            oImage.resize(Start + sizeof(Header) + (Header.BidOrders + Header.AskOrders) * sizeof(OrderSnapshotRecord));
+            std::memcpy(&oImage[Start], &Header, sizeof(Header));
+
+            if (!m_pOrders)
+            {
+                return;
+            }
+
+            auto pRecord = reinterpret_cast<OrderSnapshotRecord*>(&oImage[Start + sizeof(Header)]);
+            m_pOrders->VisitByOrder([&pRecord](const TOrder & iOrder)
+            {
+                OrderSnapshotRecord Record;
+                Record.Price            = static_cast<std::uint32_t>(iOrder.GetPrice());
+                Record.Quantity         = static_cast<std::uint32_t>(iOrder.GetQuantity());
+                Record.ExecutedQuantity = static_cast<std::uint32_t>(iOrder.GetExecutedQuantity());
+                Record.OrderID          = static_cast<std::uint32_t>(iOrder.GetOrderID());
+                Record.ClientID         = static_cast<std::uint32_t>(iOrder.GetClientID());
+                Record.Way              = static_cast<std::uint8_t>(iOrder.GetWay());
+                *pRecord++ = Record;
+            });
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        bool OrderBook<TOrder, TMatchingEngine>::LoadSnapshot(const BookSnapshotHeader & iHeader, const OrderSnapshotRecord * iOrders)
+        {
+            const auto Phase = static_cast<TradingPhase>(iHeader.Phase);
+            if (!IsValidPhase(Phase) || GetOrderCount() != 0)
+            {
+                EXERR("OrderBook::LoadSnapshot " << m_SecurityName << " : Invalid phase or book not empty");
+                return false;
+            }
+
+            // Orders are inserted in priority order, the time priority within a price is kept
+            const auto Orders = static_cast<std::size_t>(iHeader.BidOrders) + iHeader.AskOrders;
+            for (std::size_t i = 0; i < Orders; ++i)
+            {
+                const auto & Record = iOrders[i];
+                const auto Way = (i < iHeader.BidOrders) ? OrderWay::BUY : OrderWay::SELL;
+                if (static_cast<OrderWay>(Record.Way) != Way || Record.ExecutedQuantity >= Record.Quantity)
+                {
+                    EXERR("OrderBook::LoadSnapshot " << m_SecurityName << " : Invalid order[" << Record.OrderID << "]");
+                    return false;
+                }
+
+                auto pOrder = std::make_unique<TOrder>(Way, qty_type(Record.Quantity), price_type(Record.Price),
+                                                       client_orderid_type(Record.OrderID), client_id_type(Record.ClientID));
+                pOrder->AddExecutedQuantity(qty_type(Record.ExecutedQuantity));
+
+                if (GetOrders().Insert(std::move(pOrder)) != Status::Ok)
+                {
+                    EXERR("OrderBook::LoadSnapshot " << m_SecurityName << " : Duplicated order[" << Record.OrderID << "]");
+                    return false;
+                }
+            }
+
+            m_Phase       = Phase;
+            m_LastPrice   = price_type(iHeader.LastPrice);
+            m_OpenPrice   = price_type(iHeader.OpenPrice);
+            m_Turnover    = nominal_type(iHeader.Turnover);
+            m_DailyVolume = volume_type(iHeader.DailyVolume);
+            m_PeakOrders  = std::max<std::uint64_t>(m_PeakOrders, Orders);
+            SetPostAuctionPrice(price_type(iHeader.PostAuctionPrice));
+            m_rMatchingEngine.OnTradingPhase(this->GetInstrumentID(), m_Phase);
+
+            // The auction started before the snapshot restarts for a full duration
+            if (m_Phase == TradingPhase::INTRADAY_AUCTION)
+            {
+                m_AuctionEnd = TMatchingEngine::ClockType::local_time() + m_rMatchingEngine.GetIntradayAuctionDuration();
+                m_rMatchingEngine.MonitorOrderBook(this);
+            }
+            return true;
+        }
+
+        template <typename TOrder, typename TMatchingEngine>
+        void OrderBook<TOrder, TMatchingEngine>::FillMetrics(OrderBookMetrics & oMetrics) const
+        {
+            std::strncpy(oMetrics.SecurityName, m_SecurityName.c_str(), sizeof(oMetrics.SecurityName) - 1);
+            oMetrics.ProductID    = this->GetInstrumentID();
+            oMetrics.Phase        = static_cast<std::uint32_t>(m_Phase);
+            oMetrics.Counters     = m_Counters;
+            oMetrics.Deals        = this->GetDealCounter();
+            oMetrics.Turnover     = static_cast<std::uint64_t>(m_Turnover);
+            oMetrics.DailyVolume  = static_cast<std::uint64_t>(m_DailyVolume);
+            oMetrics.LastPrice    = static_cast<std::uint32_t>(m_LastPrice);
+            oMetrics.OpenPrice    = static_cast<std::uint32_t>(m_OpenPrice);
+            oMetrics.ClosePrice   = static_cast<std::uint32_t>(m_ClosePrice);
+            oMetrics.DealPoolUsed = this->GetDealPoolUsed();
+
+            if (m_pOrders)
+            {
+                oMetrics.BidOrders = static_cast<std::uint32_t>(m_pOrders->GetBidOrderCount());
+                oMetrics.AskOrders = static_cast<std::uint32_t>(m_pOrders->GetAskOrderCount());
+                oMetrics.BidLevels = static_cast<std::uint32_t>(m_pOrders->GetBidLevelCount());
+                oMetrics.AskLevels = static_cast<std::uint32_t>(m_pOrders->GetAskLevelCount());
+            }
         }
 
         template <typename TOrder, typename TMatchingEngine>
@@ -219,7 +582,10 @@ namespace exchange
                 << "OpenPrice["      << iOrders.m_OpenPrice << "] ; "
                 << "LastClosePrice[" << iOrders.m_ClosePrice << "]" << std::endl;
 
-            oss << iOrders.m_Orders;
+            if (iOrders.m_pOrders)
+            {
+                oss << *iOrders.m_pOrders;
+            }
             return oss;
         }
     }
@@ -14,10 +14,19 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 
+#include <NodeAllocator.h>
+#include <SeqLock.h>
+
 #include <Engine_Status.h>
+#include <Engine_Deal.h>
+#include <Engine_Defines.h>
+#include <Engine_Depth.h>
 
+#include <algorithm>
 #include <unordered_set>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 namespace exchange
 {
@@ -70,7 +79,8 @@ namespace exchange
 
                     bmi::ordered_non_unique<
                     bmi::tag<price_tag>, bmi::const_mem_fun<TOrder, typename TOrder::price_type, &TOrder::GetPrice>, SortingPredicate>
-                >
+                >,
+                common::NodeAllocator<TOrder*>
             > open_orders_container;
         };
 
@@ -112,10 +122,7 @@ namespace exchange
 
                 using OrderPtrType = TOrder*;
 
-                /* Index all orders */
-                using orders_container = std::multimap<client_id_type, std::unique_ptr<TOrder> >;
-
-                /* Index only open orders */
+                /* Index only open orders, the storages own them until they leave the book */
                 typedef std::greater<price_type>                                            BidPredicate;
                 typedef typename OrderStorage<TOrder, BidPredicate>::open_orders_container  BidStorage;
 
@@ -133,13 +140,24 @@ namespace exchange
                 /**
                 */
                 OrderContainer(TEventHandler & iEventHandler):
-                    m_EventHandler(iEventHandler), m_ViewMode(ViewMode::VM_BY_ORDER)
+                    m_EventHandler(iEventHandler), m_ViewMode(ViewMode::VM_BY_ORDER),
+                    m_MinCollarPrice(price_type::min()), m_MaxCollarPrice(constants::MaxPrice)
                 {}
 
+                /**
+                */
+                ~OrderContainer();
+
                 /**
                 */
                 Status Insert(std::unique_ptr<TOrder> ipOrder, bool Match = false);
 
+                /**
+                *  Execute an IOC or FOK order against the resting orders. The order is built in
+                *  a scratch slot, its remaining quantity is discarded and it never reaches the indexes
+                */
+                Status ImmediateInsert(OrderWay iWay, qty_type iQty, price_type iPrice, client_orderid_type iOrderID, client_id_type iClientID, TimeQualifier iQualifier);
+
                 /**
                 */
                 template <typename TOrderReplace>
@@ -160,6 +178,9 @@ namespace exchange
                 /**/
                 void RehashIndexes(size_t size);
 
+                /* Size the indexes and pre fault the nodes of iCount resting orders, done before the opening */
+                void Reserve(size_t iCount);
+
                 /**
                 */
                 void AggregatedView(LimitContainer & BidContainer, LimitContainer & AskContainer) const;
@@ -168,6 +189,10 @@ namespace exchange
                 */
                 void ByOrderView(std::vector<TOrder*> & BidContainer, std::vector<TOrder*> & AskContainer) const;
 
+                /* Call iVisitor on the bids then the asks in priority order, without copying the indexes */
+                template <typename Visitor>
+                void VisitByOrder(Visitor && iVisitor) const;
+
                 /**
                 */
                 OpenInformationType GetTheoriticalAuctionInformations() const;
@@ -177,16 +202,44 @@ namespace exchange
                 inline void SetViewMode(ViewMode iView) { m_ViewMode = iView; }
                 inline ViewMode GetViewMode() const { return m_ViewMode; }
 
+                /*
+                *  Deals are only generated inside [iMinPrice, iMaxPrice], an aggressive order
+                *  which would trade outside stops at the boundary and the event handler is notified
+                */
+                inline void SetPriceCollars(price_type iMinPrice, price_type iMaxPrice) { m_MinCollarPrice = iMinPrice; m_MaxCollarPrice = iMaxPrice; }
+                inline price_type GetMinCollarPrice() const { return m_MinCollarPrice; }
+                inline price_type GetMaxCollarPrice() const { return m_MaxCollarPrice; }
+                inline bool IsInsideCollars(price_type iPrice) const { return iPrice >= m_MinCollarPrice && iPrice <= m_MaxCollarPrice; }
+
+                inline size_t GetBidOrderCount() const { return m_BidOrders.size(); }
+                inline size_t GetAskOrderCount() const { return m_AskOrders.size(); }
+
+                /* Distinct prices of each side, maintained with the depth */
+                inline size_t GetBidLevelCount() const { return m_BidLevelCount; }
+                inline size_t GetAskLevelCount() const { return m_AskLevelCount; }
+
+                /* Best levels as maintained on the engine thread */
+                inline const BookDepth & GetDepth() const { return m_Depth; }
+
+                /* Best levels as of the end of the last command, may be read from any thread */
+                inline const common::SeqLock<BookDepth> & GetPublishedDepth() const { return m_PublishedDepth; }
+
             protected:
 
                 bool AuctionInsert(TOrder * ipOrder);
 
+                /* True if the client already has a resting order with this ID on the given side */
+                bool IsResting(OrderWay iWay, client_orderid_type iOrderID, client_id_type iClientID) const;
+
                 template <typename Container>
                 volume_type GetExecutableQuantity(const Container & Orders, price_type iPrice, volume_type iMaxVolume) const;
 
                 template <typename Msg>
                 volume_type GetExecutableQuantity(const Msg & ipMsg) const;
 
+                template <typename Msg>
+                bool IsPriceCollarBreached(const Msg & ipMsg) const;
+
                 template <typename Container, typename Msg>
                 void ProcessDeals(Container & Orders, Msg & iMsg, volume_type iMatchQty);
 
@@ -199,6 +252,22 @@ namespace exchange
                 const bid_index_type & GetBidIndex() const { return bmi::get<price_tag>(m_BidOrders); }
                 const ask_index_type & GetAskIndex() const { return bmi::get<price_tag>(m_AskOrders); }
 
+                static std::int64_t ToDepthQuantity(qty_type iQty) { return static_cast<typename qty_type::underlying_type>(iQty); }
+
+                /* Apply a change of the open quantity and order count of a price level, called once the index is updated */
+                void UpdateDepth(OrderWay iWay, price_type iPrice, std::int64_t iQuantity, std::int32_t iOrders);
+
+                template <typename Index>
+                void UpdateDepth(const Index & iIndex, DepthLevel * ioLevels, std::uint32_t & ioCount, size_t & ioLevelCount, price_type iPrice,
+                                 std::int64_t iQuantity, std::int32_t iOrders);
+
+                /* Append the level following the last one of the depth, read from the index */
+                template <typename Index>
+                static void RefillDepth(const Index & iIndex, DepthLevel * ioLevels, std::uint32_t & ioCount);
+
+                /* Store the depth in the SeqLock if it changed since the last publication */
+                void PublishDepth();
+
             private:
 
                 /**
@@ -215,8 +284,6 @@ namespace exchange
                 OrderContainer & operator= (const OrderContainer & other);
 
             protected:
-                /* */
-                orders_container m_OrderContainer;
                 /* */
                 BidStorage       m_BidOrders;
                 /* */
@@ -225,6 +292,20 @@ namespace exchange
                 TEventHandler&   m_EventHandler;
                 /* */
                 ViewMode         m_ViewMode;
+                /* Reusable storage for orders which never rest in the book ( IOC, FOK ) */
+                std::aligned_storage_t<sizeof(TOrder), alignof(TOrder)> m_ScratchOrder;
+                /* Deals generated by the current matching sweep, reused to avoid allocations */
+                std::vector<const Deal *> m_SweepDeals;
+                /* Price collars, no deal can be generated outside */
+                price_type       m_MinCollarPrice;
+                price_type       m_MaxCollarPrice;
+                /* Best levels of both sides, updated with the indexes and published at the end of each command */
+                BookDepth        m_Depth;
+                bool             m_DepthDirty = false;
+                /* Number of price levels of each side, the depth only holds the best ones */
+                size_t           m_BidLevelCount = 0;
+                size_t           m_AskLevelCount = 0;
+                common::SeqLock<BookDepth> m_PublishedDepth;
         };
 
     }
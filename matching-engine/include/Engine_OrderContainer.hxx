@@ -4,11 +4,13 @@
 */
 
 #include <ScopedExit.h>
+#include <LatencyTrace.h>
 
 #include <Engine_OrderContainer.h>
 #include <Engine_Deal.h>
 #include <Engine_Tools.h>
 
+#include <deque>
 #include <iomanip>
 
 namespace exchange
@@ -16,21 +18,54 @@ namespace exchange
     namespace engine
     {
 
+        template <typename TOrder, typename TEventHandler>
+        OrderContainer<TOrder, TEventHandler>::~OrderContainer()
+        {
+            for (auto pOrder : m_BidOrders)
+            {
+                delete pOrder;
+            }
+            for (auto pOrder : m_AskOrders)
+            {
+                delete pOrder;
+            }
+        }
+
         template <typename TOrder, typename TEventHandler>
         void OrderContainer<TOrder, TEventHandler>::CancelAllOrders()
         {
-            auto DoCancelAllOrders = [this](auto & container)
+            if (m_AskOrders.empty() && m_BidOrders.empty())
             {
-                while (!container.empty())
-                {
-                    auto OrderIt = container.begin();
-                    m_EventHandler.OnUnsolicitedCancelledOrder(*OrderIt);
-                    container.erase(OrderIt);
-                }
-            };
+                return;
+            }
+
+            auto publish_at_exit = common::make_scope_exit([this]() { PublishDepth(); });
 
-            DoCancelAllOrders(m_AskOrders);
-            DoCancelAllOrders(m_BidOrders);
+            std::vector<const TOrder *> Orders;
+            Orders.reserve(m_AskOrders.size() + m_BidOrders.size());
+            Orders.insert(Orders.end(), m_AskOrders.begin(), m_AskOrders.end());
+            Orders.insert(Orders.end(), m_BidOrders.begin(), m_BidOrders.end());
+
+            m_EventHandler.OnUnsolicitedCancelledOrders(Orders);
+
+            // The indexes are released whole, with their buckets : no rebalancing and no hash lookup per order
+            {
+                AskStorage AskOrders;
+                BidStorage BidOrders;
+                AskOrders.swap(m_AskOrders);
+                BidOrders.swap(m_BidOrders);
+            }
+
+            m_Depth.BidLevels = 0;
+            m_Depth.AskLevels = 0;
+            m_BidLevelCount   = 0;
+            m_AskLevelCount   = 0;
+            m_DepthDirty      = true;
+
+            for (auto pOrder : Orders)
+            {
+                delete pOrder;
+            }
         }
 
         template <typename TOrder, typename SortingPredicate>
@@ -83,14 +118,23 @@ namespace exchange
         {
             switch (ipMsg->GetWay())
             {
+                // Deals are generated at the resting price, the limit price is capped by the price collars
                 case OrderWay::BUY:
                 {
-                    return GetExecutableQuantity(m_AskOrders, ipMsg->GetPrice(), (volume_type)ipMsg->GetQuantity());
+                    if (GetAskIndex().empty() || !IsInsideCollars((*GetAskIndex().begin())->GetPrice()))
+                    {
+                        return 0_volume;
+                    }
+                    return GetExecutableQuantity(m_AskOrders, (std::min)(ipMsg->GetPrice(), m_MaxCollarPrice), (volume_type)ipMsg->GetOpenQuantity());
 
                 }
                 case OrderWay::SELL:
                 {
-                    return GetExecutableQuantity(m_BidOrders, ipMsg->GetPrice(), (volume_type)ipMsg->GetQuantity());
+                    if (GetBidIndex().empty() || !IsInsideCollars((*GetBidIndex().begin())->GetPrice()))
+                    {
+                        return 0_volume;
+                    }
+                    return GetExecutableQuantity(m_BidOrders, (std::max)(ipMsg->GetPrice(), m_MinCollarPrice), (volume_type)ipMsg->GetOpenQuantity());
                 }
                 default:
                     assert(false && "Invalid order way");
@@ -98,6 +142,34 @@ namespace exchange
             }
         }
 
+        template <typename TOrder, typename TEventHandler>
+        template <typename Msg>
+        bool OrderContainer<TOrder, TEventHandler>::IsPriceCollarBreached(const Msg & ipMsg) const
+        {
+            if (ipMsg->GetOpenQuantity() == 0_qty)
+            {
+                return false;
+            }
+
+            // Once matching is done, the best opposite order is the first one the collars prevented from trading
+            switch (ipMsg->GetWay())
+            {
+                case OrderWay::BUY:
+                {
+                    const auto & Index = GetAskIndex();
+                    return !Index.empty() && (*Index.begin())->GetPrice() <= ipMsg->GetPrice() && !IsInsideCollars((*Index.begin())->GetPrice());
+                }
+                case OrderWay::SELL:
+                {
+                    const auto & Index = GetBidIndex();
+                    return !Index.empty() && (*Index.begin())->GetPrice() >= ipMsg->GetPrice() && !IsInsideCollars((*Index.begin())->GetPrice());
+                }
+                default:
+                    assert(false && "Invalid order way");
+                    return false;
+            }
+        }
+
         template <typename Msg, bool bIsReplaceOrder>
         struct AggressorIDHelper
         {
@@ -124,6 +196,8 @@ namespace exchange
         {
             auto & Index = bmi::get<price_tag>(Orders);
 
+            m_SweepDeals.clear();
+
             while (iMatchQty > 0_volume)
             {
                 auto OrderToHitIt  = Index.begin();
@@ -156,13 +230,27 @@ namespace exchange
                     pDeal = m_EventHandler.CreateDeal(ExecPrice, ExecQty, iMsg->GetClientID(), GetAggressorID(iMsg), OrderToHit->GetClientID(), OrderToHit->GetOrderID());
                 }
 
-                m_EventHandler.OnDeal(std::move(pDeal));
+                if (auto pRecordedDeal = m_EventHandler.RecordDeal(std::move(pDeal)))
+                {
+                    m_SweepDeals.push_back(pRecordedDeal);
+                }
 
                 if (0_qty == OrderToHit->GetOpenQuantity())
                 {
                     Index.erase(OrderToHitIt);
+                    UpdateDepth(OrderToHit->GetWay(), ExecPrice, -ToDepthQuantity(ExecQty), -1);
+                    delete OrderToHit;
+                }
+                else
+                {
+                    UpdateDepth(OrderToHit->GetWay(), ExecPrice, -ToDepthQuantity(ExecQty), 0);
                 }
             }
+
+            // Book statistics and price monitoring are done once per aggressive order
+            m_EventHandler.OnDeals(m_SweepDeals);
+
+            common::LatencyTracer::Stamp(common::TraceStage::MATCHED);
         }
 
         template <typename TOrder, typename TEventHandler>
@@ -186,11 +274,13 @@ namespace exchange
         template <typename TOrder, typename TEventHandler>
         Status OrderContainer<TOrder, TEventHandler>::Insert(std::unique_ptr<TOrder> ipOrder, bool Match)
         {
-            auto insert_at_exit = common::make_scope_exit([this,&ipOrder]()
-                {
-                    m_OrderContainer.emplace(ipOrder->GetClientID(), std::move(ipOrder));
-                }
-            );
+            // Rejected before any deal, the book is left untouched
+            if (IsResting(ipOrder->GetWay(), ipOrder->GetOrderID(), ipOrder->GetClientID()))
+            {
+                return Status::DuplicateOrderID;
+            }
+
+            auto publish_at_exit = common::make_scope_exit([this]() { PublishDepth(); });
 
             if (Match)
             {
@@ -208,11 +298,77 @@ namespace exchange
                 {
                     return Status::InternalError;;
                 }
+
+                // The order rests in the book, which now owns it
+                TOrder * pOrder = ipOrder.release();
+
+                if (Match && IsPriceCollarBreached(pOrder))
+                {
+                    m_EventHandler.OnPriceCollarBreach();
+                }
             }
 
+            // A fully executed order is released here
             return Status::Ok;;
         }
 
+        template <typename TOrder, typename TEventHandler>
+        Status OrderContainer<TOrder, TEventHandler>::ImmediateInsert(OrderWay iWay, qty_type iQty, price_type iPrice, client_orderid_type iOrderID, client_id_type iClientID, TimeQualifier iQualifier)
+        {
+            auto publish_at_exit = common::make_scope_exit([this]() { PublishDepth(); });
+
+            TOrder * pOrder = new (&m_ScratchOrder) TOrder(iWay, iQty, iPrice, iOrderID, iClientID);
+
+            auto release_at_exit = common::make_scope_exit([pOrder]() { pOrder->~TOrder(); });
+
+            volume_type MatchQty = GetExecutableQuantity(pOrder);
+
+            switch (iQualifier)
+            {
+                case TimeQualifier::IOC:
+                    break;
+                case TimeQualifier::FOK:
+                    // Rejected before any deal, the book is left untouched
+                    if (MatchQty != static_cast<volume_type>(iQty))
+                    {
+                        return Status::NotFullyExecutable;
+                    }
+                    break;
+                default:
+                    assert(false);
+                    return Status::InvalidTimeQualifier;
+            }
+
+            if (MatchQty != 0_volume)
+            {
+                ProcessDeals(pOrder, iWay, MatchQty);
+            }
+
+            if (IsPriceCollarBreached(pOrder))
+            {
+                m_EventHandler.OnPriceCollarBreach();
+            }
+
+            // The remaining quantity, if any, is discarded
+            return Status::Ok;
+        }
+
+        template <typename TOrder, typename TEventHandler>
+        bool OrderContainer<TOrder, TEventHandler>::IsResting(OrderWay iWay, client_orderid_type iOrderID, client_id_type iClientID) const
+        {
+            const auto OrderID = OrderIDGenerator<TOrder>()(iClientID, iOrderID);
+            switch (iWay)
+            {
+                case OrderWay::BUY:
+                    return m_BidOrders.find(OrderID) != m_BidOrders.end();
+                case OrderWay::SELL:
+                    return m_AskOrders.find(OrderID) != m_AskOrders.end();
+                default:
+                    assert(false);
+                    return false;
+            }
+        }
+
         template <typename TOrder, typename TEventHandler>
         bool OrderContainer<TOrder, TEventHandler>::AuctionInsert(TOrder * ipOrder)
         {
@@ -221,16 +377,25 @@ namespace exchange
             *  insert return a pair, the second element indicate
             *  if the insertion fail or not.
             */
+            bool Inserted = false;
             switch (ipOrder->GetWay())
             {
                 case OrderWay::BUY:
-                    return m_BidOrders.insert( ipOrder ).second;
+                    Inserted = m_BidOrders.insert( ipOrder ).second;
+                    break;
                 case OrderWay::SELL:
-                    return m_AskOrders.insert( ipOrder ).second;
+                    Inserted = m_AskOrders.insert( ipOrder ).second;
+                    break;
                 default:
                     assert(false);
                     return false;
             };
+
+            if (Inserted)
+            {
+                UpdateDepth(ipOrder->GetWay(), ipOrder->GetPrice(), ToDepthQuantity(ipOrder->GetOpenQuantity()), 1);
+            }
+            return Inserted;
         }
 
         /**
@@ -239,21 +404,33 @@ namespace exchange
         template <typename TOrder, typename TEventHandler>
         Status OrderContainer<TOrder, TEventHandler>::Delete(const client_orderid_type iOrderId, const client_id_type iClientId, OrderWay iWay)
         {    
-            bool Result = false;
+            auto DoDelete = [&](auto & Container)
+            {
+                auto OrderIt = Container.find(OrderIDGenerator<TOrder>()(iClientId, iOrderId));
+                if (OrderIt == Container.end())
+                {
+                    return Status::OrderNotFound;
+                }
+
+                auto pOrder = *OrderIt;
+                Container.erase(OrderIt);
+                UpdateDepth(iWay, pOrder->GetPrice(), -ToDepthQuantity(pOrder->GetOpenQuantity()), -1);
+                delete pOrder;
+                return Status::Ok;
+            };
+
+            auto publish_at_exit = common::make_scope_exit([this]() { PublishDepth(); });
 
             switch (iWay)
             {
                 case OrderWay::BUY:
-                    Result = (1 == m_BidOrders.erase(OrderIDGenerator<TOrder>()(iClientId, iOrderId)));
-                    break;
+                    return DoDelete(m_BidOrders);
                 case OrderWay::SELL:
-                    Result = (1 == m_AskOrders.erase(OrderIDGenerator<TOrder>()(iClientId, iOrderId)));
-                    break;
+                    return DoDelete(m_AskOrders);
                 default:
                     assert(false);
                     return Status::InternalError;
             }
-            return Result ? Status::Ok : Status::OrderNotFound;
         }
 
         template <typename TOrder, typename TEventHandler>
@@ -275,12 +452,19 @@ namespace exchange
                             return false;
                         }
                     }
+
+                    if (IsPriceCollarBreached(iOrder))
+                    {
+                        m_EventHandler.OnPriceCollarBreach();
+                    }
                 }
                 return true;
             };
 
             auto OrderID    = OrderIDGenerator<TOrder>()(iOrderReplace->GetClientID(), iOrderReplace->GetExistingOrderID());
 
+            auto publish_at_exit = common::make_scope_exit([this]() { PublishDepth(); });
+
             auto ApplyModify = [&](auto & Container)
             {
                 auto Order = Container.find(OrderID);
@@ -295,7 +479,33 @@ namespace exchange
                         return Status::InvalidQuantity;
                     }
 
+                    // Checked before the book is touched : a rejected modify leaves the original order resting
+                    if (iOrderReplace->GetReplacedOrderID() != iOrderReplace->GetExistingOrderID() &&
+                        Container.find(OrderIDGenerator<TOrder>()(iOrderReplace->GetClientID(), iOrderReplace->GetReplacedOrderID())) != Container.end())
+                    {
+                        return Status::DuplicateOrderID;
+                    }
+
+                    if (iOrderReplace->GetPrice() == OrderPtr->GetPrice() && iOrderReplace->GetQuantity() <= OrderPtr->GetQuantity())
+                    {
+                        /*
+                        *  Quantity decrease at the same price : the order can't become executable,
+                        *  it is amended in place and keeps its time priority.
+                        *  Only the order ID index is updated, the price index is left untouched.
+                        */
+                        const AmendUpdater<OrderPtrType> Rollback(OrderPtr->GetQuantity(), OrderPtr->GetOrderID());
+                        const auto OpenQuantity = ToDepthQuantity(OrderPtr->GetOpenQuantity());
+
+                        if (!Container.modify(Order, AmendUpdater<OrderPtrType>(iOrderReplace->GetQuantity(), iOrderReplace->GetReplacedOrderID()), Rollback))
+                        {
+                            return Status::InternalError;
+                        }
+                        UpdateDepth(OrderPtr->GetWay(), OrderPtr->GetPrice(), ToDepthQuantity(OrderPtr->GetOpenQuantity()) - OpenQuantity, 0);
+                        return Status::Ok;
+                    }
+
                     Container.erase(Order);
+                    UpdateDepth(OrderPtr->GetWay(), OrderPtr->GetPrice(), -ToDepthQuantity(OrderPtr->GetOpenQuantity()), -1);
 
                     OrderPtr->SetQuantity(iOrderReplace->GetQuantity() );
                     OrderPtr->SetPrice(iOrderReplace->GetPrice());
@@ -303,8 +513,15 @@ namespace exchange
 
                     if (ProcessModify(OrderPtr))
                     {
-                        // Order is not fully filled, re-queued the rest of the quantity
-                        Container.insert(OrderPtr);
+                        // Order is not fully filled, re-queued the rest of the quantity, its new ID was checked above
+                        const bool Inserted = Container.insert(OrderPtr).second;
+                        assert(Inserted && "Replaced order ID already used");
+                        (void)Inserted;
+                        UpdateDepth(OrderPtr->GetWay(), OrderPtr->GetPrice(), ToDepthQuantity(OrderPtr->GetOpenQuantity()), 1);
+                    }
+                    else
+                    {
+                        delete OrderPtr;
                     }
                     
                     return Status::Ok;
@@ -369,6 +586,10 @@ namespace exchange
             bid_index_type & BidIndex = GetBidIndex();
             ask_index_type & AskIndex = GetAskIndex();
 
+            auto publish_at_exit = common::make_scope_exit([this]() { PublishDepth(); });
+
+            m_SweepDeals.clear();
+
             while (MatchingQty > 0_volume)
             {
                 auto   BidOrderIt = BidIndex.begin();
@@ -383,24 +604,38 @@ namespace exchange
 
                     AskIndex.modify(AskOrderIt, ExecQuantityUpdater<OrderPtrType>(ExecutedQty));
                     BidIndex.modify(BidOrderIt, ExecQuantityUpdater<OrderPtrType>(ExecutedQty));
+                    UpdateDepth(OrderWay::BUY, BidOrder->GetPrice(), -ToDepthQuantity(ExecutedQty), 0);
 
                     auto pDeal = m_EventHandler.CreateDeal(MatchingPrice, ExecutedQty, BidOrder->GetClientID(), BidOrder->GetOrderID(), AskOrder->GetClientID(), AskOrder->GetOrderID());
 
-                    m_EventHandler.OnDeal(std::move(pDeal));
+                    if (auto pRecordedDeal = m_EventHandler.RecordDeal(std::move(pDeal)))
+                    {
+                        m_SweepDeals.push_back(pRecordedDeal);
+                    }
 
                     MatchingQty -= ExecutedQty;
 
                     if (0_qty == AskOrder->GetOpenQuantity())
                     {
                         AskIndex.erase(AskOrderIt);
+                        UpdateDepth(OrderWay::SELL, AskOrder->GetPrice(), -ToDepthQuantity(ExecutedQty), -1);
+                        delete AskOrder;
+                    }
+                    else
+                    {
+                        UpdateDepth(OrderWay::SELL, AskOrder->GetPrice(), -ToDepthQuantity(ExecutedQty), 0);
                     }
                 }
 
                 if (0_qty == BidOrder->GetOpenQuantity())
                 {
                     GetBidIndex().erase(BidOrderIt);
+                    UpdateDepth(OrderWay::BUY, BidOrder->GetPrice(), 0, -1);
+                    delete BidOrder;
                 }
             }
+
+            m_EventHandler.OnDeals(m_SweepDeals);
         }
 
         template <typename TOrder, typename TEventHandler>
@@ -410,6 +645,135 @@ namespace exchange
             bmi::get<order_id_tag>(m_AskOrders).rehash(size);
         }
 
+        template <typename TOrder, typename TEventHandler>
+        void OrderContainer<TOrder, TEventHandler>::Reserve(size_t iCount)
+        {
+            RehashIndexes(iCount);
+
+            // Both sides share the per thread node free list : the nodes of a scratch storage are recycled by the book
+            std::deque<TOrder> Orders;
+            BidStorage Scratch;
+            for (size_t i = 0; i < iCount; ++i)
+            {
+                Orders.emplace_back(OrderWay::BUY, qty_type(1), price_type(1), client_orderid_type(static_cast<std::uint32_t>(i)), client_id_type(0));
+                Scratch.insert(&Orders.back());
+            }
+        }
+
+        template <typename TOrder, typename TEventHandler>
+        void OrderContainer<TOrder, TEventHandler>::UpdateDepth(OrderWay iWay, price_type iPrice, std::int64_t iQuantity, std::int32_t iOrders)
+        {
+            m_EventHandler.OnLevelChange(iWay, iPrice, iQuantity, iOrders);
+
+            switch (iWay)
+            {
+                case OrderWay::BUY:
+                    UpdateDepth(GetBidIndex(), m_Depth.Bids, m_Depth.BidLevels, m_BidLevelCount, iPrice, iQuantity, iOrders);
+                    break;
+                case OrderWay::SELL:
+                    UpdateDepth(GetAskIndex(), m_Depth.Asks, m_Depth.AskLevels, m_AskLevelCount, iPrice, iQuantity, iOrders);
+                    break;
+                default:
+                    assert(false);
+                    break;
+            }
+        }
+
+        template <typename TOrder, typename TEventHandler>
+        template <typename Index>
+        void OrderContainer<TOrder, TEventHandler>::UpdateDepth(const Index & iIndex, DepthLevel * ioLevels, std::uint32_t & ioCount, size_t & ioLevelCount,
+                                                                price_type iPrice, std::int64_t iQuantity, std::int32_t iOrders)
+        {
+            const auto Better = iIndex.key_comp();
+            const auto Price  = static_cast<std::uint32_t>(iPrice);
+
+            std::uint32_t Position = 0;
+            while (Position < ioCount && Better(price_type(ioLevels[Position].Price), iPrice))
+            {
+                ++Position;
+            }
+
+            if (Position < ioCount && ioLevels[Position].Price == Price)
+            {
+                auto & Level = ioLevels[Position];
+                Level.Quantity = static_cast<std::uint64_t>(static_cast<std::int64_t>(Level.Quantity) + iQuantity);
+                Level.Orders   = static_cast<std::uint32_t>(static_cast<std::int32_t>(Level.Orders) + iOrders);
+
+                if (Level.Orders == 0)
+                {
+                    std::copy(ioLevels + Position + 1, ioLevels + ioCount, ioLevels + Position);
+                    --ioCount;
+                    --ioLevelCount;
+
+                    // The depth was full, the next level of the index enters it
+                    if (ioCount == BookDepth::MaxLevels - 1)
+                    {
+                        RefillDepth(iIndex, ioLevels, ioCount);
+                    }
+                }
+            }
+            else if (Position < BookDepth::MaxLevels)
+            {
+                // The depth holds every level better than its last one, an unknown price is a new level
+                assert(iOrders == 1);
+
+                const auto Last = (std::min)(ioCount, static_cast<std::uint32_t>(BookDepth::MaxLevels - 1));
+                std::copy_backward(ioLevels + Position, ioLevels + Last, ioLevels + Last + 1);
+                ioLevels[Position] = DepthLevel { Price, 1, static_cast<std::uint64_t>(iQuantity) };
+                ioCount = Last + 1;
+                ++ioLevelCount;
+            }
+            else
+            {
+                // Beyond the published levels the order count is unknown, the index tells if the level was created or removed
+                if (iOrders == 1)
+                {
+                    auto It = iIndex.lower_bound(iPrice);
+                    if (++It == iIndex.end() || (*It)->GetPrice() != iPrice)
+                    {
+                        ++ioLevelCount;
+                    }
+                }
+                else if (iOrders == -1 && iIndex.find(iPrice) == iIndex.end())
+                {
+                    --ioLevelCount;
+                }
+                return;
+            }
+
+            m_DepthDirty = true;
+        }
+
+        template <typename TOrder, typename TEventHandler>
+        template <typename Index>
+        void OrderContainer<TOrder, TEventHandler>::RefillDepth(const Index & iIndex, DepthLevel * ioLevels, std::uint32_t & ioCount)
+        {
+            auto It = ioCount == 0 ? iIndex.begin() : iIndex.upper_bound(price_type(ioLevels[ioCount - 1].Price));
+            if (It == iIndex.end())
+            {
+                return;
+            }
+
+            const auto Price = (*It)->GetPrice();
+            DepthLevel Level { static_cast<std::uint32_t>(Price), 0, 0 };
+            for (; It != iIndex.end() && (*It)->GetPrice() == Price; ++It)
+            {
+                ++Level.Orders;
+                Level.Quantity += static_cast<std::uint32_t>((*It)->GetOpenQuantity());
+            }
+            ioLevels[ioCount++] = Level;
+        }
+
+        template <typename TOrder, typename TEventHandler>
+        void OrderContainer<TOrder, TEventHandler>::PublishDepth()
+        {
+            if (m_DepthDirty)
+            {
+                m_PublishedDepth.Store(m_Depth);
+                m_DepthDirty = false;
+            }
+        }
+
         template <typename TOrder, typename TEventHandler>
         void OrderContainer<TOrder, TEventHandler>::ByOrderView(std::vector<TOrder*> & BidContainer, std::vector<TOrder*> & AskContainer) const
         {
@@ -420,6 +784,20 @@ namespace exchange
             std::copy(GetBidIndex().begin(), GetBidIndex().end(), std::back_inserter(BidContainer));
         }
 
+        template <typename TOrder, typename TEventHandler>
+        template <typename Visitor>
+        void OrderContainer<TOrder, TEventHandler>::VisitByOrder(Visitor && iVisitor) const
+        {
+            for (auto pOrder : GetBidIndex())
+            {
+                iVisitor(*pOrder);
+            }
+            for (auto pOrder : GetAskIndex())
+            {
+                iVisitor(*pOrder);
+            }
+        }
+
         template <typename TOrder, typename TEventHandler>
         void OrderContainer<TOrder, TEventHandler>::AggregatedView(LimitContainer & BidContainer, LimitContainer & AskContainer) const
         {
@@ -0,0 +1,208 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <Engine_Command.h>
+#include <Engine_Order.h>
+#include <Engine_Deal.h>
+#include <Engine_Status.h>
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace exchange
+{
+    namespace engine
+    {
+        /* Defined with the order book, the matching engine includes this header */
+        enum class TradingPhase;
+
+        /*!
+         * OrderFlowCommand
+         */
+        enum class OrderFlowCommand : std::uint8_t
+        {
+            PHASE = 0,
+            INSERT,
+            IMMEDIATE_INSERT,
+            MODIFY,
+            DELETE,
+            /* Journal only : end of the intraday auction of one book, TradingPhase in Type */
+            BOOK_PHASE,
+            /* Journal only : unsolicited cancellation of every resting order at the close */
+            CANCEL_ALL,
+            MAX_COMMAND
+        };
+
+        const char * OrderFlowCommandToString(OrderFlowCommand iCommand);
+
+#pragma pack(push, 1)
+
+        /*!
+        *  \brief OrderFlowRecord
+        *
+        *  One decoded inbound command as written in a capture file.
+        *  Timestamps are steady clock nanoseconds of the capturing process, only their differences are meaningful.
+        */
+        struct OrderFlowRecord
+        {
+            std::uint64_t Timestamp  = 0;
+            std::uint32_t ProductID  = 0;
+            std::uint32_t Quantity   = 0;
+            std::uint32_t Price      = 0;
+            std::uint32_t OrderID    = 0;
+            /* Replacing order ID of a MODIFY */
+            std::uint32_t NewOrderID = 0;
+            std::uint32_t ClientID   = 0;
+            std::uint8_t  Command    = 0;
+            std::uint8_t  Way        = 0;
+            /* OrderType, or TradingPhase of a PHASE command */
+            std::uint8_t  Type       = 0;
+            std::uint8_t  Qualifier  = 0;
+        };
+
+        /*!
+        *  \brief DealRecord
+        *
+        *  Deterministic part of a deal ( no timestamp nor reference ), two runs of the same capture must produce the same stream.
+        */
+        struct DealRecord
+        {
+            std::uint32_t ProductID      = 0;
+            std::uint32_t Price          = 0;
+            std::uint32_t Quantity       = 0;
+            std::uint32_t BuyerClientID  = 0;
+            std::uint32_t BuyerOrderID   = 0;
+            std::uint32_t SellerClientID = 0;
+            std::uint32_t SellerOrderID  = 0;
+        };
+
+#pragma pack(pop)
+
+        static_assert(sizeof(OrderFlowRecord) == 36, "OrderFlowRecord is part of the capture file format");
+        static_assert(sizeof(DealRecord) == 28, "DealRecord is part of the deal stream file format");
+
+        /**/
+        DealRecord MakeDealRecord(std::uint32_t iProductID, const Deal & iDeal);
+
+        /* Records of the inbound commands, without timestamp */
+        OrderFlowRecord MakeInsertRecord(const Order & iOrder, std::uint32_t iProductID);
+        OrderFlowRecord MakeImmediateInsertRecord(OrderType iType, OrderWay iWay, Order::qty_type iQty, Order::price_type iPrice, Order::client_orderid_type iOrderID,
+                                                  Order::client_id_type iClientID, TimeQualifier iQualifier, std::uint32_t iProductID);
+        OrderFlowRecord MakeModifyRecord(const OrderReplace & iOrderReplace, std::uint32_t iProductID);
+        OrderFlowRecord MakeDeleteRecord(Order::client_orderid_type iOrderID, Order::client_id_type iClientID, OrderWay iWay, std::uint32_t iProductID);
+        OrderFlowRecord MakePhaseRecord(TradingPhase iPhase, OrderFlowCommand iCommand = OrderFlowCommand::PHASE, std::uint32_t iProductID = 0);
+        OrderFlowRecord MakeCommandRecord(const OrderCommand & iCommand);
+
+        /*!
+        *  \brief OrderFlowRecorder
+        *
+        *  Append the commands received by the gateway to a binary capture file.
+        */
+        class OrderFlowRecorder
+        {
+            public:
+
+                explicit OrderFlowRecorder(const std::string & iFileName);
+                ~OrderFlowRecorder();
+
+                OrderFlowRecorder(const OrderFlowRecorder &) = delete;
+                OrderFlowRecorder & operator=(const OrderFlowRecorder &) = delete;
+
+            public:
+
+                /**/
+                bool IsOpen() const { return m_Stream.is_open() && m_Stream.good(); }
+
+                /**/
+                void RecordInsert(const Order & iOrder, std::uint32_t iProductID);
+
+                /**/
+                void RecordImmediateInsert(OrderType iType, OrderWay iWay, Order::qty_type iQty, Order::price_type iPrice, Order::client_orderid_type iOrderID,
+                                           Order::client_id_type iClientID, TimeQualifier iQualifier, std::uint32_t iProductID);
+
+                /**/
+                void RecordModify(const OrderReplace & iOrderReplace, std::uint32_t iProductID);
+
+                /**/
+                void RecordDelete(Order::client_orderid_type iOrderID, Order::client_id_type iClientID, OrderWay iWay, std::uint32_t iProductID);
+
+                /**/
+                void RecordPhase(TradingPhase iPhase);
+
+                /**/
+                void Flush();
+
+                /**/
+                std::uint64_t GetRecordCounter() const { return m_RecordCounter; }
+
+            private:
+
+                void Write(OrderFlowRecord & rRecord);
+
+            private:
+                std::ofstream   m_Stream;
+                std::uint64_t   m_RecordCounter = 0;
+        };
+
+        /*!
+        *  \brief OrderFlowReader
+        *
+        *  Sequential reader of a capture file written by OrderFlowRecorder.
+        */
+        class OrderFlowReader
+        {
+            public:
+
+                explicit OrderFlowReader(const std::string & iFileName);
+
+            public:
+
+                /* False when the file can't be opened or is not a capture */
+                bool IsValid() const { return m_Valid; }
+
+                /* False at the end of the capture */
+                bool Next(OrderFlowRecord & oRecord);
+
+            private:
+                std::ifstream   m_Stream;
+                bool            m_Valid = false;
+        };
+
+        /* Apply one captured command to the engine */
+        template <typename TMatchingEngine>
+        Status ReplayRecord(TMatchingEngine & rEngine, const OrderFlowRecord & iRecord)
+        {
+            const auto eWay = static_cast<OrderWay>(iRecord.Way);
+
+            switch (static_cast<OrderFlowCommand>(iRecord.Command))
+            {
+                case OrderFlowCommand::PHASE:
+                    return rEngine.SetGlobalPhase(static_cast<TradingPhase>(iRecord.Type)) ? Status::Ok : Status::MarketNotOpened;
+                case OrderFlowCommand::INSERT:
+                    return rEngine.Insert(std::make_unique<Order>(eWay, Quantity(iRecord.Quantity), Price(iRecord.Price),
+                                                                  ClientOrderID(iRecord.OrderID), ClientID(iRecord.ClientID)), iRecord.ProductID);
+                case OrderFlowCommand::IMMEDIATE_INSERT:
+                    return rEngine.ImmediateInsert(static_cast<OrderType>(iRecord.Type), eWay, Quantity(iRecord.Quantity), Price(iRecord.Price),
+                                                   ClientOrderID(iRecord.OrderID), ClientID(iRecord.ClientID),
+                                                   static_cast<TimeQualifier>(iRecord.Qualifier), iRecord.ProductID);
+                case OrderFlowCommand::MODIFY:
+                    return rEngine.Modify(std::make_unique<OrderReplace>(eWay, Quantity(iRecord.Quantity), Price(iRecord.Price), ClientOrderID(iRecord.OrderID),
+                                                                         ClientOrderID(iRecord.NewOrderID), ClientID(iRecord.ClientID)), iRecord.ProductID);
+                case OrderFlowCommand::DELETE:
+                    return rEngine.Delete(ClientOrderID(iRecord.OrderID), ClientID(iRecord.ClientID), eWay, iRecord.ProductID);
+                case OrderFlowCommand::CANCEL_ALL:
+                    rEngine.CancelAllOrders();
+                    return Status::Ok;
+                default:
+                    assert(false);
+                    return Status::InternalError;
+            }
+        }
+    }
+}
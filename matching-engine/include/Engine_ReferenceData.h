@@ -0,0 +1,157 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <Engine_Instrument.h>
+#include <Engine_Order.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace exchange
+{
+    namespace engine
+    {
+
+#pragma pack(push, 1)
+
+        /*!
+        *  \brief ReferenceDataHeader
+        *
+        *  Start of an instrument image : the records of the product IDs [FirstProductID, FirstProductID + SlotCount)
+        *  follow the header, then the string table. The CRC32 covers everything after the header.
+        *  DatabaseFingerprint identifies the state of the database the image was exported from.
+        */
+        struct ReferenceDataHeader
+        {
+            char          Magic[8];
+            std::uint32_t Version             = 0;
+            std::uint32_t InstrumentCount     = 0;
+            std::uint32_t FirstProductID      = 0;
+            std::uint32_t SlotCount           = 0;
+            std::uint64_t StringTableSize     = 0;
+            std::uint32_t Crc                 = 0;
+            std::uint32_t Padding             = 0;
+            std::uint64_t DatabaseFingerprint = 0;
+        };
+
+        /*!
+        *  \brief InstrumentRecord
+        *
+        *  One slot of the image, Name, Isin and Currency are offsets of null terminated strings in the string table.
+        */
+        struct InstrumentRecord
+        {
+            std::uint32_t ProductID  = 0;
+            std::uint32_t Listed     = 0;
+            std::uint32_t ClosePrice = 0;
+            std::uint32_t Name       = 0;
+            std::uint32_t Isin       = 0;
+            std::uint32_t Currency   = 0;
+            std::uint64_t PeakOrders = 0;
+            std::uint64_t PeakDeals  = 0;
+        };
+
+#pragma pack(pop)
+
+        static_assert(sizeof(ReferenceDataHeader) == 48, "ReferenceDataHeader is part of the instrument image format");
+        static_assert(sizeof(InstrumentRecord) == 40, "InstrumentRecord is part of the instrument image format");
+
+        /*!
+        *  \brief ReferenceDataImage
+        *
+        *  Read only image of the instrument database. The file is mapped and checked once, then an instrument
+        *  is found by its product ID without any decoding. LevelDB stays the editable copy : the image is
+        *  exported from it by the engine at the close and by the instrument editor, and is out of date as soon
+        *  as the database fingerprint differs from the one it was exported with.
+        */
+        class ReferenceDataImage
+        {
+            public:
+
+                /* Product IDs spread over more slots than this factor of the instruments are refused */
+                static constexpr std::uint32_t MaxSlotsPerInstrument = 4;
+
+            public:
+
+                explicit ReferenceDataImage(const std::string & iFileName);
+                ~ReferenceDataImage();
+
+                ReferenceDataImage(const ReferenceDataImage &) = delete;
+                ReferenceDataImage & operator=(const ReferenceDataImage &) = delete;
+
+                /* Written aside and renamed, a mapped image is never modified */
+                static bool Export(const std::string & iFileName, const std::vector<Instrument<Order> > & iInstruments,
+                                   std::uint64_t iDatabaseFingerprint);
+
+                /* Same without logging, the failure reason is returned in oError */
+                static bool Export(const std::string & iFileName, const std::vector<Instrument<Order> > & iInstruments,
+                                   std::uint64_t iDatabaseFingerprint, std::string & oError);
+
+                /*
+                *  Hash of the name, size and modification time of the files of a LevelDB directory, without opening it.
+                *  Any write changes it. The info logs and the lock are left out, 0 when the directory can't be read
+                */
+                static std::uint64_t GetDatabaseFingerprint(const std::string & iDBPath);
+
+            public:
+
+                /* False when the file does not exist */
+                bool IsOpen() const { return m_bOpen; }
+
+                /* False when the file is not a complete image */
+                bool IsValid() const { return m_pHeader != nullptr; }
+
+                std::uint32_t GetInstrumentCount() const { return m_pHeader->InstrumentCount; }
+
+                std::uint64_t GetDatabaseFingerprint() const { return m_pHeader->DatabaseFingerprint; }
+
+                /* Valid image only, null when the product is not listed */
+                const InstrumentRecord * Find(std::uint32_t iProductID) const
+                {
+                    const auto Slot = iProductID - m_pHeader->FirstProductID;
+                    if (iProductID < m_pHeader->FirstProductID || Slot >= m_pHeader->SlotCount || !m_pRecords[Slot].Listed)
+                    {
+                        return nullptr;
+                    }
+                    return m_pRecords + Slot;
+                }
+
+                /* Null terminated string of the string table */
+                const char * GetString(std::uint32_t iOffset) const { return m_pStrings + iOffset; }
+
+                Instrument<Order> ToInstrument(const InstrumentRecord & iRecord) const;
+
+                /* Call iVisitor on the listed instruments in product ID order */
+                template <typename Visitor>
+                void VisitInstruments(Visitor && iVisitor) const
+                {
+                    for (std::uint32_t i = 0; i < m_pHeader->SlotCount; ++i)
+                    {
+                        if (m_pRecords[i].Listed)
+                        {
+                            iVisitor(m_pRecords[i]);
+                        }
+                    }
+                }
+
+            private:
+
+                bool Check() const;
+
+            private:
+
+                const char *                 m_pData    = nullptr;
+                std::size_t                  m_Size     = 0;
+                const ReferenceDataHeader *  m_pHeader  = nullptr;
+                const InstrumentRecord *     m_pRecords = nullptr;
+                const char *                 m_pStrings = nullptr;
+                bool                         m_bOpen    = false;
+        };
+
+    }
+}
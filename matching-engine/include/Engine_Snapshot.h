@@ -0,0 +1,180 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace exchange
+{
+    namespace engine
+    {
+
+        class JournalWriter;
+
+        /* fsync the directory of iFileName, makes a rename durable */
+        bool SyncDirectory(const std::string & iFileName);
+
+#pragma pack(push, 1)
+
+        /*!
+        *  \brief SnapshotHeader
+        *
+        *  Start of a snapshot file : journal sequence of the snapshot, global phase and CRC32 of everything after the header.
+        */
+        struct SnapshotHeader
+        {
+            char          Magic[8];
+            std::uint32_t Version     = 0;
+            std::uint32_t BookCount   = 0;
+            std::uint64_t Sequence    = 0;
+            std::uint64_t Size        = 0;
+            std::uint32_t GlobalPhase = 0;
+            std::uint32_t Crc         = 0;
+        };
+
+        /*!
+        *  \brief BookSnapshotHeader
+        *
+        *  Statistics of one book, followed by its bids then its asks in priority order.
+        */
+        struct BookSnapshotHeader
+        {
+            std::uint32_t ProductID        = 0;
+            std::uint32_t Phase            = 0;
+            std::uint32_t LastPrice        = 0;
+            std::uint32_t OpenPrice        = 0;
+            std::uint32_t PostAuctionPrice = 0;
+            std::uint32_t BidOrders        = 0;
+            std::uint32_t AskOrders        = 0;
+            std::uint32_t Padding          = 0;
+            std::uint64_t Turnover         = 0;
+            std::uint64_t DailyVolume      = 0;
+        };
+
+        /*!
+        *  \brief OrderSnapshotRecord
+        *
+        *  One resting order, the open quantity is Quantity - ExecutedQuantity.
+        */
+        struct OrderSnapshotRecord
+        {
+            std::uint32_t Price            = 0;
+            std::uint32_t Quantity         = 0;
+            std::uint32_t ExecutedQuantity = 0;
+            std::uint32_t OrderID          = 0;
+            std::uint32_t ClientID         = 0;
+            std::uint8_t  Way              = 0;
+            std::uint8_t  Padding[3]       = {};
+        };
+
+#pragma pack(pop)
+
+        static_assert(sizeof(SnapshotHeader) == 40, "SnapshotHeader is part of the snapshot file format");
+        static_assert(sizeof(BookSnapshotHeader) == 48, "BookSnapshotHeader is part of the snapshot file format");
+        static_assert(sizeof(OrderSnapshotRecord) == 24, "OrderSnapshotRecord is part of the snapshot file format");
+
+        /*!
+        *  \brief SnapshotWriter
+        *
+        *  Write the encoded books to a memory mapped file from a background thread. The engine thread only
+        *  encodes the books changed since the previous snapshot, the images of the other books are shared.
+        *
+        *  The file is built aside and renamed once it is synced and the journal is durable up to its
+        *  sequence : the snapshot on disk is always complete and never ahead of the journal.
+        */
+        class SnapshotWriter
+        {
+            public:
+
+                using image_type = std::shared_ptr<const std::vector<char> >;
+
+            public:
+
+                SnapshotWriter(const std::string & iFileName, JournalWriter & rJournal);
+                ~SnapshotWriter();
+
+                SnapshotWriter(const SnapshotWriter &) = delete;
+                SnapshotWriter & operator=(const SnapshotWriter &) = delete;
+
+            public:
+
+                /* The previous snapshot is still being written */
+                bool IsBusy() const { return m_Busy.load(std::memory_order_acquire); }
+
+                /* Engine thread, false when busy : iBooks is the state of the books at journal sequence iSequence */
+                bool Write(std::uint64_t iSequence, std::uint32_t iGlobalPhase, std::vector<image_type> iBooks);
+
+                /* Block until the current snapshot is on disk */
+                void Wait();
+
+                /* Sequence of the last snapshot written, 0 if none */
+                std::uint64_t GetLastSequence() const { return m_LastSequence.load(std::memory_order_acquire); }
+
+            private:
+
+                void Run(std::uint64_t iSequence, std::uint32_t iGlobalPhase, std::vector<image_type> iBooks);
+
+                bool WriteFile(const std::string & iFileName, std::uint64_t iSequence, std::uint32_t iGlobalPhase, const std::vector<image_type> & iBooks);
+
+            private:
+
+                std::string                 m_FileName;
+                JournalWriter &             m_rJournal;
+                std::atomic<bool>           m_Busy { false };
+                std::atomic<std::uint64_t>  m_LastSequence { 0 };
+                std::thread                 m_Writer;
+        };
+
+        /*!
+        *  \brief SnapshotReader
+        *
+        *  Map a snapshot file and walk its books in place. The whole file is checked when it is opened.
+        */
+        class SnapshotReader
+        {
+            public:
+
+                explicit SnapshotReader(const std::string & iFileName);
+                ~SnapshotReader();
+
+                SnapshotReader(const SnapshotReader &) = delete;
+                SnapshotReader & operator=(const SnapshotReader &) = delete;
+
+            public:
+
+                /* False when the file does not exist */
+                bool IsOpen() const { return m_bOpen; }
+
+                /* False when the file is not a complete snapshot */
+                bool IsValid() const { return m_pHeader != nullptr; }
+
+                std::uint64_t GetSequence() const { return m_pHeader->Sequence; }
+                std::uint32_t GetGlobalPhase() const { return m_pHeader->GlobalPhase; }
+                std::uint32_t GetBookCount() const { return m_pHeader->BookCount; }
+
+                /* False after the last book, oOrders points to the bids then the asks of oBook */
+                bool Next(const BookSnapshotHeader *& oBook, const OrderSnapshotRecord *& oOrders);
+
+            private:
+
+                bool Check() const;
+
+            private:
+
+                const char *            m_pData   = nullptr;
+                std::size_t             m_Size    = 0;
+                std::size_t             m_Offset  = 0;
+                const SnapshotHeader *  m_pHeader = nullptr;
+                bool                    m_bOpen   = false;
+        };
+
+    }
+}
@@ -22,7 +22,12 @@ namespace exchange
             InvalidQuantity,
             InvalidWay,
             OrderNotFound,
-            InternalError
+            InvalidOrderType,
+            InvalidTimeQualifier,
+            NotFullyExecutable,
+            InternalError,
+            /* The client already has a resting order with this ID */
+            DuplicateOrderID
         };
 
 
@@ -124,6 +124,9 @@ namespace exchange
         {
         public:
             using Numeric<std::uint64_t, Volume>::Numeric;
+            using Numeric<std::uint64_t, Volume>::operator+;
+            using Numeric<std::uint64_t, Volume>::operator+=;
+            using Numeric<std::uint64_t, Volume>::operator-=;
         public:
             constexpr Volume operator +(const Quantity & rhs) const { return Volume(m_value + static_cast<Quantity::underlying_type>(rhs) ); }
 
@@ -1,85 +1,1290 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
 #include <memory>
-#include <forward_list>
+#include <thread>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include <boost/algorithm/string.hpp>
+
+#include <AllocationHook.h>
+#include <BlockAllocator.h>
+#include <LatencyHistogram.h>
+#include <LatencyTrace.h>
+#include <MemoryPool.h>
+#include <SpscRing.h>
 
 #include <Engine_Order.h>
+#include <Engine_Journal.h>
 #include <Engine_MatchingEngine.h>
 
 using namespace exchange::engine;
+using exchange::common::LatencyHistogram;
+using exchange::common::ScopedAllocationCounter;
+using exchange::common::LatencyTracer;
+using exchange::common::LatencyTraceAggregator;
+using exchange::common::TraceStage;
+using exchange::common::BlockBacking;
+using exchange::common::HeapBlockAllocator;
+using exchange::common::MappedBlockAllocator;
+using exchange::common::LevelDBStorage;
+using exchange::common::NoSqlStorage;
+using exchange::common::TextArchiveSerializer;
 
-using engine_type = exchange::engine::MatchingEngine<>;
+using engine_type   = exchange::engine::MatchingEngine<>;
 using OrderBookType = engine_type::OrderBookType;
-
+using ClockType     = std::chrono::steady_clock;
 
 #define CREATE_ORDER(Way, Qty, Price, OrderID, ClientID) (  std::make_unique<Order>(Way, Qty, Price, OrderID, ClientID) )
-#define INSERT_ORDER(OrderBook, iOrder) ( OrderBook->Insert( std::move(iOrder) ) )
+#define CREATE_REPLACE(Way, Qty, Price, OldOrderID, NewOrderID, ClientID) ( std::make_unique<OrderReplace>(Way, Qty, Price, OldOrderID, NewOrderID, ClientID) )
 
-int main(int argc, char ** argv)
+enum class PerfEvent
+{
+    CACHE_MISSES,
+    DTLB_MISSES
+};
+
+/*
+    Hardware cache or data TLB misses of the calling thread, read through perf_event_open.
+    When the counter is not available ( kernel.perf_event_paranoid, container, other OS ) Stop returns -1.
+*/
+class PerfEventCounter
+{
+    public:
+
+        explicit PerfEventCounter(PerfEvent iEvent)
+        {
+#ifdef __linux__
+            perf_event_attr Attr;
+            std::memset(&Attr, 0, sizeof(Attr));
+            Attr.size           = sizeof(Attr);
+            if (iEvent == PerfEvent::DTLB_MISSES)
+            {
+                Attr.type   = PERF_TYPE_HW_CACHE;
+                Attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            }
+            else
+            {
+                Attr.type   = PERF_TYPE_HARDWARE;
+                Attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            }
+            Attr.disabled       = 1;
+            Attr.exclude_kernel = 1;
+            Attr.exclude_hv     = 1;
+
+            m_Fd = static_cast<int>(syscall(__NR_perf_event_open, &Attr, 0, -1, -1, 0));
+#else
+            (void)iEvent;
+#endif
+        }
+
+        ~PerfEventCounter()
+        {
+#ifdef __linux__
+            if (m_Fd != -1)
+            {
+                close(m_Fd);
+            }
+#endif
+        }
+
+        PerfEventCounter(const PerfEventCounter &) = delete;
+        PerfEventCounter & operator=(const PerfEventCounter &) = delete;
+
+        void Start()
+        {
+#ifdef __linux__
+            if (m_Fd != -1)
+            {
+                ioctl(m_Fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(m_Fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        long long Stop()
+        {
+            long long Count = -1;
+#ifdef __linux__
+            if (m_Fd != -1)
+            {
+                ioctl(m_Fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(m_Fd, &Count, sizeof(Count)) != sizeof(Count))
+                {
+                    Count = -1;
+                }
+            }
+#endif
+            return Count;
+        }
+
+    private:
+        int m_Fd = -1;
+};
+
+/*
+    Benchmark settings, read from the [Benchmark] section of the configuration file
+*/
+struct BenchmarkSettings
+{
+    int                 CpuCore           = -1;
+    std::vector<int>    BookDepths        = { 100, 1000, 10000 };
+    std::string         PriceDistribution = "uniform";
+    int                 PriceLevels       = 50;
+    int                 Iterations        = 100000;
+    int                 SweepOrders       = 200;
+    int                 AuctionRuns       = 20;
+    unsigned            Seed              = 42;
+    int                 PoolElements      = 1000000;
+    std::string         JournalFile       = "benchmark.journal";
+    int                 Instruments       = 100000;
+    std::string         InstrumentDBPath  = "/tmp/benchmark-instrument-load-db";
+    int                 UncrossInstruments = 5000;
+    int                 UncrossOrders     = 50;
+    std::string         OutputFile        = "benchmark.json";
+};
+
+bool LoadSettings(const boost::property_tree::ptree & iConfig, BenchmarkSettings & oSettings)
 {
-    if( argc < 2)
+    try
     {
-        std::cerr << "Usage : " << argv[0] << " NbOrderToInsert" << std::endl;
-        return 1;
+        oSettings.CpuCore           = iConfig.get<int>("Benchmark.cpu_core", oSettings.CpuCore);
+        oSettings.PriceDistribution = iConfig.get<std::string>("Benchmark.price_distribution", oSettings.PriceDistribution);
+        oSettings.PriceLevels       = iConfig.get<int>("Benchmark.price_levels", oSettings.PriceLevels);
+        oSettings.Iterations        = iConfig.get<int>("Benchmark.iterations", oSettings.Iterations);
+        oSettings.SweepOrders       = iConfig.get<int>("Benchmark.sweep_orders", oSettings.SweepOrders);
+        oSettings.AuctionRuns       = iConfig.get<int>("Benchmark.auction_runs", oSettings.AuctionRuns);
+        oSettings.Seed              = iConfig.get<unsigned>("Benchmark.seed", oSettings.Seed);
+        oSettings.PoolElements      = iConfig.get<int>("Benchmark.pool_elements", oSettings.PoolElements);
+        oSettings.JournalFile       = iConfig.get<std::string>("Benchmark.journal_file", oSettings.JournalFile);
+        oSettings.Instruments       = iConfig.get<int>("Benchmark.instruments", oSettings.Instruments);
+        oSettings.InstrumentDBPath  = iConfig.get<std::string>("Benchmark.instrument_db_path", oSettings.InstrumentDBPath);
+        oSettings.UncrossInstruments = iConfig.get<int>("Benchmark.uncross_instruments", oSettings.UncrossInstruments);
+        oSettings.UncrossOrders     = iConfig.get<int>("Benchmark.uncross_orders", oSettings.UncrossOrders);
+        oSettings.OutputFile        = iConfig.get<std::string>("Benchmark.output_file", oSettings.OutputFile);
+
+        if (auto Depths = iConfig.get_optional<std::string>("Benchmark.book_depths"))
+        {
+            std::vector<std::string> Tokens;
+            boost::split(Tokens, *Depths, boost::is_any_of(","));
+
+            oSettings.BookDepths.clear();
+            for (auto & Token : Tokens)
+            {
+                boost::trim(Token);
+                oSettings.BookDepths.push_back(std::stoi(Token));
+            }
+        }
+    }
+    catch (const std::exception & Error)
+    {
+        std::cerr << "Invalid benchmark configuration : " << Error.what() << std::endl;
+        return false;
+    }
+
+    if (oSettings.PriceDistribution != "uniform" && oSettings.PriceDistribution != "normal")
+    {
+        std::cerr << "Invalid price_distribution [" << oSettings.PriceDistribution << "], expected uniform or normal" << std::endl;
+        return false;
+    }
+
+    if (oSettings.PriceLevels <= 0 || oSettings.Iterations <= 0 || oSettings.SweepOrders <= 0 || oSettings.AuctionRuns <= 0 || oSettings.PoolElements <= 0 ||
+        oSettings.Instruments <= 0 || oSettings.UncrossInstruments <= 0 || oSettings.UncrossOrders <= 0 ||
+        oSettings.BookDepths.empty())
+    {
+        std::cerr << "Invalid benchmark configuration : counts must be positive" << std::endl;
+        return false;
+    }
+
+    for (auto Depth : oSettings.BookDepths)
+    {
+        if (Depth <= 0)
+        {
+            std::cerr << "Invalid benchmark configuration : book depths must be positive" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void PinToCore(int iCpuCore)
+{
+    if (iCpuCore < 0)
+    {
+        return;
+    }
+#ifdef __linux__
+    cpu_set_t CpuSet;
+    CPU_ZERO(&CpuSet);
+    CPU_SET(iCpuCore, &CpuSet);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(CpuSet), &CpuSet) != 0)
+    {
+        std::cerr << "Failed to pin the benchmark thread on core " << iCpuCore << std::endl;
+    }
+#else
+    std::cerr << "Core pinning is not supported on this platform" << std::endl;
+#endif
+}
+
+/*
+    Result of one scenario for one book depth
+*/
+struct ScenarioResult
+{
+    std::string       Scenario;
+    int               BookDepth = 0;
+    LatencyHistogram  Latencies;
+    double            ElapsedSeconds = 0.0;
+    long long         CacheMisses = 0;
+    long long         DtlbMisses = 0;
+    /* Heap allocations done by the measured operations */
+    std::uint64_t     Allocations = 0;
+};
+
+double GetAllocationsPerOperation(const ScenarioResult & iResult)
+{
+    const auto Count = iResult.Latencies.GetCount();
+    return Count > 0 ? static_cast<double>(iResult.Allocations) / Count : 0.0;
+}
+
+/* Sum of the counts of several runs, -1 as soon as one of them was not available */
+long long AddPerfCount(long long iTotal, long long iCount)
+{
+    return (iTotal < 0 || iCount < 0) ? -1 : iTotal + iCount;
+}
+
+/*
+    Book used by a scenario : a price reference, passive orders spread over
+    price_levels ticks on each side, and the resting orders still alive
+*/
+class BenchmarkBook
+{
+    public:
+
+        struct RestingOrder
+        {
+            OrderWay      Way;
+            Price         LimitPrice;
+            Quantity      Qty;
+            ClientOrderID OrderID;
+            ClientID      Client;
+        };
+
+        static constexpr std::uint32_t ReferencePrice = 10000;
+
+    public:
+
+        BenchmarkBook(engine_type & rEngine, const BenchmarkSettings & iSettings, std::mt19937 & rGenerator, TradingPhase iPhase)
+            :m_Instrument{ "BenchmarkCorporation", "ISIN", "EUR", 1, Price(ReferencePrice) }, m_Settings(iSettings), m_rGenerator(rGenerator),
+             m_Uniform(0, iSettings.PriceLevels - 1), m_Normal(0.0, iSettings.PriceLevels / 4.0)
+        {
+            m_pOrderBook = std::make_unique<OrderBookType>(m_Instrument, rEngine);
+            m_pOrderBook->SetTradingPhase(iPhase);
+        }
+
+        OrderBookType & GetOrderBook() { return *m_pOrderBook; }
+        std::vector<RestingOrder> & GetRestingOrders() { return m_RestingOrders; }
+
+        ClientOrderID NextOrderID() { return ClientOrderID(++m_LastOrderID); }
+
+        /* Distance to the reference price, in ticks */
+        int NextLevel()
+        {
+            if (m_Settings.PriceDistribution == "normal")
+            {
+                return (std::min)(static_cast<int>(std::abs(m_Normal(m_rGenerator))), m_Settings.PriceLevels - 1);
+            }
+            return m_Uniform(m_rGenerator);
+        }
+
+        /* A price which never crosses the opposite side */
+        Price NextPassivePrice(OrderWay iWay)
+        {
+            const auto Level = static_cast<std::uint32_t>(NextLevel()) + 1;
+            return iWay == OrderWay::BUY ? Price(ReferencePrice - Level) : Price(ReferencePrice + Level);
+        }
+
+        /* A price which crosses every passive level of the opposite side */
+        Price AggressivePrice(OrderWay iWay) const
+        {
+            const auto Level = static_cast<std::uint32_t>(m_Settings.PriceLevels) + 1;
+            return iWay == OrderWay::BUY ? Price(ReferencePrice + Level) : Price(ReferencePrice - Level);
+        }
+
+        std::unique_ptr<Order> CreatePassiveOrder(OrderWay iWay, Quantity iQty)
+        {
+            const auto Client = iWay == OrderWay::BUY ? 5_clientid : 6_clientid;
+            m_RestingOrders.push_back(RestingOrder{ iWay, NextPassivePrice(iWay), iQty, NextOrderID(), Client });
+
+            const auto & Resting = m_RestingOrders.back();
+            return CREATE_ORDER(Resting.Way, Resting.Qty, Resting.LimitPrice, Resting.OrderID, Resting.Client);
+        }
+
+        void AddPassiveOrder(OrderWay iWay, Quantity iQty)
+        {
+            m_pOrderBook->Insert(CreatePassiveOrder(iWay, iQty));
+        }
+
+        void Fill(int iDepth, Quantity iQty)
+        {
+            m_pOrderBook->RehashOrderIndexes(iDepth);
+            m_RestingOrders.reserve(2 * iDepth);
+
+            for (auto i = 0; i < iDepth; i++)
+            {
+                AddPassiveOrder(OrderWay::BUY, iQty);
+                AddPassiveOrder(OrderWay::SELL, iQty);
+            }
+        }
+
+        /* Remove a resting order from the book and from the resting list */
+        void Cancel(size_t iIndex)
+        {
+            const auto Resting = m_RestingOrders[iIndex];
+            m_RestingOrders[iIndex] = m_RestingOrders.back();
+            m_RestingOrders.pop_back();
+
+            m_pOrderBook->Delete(Resting.OrderID, Resting.Client, Resting.Way);
+        }
+
+        size_t RandomRestingIndex()
+        {
+            return std::uniform_int_distribution<size_t>(0, m_RestingOrders.size() - 1)(m_rGenerator);
+        }
+
+        size_t RandomRestingIndex(OrderWay iWay)
+        {
+            size_t Index = 0;
+            do
+            {
+                Index = RandomRestingIndex();
+            } while (m_RestingOrders[Index].Way != iWay);
+            return Index;
+        }
+
+    private:
+        Instrument<Order>                 m_Instrument;
+        const BenchmarkSettings &         m_Settings;
+        std::mt19937 &                    m_rGenerator;
+        std::uniform_int_distribution<>   m_Uniform;
+        std::normal_distribution<>        m_Normal;
+        std::unique_ptr<OrderBookType>    m_pOrderBook;
+        std::vector<RestingOrder>         m_RestingOrders;
+        std::uint32_t                     m_LastOrderID = 0;
+};
+
+/*
+    Time a single operation and record its latency in nanoseconds, with its heap allocations
+*/
+template <typename Operation>
+void Measure(ScenarioResult & rResult, Operation && iOperation)
+{
+    ScopedAllocationCounter Allocations;
+
+    const auto Start = ClockType::now();
+    iOperation();
+    const auto End = ClockType::now();
+
+    rResult.Allocations += Allocations.GetAllocations();
+
+    const auto Elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(End - Start);
+    rResult.Latencies.Record(static_cast<LatencyHistogram::value_type>(Elapsed.count()));
+    rResult.ElapsedSeconds += std::chrono::duration<double>(Elapsed).count();
+}
+
+/*
+    The scenario body is called with the book already filled at the requested depth
+*/
+template <typename Body>
+ScenarioResult RunScenario(const std::string & iName, engine_type & rEngine, const BenchmarkSettings & iSettings, std::mt19937 & rGenerator,
+                           int iDepth, Quantity iRestingQty, Body && iBody)
+{
+    ScenarioResult Result;
+    Result.Scenario  = iName;
+    Result.BookDepth = iDepth;
+
+    BenchmarkBook Book(rEngine, iSettings, rGenerator, TradingPhase::CONTINUOUS_TRADING);
+    Book.Fill(iDepth, iRestingQty);
+    Book.GetOrderBook().ReserveDeals(iSettings.Iterations);
+
+    PerfEventCounter CacheMisses(PerfEvent::CACHE_MISSES);
+    PerfEventCounter DtlbMisses(PerfEvent::DTLB_MISSES);
+    CacheMisses.Start();
+    DtlbMisses.Start();
+
+    iBody(Book, Result);
+
+    Result.DtlbMisses  = DtlbMisses.Stop();
+    Result.CacheMisses = CacheMisses.Stop();
+    return Result;
+}
+
+std::vector<ScenarioResult> RunBookDepth(engine_type & rEngine, const BenchmarkSettings & iSettings, std::mt19937 & rGenerator, int iDepth)
+{
+    std::vector<ScenarioResult> Results;
+
+    const auto Iterations  = iSettings.Iterations;
+    const auto RestingQty  = 100_qty;
+
+    /* Passive insert, a random resting order of the same side is cancelled to keep the depth */
+    Results.push_back(RunScenario("insert_passive", rEngine, iSettings, rGenerator, iDepth, RestingQty,
+        [&](BenchmarkBook & Book, ScenarioResult & Result)
+        {
+            for (auto i = 0; i < Iterations; i++)
+            {
+                const auto Way = i % 2 ? OrderWay::SELL : OrderWay::BUY;
+                auto pOrder = Book.CreatePassiveOrder(Way, RestingQty);
+
+                Measure(Result, [&]() { Book.GetOrderBook().Insert(std::move(pOrder)); });
+
+                Book.Cancel(Book.RandomRestingIndex(Way));
+            }
+        }));
+
+    /* Same as insert_passive with every order traced, the difference with insert_passive is the tracing overhead */
+    Results.push_back(RunScenario("insert_passive_traced", rEngine, iSettings, rGenerator, iDepth, RestingQty,
+        [&](BenchmarkBook & Book, ScenarioResult & Result)
+        {
+            LatencyTracer          Tracer(1);
+            LatencyTraceAggregator Aggregator(Tracer, "", std::chrono::seconds(0));
+            Aggregator.Start();
+
+            for (auto i = 0; i < Iterations; i++)
+            {
+                const auto Way = i % 2 ? OrderWay::SELL : OrderWay::BUY;
+                auto pOrder = Book.CreatePassiveOrder(Way, RestingQty);
+
+                Measure(Result, [&]()
+                {
+                    Tracer.Begin(exchange::common::ReadTimestampCounter());
+                    LatencyTracer::Stamp(TraceStage::PARSED);
+                    LatencyTracer::Stamp(TraceStage::ENGINE_ENTRY);
+                    Book.GetOrderBook().Insert(std::move(pOrder));
+                    LatencyTracer::Stamp(TraceStage::ENGINE_EXIT);
+                    Tracer.End();
+                });
+
+                Book.Cancel(Book.RandomRestingIndex(Way));
+            }
+        }));
+
+    /* Aggressive insert fully executing the best opposite order, which is then replenished */
+    Results.push_back(RunScenario("insert_aggressive", rEngine, iSettings, rGenerator, iDepth, RestingQty,
+        [&](BenchmarkBook & Book, ScenarioResult & Result)
+        {
+            for (auto i = 0; i < Iterations; i++)
+            {
+                const auto Way = i % 2 ? OrderWay::SELL : OrderWay::BUY;
+                auto pOrder = CREATE_ORDER(Way, RestingQty, Book.AggressivePrice(Way), Book.NextOrderID(), 7_clientid);
+
+                Measure(Result, [&]() { Book.GetOrderBook().Insert(std::move(pOrder)); });
+
+                Book.AddPassiveOrder(Way == OrderWay::BUY ? OrderWay::SELL : OrderWay::BUY, RestingQty);
+            }
+        }));
+
+    /* Aggressive insert executing sweep_orders resting orders, which are then replenished */
+    const auto SweepOrders = (std::min)(iSettings.SweepOrders, iDepth);
+    Results.push_back(RunScenario("sweep", rEngine, iSettings, rGenerator, iDepth, RestingQty,
+        [&](BenchmarkBook & Book, ScenarioResult & Result)
+        {
+            const auto Sweeps = (std::max)(Iterations / SweepOrders, 1);
+            for (auto i = 0; i < Sweeps; i++)
+            {
+                const auto Way = i % 2 ? OrderWay::SELL : OrderWay::BUY;
+                auto pOrder = CREATE_ORDER(Way, Quantity(SweepOrders * static_cast<std::uint32_t>(RestingQty)), Book.AggressivePrice(Way), Book.NextOrderID(), 7_clientid);
+
+                Measure(Result, [&]() { Book.GetOrderBook().Insert(std::move(pOrder)); });
+
+                for (auto j = 0; j < SweepOrders; j++)
+                {
+                    Book.AddPassiveOrder(Way == OrderWay::BUY ? OrderWay::SELL : OrderWay::BUY, RestingQty);
+                }
+            }
+        }));
+
+    /* Quantity decrease at the same price, the order keeps its priority */
+    const auto AmendsPerOrder = static_cast<std::uint32_t>(Iterations / (2 * iDepth) + 1);
+    Results.push_back(RunScenario("amend_down", rEngine, iSettings, rGenerator, iDepth, Quantity(100 + AmendsPerOrder),
+        [&](BenchmarkBook & Book, ScenarioResult & Result)
+        {
+            auto & Resting = Book.GetRestingOrders();
+            for (auto i = 0; i < Iterations; i++)
+            {
+                auto & Order = Resting[i % Resting.size()];
+                const auto NewOrderID = Book.NextOrderID();
+                Order.Qty -= 1_qty;
+                auto pReplace = CREATE_REPLACE(Order.Way, Order.Qty, Order.LimitPrice, Order.OrderID, NewOrderID, Order.Client);
+                Order.OrderID = NewOrderID;
+
+                Measure(Result, [&]() { Book.GetOrderBook().Modify(std::move(pReplace)); });
+            }
+        }));
+
+    /* Price change on the same side, the order never crosses */
+    Results.push_back(RunScenario("modify_reprice", rEngine, iSettings, rGenerator, iDepth, RestingQty,
+        [&](BenchmarkBook & Book, ScenarioResult & Result)
+        {
+            auto & Resting = Book.GetRestingOrders();
+            for (auto i = 0; i < Iterations; i++)
+            {
+                auto & Order = Resting[Book.RandomRestingIndex()];
+                const auto NewOrderID = Book.NextOrderID();
+                Order.LimitPrice = Book.NextPassivePrice(Order.Way);
+                auto pReplace = CREATE_REPLACE(Order.Way, Order.Qty, Order.LimitPrice, Order.OrderID, NewOrderID, Order.Client);
+                Order.OrderID = NewOrderID;
+
+                Measure(Result, [&]() { Book.GetOrderBook().Modify(std::move(pReplace)); });
+            }
+        }));
+
+    /* Cancel a random resting order, a new one is inserted to keep the depth */
+    Results.push_back(RunScenario("cancel", rEngine, iSettings, rGenerator, iDepth, RestingQty,
+        [&](BenchmarkBook & Book, ScenarioResult & Result)
+        {
+            auto & Resting = Book.GetRestingOrders();
+            for (auto i = 0; i < Iterations; i++)
+            {
+                const auto Index = Book.RandomRestingIndex();
+                const auto Order = Resting[Index];
+
+                Resting[Index] = Resting.back();
+                Resting.pop_back();
+
+                Measure(Result, [&]() { Book.GetOrderBook().Delete(Order.OrderID, Order.Client, Order.Way); });
+
+                Book.AddPassiveOrder(Order.Way, RestingQty);
+            }
+        }));
+
+    /* Uncross of an opening auction, both sides overlap around the reference price */
+    {
+        ScenarioResult Result;
+        Result.Scenario  = "auction_uncross";
+        Result.BookDepth = iDepth;
+
+        PerfEventCounter CacheMissCounter(PerfEvent::CACHE_MISSES);
+        PerfEventCounter DtlbMissCounter(PerfEvent::DTLB_MISSES);
+
+        for (auto r = 0; r < iSettings.AuctionRuns; r++)
+        {
+            BenchmarkBook Book(rEngine, iSettings, rGenerator, TradingPhase::OPENING_AUCTION);
+
+            auto & OrderBook = Book.GetOrderBook();
+            OrderBook.RehashOrderIndexes(iDepth);
+            OrderBook.ReserveDeals(2 * iDepth);
+
+            const auto HalfLevels = static_cast<std::uint32_t>(iSettings.PriceLevels / 2);
+            for (auto i = 0; i < iDepth; i++)
+            {
+                const auto Shift = static_cast<std::uint32_t>(Book.NextLevel());
+                OrderBook.Insert(CREATE_ORDER(OrderWay::BUY, RestingQty, Price(BenchmarkBook::ReferencePrice + HalfLevels - Shift), Book.NextOrderID(), 5_clientid));
+                OrderBook.Insert(CREATE_ORDER(OrderWay::SELL, RestingQty, Price(BenchmarkBook::ReferencePrice - HalfLevels + Shift), Book.NextOrderID(), 6_clientid));
+            }
+
+            CacheMissCounter.Start();
+            DtlbMissCounter.Start();
+            Measure(Result, [&]() { OrderBook.SetTradingPhase(TradingPhase::CONTINUOUS_TRADING); });
+
+            Result.DtlbMisses  = AddPerfCount(Result.DtlbMisses, DtlbMissCounter.Stop());
+            Result.CacheMisses = AddPerfCount(Result.CacheMisses, CacheMissCounter.Stop());
+        }
+
+        Results.push_back(std::move(Result));
+    }
+
+    /* End of day cancellation of every resting order of the book */
+    {
+        ScenarioResult Result;
+        Result.Scenario  = "cancel_all";
+        Result.BookDepth = iDepth;
+
+        PerfEventCounter CacheMissCounter(PerfEvent::CACHE_MISSES);
+        PerfEventCounter DtlbMissCounter(PerfEvent::DTLB_MISSES);
+
+        for (auto r = 0; r < iSettings.AuctionRuns; r++)
+        {
+            BenchmarkBook Book(rEngine, iSettings, rGenerator, TradingPhase::CONTINUOUS_TRADING);
+            Book.Fill(iDepth, RestingQty);
+
+            CacheMissCounter.Start();
+            DtlbMissCounter.Start();
+            Measure(Result, [&]() { Book.GetOrderBook().CancelAllOrders(); });
+
+            Result.DtlbMisses  = AddPerfCount(Result.DtlbMisses, DtlbMissCounter.Stop());
+            Result.CacheMisses = AddPerfCount(Result.CacheMisses, CacheMissCounter.Stop());
+        }
+
+        Results.push_back(std::move(Result));
+    }
+
+    return Results;
+}
+
+/*
+    Random reads of pool_elements deals held by one pool, the pool is reserved ( pre faulted ) before the run.
+    Comparing the heap and the mapped backings shows the cost of the data TLB misses.
+*/
+template <typename Pool>
+ScenarioResult RunPoolScenario(const std::string & iName, const BenchmarkSettings & iSettings, std::mt19937 & rGenerator)
+{
+    ScenarioResult Result;
+    Result.Scenario  = iName;
+    Result.BookDepth = iSettings.PoolElements;
+
+    const auto Elements = static_cast<size_t>(iSettings.PoolElements);
+
+    auto pPool = std::make_unique<Pool>();
+    pPool->reserve(Elements);
+
+    std::vector<Deal *> Deals;
+    Deals.reserve(Elements);
+    for (size_t i = 0; i < Elements; i++)
+    {
+        Deals.push_back(pPool->newElement(Price(BenchmarkBook::ReferencePrice), Quantity(static_cast<std::uint32_t>(i % 100 + 1)), 5_clientid,
+                                          ClientOrderID(static_cast<std::uint32_t>(i)), 6_clientid, ClientOrderID(static_cast<std::uint32_t>(i))));
+    }
+
+    std::uniform_int_distribution<size_t> Distribution(0, Elements - 1);
+    std::vector<size_t> Indexes(static_cast<size_t>(iSettings.Iterations));
+    for (auto & Index : Indexes)
+    {
+        Index = Distribution(rGenerator);
+    }
+
+    PerfEventCounter CacheMisses(PerfEvent::CACHE_MISSES);
+    PerfEventCounter DtlbMisses(PerfEvent::DTLB_MISSES);
+    CacheMisses.Start();
+    DtlbMisses.Start();
+
+    volatile std::uint32_t Volume = 0;
+    for (auto Index : Indexes)
+    {
+        Measure(Result, [&]() { Volume = Volume + static_cast<std::uint32_t>(Deals[Index]->GetQuantity()); });
+    }
+
+    Result.DtlbMisses  = DtlbMisses.Stop();
+    Result.CacheMisses = CacheMisses.Stop();
+
+    for (auto pDeal : Deals)
+    {
+        pPool->deleteElement(pDeal);
+    }
+    return Result;
+}
+
+/*
+    Orders allocated on the benchmark thread and released by another thread, as between the gateway sessions and the engine.
+    Only the allocation is measured. Other allocators ( jemalloc, tcmalloc ) are compared by preloading them : they replace malloc.
+*/
+template <typename Allocate, typename Release>
+ScenarioResult RunCrossThreadAllocation(const std::string & iName, const BenchmarkSettings & iSettings, Allocate && iAllocate, Release && iRelease)
+{
+    ScenarioResult Result;
+    Result.Scenario = iName;
+
+    using ring_type = exchange::common::SpscRing<Order *, 4096>;
+    auto pRing = std::make_unique<ring_type>();
+
+    std::atomic<bool> bDone { false };
+    std::thread Releaser([&]()
+    {
+        Order * pOrder = nullptr;
+        while (true)
+        {
+            if (pRing->TryPop(pOrder))
+            {
+                iRelease(pOrder);
+            }
+            else if (bDone.load(std::memory_order_acquire))
+            {
+                while (pRing->TryPop(pOrder))
+                {
+                    iRelease(pOrder);
+                }
+                break;
+            }
+        }
+    });
+
+    PerfEventCounter CacheMisses(PerfEvent::CACHE_MISSES);
+    PerfEventCounter DtlbMisses(PerfEvent::DTLB_MISSES);
+    CacheMisses.Start();
+    DtlbMisses.Start();
+
+    for (auto i = 0; i < iSettings.Iterations; i++)
+    {
+        Order * pOrder = nullptr;
+        const auto OrderID = ClientOrderID(static_cast<std::uint32_t>(i));
+
+        Measure(Result, [&]() { pOrder = iAllocate(OrderID); });
+
+        while (!pRing->TryPush(pOrder))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    Result.DtlbMisses  = DtlbMisses.Stop();
+    Result.CacheMisses = CacheMisses.Stop();
+
+    bDone.store(true, std::memory_order_release);
+    Releaser.join();
+    return Result;
+}
+
+std::vector<ScenarioResult> RunOrderAllocations(const BenchmarkSettings & iSettings)
+{
+    std::vector<ScenarioResult> Results;
+
+    Results.push_back(RunCrossThreadAllocation("order_alloc_malloc", iSettings,
+        [](ClientOrderID iOrderID) { return new (std::malloc(sizeof(Order))) Order(OrderWay::BUY, 100_qty, 1000_price, iOrderID, 5_clientid); },
+        [](Order * pOrder) { pOrder->~Order(); std::free(pOrder); }));
+
+    Results.push_back(RunCrossThreadAllocation("order_alloc_pool", iSettings,
+        [](ClientOrderID iOrderID) { return new Order(OrderWay::BUY, 100_qty, 1000_price, iOrderID, 5_clientid); },
+        [](Order * pOrder) { delete pOrder; }));
+
+    return Results;
+}
+
+std::vector<ScenarioResult> RunPoolBackings(const BenchmarkSettings & iSettings, std::mt19937 & rGenerator)
+{
+    std::vector<ScenarioResult> Results;
+
+    Results.push_back(RunPoolScenario<MemoryPool<Deal, 65536, HeapBlockAllocator> >("pool_heap", iSettings, rGenerator));
+    Results.push_back(RunPoolScenario<MemoryPool<Deal, MappedBlockAllocator::HugePageSize, MappedBlockAllocator> >("pool_huge_pages", iSettings, rGenerator));
+
+    std::cout << "pool_huge_pages blocks :";
+    for (auto Backing : { BlockBacking::HUGE_TLB, BlockBacking::TRANSPARENT_HUGE_PAGES, BlockBacking::SMALL_PAGES })
+    {
+        std::cout << " " << exchange::common::BlockBackingToString(Backing) << "[" << MappedBlockAllocator::GetBlockCount(Backing) << "]";
+    }
+    std::cout << std::endl;
+
+    return Results;
+}
+
+/*
+    ReplayRecord target applying the commands to a single benchmark book
+*/
+struct BookReplayTarget
+{
+    OrderBookType & rOrderBook;
+
+    Status Insert(std::unique_ptr<Order> ipOrder, std::uint32_t) { return rOrderBook.Insert(std::move(ipOrder)); }
+
+    Status ImmediateInsert(OrderType iType, OrderWay iWay, Order::qty_type iQty, Order::price_type iPrice, Order::client_orderid_type iOrderID,
+                           Order::client_id_type iClientID, TimeQualifier iQualifier, std::uint32_t)
+    {
+        return rOrderBook.ImmediateInsert(iType, iWay, iQty, iPrice, iOrderID, iClientID, iQualifier);
+    }
+
+    Status Modify(std::unique_ptr<OrderReplace> ipOrderReplace, std::uint32_t) { return rOrderBook.Modify(std::move(ipOrderReplace)); }
+
+    Status Delete(Order::client_orderid_type iOrderID, Order::client_id_type iClientID, OrderWay iWay, std::uint32_t)
+    {
+        return rOrderBook.Delete(iOrderID, iClientID, iWay);
+    }
+
+    bool SetGlobalPhase(TradingPhase iPhase) { return rOrderBook.SetTradingPhase(iPhase); }
+
+    void CancelAllOrders() { rOrderBook.CancelAllOrders(); }
+};
+
+/*
+    Journal of a synthetic flow ( passive buy and sell, IOC hitting the bid, cancel of the ask ).
+    journal_append is the cost on the engine thread, journal_replay the crash recovery loop :
+    read, CRC check and apply into an empty book.
+*/
+std::vector<ScenarioResult> RunJournal(engine_type & rEngine, const BenchmarkSettings & iSettings, std::mt19937 & rGenerator)
+{
+    std::vector<ScenarioResult> Results;
+
+    std::vector<OrderFlowRecord> Flow;
+    Flow.reserve(4 * static_cast<size_t>(iSettings.Iterations));
+    {
+        BenchmarkBook Source(rEngine, iSettings, rGenerator, TradingPhase::CONTINUOUS_TRADING);
+        for (auto i = 0; i < iSettings.Iterations; i++)
+        {
+            const Order Buy(OrderWay::BUY, 100_qty, Source.NextPassivePrice(OrderWay::BUY), Source.NextOrderID(), 5_clientid);
+            const Order Sell(OrderWay::SELL, 100_qty, Source.NextPassivePrice(OrderWay::SELL), Source.NextOrderID(), 6_clientid);
+
+            Flow.push_back(MakeInsertRecord(Buy, 1));
+            Flow.push_back(MakeInsertRecord(Sell, 1));
+            Flow.push_back(MakeImmediateInsertRecord(OrderType::LIMIT, OrderWay::SELL, 10_qty, Source.AggressivePrice(OrderWay::SELL), Source.NextOrderID(),
+                                                     7_clientid, TimeQualifier::IOC, 1));
+            Flow.push_back(MakeDeleteRecord(Sell.GetOrderID(), Sell.GetClientID(), OrderWay::SELL, 1));
+        }
+    }
+
+    std::remove(iSettings.JournalFile.c_str());
+    {
+        ScenarioResult Result;
+        Result.Scenario = "journal_append";
+
+        JournalWriter Writer(iSettings.JournalFile, 1, 0);
+        if (!Writer.IsOpen())
+        {
+            std::cerr << "Failed to create the journal " << iSettings.JournalFile << std::endl;
+            return Results;
+        }
+
+        PerfEventCounter CacheMisses(PerfEvent::CACHE_MISSES);
+        PerfEventCounter DtlbMisses(PerfEvent::DTLB_MISSES);
+        CacheMisses.Start();
+        DtlbMisses.Start();
+
+        for (const auto & Record : Flow)
+        {
+            Measure(Result, [&]() { Writer.Append(Record); });
+        }
+
+        Result.DtlbMisses  = DtlbMisses.Stop();
+        Result.CacheMisses = CacheMisses.Stop();
+        Writer.Sync();
+
+        std::cout << "journal_append : group commits[" << Writer.GetGroupCommitCounter() << "] ; ring full[" << Writer.GetStallCounter() << "]" << std::endl;
+        Results.push_back(std::move(Result));
+    }
+
+    {
+        ScenarioResult Result;
+        Result.Scenario = "journal_replay";
+
+        BenchmarkBook Book(rEngine, iSettings, rGenerator, TradingPhase::CONTINUOUS_TRADING);
+        Book.GetOrderBook().RehashOrderIndexes(iSettings.Iterations);
+        Book.GetOrderBook().ReserveDeals(iSettings.Iterations);
+        BookReplayTarget Target{ Book.GetOrderBook() };
+
+        JournalReader Reader(iSettings.JournalFile);
+        OrderFlowRecord Record;
+
+        PerfEventCounter CacheMisses(PerfEvent::CACHE_MISSES);
+        PerfEventCounter DtlbMisses(PerfEvent::DTLB_MISSES);
+        CacheMisses.Start();
+        DtlbMisses.Start();
+
+        for (size_t i = 0; i < Flow.size(); i++)
+        {
+            Measure(Result, [&]()
+            {
+                Reader.Next(Record);
+                ReplayRecord(Target, Record);
+            });
+        }
+
+        Result.DtlbMisses  = DtlbMisses.Stop();
+        Result.CacheMisses = CacheMisses.Stop();
+
+        if (Reader.GetLastSequence() != Flow.size())
+        {
+            std::cerr << "journal_replay : read " << Reader.GetLastSequence() << " records out of " << Flow.size() << std::endl;
+        }
+        Results.push_back(std::move(Result));
     }
+    std::remove(iSettings.JournalFile.c_str());
 
-    auto nb_order_to_insert = atoi(argv[1]);
+    return Results;
+}
+
+/*
+    Load a large instrument database : one sample per instrument, time since the previous one ( iteration and decoding )
+*/
+template <typename Storage>
+ScenarioResult LoadInstruments(const std::string & iName, const BenchmarkSettings & iSettings, std::size_t & oMigrated)
+{
+    ScenarioResult Result;
+    Result.Scenario = iName;
 
-    Instrument<Order>              Instrument{ "MingYiCorporation", "ISIN", "EUR", 1, 100_price };
-    boost::property_tree::ptree    Config;
-    auto                           pEngine = std::make_unique<engine_type>();
-    auto                           pOrderBook = std::make_unique<OrderBookType>(Instrument, *pEngine);
+    Storage Loader(iSettings.InstrumentDBPath);
 
-    if (boost::filesystem::exists("config.ini"))
+    ScopedAllocationCounter Allocations;
+    const auto Start = ClockType::now();
+    auto Previous = Start;
+
+    const bool bLoaded = Loader.Load([&Result, &Previous](const Instrument<Order> &)
     {
-        boost::property_tree::ini_parser::read_ini("config.ini", Config);
-        pEngine->Configure(Config);
+        const auto Now = ClockType::now();
+        Result.Latencies.Record(static_cast<LatencyHistogram::value_type>(std::chrono::duration_cast<std::chrono::nanoseconds>(Now - Previous).count()));
+        Previous = Now;
+    });
+
+    // The migration of the records is part of the load
+    Result.ElapsedSeconds = std::chrono::duration<double>(ClockType::now() - Start).count();
+    Result.Allocations    = Allocations.GetAllocations();
+    Result.DtlbMisses     = -1;
+    Result.CacheMisses    = -1;
+    oMigrated             = Loader.GetMigratedCounter();
+
+    if (!bLoaded || Result.Latencies.GetCount() != static_cast<std::uint64_t>(iSettings.Instruments))
+    {
+        std::cerr << iName << " : loaded " << Result.Latencies.GetCount() << " instruments out of " << iSettings.Instruments << std::endl;
+    }
+    return Result;
+}
+
+/* Resident memory of the process in kilobytes, 0 when it can not be read */
+long GetResidentKilobytes()
+{
+    long Pages = 0, Resident = 0;
+    std::ifstream Statm("/proc/self/statm");
+    if (!(Statm >> Pages >> Resident))
+    {
+        return 0;
+    }
+    return Resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/*
+    Configure an engine on the instrument database : a single sample for the whole startup,
+    the resident memory it added is printed aside
+*/
+ScenarioResult RunEngineStartup(const std::string & iName, boost::property_tree::ptree iConfig, const BenchmarkSettings & iSettings, unsigned iThreads,
+                                const std::string & iImagePath = "")
+{
+    ScenarioResult Result;
+    Result.Scenario = iName;
+
+    iConfig.put("Engine.instrument_db_path", iSettings.InstrumentDBPath);
+    iConfig.put("Engine.instrument_load_threads", iThreads);
+    iConfig.put("Engine.instrument_image_path", iImagePath);
+
+    // Give the pages freed by the previous scenarios back to the system first
+    malloc_trim(0);
+    const auto Resident = GetResidentKilobytes();
+    auto pEngine = std::make_unique<engine_type>();
+
+    ScopedAllocationCounter Allocations;
+    const auto Start = ClockType::now();
+
+    if (!pEngine->Configure(iConfig))
+    {
+        std::cerr << iName << " : failed to configure the engine on " << iSettings.InstrumentDBPath << std::endl;
+    }
+
+    const auto Elapsed = ClockType::now() - Start;
+    Result.Latencies.Record(static_cast<LatencyHistogram::value_type>(std::chrono::duration_cast<std::chrono::nanoseconds>(Elapsed).count()));
+    Result.ElapsedSeconds = std::chrono::duration<double>(Elapsed).count();
+    Result.Allocations    = Allocations.GetAllocations();
+    Result.DtlbMisses     = -1;
+    Result.CacheMisses    = -1;
+
+    std::cout << iName << " : threads[" << iThreads << "] seconds[" << Result.ElapsedSeconds << "] resident_kb["
+              << GetResidentKilobytes() - Resident << "] heap_bytes[" << Allocations.GetCounters().Bytes << "]" << std::endl;
+    return Result;
+}
+
+std::vector<ScenarioResult> RunInstrumentLoad(const boost::property_tree::ptree & iConfig, const BenchmarkSettings & iSettings)
+{
+    using text_storage_type   = NoSqlStorage<Instrument<Order>, LevelDBStorage, TextArchiveSerializer<Instrument<Order> > >;
+    using binary_storage_type = InstrumentManager<Order>;
+
+    std::vector<ScenarioResult> Results;
+
+    boost::filesystem::remove_all(iSettings.InstrumentDBPath);
+    {
+        text_storage_type Writer(iSettings.InstrumentDBPath);
+        auto key_extractor = [](const Instrument<Order> & iInstrument) -> const std::string & { return iInstrument.GetName(); };
+
+        std::vector<Instrument<Order> > Instruments;
+        Instruments.reserve(iSettings.Instruments);
+        for (int i = 1; i <= iSettings.Instruments; i++)
+        {
+            const auto Name = "INSTR" + std::to_string(i);
+            Instruments.push_back({ Name, "ISIN" + std::to_string(i), "EUR", i, Price(1000 + i % 1000) });
+            Instruments.back().SetPeaks(1000 + i, 500 + i);
+        }
+
+        if (!Writer.WriteBatch(Instruments.begin(), Instruments.end(), key_extractor))
+        {
+            std::cerr << "Failed to write the instrument database " << iSettings.InstrumentDBPath << std::endl;
+            return Results;
+        }
+    }
+
+    // Text archives, then the migration to the binary encoding, then the binary records
+    std::size_t Migrated = 0;
+    Results.push_back(LoadInstruments<text_storage_type>("instrument_load_text", iSettings, Migrated));
+    Results.push_back(LoadInstruments<binary_storage_type>("instrument_migrate", iSettings, Migrated));
+    std::cout << "instrument_migrate : migrated[" << Migrated << "]" << std::endl;
+    Results.push_back(LoadInstruments<binary_storage_type>("instrument_load_binary", iSettings, Migrated));
+
+    // Books of the whole database, decoded by one thread then by every hardware thread
+    Results.push_back(RunEngineStartup("engine_startup_1_thread", iConfig, iSettings, 1));
+    Results.push_back(RunEngineStartup("engine_startup", iConfig, iSettings, std::max(1u, std::thread::hardware_concurrency())));
+
+    // The first startup exports the instrument image, the second one maps it
+    const auto ImagePath = iSettings.InstrumentDBPath + ".image";
+    std::remove(ImagePath.c_str());
+    Results.push_back(RunEngineStartup("engine_startup_export", iConfig, iSettings, 1, ImagePath));
+    Results.push_back(RunEngineStartup("engine_startup_image", iConfig, iSettings, 1, ImagePath));
+    std::remove(ImagePath.c_str());
+
+    boost::filesystem::remove_all(iSettings.InstrumentDBPath);
+    return Results;
+}
+
+/*
+    Opening of uncross_instruments books holding uncross_orders crossed orders on each side :
+    a single sample for the switch to continuous trading, deals published included
+*/
+ScenarioResult RunOpeningUncross(const std::string & iName, boost::property_tree::ptree iConfig, const BenchmarkSettings & iSettings, unsigned iThreads)
+{
+    ScenarioResult Result;
+    Result.Scenario  = iName;
+    Result.BookDepth = iSettings.UncrossOrders;
+
+    iConfig.put("Engine.instrument_db_path", iSettings.InstrumentDBPath);
+    iConfig.put("Engine.instrument_image_path", "");
+    iConfig.put("Engine.uncross_threads", iThreads);
+
+    auto pEngine = std::make_unique<engine_type>();
+    if (!pEngine->Configure(iConfig) || !pEngine->SetGlobalPhase(TradingPhase::OPENING_AUCTION))
+    {
+        std::cerr << iName << " : failed to configure the engine on " << iSettings.InstrumentDBPath << std::endl;
+        return Result;
+    }
+
+    std::uint64_t Deals = 0;
+    pEngine->SetDealListener([&Deals](std::uint32_t, const Deal &) { ++Deals; });
+
+    // Same books for every thread count
+    std::mt19937 Generator(iSettings.Seed);
+    std::uniform_int_distribution<> Level(0, iSettings.PriceLevels - 1);
+    const auto HalfLevels = static_cast<std::uint32_t>(iSettings.PriceLevels / 2);
+
+    std::uint32_t OrderID = 0;
+    for (int ProductID = 1; ProductID <= iSettings.UncrossInstruments; ProductID++)
+    {
+        for (auto i = 0; i < iSettings.UncrossOrders; i++)
+        {
+            const auto Shift = static_cast<std::uint32_t>(Level(Generator));
+            pEngine->Insert(CREATE_ORDER(OrderWay::BUY, 100_qty, Price(BenchmarkBook::ReferencePrice + HalfLevels - Shift), ClientOrderID(++OrderID), 5_clientid), ProductID);
+            pEngine->Insert(CREATE_ORDER(OrderWay::SELL, 100_qty, Price(BenchmarkBook::ReferencePrice - HalfLevels + Shift), ClientOrderID(++OrderID), 6_clientid), ProductID);
+        }
+    }
+
+    ScopedAllocationCounter Allocations;
+    const auto Start = ClockType::now();
+
+    pEngine->SetGlobalPhase(TradingPhase::CONTINUOUS_TRADING);
+
+    const auto Elapsed = ClockType::now() - Start;
+    Result.Latencies.Record(static_cast<LatencyHistogram::value_type>(std::chrono::duration_cast<std::chrono::nanoseconds>(Elapsed).count()));
+    Result.ElapsedSeconds = std::chrono::duration<double>(Elapsed).count();
+    Result.Allocations    = Allocations.GetAllocations();
+    Result.DtlbMisses     = -1;
+    Result.CacheMisses    = -1;
+
+    std::cout << iName << " : threads[" << iThreads << "] books[" << iSettings.UncrossInstruments << "] deals[" << Deals << "] seconds["
+              << Result.ElapsedSeconds << "]" << std::endl;
+    return Result;
+}
+
+std::vector<ScenarioResult> RunOpeningUncrosses(const boost::property_tree::ptree & iConfig, const BenchmarkSettings & iSettings)
+{
+    std::vector<ScenarioResult> Results;
+
+    boost::filesystem::remove_all(iSettings.InstrumentDBPath);
+    {
+        InstrumentManager<Order> Writer(iSettings.InstrumentDBPath);
+        auto key_extractor = [](const Instrument<Order> & iInstrument) -> const std::string & { return iInstrument.GetName(); };
+
+        std::vector<Instrument<Order> > Instruments;
+        Instruments.reserve(iSettings.UncrossInstruments);
+        for (int i = 1; i <= iSettings.UncrossInstruments; i++)
+        {
+            Instruments.push_back({ "INSTR" + std::to_string(i), "ISIN" + std::to_string(i), "EUR", i, Price(BenchmarkBook::ReferencePrice) });
+        }
+
+        if (!Writer.WriteBatch(Instruments.begin(), Instruments.end(), key_extractor))
+        {
+            std::cerr << "Failed to write the instrument database " << iSettings.InstrumentDBPath << std::endl;
+            return Results;
+        }
+    }
+
+    // Uncross on the engine thread, then on the configured pool ( every hardware thread by default )
+    Results.push_back(RunOpeningUncross("opening_uncross_1_thread", iConfig, iSettings, 1));
+    Results.push_back(RunOpeningUncross("opening_uncross", iConfig, iSettings,
+                                        iConfig.get<unsigned>("Engine.uncross_threads", std::max(1u, std::thread::hardware_concurrency()))));
+
+    boost::filesystem::remove_all(iSettings.InstrumentDBPath);
+    return Results;
+}
+
+void WritePerfCount(std::ostream & oss, long long iCount)
+{
+    if (iCount < 0)
+    {
+        oss << "null";
     }
     else
     {
-        std::cerr << "No such file or directory : config.ini" << std::endl;
-        return 2;
+        oss << iCount;
     }
+}
+
+void WriteJson(std::ostream & oss, const BenchmarkSettings & iSettings, const std::vector<ScenarioResult> & iResults)
+{
+    oss << "{" << std::endl;
+    oss << "  \"settings\": {" << std::endl;
+    oss << "    \"cpu_core\": " << iSettings.CpuCore << "," << std::endl;
+    oss << "    \"price_distribution\": \"" << iSettings.PriceDistribution << "\"," << std::endl;
+    oss << "    \"price_levels\": " << iSettings.PriceLevels << "," << std::endl;
+    oss << "    \"iterations\": " << iSettings.Iterations << "," << std::endl;
+    oss << "    \"sweep_orders\": " << iSettings.SweepOrders << "," << std::endl;
+    oss << "    \"auction_runs\": " << iSettings.AuctionRuns << "," << std::endl;
+    oss << "    \"pool_elements\": " << iSettings.PoolElements << "," << std::endl;
+    oss << "    \"instruments\": " << iSettings.Instruments << "," << std::endl;
+    oss << "    \"seed\": " << iSettings.Seed << std::endl;
+    oss << "  }," << std::endl;
+    oss << "  \"results\": [" << std::endl;
+
+    for (size_t i = 0; i < iResults.size(); i++)
+    {
+        const auto & Result     = iResults[i];
+        const auto & Latencies  = Result.Latencies;
+        const auto   Throughput = Result.ElapsedSeconds > 0.0 ? Latencies.GetCount() / Result.ElapsedSeconds : 0.0;
+
+        oss << "    {"
+            << "\"scenario\": \"" << Result.Scenario << "\", "
+            << "\"book_depth\": " << Result.BookDepth << ", "
+            << "\"count\": " << Latencies.GetCount() << ", "
+            << "\"throughput_ops\": " << std::fixed << std::setprecision(1) << Throughput << ", "
+            << "\"mean_ns\": " << Latencies.GetMean() << ", "
+            << "\"min_ns\": " << Latencies.GetMin() << ", "
+            << "\"p50_ns\": " << Latencies.GetValueAtPercentile(50.0) << ", "
+            << "\"p99_ns\": " << Latencies.GetValueAtPercentile(99.0) << ", "
+            << "\"p999_ns\": " << Latencies.GetValueAtPercentile(99.9) << ", "
+            << "\"max_ns\": " << Latencies.GetMax() << ", "
+            << "\"allocs_per_op\": " << std::setprecision(3) << GetAllocationsPerOperation(Result) << ", "
+            << "\"cache_misses\": ";
+
+        WritePerfCount(oss, Result.CacheMisses);
+        oss << ", \"dtlb_misses\": ";
+        WritePerfCount(oss, Result.DtlbMisses);
+        oss << "}" << (i + 1 < iResults.size() ? "," : "") << std::endl;
+    }
+
+    oss << "  ]" << std::endl;
+    oss << "}" << std::endl;
+}
+
+void PrintSummary(std::ostream & oss, const std::vector<ScenarioResult> & iResults)
+{
+    oss << std::left << std::setw(20) << "scenario" << std::right << std::setw(8) << "depth" << std::setw(10) << "count"
+        << std::setw(14) << "ops/s" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+        << std::setw(12) << "max" << std::setw(11) << "allocs/op" << std::setw(10) << "dTLB/op" << std::endl;
+
+    for (const auto & Result : iResults)
+    {
+        const auto & Latencies  = Result.Latencies;
+        const auto   Throughput = Result.ElapsedSeconds > 0.0 ? Latencies.GetCount() / Result.ElapsedSeconds : 0.0;
 
-    pOrderBook->SetTradingPhase(TradingPhase::CONTINUOUS_TRADING);
+        oss << std::left << std::setw(20) << Result.Scenario << std::right << std::setw(8) << Result.BookDepth
+            << std::setw(10) << Latencies.GetCount() << std::setw(14) << std::fixed << std::setprecision(0) << Throughput
+            << std::setw(10) << Latencies.GetValueAtPercentile(50.0) << std::setw(10) << Latencies.GetValueAtPercentile(99.0)
+            << std::setw(10) << Latencies.GetValueAtPercentile(99.9) << std::setw(12) << Latencies.GetMax()
+            << std::setw(11) << std::setprecision(2) << GetAllocationsPerOperation(Result) << std::setw(10);
 
-    std::forward_list< std::unique_ptr<Order> > m_Orders;
+        if (Result.DtlbMisses < 0 || Latencies.GetCount() == 0)
+        {
+            oss << "n/a";
+        }
+        else
+        {
+            oss << static_cast<double>(Result.DtlbMisses) / Latencies.GetCount();
+        }
+        oss << std::endl;
+    }
+    oss << "latencies in nanoseconds, heap allocations and data TLB read misses counted on the benchmark thread" << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    const std::string ConfigFile = argc > 1 ? argv[1] : "benchmark.ini";
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(1, 100);
+    boost::property_tree::ptree Config;
 
-    for (auto i = 0; i < nb_order_to_insert; i++)
+    if (boost::filesystem::exists(ConfigFile))
     {
-        m_Orders.push_front(CREATE_ORDER(OrderWay::BUY, Quantity(dis(gen)), Price(dis(gen)), ClientOrderID(i + 1), 5_clientid));
-        m_Orders.push_front(CREATE_ORDER(OrderWay::SELL, Quantity(dis(gen)), Price(dis(gen)), ClientOrderID(i + 1), 6_clientid));
+        boost::property_tree::ini_parser::read_ini(ConfigFile, Config);
+    }
+    else
+    {
+        std::cerr << "Usage : " << argv[0] << " [benchmark.ini]" << std::endl;
+        std::cerr << "No such file or directory : " << ConfigFile << std::endl;
+        return 1;
     }
 
-    std::string s;
+    BenchmarkSettings Settings;
+    if (!LoadSettings(Config, Settings))
+    {
+        return 2;
+    }
 
-    pOrderBook->RehashOrderIndexes(nb_order_to_insert);
-    pOrderBook->RehashDealIndexes(2*nb_order_to_insert);
+    auto pEngine = std::make_unique<engine_type>();
+    if (!pEngine->Configure(Config))
+    {
+        std::cerr << "Failed to configure the matching engine from " << ConfigFile << std::endl;
+        return 3;
+    }
 
-    std::cout << "Enable callgrind" << std::endl;
-    std::cin >> s;
+    PinToCore(Settings.CpuCore);
 
-    std::chrono::time_point<std::chrono::high_resolution_clock > start, end;
-    start = std::chrono::high_resolution_clock::now();
+    std::mt19937                 Generator(Settings.Seed);
+    std::vector<ScenarioResult>  Results;
 
-    for (auto & pOrder : m_Orders)
+    for (auto Depth : Settings.BookDepths)
     {
-        INSERT_ORDER(pOrderBook, pOrder);
+        auto DepthResults = RunBookDepth(*pEngine, Settings, Generator, Depth);
+        std::move(DepthResults.begin(), DepthResults.end(), std::back_inserter(Results));
     }
 
-    end = std::chrono::high_resolution_clock::now();
+    auto PoolResults = RunPoolBackings(Settings, Generator);
+    std::move(PoolResults.begin(), PoolResults.end(), std::back_inserter(Results));
+
+    auto AllocationResults = RunOrderAllocations(Settings);
+    std::move(AllocationResults.begin(), AllocationResults.end(), std::back_inserter(Results));
 
-    std::chrono::duration<double> elapsed_seconds = end - start;
-    std::time_t end_time = std::chrono::high_resolution_clock::to_time_t(end);
+    auto JournalResults = RunJournal(*pEngine, Settings, Generator);
+    std::move(JournalResults.begin(), JournalResults.end(), std::back_inserter(Results));
 
-    std::cout << "finished computation at " << std::ctime(&end_time)
-    << "elapsed time: " << elapsed_seconds.count() << "s" << std::endl;
-    std::cout << "number of generated deals : " << pOrderBook->GetDealCounter() << std::endl;
+    auto InstrumentResults = RunInstrumentLoad(Config, Settings);
+    std::move(InstrumentResults.begin(), InstrumentResults.end(), std::back_inserter(Results));
 
-    std::cout << "Disable callgrind" << std::endl;
-    std::cin >> s;
+    auto UncrossResults = RunOpeningUncrosses(Config, Settings);
+    std::move(UncrossResults.begin(), UncrossResults.end(), std::back_inserter(Results));
+
+    PrintSummary(std::cout, Results);
+
+    std::ofstream Output(Settings.OutputFile);
+    if (!Output)
+    {
+        std::cerr << "Failed to open " << Settings.OutputFile << std::endl;
+        return 4;
+    }
+    WriteJson(Output, Settings, Results);
 
+    std::cout << "results written to " << Settings.OutputFile << std::endl;
     return 0;
 }
@@ -13,7 +13,7 @@ namespace exchange
     {
 
         Deal::Deal(price_type iPrice, qty_type iQty, client_id_type iBuyerClientID, client_orderid_type iBuyerOrderID, client_id_type iSellerClientID, client_orderid_type iSellerOrderID)
-            : m_Reference{0}, m_Price(iPrice), m_Qty(iQty), m_BuyerClientID(iBuyerClientID),
+            : m_Reference{}, m_Price(iPrice), m_Qty(iQty), m_BuyerClientID(iBuyerClientID),
             m_BuyerOrderID(iBuyerOrderID), m_SellerClientID(iSellerClientID), m_SellerOrderID(iSellerOrderID)
         {
             m_Timestamp = std::chrono::system_clock::now();
@@ -35,7 +35,7 @@ namespace exchange
             o << "Deal : Price[" << x.GetPrice() << "] ; Qty[" << x.GetQuantity() << "] ;"
                 << " BuyerClientID[" << x.GetBuyerClientID() << "] ; BuyerOrderID[" << x.GetBuyerOrderID()
                 << "] ; SellerClientID[" << x.GetSellerClientID() << "] ; SellerOrderID[" << x.GetSellerOrderID() << "] ;"
-                << " Reference[" << x.GetReference().data() << "]";
+                << " Reference[" << x.GetReference() << "]";
             return o;
         }
 
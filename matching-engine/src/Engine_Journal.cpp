@@ -0,0 +1,323 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <Engine_Journal.h>
+
+#include <logger/Logger.h>
+
+#include <boost/crc.hpp>
+
+#include <chrono>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace exchange
+{
+    namespace engine
+    {
+        namespace
+        {
+            /* Journal file header : magic, format version and record size */
+            const char          JournalMagic[8] = { 'E', 'X', 'J', 'O', 'U', 'R', 'N', '\0' };
+            const std::uint32_t JournalVersion  = 1;
+            const std::uint64_t HeaderSize      = sizeof(JournalMagic) + 2 * sizeof(std::uint32_t);
+
+            /* Idle writer thread poll period */
+            const std::chrono::microseconds WriterIdlePeriod(50);
+
+            bool WriteAll(int iFd, const char * iData, std::size_t iSize)
+            {
+                while (iSize > 0)
+                {
+                    const auto Written = ::write(iFd, iData, iSize);
+                    if (Written < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        return false;
+                    }
+                    iData += Written;
+                    iSize -= static_cast<std::size_t>(Written);
+                }
+                return true;
+            }
+
+            bool WriteHeader(int iFd)
+            {
+                char Header[HeaderSize];
+                const std::uint32_t RecordSize = sizeof(JournalRecord);
+
+                std::memcpy(Header, JournalMagic, sizeof(JournalMagic));
+                std::memcpy(Header + sizeof(JournalMagic), &JournalVersion, sizeof(JournalVersion));
+                std::memcpy(Header + sizeof(JournalMagic) + sizeof(JournalVersion), &RecordSize, sizeof(RecordSize));
+
+                return WriteAll(iFd, Header, sizeof(Header)) && ::fdatasync(iFd) == 0;
+            }
+        }
+
+        std::uint32_t ComputeJournalCrc(const JournalRecord & iRecord)
+        {
+            boost::crc_32_type Crc;
+            Crc.process_bytes(&iRecord, offsetof(JournalRecord, Crc));
+            return Crc.checksum();
+        }
+
+        JournalWriter::JournalWriter(const std::string & iFileName, std::uint64_t iNextSequence, std::uint64_t iValidSize)
+            :m_pRing(std::make_unique<ring_type>()), m_NextSequence(iNextSequence), m_DurableSequence(iNextSequence - 1)
+        {
+            if (iValidSize == 0)
+            {
+                m_Fd = ::open(iFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (m_Fd != -1 && !WriteHeader(m_Fd))
+                {
+                    EXERR("JournalWriter::JournalWriter : Unable to write the header of [" << iFileName << "] : " << std::strerror(errno));
+                    ::close(m_Fd);
+                    m_Fd = -1;
+                }
+            }
+            else
+            {
+                m_Fd = ::open(iFileName.c_str(), O_WRONLY);
+                if (m_Fd != -1 && (::ftruncate(m_Fd, static_cast<off_t>(iValidSize)) != 0 || ::lseek(m_Fd, 0, SEEK_END) < 0))
+                {
+                    EXERR("JournalWriter::JournalWriter : Unable to truncate [" << iFileName << "] : " << std::strerror(errno));
+                    ::close(m_Fd);
+                    m_Fd = -1;
+                }
+            }
+
+            if (m_Fd == -1)
+            {
+                EXERR("JournalWriter::JournalWriter : Unable to open [" << iFileName << "]");
+                return;
+            }
+
+            m_Writer = std::thread(&JournalWriter::Run, this);
+        }
+
+        JournalWriter::~JournalWriter()
+        {
+            if (m_Writer.joinable())
+            {
+                m_Stop.store(true, std::memory_order_release);
+                m_Writer.join();
+            }
+
+            if (m_Fd != -1)
+            {
+                ::close(m_Fd);
+            }
+        }
+
+        std::uint64_t JournalWriter::Append(const OrderFlowRecord & iRecord)
+        {
+            JournalRecord Record;
+            Record.Sequence = m_NextSequence;
+            Record.Command  = iRecord;
+
+            if (!m_pRing->TryPush(Record))
+            {
+                ++m_Stalls;
+                do
+                {
+                    std::this_thread::yield();
+                } while (!m_pRing->TryPush(Record));
+            }
+
+            return m_NextSequence++;
+        }
+
+        void JournalWriter::Sync()
+        {
+            if (!IsOpen())
+            {
+                return;
+            }
+
+            WaitDurable(GetLastSequence());
+        }
+
+        bool JournalWriter::WaitDurable(std::uint64_t iSequence)
+        {
+            if (!IsOpen())
+            {
+                return false;
+            }
+
+            std::unique_lock<std::mutex> Lock(m_DurableMutex);
+            m_DurableCondition.wait(Lock, [this, iSequence]()
+            {
+                return m_DurableSequence.load(std::memory_order_acquire) >= iSequence || m_Failed.load(std::memory_order_acquire);
+            });
+            return m_DurableSequence.load(std::memory_order_acquire) >= iSequence;
+        }
+
+        void JournalWriter::Run()
+        {
+            std::vector<JournalRecord> Group(MaxGroupSize);
+            bool bStopping = false;
+
+            while (true)
+            {
+                std::size_t Count = 0;
+                while (Count < MaxGroupSize && m_pRing->TryPop(Group[Count]))
+                {
+                    Group[Count].Crc = ComputeJournalCrc(Group[Count]);
+                    ++Count;
+                }
+
+                if (Count == 0)
+                {
+                    // The ring is drained once more after the stop request : appends done before it are visible
+                    if (bStopping)
+                    {
+                        break;
+                    }
+                    bStopping = m_Stop.load(std::memory_order_acquire);
+                    if (!bStopping)
+                    {
+                        std::this_thread::sleep_for(WriterIdlePeriod);
+                    }
+                    continue;
+                }
+
+                if (m_Failed.load(std::memory_order_relaxed))
+                {
+                    continue;
+                }
+
+                if (!WriteAll(m_Fd, reinterpret_cast<const char*>(Group.data()), Count * sizeof(JournalRecord)) || ::fdatasync(m_Fd) != 0)
+                {
+                    EXPANIC("JournalWriter::Run : Journal write failed, the following commands are not persisted : " << std::strerror(errno));
+                    m_Failed.store(true, std::memory_order_release);
+                }
+                else
+                {
+                    m_GroupCommits.fetch_add(1, std::memory_order_relaxed);
+                    std::lock_guard<std::mutex> Lock(m_DurableMutex);
+                    m_DurableSequence.store(Group[Count - 1].Sequence, std::memory_order_release);
+                }
+                m_DurableCondition.notify_all();
+            }
+        }
+
+        JournalReader::JournalReader(const std::string & iFileName)
+            :m_Stream(iFileName, std::ios::binary)
+        {
+            if (!m_Stream)
+            {
+                return;
+            }
+
+            char          Magic[sizeof(JournalMagic)];
+            std::uint32_t Version    = 0;
+            std::uint32_t RecordSize = 0;
+
+            m_Stream.read(Magic, sizeof(Magic));
+            if (m_Stream.gcount() == 0)
+            {
+                // Crash before the header was written
+                m_Valid = true;
+                m_End   = true;
+                return;
+            }
+            m_Stream.read(reinterpret_cast<char*>(&Version), sizeof(Version));
+            m_Stream.read(reinterpret_cast<char*>(&RecordSize), sizeof(RecordSize));
+
+            m_Valid = m_Stream && std::memcmp(Magic, JournalMagic, sizeof(Magic)) == 0 &&
+                      Version == JournalVersion && RecordSize == sizeof(JournalRecord);
+
+            if (m_Valid)
+            {
+                m_ValidSize = HeaderSize;
+                m_Buffer.resize(BufferRecords);
+            }
+        }
+
+        bool JournalReader::Next(OrderFlowRecord & oRecord)
+        {
+            if (!m_Valid || m_End)
+            {
+                return false;
+            }
+
+            if (m_Position == m_Count && !Fill())
+            {
+                m_End = true;
+                return false;
+            }
+
+            const auto & Record = m_Buffer[m_Position];
+            if (Record.Sequence != m_LastSequence + 1 || Record.Crc != ComputeJournalCrc(Record))
+            {
+                m_CorruptedTail = true;
+                m_End           = true;
+                return false;
+            }
+
+            ++m_Position;
+            m_LastSequence = Record.Sequence;
+            m_ValidSize   += sizeof(JournalRecord);
+            oRecord        = Record.Command;
+            return true;
+        }
+
+        bool JournalReader::SkipTo(std::uint64_t iSequence)
+        {
+            if (iSequence == 0)
+            {
+                return true;
+            }
+
+            if (!m_Valid || m_LastSequence != 0)
+            {
+                return false;
+            }
+
+            // Records are fixed size and gap free, the one holding iSequence must be intact
+            const auto Offset = HeaderSize + (iSequence - 1) * sizeof(JournalRecord);
+
+            JournalRecord Record;
+            m_Stream.clear();
+            m_Stream.seekg(static_cast<std::streamoff>(Offset));
+            m_Stream.read(reinterpret_cast<char*>(&Record), sizeof(Record));
+
+            if (!m_Stream || Record.Sequence != iSequence || Record.Crc != ComputeJournalCrc(Record))
+            {
+                return false;
+            }
+
+            m_LastSequence = iSequence;
+            m_ValidSize    = Offset + sizeof(JournalRecord);
+            m_Position     = 0;
+            m_Count        = 0;
+            m_End          = false;
+            return true;
+        }
+
+        bool JournalReader::Fill()
+        {
+            m_Stream.read(reinterpret_cast<char*>(m_Buffer.data()), static_cast<std::streamsize>(m_Buffer.size() * sizeof(JournalRecord)));
+
+            const auto Bytes = static_cast<std::size_t>(m_Stream.gcount());
+            m_Position = 0;
+            m_Count    = Bytes / sizeof(JournalRecord);
+
+            // Record partially written when the process died
+            if (Bytes % sizeof(JournalRecord) != 0)
+            {
+                m_CorruptedTail = true;
+            }
+            return m_Count > 0;
+        }
+
+    }
+}
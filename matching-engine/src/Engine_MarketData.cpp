@@ -0,0 +1,448 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <Engine_MarketData.h>
+
+#include <logger/Logger.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace exchange
+{
+    namespace engine
+    {
+        namespace
+        {
+            /* Idle publisher thread poll period */
+            const std::chrono::microseconds PublisherIdlePeriod(100);
+
+            /* Events applied between two looks at the clock */
+            const std::size_t MaxEventsPerPass = 4096;
+
+            const std::size_t MaxUpdatesPerMessage = std::numeric_limits<decltype(MarketDataHeader::Updates)>::max();
+
+            void AppendMessage(std::string & oBuffer, std::uint64_t iSequence, std::uint32_t iProductID, std::uint8_t iFlags,
+                               const MarketDataUpdate * iUpdates, std::size_t iCount)
+            {
+                MarketDataHeader Header;
+                Header.Sequence  = iSequence;
+                Header.ProductID = iProductID;
+                Header.Updates   = static_cast<std::uint16_t>(iCount);
+                Header.Flags     = iFlags;
+
+                oBuffer.append(reinterpret_cast<const char*>(&Header), sizeof(Header));
+                oBuffer.append(reinterpret_cast<const char*>(iUpdates), iCount * sizeof(MarketDataUpdate));
+            }
+
+            MarketDataUpdate MakeUpdate(MarketDataAction iAction, std::uint8_t iWay, std::uint32_t iPrice, std::uint32_t iOrders, std::uint64_t iQuantity)
+            {
+                MarketDataUpdate Update;
+                Update.Action   = iAction;
+                Update.Way      = iWay;
+                Update.Price    = iPrice;
+                Update.Orders   = iOrders;
+                Update.Quantity = iQuantity;
+                return Update;
+            }
+        }
+
+        MarketDataPublisher::MarketDataPublisher(std::uint16_t iPort, std::chrono::milliseconds iInterval)
+            :m_Interval(iInterval), m_pRing(std::make_unique<ring_type>())
+        {
+            m_ListenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (m_ListenFd == -1)
+            {
+                EXERR("MarketDataPublisher::MarketDataPublisher : Unable to create the socket : " << std::strerror(errno));
+                return;
+            }
+
+            const int Enable = 1;
+            ::setsockopt(m_ListenFd, SOL_SOCKET, SO_REUSEADDR, &Enable, sizeof(Enable));
+
+            sockaddr_in Address;
+            std::memset(&Address, 0, sizeof(Address));
+            Address.sin_family      = AF_INET;
+            Address.sin_port        = htons(iPort);
+            Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            socklen_t AddressSize = sizeof(Address);
+            if (::bind(m_ListenFd, reinterpret_cast<sockaddr*>(&Address), sizeof(Address)) != 0 || ::listen(m_ListenFd, SOMAXCONN) != 0 ||
+                ::getsockname(m_ListenFd, reinterpret_cast<sockaddr*>(&Address), &AddressSize) != 0)
+            {
+                EXERR("MarketDataPublisher::MarketDataPublisher : Unable to listen on port [" << iPort << "] : " << std::strerror(errno));
+                ::close(m_ListenFd);
+                m_ListenFd = -1;
+                return;
+            }
+            m_Port = ntohs(Address.sin_port);
+
+            EXINFO("MarketDataPublisher::MarketDataPublisher : Listening on port [" << m_Port << "] ; Interval[" << m_Interval.count() << "ms]");
+
+            m_Thread = std::thread(&MarketDataPublisher::Run, this);
+        }
+
+        MarketDataPublisher::~MarketDataPublisher()
+        {
+            if (m_Thread.joinable())
+            {
+                m_Stop.store(true, std::memory_order_release);
+                m_Thread.join();
+
+                // The publisher thread only counts, its activity is reported by the owner
+                EXINFO("MarketDataPublisher::~MarketDataPublisher : Sequence[" << m_Sequence << "] ; Subscribers[" << m_Subscribers.size() <<
+                       "] ; SlowSubscribers[" << m_SlowSubscribers.load() << "] ; AcceptErrors[" << m_AcceptErrors.load() << "] ; Stalls[" << m_Stalls << "]");
+            }
+
+            for (auto && rSubscriber : m_Subscribers)
+            {
+                ::close(rSubscriber.Fd);
+            }
+
+            if (m_ListenFd != -1)
+            {
+                ::close(m_ListenFd);
+            }
+        }
+
+        void MarketDataPublisher::Push(const MarketDataEvent & iEvent)
+        {
+            if (!m_pRing->TryPush(iEvent))
+            {
+                ++m_Stalls;
+                do
+                {
+                    std::this_thread::yield();
+                } while (!m_pRing->TryPush(iEvent));
+            }
+        }
+
+        void MarketDataPublisher::Run()
+        {
+            auto NextPublication = std::chrono::steady_clock::now() + m_Interval;
+            bool bStopping = false;
+
+            while (true)
+            {
+                MarketDataEvent Event;
+                std::size_t Count = 0;
+                while (Count < MaxEventsPerPass && m_pRing->TryPop(Event))
+                {
+                    Apply(Event);
+                    ++Count;
+                }
+
+                // The events pushed before the stop request are published once more
+                const auto Now = std::chrono::steady_clock::now();
+                if (Now >= NextPublication || (bStopping && Count == 0))
+                {
+                    Publish();
+                    AcceptSubscribers();
+                    NextPublication = Now + m_Interval;
+                }
+
+                if (Count == 0)
+                {
+                    if (bStopping)
+                    {
+                        break;
+                    }
+                    bStopping = m_Stop.load(std::memory_order_acquire);
+                    if (!bStopping)
+                    {
+                        std::this_thread::sleep_for(PublisherIdlePeriod);
+                    }
+                }
+            }
+        }
+
+        void MarketDataPublisher::Apply(const MarketDataEvent & iEvent)
+        {
+            auto & rBook = m_Books[iEvent.ProductID];
+            if (!rBook.Dirty)
+            {
+                rBook.Dirty = true;
+                m_DirtyBooks.push_back(iEvent.ProductID);
+            }
+
+            switch (iEvent.Type)
+            {
+                case MarketDataEventType::LEVEL:
+                    ApplyLevel(rBook, iEvent.Way, iEvent.Price, iEvent.Quantity, iEvent.Orders);
+                    break;
+                case MarketDataEventType::TRADE:
+                    rBook.Trades.push_back(MakeUpdate(MarketDataAction::TRADE, 0, iEvent.Price, 0, static_cast<std::uint64_t>(iEvent.Quantity)));
+                    break;
+                case MarketDataEventType::PHASE:
+                    rBook.Phase        = iEvent.Phase;
+                    rBook.PhaseChanged = true;
+                    break;
+                case MarketDataEventType::CLEAR:
+                    for (std::uint8_t Way = 0; Way < 2; ++Way)
+                    {
+                        for (auto && rLevel : rBook.Levels[Way])
+                        {
+                            rBook.Changes.emplace(MakeChangeKey(Way, rLevel.first), rLevel.second);
+                        }
+                        rBook.Levels[Way].clear();
+                    }
+                    break;
+                default:
+                    assert(false);
+                    break;
+            }
+        }
+
+        void MarketDataPublisher::ApplyLevel(Book & ioBook, std::uint8_t iWay, std::uint32_t iPrice, std::int64_t iQuantity, std::int32_t iOrders)
+        {
+            assert(iWay < 2);
+
+            auto & rLevels = ioBook.Levels[iWay];
+            auto It = rLevels.find(iPrice);
+
+            // Only the first change of an interval records the published state
+            ioBook.Changes.emplace(MakeChangeKey(iWay, iPrice), It != rLevels.end() ? It->second : Level());
+
+            if (It == rLevels.end())
+            {
+                It = rLevels.emplace(iPrice, Level()).first;
+            }
+
+            It->second.Quantity = static_cast<std::uint64_t>(static_cast<std::int64_t>(It->second.Quantity) + iQuantity);
+            It->second.Orders   = static_cast<std::uint32_t>(static_cast<std::int32_t>(It->second.Orders) + iOrders);
+
+            if (It->second.Orders == 0)
+            {
+                rLevels.erase(It);
+            }
+        }
+
+        void MarketDataPublisher::Publish()
+        {
+            m_Buffer.clear();
+            std::sort(m_DirtyBooks.begin(), m_DirtyBooks.end());
+
+            for (auto ProductID : m_DirtyBooks)
+            {
+                auto & rBook = m_Books[ProductID];
+                m_Updates.clear();
+
+                if (rBook.PhaseChanged)
+                {
+                    auto Update  = MakeUpdate(MarketDataAction::PHASE, 0, 0, 0, 0);
+                    Update.Phase = rBook.Phase;
+                    m_Updates.push_back(Update);
+                }
+
+                // A level changed many times in the interval is sent once, with its last state
+                for (auto && rChange : rBook.Changes)
+                {
+                    const auto   Way      = static_cast<std::uint8_t>(rChange.first >> 32);
+                    const auto   Price    = static_cast<std::uint32_t>(rChange.first);
+                    const auto & Previous = rChange.second;
+                    const auto   It       = rBook.Levels[Way].find(Price);
+
+                    if (It == rBook.Levels[Way].end())
+                    {
+                        if (Previous.Orders != 0)
+                        {
+                            m_Updates.push_back(MakeUpdate(MarketDataAction::DELETE, Way, Price, 0, 0));
+                        }
+                    }
+                    else if (Previous.Orders == 0)
+                    {
+                        m_Updates.push_back(MakeUpdate(MarketDataAction::ADD, Way, Price, It->second.Orders, It->second.Quantity));
+                    }
+                    else if (Previous.Orders != It->second.Orders || Previous.Quantity != It->second.Quantity)
+                    {
+                        m_Updates.push_back(MakeUpdate(MarketDataAction::UPDATE, Way, Price, It->second.Orders, It->second.Quantity));
+                    }
+                }
+
+                m_Updates.insert(m_Updates.end(), rBook.Trades.begin(), rBook.Trades.end());
+
+                rBook.Changes.clear();
+                rBook.Trades.clear();
+                rBook.PhaseChanged = false;
+                rBook.Dirty        = false;
+
+                for (std::size_t First = 0; First < m_Updates.size(); First += MaxUpdatesPerMessage)
+                {
+                    AppendMessage(m_Buffer, ++m_Sequence, ProductID, 0, m_Updates.data() + First, (std::min)(MaxUpdatesPerMessage, m_Updates.size() - First));
+                }
+            }
+            m_DirtyBooks.clear();
+
+            // Serialized once, written to every subscriber
+            for (auto It = m_Subscribers.begin(); It != m_Subscribers.end();)
+            {
+                if (!Flush(*It) || (!m_Buffer.empty() && !Send(*It, m_Buffer.data(), m_Buffer.size())))
+                {
+                    ::close(It->Fd);
+                    It = m_Subscribers.erase(It);
+                    m_SubscriberCount.store(m_Subscribers.size(), std::memory_order_relaxed);
+                }
+                else
+                {
+                    ++It;
+                }
+            }
+
+            m_PublishedSequence.store(m_Sequence, std::memory_order_release);
+        }
+
+        void MarketDataPublisher::AcceptSubscribers()
+        {
+            std::string Snapshot;
+
+            while (true)
+            {
+                const int Fd = ::accept4(m_ListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (Fd == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    {
+                        m_AcceptErrors.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    break;
+                }
+
+                const int Enable = 1;
+                ::setsockopt(Fd, IPPROTO_TCP, TCP_NODELAY, &Enable, sizeof(Enable));
+
+                // Taken right after a publication : the levels are the state at the last sequence
+                if (Snapshot.empty())
+                {
+                    EncodeSnapshot(Snapshot);
+                }
+
+                Subscriber NewSubscriber;
+                NewSubscriber.Fd         = Fd;
+                NewSubscriber.MaxBacklog = MaxBacklog + Snapshot.size();
+
+                if (!Send(NewSubscriber, Snapshot.data(), Snapshot.size()))
+                {
+                    ::close(Fd);
+                    continue;
+                }
+
+                m_Subscribers.push_back(std::move(NewSubscriber));
+                m_SubscriberCount.store(m_Subscribers.size(), std::memory_order_relaxed);
+            }
+        }
+
+        void MarketDataPublisher::EncodeSnapshot(std::string & oBuffer) const
+        {
+            std::vector<std::uint32_t> ProductIDs;
+            ProductIDs.reserve(m_Books.size());
+            for (auto && rBook : m_Books)
+            {
+                ProductIDs.push_back(rBook.first);
+            }
+            std::sort(ProductIDs.begin(), ProductIDs.end());
+
+            std::vector<MarketDataUpdate> Updates;
+            for (auto ProductID : ProductIDs)
+            {
+                const auto & rBook = m_Books.at(ProductID);
+                Updates.clear();
+
+                auto Update  = MakeUpdate(MarketDataAction::PHASE, 0, 0, 0, 0);
+                Update.Phase = rBook.Phase;
+                Updates.push_back(Update);
+
+                for (std::uint8_t Way = 0; Way < 2; ++Way)
+                {
+                    for (auto && rLevel : rBook.Levels[Way])
+                    {
+                        Updates.push_back(MakeUpdate(MarketDataAction::ADD, Way, rLevel.first, rLevel.second.Orders, rLevel.second.Quantity));
+                    }
+                }
+
+                for (std::size_t First = 0; First < Updates.size(); First += MaxUpdatesPerMessage)
+                {
+                    AppendMessage(oBuffer, m_Sequence, ProductID, MarketDataHeader::SnapshotFlag, Updates.data() + First,
+                                  (std::min)(MaxUpdatesPerMessage, Updates.size() - First));
+                }
+            }
+
+            // An empty snapshot message ends the snapshot
+            AppendMessage(oBuffer, m_Sequence, 0, MarketDataHeader::SnapshotFlag, nullptr, 0);
+        }
+
+        bool MarketDataPublisher::Send(Subscriber & ioSubscriber, const char * iData, std::size_t iSize)
+        {
+            // Written after the backlog to keep the order of the messages
+            if (ioSubscriber.Backlog.empty())
+            {
+                while (iSize > 0)
+                {
+                    const auto Written = ::send(ioSubscriber.Fd, iData, iSize, MSG_NOSIGNAL | MSG_DONTWAIT);
+                    if (Written < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        {
+                            break;
+                        }
+                        return false;
+                    }
+                    iData += Written;
+                    iSize -= static_cast<std::size_t>(Written);
+                }
+            }
+
+            ioSubscriber.Backlog.append(iData, iSize);
+            if (ioSubscriber.Backlog.size() > ioSubscriber.MaxBacklog)
+            {
+                m_SlowSubscribers.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        }
+
+        bool MarketDataPublisher::Flush(Subscriber & ioSubscriber)
+        {
+            std::size_t Sent = 0;
+            while (Sent < ioSubscriber.Backlog.size())
+            {
+                const auto Written = ::send(ioSubscriber.Fd, ioSubscriber.Backlog.data() + Sent, ioSubscriber.Backlog.size() - Sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (Written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        break;
+                    }
+                    return false;
+                }
+                Sent += static_cast<std::size_t>(Written);
+            }
+            ioSubscriber.Backlog.erase(0, Sent);
+            return true;
+        }
+
+    }
+}
@@ -0,0 +1,104 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <Engine_Metrics.h>
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+namespace exchange
+{
+    namespace engine
+    {
+        namespace
+        {
+            constexpr char MetricsMagic[8] = { 'E', 'X', 'M', 'E', 'T', 'R', 'I', 'C' };
+
+            size_t GetSegmentSize(std::uint32_t iOrderBookCount)
+            {
+                return sizeof(MetricsSegmentHeader) + iOrderBookCount * sizeof(common::SeqLock<OrderBookMetrics>);
+            }
+        }
+
+        MetricsPublisher::MetricsPublisher(const std::string & iSegmentName, std::uint32_t iOrderBookCount)
+            :m_Segment(common::SharedMemorySegment::Create(iSegmentName, GetSegmentSize(iOrderBookCount)))
+        {
+            if (!m_Segment.IsMapped())
+            {
+                return;
+            }
+
+            auto pData = static_cast<char *>(m_Segment.GetAddress());
+
+            m_pHeader = new (pData) MetricsSegmentHeader();
+            m_pHeader->Version        = MetricsSegmentHeader::CurrentVersion;
+            m_pHeader->OrderBookCount = iOrderBookCount;
+
+            m_pOrderBooks = reinterpret_cast<common::SeqLock<OrderBookMetrics> *>(pData + sizeof(MetricsSegmentHeader));
+            for (std::uint32_t i = 0; i < iOrderBookCount; ++i)
+            {
+                new (m_pOrderBooks + i) common::SeqLock<OrderBookMetrics>();
+            }
+
+            // Readers only trust the layout once the magic is visible
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(m_pHeader->Magic, MetricsMagic, sizeof(MetricsMagic));
+        }
+
+        void MetricsPublisher::PublishEngine(const EngineMetrics & iMetrics)
+        {
+            if (IsOpen())
+            {
+                m_pHeader->Engine.Store(iMetrics);
+            }
+        }
+
+        void MetricsPublisher::PublishOrderBook(std::uint32_t iIndex, const OrderBookMetrics & iMetrics)
+        {
+            if (iIndex < GetOrderBookCount())
+            {
+                m_pOrderBooks[iIndex].Store(iMetrics);
+            }
+        }
+
+        MetricsReader::MetricsReader(const std::string & iSegmentName)
+            :m_Segment(common::SharedMemorySegment::OpenReadOnly(iSegmentName))
+        {
+            if (!m_Segment.IsMapped() || m_Segment.GetSize() < sizeof(MetricsSegmentHeader))
+            {
+                return;
+            }
+
+            auto pData   = static_cast<const char *>(m_Segment.GetAddress());
+            auto pHeader = reinterpret_cast<const MetricsSegmentHeader *>(pData);
+
+            if (std::memcmp(pHeader->Magic, MetricsMagic, sizeof(MetricsMagic)) != 0)
+            {
+                return;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (pHeader->Version != MetricsSegmentHeader::CurrentVersion || m_Segment.GetSize() < GetSegmentSize(pHeader->OrderBookCount))
+            {
+                return;
+            }
+
+            m_pHeader     = pHeader;
+            m_pOrderBooks = reinterpret_cast<const common::SeqLock<OrderBookMetrics> *>(pData + sizeof(MetricsSegmentHeader));
+        }
+
+        bool MetricsReader::ReadEngine(EngineMetrics & oMetrics) const
+        {
+            return IsValid() && m_pHeader->Engine.TryLoad(oMetrics);
+        }
+
+        bool MetricsReader::ReadOrderBook(std::uint32_t iIndex, OrderBookMetrics & oMetrics) const
+        {
+            return iIndex < GetOrderBookCount() && m_pOrderBooks[iIndex].TryLoad(oMetrics);
+        }
+
+    }
+}
@@ -0,0 +1,128 @@
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <Engine_Metrics.h>
+#include <Engine_OrderBook.h>
+
+using namespace exchange::engine;
+
+/*
+    Print the metrics published by a matching engine in its shared memory segment ( Engine.metrics_segment ).
+
+    The segment is mapped read only, a snapshot is a few memory copies : the engine is never slowed down.
+    With --watch the snapshot is refreshed every SECONDS until interrupted.
+*/
+struct MetricsReaderSettings
+{
+    std::string SegmentName;
+    double      WatchInterval = 0.0;
+};
+
+void Usage(const char * iProgram)
+{
+    std::cerr << "Usage : " << iProgram << " SEGMENT [--watch SECONDS]" << std::endl;
+}
+
+bool ParseArguments(int argc, char ** argv, MetricsReaderSettings & oSettings)
+{
+    if (argc != 2 && argc != 4)
+    {
+        return false;
+    }
+
+    oSettings.SegmentName = argv[1];
+
+    if (argc == 4)
+    {
+        if (std::string(argv[2]) != "--watch")
+        {
+            std::cerr << "Unknown option " << argv[2] << std::endl;
+            return false;
+        }
+        oSettings.WatchInterval = std::stod(argv[3]);
+    }
+    return oSettings.WatchInterval >= 0.0;
+}
+
+bool PrintSnapshot(const MetricsReader & iReader)
+{
+    EngineMetrics Engine;
+    if (!iReader.ReadEngine(Engine))
+    {
+        std::cerr << "Engine metrics are being updated, retry later" << std::endl;
+        return false;
+    }
+
+    const auto Now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    const auto Age = Now > static_cast<std::int64_t>(Engine.Timestamp) ? (Now - Engine.Timestamp) / 1000000 : 0;
+
+    std::cout << "phase " << TradingPhaseToString(static_cast<TradingPhase>(Engine.GlobalPhase))
+              << " ; publication " << iReader.GetVersion() << " ; age " << Age << " ms" << std::endl;
+
+    std::cout << "orders in " << Engine.OrdersIn << " ; accepted " << Engine.OrdersAccepted << " ; rejected " << Engine.OrdersRejected
+              << " ; unknown instrument " << Engine.UnknownInstrument << " ; unsolicited cancels " << Engine.UnsolicitedCancels << std::endl;
+
+    std::cout << "deals " << Engine.Deals << " ; resting orders " << Engine.RestingOrders << " ; turnover " << Engine.Turnover
+              << " ; volume " << Engine.DailyVolume << " ; books " << Engine.OrderBookCount
+              << " ; in intraday auction " << Engine.MonitoredOrderBooks << std::endl;
+
+    std::cout << std::left << std::setw(16) << "security" << std::right << std::setw(8) << "id" << std::setw(20) << "phase"
+              << std::setw(10) << "in" << std::setw(10) << "rejects" << std::setw(10) << "deals"
+              << std::setw(9) << "bids" << std::setw(9) << "asks" << std::setw(8) << "b.lvl" << std::setw(8) << "a.lvl"
+              << std::setw(10) << "last" << std::setw(12) << "volume" << std::setw(16) << "turnover" << std::setw(10) << "pool" << std::endl;
+
+    for (std::uint32_t i = 0; i < iReader.GetOrderBookCount(); ++i)
+    {
+        OrderBookMetrics Book;
+        if (!iReader.ReadOrderBook(i, Book))
+        {
+            continue;
+        }
+
+        const auto & Counters = Book.Counters;
+        std::cout << std::left << std::setw(16) << std::string(Book.SecurityName, strnlen(Book.SecurityName, sizeof(Book.SecurityName)))
+                  << std::right << std::setw(8) << Book.ProductID
+                  << std::setw(20) << TradingPhaseToString(static_cast<TradingPhase>(Book.Phase))
+                  << std::setw(10) << Counters.Inserts + Counters.ImmediateInserts + Counters.Modifies + Counters.Deletes
+                  << std::setw(10) << Counters.Rejects << std::setw(10) << Book.Deals
+                  << std::setw(9) << Book.BidOrders << std::setw(9) << Book.AskOrders
+                  << std::setw(8) << Book.BidLevels << std::setw(8) << Book.AskLevels
+                  << std::setw(10) << Book.LastPrice << std::setw(12) << Book.DailyVolume << std::setw(16) << Book.Turnover
+                  << std::setw(10) << Book.DealPoolUsed << std::endl;
+    }
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    MetricsReaderSettings Settings;
+    if (!ParseArguments(argc, argv, Settings))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    MetricsReader Reader(Settings.SegmentName);
+    if (!Reader.IsValid())
+    {
+        std::cerr << "No engine metrics in shared memory segment " << Settings.SegmentName << std::endl;
+        return 2;
+    }
+
+    if (Settings.WatchInterval == 0.0)
+    {
+        return PrintSnapshot(Reader) ? 0 : 3;
+    }
+
+    const auto Interval = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(Settings.WatchInterval));
+    while (true)
+    {
+        PrintSnapshot(Reader);
+        std::cout << std::endl;
+        std::this_thread::sleep_for(Interval);
+    }
+}
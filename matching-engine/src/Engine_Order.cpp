@@ -26,6 +26,34 @@ namespace exchange
             }
         }
 
+        const char * OrderTypeToString(OrderType iType)
+        {
+            switch (iType)
+            {
+            case OrderType::LIMIT:
+                return "LIMIT";
+            case OrderType::MARKET:
+                return "MARKET";
+            default:
+                return "UNKNOWN_ORDER_TYPE";
+            }
+        }
+
+        const char * TimeQualifierToString(TimeQualifier iQualifier)
+        {
+            switch (iQualifier)
+            {
+            case TimeQualifier::DAY:
+                return "DAY";
+            case TimeQualifier::IOC:
+                return "IOC";
+            case TimeQualifier::FOK:
+                return "FOK";
+            default:
+                return "UNKNOWN_TIME_QUALIFIER";
+            }
+        }
+
         std::ostream& operator<<(std::ostream& o, const Order & x)
         {
             o << "Order : Price[" << x.GetPrice() << "] ; Quantity[" << x.GetQuantity() << "] ;"
@@ -0,0 +1,235 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <Engine_OrderFlow.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace exchange
+{
+    namespace engine
+    {
+        namespace
+        {
+            /* Capture file header : magic, format version and record size */
+            const char          CaptureMagic[8] = { 'E', 'X', 'O', 'F', 'L', 'O', 'W', '\0' };
+            const std::uint32_t CaptureVersion  = 1;
+
+            template <typename T>
+            std::uint32_t ToRaw(const T & iValue)
+            {
+                return static_cast<std::uint32_t>(iValue);
+            }
+        }
+
+        const char * OrderFlowCommandToString(OrderFlowCommand iCommand)
+        {
+            switch (iCommand)
+            {
+                case OrderFlowCommand::PHASE:
+                    return "PHASE";
+                case OrderFlowCommand::INSERT:
+                    return "INSERT";
+                case OrderFlowCommand::IMMEDIATE_INSERT:
+                    return "IMMEDIATE_INSERT";
+                case OrderFlowCommand::MODIFY:
+                    return "MODIFY";
+                case OrderFlowCommand::DELETE:
+                    return "DELETE";
+                case OrderFlowCommand::BOOK_PHASE:
+                    return "BOOK_PHASE";
+                case OrderFlowCommand::CANCEL_ALL:
+                    return "CANCEL_ALL";
+                default:
+                    assert(false);
+                    return "UNKNOWN";
+            }
+        }
+
+        DealRecord MakeDealRecord(std::uint32_t iProductID, const Deal & iDeal)
+        {
+            DealRecord Record;
+            Record.ProductID      = iProductID;
+            Record.Price          = ToRaw(iDeal.GetPrice());
+            Record.Quantity       = ToRaw(iDeal.GetQuantity());
+            Record.BuyerClientID  = ToRaw(iDeal.GetBuyerClientID());
+            Record.BuyerOrderID   = ToRaw(iDeal.GetBuyerOrderID());
+            Record.SellerClientID = ToRaw(iDeal.GetSellerClientID());
+            Record.SellerOrderID  = ToRaw(iDeal.GetSellerOrderID());
+            return Record;
+        }
+
+        OrderFlowRecorder::OrderFlowRecorder(const std::string & iFileName)
+            :m_Stream(iFileName, std::ios::binary | std::ios::trunc)
+        {
+            if (m_Stream)
+            {
+                const std::uint32_t RecordSize = sizeof(OrderFlowRecord);
+
+                m_Stream.write(CaptureMagic, sizeof(CaptureMagic));
+                m_Stream.write(reinterpret_cast<const char*>(&CaptureVersion), sizeof(CaptureVersion));
+                m_Stream.write(reinterpret_cast<const char*>(&RecordSize), sizeof(RecordSize));
+            }
+        }
+
+        OrderFlowRecorder::~OrderFlowRecorder()
+        {
+            Flush();
+        }
+
+        OrderFlowRecord MakeInsertRecord(const Order & iOrder, std::uint32_t iProductID)
+        {
+            OrderFlowRecord Record;
+            Record.Command   = static_cast<std::uint8_t>(OrderFlowCommand::INSERT);
+            Record.ProductID = iProductID;
+            Record.Way       = static_cast<std::uint8_t>(iOrder.GetWay());
+            Record.Type      = static_cast<std::uint8_t>(OrderType::LIMIT);
+            Record.Qualifier = static_cast<std::uint8_t>(TimeQualifier::DAY);
+            Record.Quantity  = ToRaw(iOrder.GetQuantity());
+            Record.Price     = ToRaw(iOrder.GetPrice());
+            Record.OrderID   = ToRaw(iOrder.GetOrderID());
+            Record.ClientID  = ToRaw(iOrder.GetClientID());
+            return Record;
+        }
+
+        OrderFlowRecord MakeImmediateInsertRecord(OrderType iType, OrderWay iWay, Order::qty_type iQty, Order::price_type iPrice, Order::client_orderid_type iOrderID,
+                                                  Order::client_id_type iClientID, TimeQualifier iQualifier, std::uint32_t iProductID)
+        {
+            OrderFlowRecord Record;
+            Record.Command   = static_cast<std::uint8_t>(OrderFlowCommand::IMMEDIATE_INSERT);
+            Record.ProductID = iProductID;
+            Record.Way       = static_cast<std::uint8_t>(iWay);
+            Record.Type      = static_cast<std::uint8_t>(iType);
+            Record.Qualifier = static_cast<std::uint8_t>(iQualifier);
+            Record.Quantity  = ToRaw(iQty);
+            Record.Price     = ToRaw(iPrice);
+            Record.OrderID   = ToRaw(iOrderID);
+            Record.ClientID  = ToRaw(iClientID);
+            return Record;
+        }
+
+        OrderFlowRecord MakeModifyRecord(const OrderReplace & iOrderReplace, std::uint32_t iProductID)
+        {
+            OrderFlowRecord Record;
+            Record.Command    = static_cast<std::uint8_t>(OrderFlowCommand::MODIFY);
+            Record.ProductID  = iProductID;
+            Record.Way        = static_cast<std::uint8_t>(iOrderReplace.GetWay());
+            Record.Quantity   = ToRaw(iOrderReplace.GetQuantity());
+            Record.Price      = ToRaw(iOrderReplace.GetPrice());
+            Record.OrderID    = ToRaw(iOrderReplace.GetExistingOrderID());
+            Record.NewOrderID = ToRaw(iOrderReplace.GetReplacedOrderID());
+            Record.ClientID   = ToRaw(iOrderReplace.GetClientID());
+            return Record;
+        }
+
+        OrderFlowRecord MakeDeleteRecord(Order::client_orderid_type iOrderID, Order::client_id_type iClientID, OrderWay iWay, std::uint32_t iProductID)
+        {
+            OrderFlowRecord Record;
+            Record.Command   = static_cast<std::uint8_t>(OrderFlowCommand::DELETE);
+            Record.ProductID = iProductID;
+            Record.Way       = static_cast<std::uint8_t>(iWay);
+            Record.OrderID   = ToRaw(iOrderID);
+            Record.ClientID  = ToRaw(iClientID);
+            return Record;
+        }
+
+        OrderFlowRecord MakePhaseRecord(TradingPhase iPhase, OrderFlowCommand iCommand, std::uint32_t iProductID)
+        {
+            OrderFlowRecord Record;
+            Record.Command   = static_cast<std::uint8_t>(iCommand);
+            Record.ProductID = iProductID;
+            Record.Type      = static_cast<std::uint8_t>(iPhase);
+            return Record;
+        }
+
+        OrderFlowRecord MakeCommandRecord(const OrderCommand & iCommand)
+        {
+            switch (iCommand.Command)
+            {
+                case CommandType::INSERT:
+                    return MakeInsertRecord(*iCommand.pOrder, iCommand.ProductID);
+                case CommandType::IMMEDIATE_INSERT:
+                    return MakeImmediateInsertRecord(iCommand.Type, iCommand.Way, iCommand.Qty, iCommand.LimitPrice, iCommand.OrderID, iCommand.Client,
+                                                     iCommand.Qualifier, iCommand.ProductID);
+                case CommandType::MODIFY:
+                    return MakeModifyRecord(*iCommand.pReplace, iCommand.ProductID);
+                case CommandType::DELETE:
+                    return MakeDeleteRecord(iCommand.OrderID, iCommand.Client, iCommand.Way, iCommand.ProductID);
+                default:
+                    assert(false);
+                    return OrderFlowRecord();
+            }
+        }
+
+        void OrderFlowRecorder::RecordInsert(const Order & iOrder, std::uint32_t iProductID)
+        {
+            auto Record = MakeInsertRecord(iOrder, iProductID);
+            Write(Record);
+        }
+
+        void OrderFlowRecorder::RecordImmediateInsert(OrderType iType, OrderWay iWay, Order::qty_type iQty, Order::price_type iPrice, Order::client_orderid_type iOrderID,
+                                                      Order::client_id_type iClientID, TimeQualifier iQualifier, std::uint32_t iProductID)
+        {
+            auto Record = MakeImmediateInsertRecord(iType, iWay, iQty, iPrice, iOrderID, iClientID, iQualifier, iProductID);
+            Write(Record);
+        }
+
+        void OrderFlowRecorder::RecordModify(const OrderReplace & iOrderReplace, std::uint32_t iProductID)
+        {
+            auto Record = MakeModifyRecord(iOrderReplace, iProductID);
+            Write(Record);
+        }
+
+        void OrderFlowRecorder::RecordDelete(Order::client_orderid_type iOrderID, Order::client_id_type iClientID, OrderWay iWay, std::uint32_t iProductID)
+        {
+            auto Record = MakeDeleteRecord(iOrderID, iClientID, iWay, iProductID);
+            Write(Record);
+        }
+
+        void OrderFlowRecorder::RecordPhase(TradingPhase iPhase)
+        {
+            auto Record = MakePhaseRecord(iPhase);
+            Write(Record);
+        }
+
+        void OrderFlowRecorder::Flush()
+        {
+            m_Stream.flush();
+        }
+
+        void OrderFlowRecorder::Write(OrderFlowRecord & rRecord)
+        {
+            rRecord.Timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+            m_Stream.write(reinterpret_cast<const char*>(&rRecord), sizeof(rRecord));
+            ++m_RecordCounter;
+        }
+
+        OrderFlowReader::OrderFlowReader(const std::string & iFileName)
+            :m_Stream(iFileName, std::ios::binary)
+        {
+            char          Magic[sizeof(CaptureMagic)];
+            std::uint32_t Version    = 0;
+            std::uint32_t RecordSize = 0;
+
+            m_Stream.read(Magic, sizeof(Magic));
+            m_Stream.read(reinterpret_cast<char*>(&Version), sizeof(Version));
+            m_Stream.read(reinterpret_cast<char*>(&RecordSize), sizeof(RecordSize));
+
+            m_Valid = m_Stream && std::memcmp(Magic, CaptureMagic, sizeof(Magic)) == 0 &&
+                      Version == CaptureVersion && RecordSize == sizeof(OrderFlowRecord);
+        }
+
+        bool OrderFlowReader::Next(OrderFlowRecord & oRecord)
+        {
+            if (!m_Valid)
+            {
+                return false;
+            }
+            return static_cast<bool>(m_Stream.read(reinterpret_cast<char*>(&oRecord), sizeof(oRecord)));
+        }
+    }
+}
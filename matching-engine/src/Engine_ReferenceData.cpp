@@ -0,0 +1,330 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <Engine_ReferenceData.h>
+#include <Engine_Snapshot.h>
+
+#include <logger/Logger.h>
+
+#include <ScopedExit.h>
+
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace exchange
+{
+    namespace engine
+    {
+        namespace
+        {
+            const char          ReferenceDataMagic[8] = { 'E', 'X', 'R', 'E', 'F', 'D', 'T', '\0' };
+            const std::uint32_t ReferenceDataVersion  = 2;
+
+            std::uint32_t ComputeImageCrc(const char * iData, std::size_t iSize)
+            {
+                boost::crc_32_type Crc;
+                Crc.process_bytes(iData, iSize);
+                return Crc.checksum();
+            }
+
+            /* Identical strings ( currencies ) are stored once */
+            class StringTable
+            {
+                public:
+
+                    std::uint32_t Add(const std::string & iValue)
+                    {
+                        auto It = m_Offsets.find(iValue);
+                        if (It != m_Offsets.end())
+                        {
+                            return It->second;
+                        }
+
+                        const auto Offset = static_cast<std::uint32_t>(m_Table.size());
+                        m_Table.insert(m_Table.end(), iValue.c_str(), iValue.c_str() + iValue.size() + 1);
+                        m_Offsets.emplace(iValue, Offset);
+                        return Offset;
+                    }
+
+                    const std::vector<char> & GetTable() const { return m_Table; }
+
+                private:
+
+                    std::vector<char>                                m_Table;
+                    std::unordered_map<std::string, std::uint32_t>   m_Offsets;
+            };
+
+            bool WriteAll(int iFd, const char * iData, std::size_t iSize)
+            {
+                while (iSize > 0)
+                {
+                    const auto Written = ::write(iFd, iData, iSize);
+                    if (Written < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        return false;
+                    }
+                    iData += Written;
+                    iSize -= static_cast<std::size_t>(Written);
+                }
+                return true;
+            }
+        }
+
+        bool ReferenceDataImage::Export(const std::string & iFileName, const std::vector<Instrument<Order> > & iInstruments,
+                                        std::uint64_t iDatabaseFingerprint)
+        {
+            std::string Error;
+            if (!Export(iFileName, iInstruments, iDatabaseFingerprint, Error))
+            {
+                EXERR("ReferenceDataImage::Export : " << Error);
+                return false;
+            }
+
+            EXINFO("ReferenceDataImage::Export : Instruments[" << iInstruments.size() << "] written in [" << iFileName << "]");
+            return true;
+        }
+
+        bool ReferenceDataImage::Export(const std::string & iFileName, const std::vector<Instrument<Order> > & iInstruments,
+                                        std::uint64_t iDatabaseFingerprint, std::string & oError)
+        {
+            ReferenceDataHeader Header;
+            std::memcpy(Header.Magic, ReferenceDataMagic, sizeof(ReferenceDataMagic));
+            Header.Version             = ReferenceDataVersion;
+            Header.InstrumentCount     = static_cast<std::uint32_t>(iInstruments.size());
+            Header.DatabaseFingerprint = iDatabaseFingerprint;
+
+            if (!iInstruments.empty())
+            {
+                auto Bounds = std::minmax_element(iInstruments.begin(), iInstruments.end(), [](const auto & iLhs, const auto & iRhs)
+                {
+                    return iLhs.GetProductId() < iRhs.GetProductId();
+                });
+                Header.FirstProductID = Bounds.first->GetProductId();
+
+                const std::uint64_t Slots = static_cast<std::uint64_t>(Bounds.second->GetProductId()) - Header.FirstProductID + 1;
+                if (Slots > static_cast<std::uint64_t>(MaxSlotsPerInstrument) * iInstruments.size())
+                {
+                    oError = "Product IDs [" + std::to_string(Header.FirstProductID) + ", " + std::to_string(Bounds.second->GetProductId()) +
+                             "] are too sparse for " + std::to_string(iInstruments.size()) + " instruments";
+                    return false;
+                }
+                Header.SlotCount = static_cast<std::uint32_t>(Slots);
+            }
+
+            std::vector<InstrumentRecord> Records(Header.SlotCount);
+            StringTable Strings;
+
+            for (auto && Instrument : iInstruments)
+            {
+                auto & Record = Records[Instrument.GetProductId() - Header.FirstProductID];
+                if (Record.Listed)
+                {
+                    oError = "Duplicated product ID[" + std::to_string(Instrument.GetProductId()) + "]";
+                    return false;
+                }
+
+                Record.ProductID  = Instrument.GetProductId();
+                Record.Listed     = 1;
+                Record.ClosePrice = static_cast<std::uint32_t>(Instrument.GetClosePrice());
+                Record.Name       = Strings.Add(Instrument.GetName());
+                Record.Isin       = Strings.Add(Instrument.GetIsin());
+                Record.Currency   = Strings.Add(Instrument.GetCurrency());
+                Record.PeakOrders = Instrument.GetPeakOrders();
+                Record.PeakDeals  = Instrument.GetPeakDeals();
+            }
+
+            const auto & Table = Strings.GetTable();
+            Header.StringTableSize = Table.size();
+
+            boost::crc_32_type Crc;
+            Crc.process_bytes(Records.data(), Records.size() * sizeof(InstrumentRecord));
+            Crc.process_bytes(Table.data(), Table.size());
+            Header.Crc = Crc.checksum();
+
+            const auto TempName = iFileName + ".tmp";
+            const int Fd = ::open(TempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (Fd == -1)
+            {
+                oError = "Unable to create [" + TempName + "] : " + std::strerror(errno);
+                return false;
+            }
+
+            bool bWritten = WriteAll(Fd, reinterpret_cast<const char*>(&Header), sizeof(Header)) &&
+                            WriteAll(Fd, reinterpret_cast<const char*>(Records.data()), Records.size() * sizeof(InstrumentRecord)) &&
+                            WriteAll(Fd, Table.data(), Table.size()) &&
+                            ::fsync(Fd) == 0;
+            ::close(Fd);
+
+            if (!bWritten || std::rename(TempName.c_str(), iFileName.c_str()) != 0 || !SyncDirectory(iFileName))
+            {
+                oError = "Unable to write [" + iFileName + "] : " + std::strerror(errno);
+                std::remove(TempName.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        std::uint64_t ReferenceDataImage::GetDatabaseFingerprint(const std::string & iDBPath)
+        {
+            DIR * pDirectory = ::opendir(iDBPath.c_str());
+            if (pDirectory == nullptr)
+            {
+                return 0;
+            }
+            auto close_directory = common::make_scope_exit([pDirectory]() { ::closedir(pDirectory); });
+
+            // Written by every open, read only sessions included
+            auto IsIgnored = [](const std::string & iName)
+            {
+                return iName == "LOCK" || iName == "LOG" || iName == "LOG.old";
+            };
+
+            std::vector<std::string> Names;
+            while (const auto pEntry = ::readdir(pDirectory))
+            {
+                const std::string Name(pEntry->d_name);
+                if (Name != "." && Name != ".." && !IsIgnored(Name))
+                {
+                    Names.push_back(Name);
+                }
+            }
+            std::sort(Names.begin(), Names.end());
+
+            // FNV-1a of the file names, sizes and modification times
+            std::uint64_t Fingerprint = 14695981039346656037ULL;
+            auto Hash = [&Fingerprint](const void * iData, std::size_t iSize)
+            {
+                const auto pBytes = static_cast<const unsigned char*>(iData);
+                for (std::size_t i = 0; i < iSize; ++i)
+                {
+                    Fingerprint = (Fingerprint ^ pBytes[i]) * 1099511628211ULL;
+                }
+            };
+
+            for (auto && Name : Names)
+            {
+                struct stat Stat;
+                if (::stat((iDBPath + "/" + Name).c_str(), &Stat) != 0)
+                {
+                    continue;
+                }
+
+                const std::int64_t Attributes[] = { static_cast<std::int64_t>(Stat.st_size), static_cast<std::int64_t>(Stat.st_mtim.tv_sec),
+                                                    static_cast<std::int64_t>(Stat.st_mtim.tv_nsec) };
+                Hash(Name.c_str(), Name.size() + 1);
+                Hash(Attributes, sizeof(Attributes));
+            }
+            return Fingerprint;
+        }
+
+        ReferenceDataImage::ReferenceDataImage(const std::string & iFileName)
+        {
+            const int Fd = ::open(iFileName.c_str(), O_RDONLY);
+            if (Fd == -1)
+            {
+                return;
+            }
+            auto close_file = common::make_scope_exit([Fd]() { ::close(Fd); });
+
+            m_bOpen = true;
+
+            struct stat Stat;
+            if (::fstat(Fd, &Stat) != 0 || static_cast<std::size_t>(Stat.st_size) < sizeof(ReferenceDataHeader))
+            {
+                return;
+            }
+
+            void * pMapping = ::mmap(nullptr, static_cast<std::size_t>(Stat.st_size), PROT_READ, MAP_PRIVATE, Fd, 0);
+            if (pMapping == MAP_FAILED)
+            {
+                EXERR("ReferenceDataImage::ReferenceDataImage : Unable to map [" << iFileName << "] : " << std::strerror(errno));
+                return;
+            }
+
+            m_pData = static_cast<const char*>(pMapping);
+            m_Size  = static_cast<std::size_t>(Stat.st_size);
+
+            if (Check())
+            {
+                m_pHeader  = reinterpret_cast<const ReferenceDataHeader*>(m_pData);
+                m_pRecords = reinterpret_cast<const InstrumentRecord*>(m_pData + sizeof(ReferenceDataHeader));
+                m_pStrings = m_pData + sizeof(ReferenceDataHeader) + m_pHeader->SlotCount * sizeof(InstrumentRecord);
+            }
+        }
+
+        ReferenceDataImage::~ReferenceDataImage()
+        {
+            if (m_pData != nullptr)
+            {
+                ::munmap(const_cast<char*>(m_pData), m_Size);
+            }
+        }
+
+        bool ReferenceDataImage::Check() const
+        {
+            const auto & Header = *reinterpret_cast<const ReferenceDataHeader*>(m_pData);
+
+            if (std::memcmp(Header.Magic, ReferenceDataMagic, sizeof(ReferenceDataMagic)) != 0 || Header.Version != ReferenceDataVersion ||
+                Header.StringTableSize > m_Size - sizeof(ReferenceDataHeader) ||
+                (m_Size - sizeof(ReferenceDataHeader) - Header.StringTableSize) / sizeof(InstrumentRecord) != Header.SlotCount ||
+                (m_Size - sizeof(ReferenceDataHeader) - Header.StringTableSize) % sizeof(InstrumentRecord) != 0 ||
+                Header.Crc != ComputeImageCrc(m_pData + sizeof(ReferenceDataHeader), m_Size - sizeof(ReferenceDataHeader)))
+            {
+                return false;
+            }
+
+            // Lookups do not check the bounds again : every listed string must be terminated inside the table
+            const auto pRecords = reinterpret_cast<const InstrumentRecord*>(m_pData + sizeof(ReferenceDataHeader));
+            const auto pStrings = m_pData + m_Size - Header.StringTableSize;
+            const auto Size     = Header.StringTableSize;
+
+            if (Size > 0 && pStrings[Size - 1] != '\0')
+            {
+                return false;
+            }
+
+            std::uint32_t Listed = 0;
+            for (std::uint32_t i = 0; i < Header.SlotCount; ++i)
+            {
+                const auto & Record = pRecords[i];
+                if (!Record.Listed)
+                {
+                    continue;
+                }
+                if (Record.ProductID != Header.FirstProductID + i || Record.Name >= Size || Record.Isin >= Size || Record.Currency >= Size)
+                {
+                    return false;
+                }
+                ++Listed;
+            }
+            return Listed == Header.InstrumentCount;
+        }
+
+        Instrument<Order> ReferenceDataImage::ToInstrument(const InstrumentRecord & iRecord) const
+        {
+            Instrument<Order> Result{ GetString(iRecord.Name), GetString(iRecord.Isin), GetString(iRecord.Currency),
+                                      static_cast<int>(iRecord.ProductID), Price(iRecord.ClosePrice) };
+            Result.SetPeaks(iRecord.PeakOrders, iRecord.PeakDeals);
+            return Result;
+        }
+
+    }
+}
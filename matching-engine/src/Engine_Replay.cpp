@@ -0,0 +1,261 @@
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+
+#include <LatencyHistogram.h>
+
+#include <Engine_MatchingEngine.h>
+#include <Engine_OrderFlow.h>
+
+using namespace exchange::engine;
+using exchange::common::LatencyHistogram;
+
+using engine_type = exchange::engine::MatchingEngine<>;
+using ClockType   = std::chrono::steady_clock;
+
+/*
+    Feed a gateway capture into the matching engine.
+
+    Speed 0 replays as fast as possible, otherwise the original inter arrival times are divided by the speed factor.
+    The deal stream can be written as a reference and compared bit for bit with the one of a later run.
+    Engine timers ( auction ends, EngineListen ) are not driven, phases only change through the captured PHASE commands.
+*/
+struct ReplaySettings
+{
+    std::string ConfigFile;
+    std::string CaptureFile;
+    double      Speed = 0.0;
+    std::string RecordDealsFile;
+    std::string VerifyDealsFile;
+};
+
+void Usage(const char * iProgram)
+{
+    std::cerr << "Usage : " << iProgram << " CONFIG CAPTURE [--speed FACTOR] [--record-deals FILE] [--verify-deals FILE]" << std::endl;
+}
+
+bool ParseArguments(int argc, char ** argv, ReplaySettings & oSettings)
+{
+    if (argc < 3)
+    {
+        return false;
+    }
+
+    oSettings.ConfigFile  = argv[1];
+    oSettings.CaptureFile = argv[2];
+
+    for (int i = 3; i < argc; ++i)
+    {
+        const std::string Option = argv[i];
+        if (i + 1 == argc)
+        {
+            std::cerr << "Missing value for " << Option << std::endl;
+            return false;
+        }
+
+        const std::string Value = argv[++i];
+        if (Option == "--speed")
+        {
+            oSettings.Speed = std::stod(Value);
+        }
+        else if (Option == "--record-deals")
+        {
+            oSettings.RecordDealsFile = Value;
+        }
+        else if (Option == "--verify-deals")
+        {
+            oSettings.VerifyDealsFile = Value;
+        }
+        else
+        {
+            std::cerr << "Unknown option " << Option << std::endl;
+            return false;
+        }
+    }
+    return oSettings.Speed >= 0.0;
+}
+
+bool LoadDeals(const std::string & iFileName, std::vector<DealRecord> & oDeals)
+{
+    std::ifstream Input(iFileName, std::ios::binary);
+    if (!Input)
+    {
+        return false;
+    }
+
+    DealRecord Record;
+    while (Input.read(reinterpret_cast<char*>(&Record), sizeof(Record)))
+    {
+        oDeals.push_back(Record);
+    }
+    return true;
+}
+
+bool SaveDeals(const std::string & iFileName, const std::vector<DealRecord> & iDeals)
+{
+    std::ofstream Output(iFileName, std::ios::binary | std::ios::trunc);
+    Output.write(reinterpret_cast<const char*>(iDeals.data()), iDeals.size() * sizeof(DealRecord));
+    return static_cast<bool>(Output);
+}
+
+/* Index of the first deal which differs from the reference, the size of the longest stream when one is a prefix of the other */
+size_t FirstMismatch(const std::vector<DealRecord> & iDeals, const std::vector<DealRecord> & iReference)
+{
+    const auto Common = std::min(iDeals.size(), iReference.size());
+    for (size_t i = 0; i < Common; ++i)
+    {
+        if (std::memcmp(&iDeals[i], &iReference[i], sizeof(DealRecord)) != 0)
+        {
+            return i;
+        }
+    }
+    return iDeals.size() == iReference.size() ? iDeals.size() : Common;
+}
+
+void PrintLatencies(std::ostream & oss, const char * iName, const LatencyHistogram & iLatencies)
+{
+    if (iLatencies.GetCount() == 0)
+    {
+        return;
+    }
+
+    oss << std::left << std::setw(20) << iName << std::right << std::setw(10) << iLatencies.GetCount()
+        << std::setw(10) << iLatencies.GetValueAtPercentile(50.0) << std::setw(10) << iLatencies.GetValueAtPercentile(99.0)
+        << std::setw(10) << iLatencies.GetValueAtPercentile(99.9) << std::setw(12) << iLatencies.GetMax() << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    ReplaySettings Settings;
+    if (!ParseArguments(argc, argv, Settings))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    boost::property_tree::ptree Config;
+    if (!boost::filesystem::exists(Settings.ConfigFile))
+    {
+        std::cerr << "No such file or directory : " << Settings.ConfigFile << std::endl;
+        return 1;
+    }
+    boost::property_tree::ini_parser::read_ini(Settings.ConfigFile, Config);
+
+    OrderFlowReader Reader(Settings.CaptureFile);
+    if (!Reader.IsValid())
+    {
+        std::cerr << "Invalid capture file : " << Settings.CaptureFile << std::endl;
+        return 2;
+    }
+
+    std::vector<DealRecord> Reference;
+    if (!Settings.VerifyDealsFile.empty() && !LoadDeals(Settings.VerifyDealsFile, Reference))
+    {
+        std::cerr << "Failed to read the reference deals : " << Settings.VerifyDealsFile << std::endl;
+        return 2;
+    }
+
+    auto pEngine = std::make_unique<engine_type>();
+    if (!pEngine->Configure(Config))
+    {
+        std::cerr << "Failed to configure the matching engine from " << Settings.ConfigFile << std::endl;
+        return 3;
+    }
+
+    std::vector<DealRecord> Deals;
+    pEngine->SetDealListener([&Deals](std::uint32_t iProductID, const Deal & iDeal)
+    {
+        Deals.push_back(MakeDealRecord(iProductID, iDeal));
+    });
+
+    const auto CommandCount = static_cast<size_t>(OrderFlowCommand::MAX_COMMAND);
+
+    std::vector<LatencyHistogram> Latencies(CommandCount);
+    LatencyHistogram              AllLatencies;
+    std::uint64_t                 Rejected = 0;
+
+    OrderFlowRecord Record;
+    std::uint64_t   FirstTimestamp = 0;
+    bool            bFirst         = true;
+
+    const auto ReplayStart = ClockType::now();
+
+    while (Reader.Next(Record))
+    {
+        if (Record.Command >= CommandCount)
+        {
+            std::cerr << "Corrupted capture : unknown command " << static_cast<unsigned>(Record.Command) << std::endl;
+            return 4;
+        }
+
+        if (bFirst)
+        {
+            FirstTimestamp = Record.Timestamp;
+            bFirst = false;
+        }
+
+        if (Settings.Speed > 0.0)
+        {
+            const auto Offset = std::chrono::nanoseconds(static_cast<std::int64_t>((Record.Timestamp - FirstTimestamp) / Settings.Speed));
+            std::this_thread::sleep_until(ReplayStart + Offset);
+        }
+
+        const auto Start  = ClockType::now();
+        const auto Result = ReplayRecord(*pEngine, Record);
+        const auto End    = ClockType::now();
+
+        const auto Elapsed = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(End - Start).count());
+        Latencies[Record.Command].Record(Elapsed);
+        AllLatencies.Record(Elapsed);
+
+        if (Result != Status::Ok)
+        {
+            ++Rejected;
+        }
+    }
+
+    const auto Seconds = std::chrono::duration<double>(ClockType::now() - ReplayStart).count();
+
+    std::cout << "commands " << AllLatencies.GetCount() << " ; rejected " << Rejected << " ; deals " << Deals.size() << std::endl;
+    std::cout << "replay time " << std::fixed << std::setprecision(3) << Seconds << "s ; throughput "
+              << std::setprecision(0) << (Seconds > 0 ? AllLatencies.GetCount() / Seconds : 0.0) << " commands/s" << std::endl;
+
+    std::cout << std::left << std::setw(20) << "command" << std::right << std::setw(10) << "count" << std::setw(10) << "p50"
+              << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(12) << "max" << std::endl;
+    for (size_t i = 0; i < CommandCount; ++i)
+    {
+        PrintLatencies(std::cout, OrderFlowCommandToString(static_cast<OrderFlowCommand>(i)), Latencies[i]);
+    }
+    PrintLatencies(std::cout, "ALL", AllLatencies);
+    std::cout << "latencies in nanoseconds" << std::endl;
+
+    if (!Settings.RecordDealsFile.empty())
+    {
+        if (!SaveDeals(Settings.RecordDealsFile, Deals))
+        {
+            std::cerr << "Failed to write the deals to " << Settings.RecordDealsFile << std::endl;
+            return 5;
+        }
+        std::cout << "deals written to " << Settings.RecordDealsFile << std::endl;
+    }
+
+    if (!Settings.VerifyDealsFile.empty())
+    {
+        const auto Mismatch = FirstMismatch(Deals, Reference);
+        if (Mismatch != Deals.size() || Deals.size() != Reference.size())
+        {
+            std::cerr << "deal stream differs from " << Settings.VerifyDealsFile << " at deal " << Mismatch
+                      << " ( " << Deals.size() << " deals, " << Reference.size() << " in the reference )" << std::endl;
+            return 6;
+        }
+        std::cout << "deal stream matches " << Settings.VerifyDealsFile << std::endl;
+    }
+
+    return 0;
+}
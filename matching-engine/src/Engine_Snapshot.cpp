@@ -0,0 +1,260 @@
+/*
+* Copyright (C) 2016, Fabien Aulaire
+* All rights reserved.
+*/
+
+#include <Engine_Snapshot.h>
+#include <Engine_Journal.h>
+
+#include <logger/Logger.h>
+
+#include <ScopedExit.h>
+
+#include <boost/crc.hpp>
+
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace exchange
+{
+    namespace engine
+    {
+        namespace
+        {
+            const char          SnapshotMagic[8] = { 'E', 'X', 'S', 'N', 'A', 'P', 'S', '\0' };
+            const std::uint32_t SnapshotVersion  = 1;
+
+            std::uint32_t ComputeSnapshotCrc(const char * iData, std::size_t iSize)
+            {
+                boost::crc_32_type Crc;
+                Crc.process_bytes(iData, iSize);
+                return Crc.checksum();
+            }
+
+        }
+
+        bool SyncDirectory(const std::string & iFileName)
+        {
+            const auto Separator = iFileName.rfind('/');
+            const std::string Directory = (Separator == std::string::npos) ? "." : iFileName.substr(0, Separator + 1);
+
+            const int Fd = ::open(Directory.c_str(), O_RDONLY | O_DIRECTORY);
+            if (Fd == -1)
+            {
+                return false;
+            }
+            const bool bSynced = ::fsync(Fd) == 0;
+            ::close(Fd);
+            return bSynced;
+        }
+
+        SnapshotWriter::SnapshotWriter(const std::string & iFileName, JournalWriter & rJournal)
+            :m_FileName(iFileName), m_rJournal(rJournal)
+        {}
+
+        SnapshotWriter::~SnapshotWriter()
+        {
+            Wait();
+        }
+
+        bool SnapshotWriter::Write(std::uint64_t iSequence, std::uint32_t iGlobalPhase, std::vector<image_type> iBooks)
+        {
+            if (IsBusy())
+            {
+                return false;
+            }
+
+            // The previous writer is done, joining does not block
+            Wait();
+
+            m_Busy.store(true, std::memory_order_release);
+            m_Writer = std::thread(&SnapshotWriter::Run, this, iSequence, iGlobalPhase, std::move(iBooks));
+            return true;
+        }
+
+        void SnapshotWriter::Wait()
+        {
+            if (m_Writer.joinable())
+            {
+                m_Writer.join();
+            }
+        }
+
+        void SnapshotWriter::Run(std::uint64_t iSequence, std::uint32_t iGlobalPhase, std::vector<image_type> iBooks)
+        {
+            auto clear_busy = common::make_scope_exit([this]() { m_Busy.store(false, std::memory_order_release); });
+
+            const auto Start    = std::chrono::steady_clock::now();
+            const auto TempName = m_FileName + ".tmp";
+
+            if (!WriteFile(TempName, iSequence, iGlobalPhase, iBooks))
+            {
+                EXERR("SnapshotWriter::Run : Unable to write [" << TempName << "] : " << std::strerror(errno));
+                std::remove(TempName.c_str());
+                return;
+            }
+
+            // Never publish a state the journal could not replay from
+            if (!m_rJournal.WaitDurable(iSequence))
+            {
+                EXERR("SnapshotWriter::Run : The journal failed before sequence[" << iSequence << "], snapshot dropped");
+                std::remove(TempName.c_str());
+                return;
+            }
+
+            if (std::rename(TempName.c_str(), m_FileName.c_str()) != 0 || !SyncDirectory(m_FileName))
+            {
+                EXERR("SnapshotWriter::Run : Unable to install [" << m_FileName << "] : " << std::strerror(errno));
+                return;
+            }
+
+            m_LastSequence.store(iSequence, std::memory_order_release);
+
+            const auto Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+            EXINFO("SnapshotWriter::Run : Sequence[" << iSequence << "] ; Books[" << iBooks.size() << "] ; Milliseconds[" << Milliseconds << "]");
+        }
+
+        bool SnapshotWriter::WriteFile(const std::string & iFileName, std::uint64_t iSequence, std::uint32_t iGlobalPhase, const std::vector<image_type> & iBooks)
+        {
+            std::size_t Size = sizeof(SnapshotHeader);
+            for (auto && pImage : iBooks)
+            {
+                Size += pImage->size();
+            }
+
+            const int Fd = ::open(iFileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (Fd == -1)
+            {
+                return false;
+            }
+            auto close_file = common::make_scope_exit([Fd]() { ::close(Fd); });
+
+            if (::ftruncate(Fd, static_cast<off_t>(Size)) != 0)
+            {
+                return false;
+            }
+
+            void * pMapping = ::mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+            if (pMapping == MAP_FAILED)
+            {
+                return false;
+            }
+            auto unmap_file = common::make_scope_exit([pMapping, Size]() { ::munmap(pMapping, Size); });
+
+            char * pData   = static_cast<char*>(pMapping);
+            std::size_t Offset = sizeof(SnapshotHeader);
+            for (auto && pImage : iBooks)
+            {
+                std::memcpy(pData + Offset, pImage->data(), pImage->size());
+                Offset += pImage->size();
+            }
+
+            SnapshotHeader Header;
+            std::memcpy(Header.Magic, SnapshotMagic, sizeof(SnapshotMagic));
+            Header.Version     = SnapshotVersion;
+            Header.BookCount   = static_cast<std::uint32_t>(iBooks.size());
+            Header.Sequence    = iSequence;
+            Header.Size        = Size;
+            Header.GlobalPhase = iGlobalPhase;
+            Header.Crc         = ComputeSnapshotCrc(pData + sizeof(SnapshotHeader), Size - sizeof(SnapshotHeader));
+            std::memcpy(pData, &Header, sizeof(Header));
+
+            return ::msync(pMapping, Size, MS_SYNC) == 0;
+        }
+
+        SnapshotReader::SnapshotReader(const std::string & iFileName)
+        {
+            const int Fd = ::open(iFileName.c_str(), O_RDONLY);
+            if (Fd == -1)
+            {
+                return;
+            }
+            auto close_file = common::make_scope_exit([Fd]() { ::close(Fd); });
+
+            m_bOpen = true;
+
+            struct stat Stat;
+            if (::fstat(Fd, &Stat) != 0 || static_cast<std::size_t>(Stat.st_size) < sizeof(SnapshotHeader))
+            {
+                return;
+            }
+
+            void * pMapping = ::mmap(nullptr, static_cast<std::size_t>(Stat.st_size), PROT_READ, MAP_PRIVATE, Fd, 0);
+            if (pMapping == MAP_FAILED)
+            {
+                EXERR("SnapshotReader::SnapshotReader : Unable to map [" << iFileName << "] : " << std::strerror(errno));
+                return;
+            }
+
+            m_pData  = static_cast<const char*>(pMapping);
+            m_Size   = static_cast<std::size_t>(Stat.st_size);
+            m_Offset = sizeof(SnapshotHeader);
+
+            if (Check())
+            {
+                m_pHeader = reinterpret_cast<const SnapshotHeader*>(m_pData);
+            }
+        }
+
+        SnapshotReader::~SnapshotReader()
+        {
+            if (m_pData != nullptr)
+            {
+                ::munmap(const_cast<char*>(m_pData), m_Size);
+            }
+        }
+
+        bool SnapshotReader::Check() const
+        {
+            const auto & Header = *reinterpret_cast<const SnapshotHeader*>(m_pData);
+
+            if (std::memcmp(Header.Magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0 || Header.Version != SnapshotVersion ||
+                Header.Size != m_Size || Header.Crc != ComputeSnapshotCrc(m_pData + sizeof(SnapshotHeader), m_Size - sizeof(SnapshotHeader)))
+            {
+                return false;
+            }
+
+            // Every book must fit, Next does not check the bounds again
+            std::size_t Offset = sizeof(SnapshotHeader);
+            for (std::uint32_t i = 0; i < Header.BookCount; ++i)
+            {
+                if (m_Size - Offset < sizeof(BookSnapshotHeader))
+                {
+                    return false;
+                }
+                const auto & Book = *reinterpret_cast<const BookSnapshotHeader*>(m_pData + Offset);
+                const auto Orders = static_cast<std::size_t>(Book.BidOrders) + Book.AskOrders;
+
+                Offset += sizeof(BookSnapshotHeader);
+                if ((m_Size - Offset) / sizeof(OrderSnapshotRecord) < Orders)
+                {
+                    return false;
+                }
+                Offset += Orders * sizeof(OrderSnapshotRecord);
+            }
+            return Offset == m_Size;
+        }
+
+        bool SnapshotReader::Next(const BookSnapshotHeader *& oBook, const OrderSnapshotRecord *& oOrders)
+        {
+            if (!IsValid() || m_Offset == m_Size)
+            {
+                return false;
+            }
+
+            oBook    = reinterpret_cast<const BookSnapshotHeader*>(m_pData + m_Offset);
+            m_Offset += sizeof(BookSnapshotHeader);
+            oOrders  = reinterpret_cast<const OrderSnapshotRecord*>(m_pData + m_Offset);
+            m_Offset += (static_cast<std::size_t>(oBook->BidOrders) + oBook->AskOrders) * sizeof(OrderSnapshotRecord);
+            return true;
+        }
+
+    }
+}
@@ -35,9 +35,21 @@ namespace exchange
                 case Status::OrderNotFound:
                     oss << "Order Not Found";
                     break;
+                case Status::InvalidOrderType:
+                    oss << "Invalid Order Type";
+                    break;
+                case Status::InvalidTimeQualifier:
+                    oss << "Invalid Time Qualifier";
+                    break;
+                case Status::NotFullyExecutable:
+                    oss << "Not Fully Executable";
+                    break;
                 case Status::InternalError:
                     oss << "Internal Error";
                     break;
+                case Status::DuplicateOrderID:
+                    oss << "Duplicate Order ID";
+                    break;
 
             };
             return oss;
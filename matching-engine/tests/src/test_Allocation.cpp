@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <list>
+#include <thread>
+
+#include <AllocationHook.h>
+#include <NodeAllocator.h>
+
+#include <Engine_MatchingEngine.h>
+#include <Logger.h>
+
+using namespace exchange::engine;
+using exchange::common::AllocationCounter;
+using exchange::common::DeferredNodes;
+using exchange::common::NodeAllocator;
+using exchange::common::ScopedAllocationCounter;
+
+#define CREATE_ORDER(Way, Qty, Price, OrderID, ClientID) ( std::make_unique<Order>(Way, Qty, Price, OrderID, ClientID) )
+#define CREATE_REPLACE(Way, Qty, Price, OldOrderID, NewOrderID, ClientID) ( std::make_unique<OrderReplace>(Way, Qty, Price, OldOrderID, NewOrderID, ClientID) )
+
+namespace
+{
+    /* Heap allocations of each operation type, summed over a run */
+    struct OperationAllocations
+    {
+        std::uint64_t PassiveInsert    = 0;
+        std::uint64_t Amend            = 0;
+        std::uint64_t Cancel           = 0;
+        std::uint64_t AggressiveInsert = 0;
+        std::uint64_t ImmediateInsert  = 0;
+    };
+
+    template <typename Operation>
+    std::uint64_t CountAllocations(Operation && iOperation)
+    {
+        ScopedAllocationCounter Counter;
+        iOperation();
+        return Counter.GetAllocations();
+    }
+}
+
+class AllocationTest : public testing::Test
+{
+public:
+
+    using engine_type = exchange::engine::MatchingEngine<>;
+
+    using OrderBookType = OrderBook<Order, engine_type>;
+
+    static constexpr int WarmUpCycles   = 1000;
+    static constexpr int MeasuredCycles = 10000;
+
+    AllocationTest():
+        m_Instrument{ "MingYiCorporation", "ISIN", "EUR", 1, 1000_price }
+    {}
+
+    virtual void SetUp()
+    {
+        m_pEngine.reset(new engine_type());
+
+        m_pOrderBook.reset(new OrderBookType(m_Instrument, *m_pEngine));
+
+        if (boost::filesystem::exists("config.ini"))
+        {
+            boost::property_tree::ini_parser::read_ini("config.ini", m_Config);
+            ASSERT_TRUE(m_pEngine->Configure(m_Config));
+        }
+        else
+        {
+            FAIL();
+        }
+    }
+
+    /*
+        One cycle of the steady state order flow : a passive order on each side, amended then cancelled,
+        a resting order fully executed by an aggressive order, and another one by an IOC order
+    */
+    OperationAllocations RunCycles(int iCycles)
+    {
+        OperationAllocations Allocations;
+
+        for (int i = 0; i < iCycles; ++i)
+        {
+            auto pBuy  = CREATE_ORDER(OrderWay::BUY, 100_qty, 990_price, NextOrderID(), 5_clientid);
+            auto pSell = CREATE_ORDER(OrderWay::SELL, 100_qty, 1010_price, NextOrderID(), 6_clientid);
+            const auto BuyID  = pBuy->GetOrderID();
+            const auto SellID = pSell->GetOrderID();
+
+            Allocations.PassiveInsert += CountAllocations([&]() { EXPECT_EQ(Status::Ok, m_pOrderBook->Insert(std::move(pBuy))); });
+            Allocations.PassiveInsert += CountAllocations([&]() { EXPECT_EQ(Status::Ok, m_pOrderBook->Insert(std::move(pSell))); });
+
+            const auto AmendedID = NextOrderID();
+            auto pReplace = CREATE_REPLACE(OrderWay::BUY, 50_qty, 990_price, BuyID, AmendedID, 5_clientid);
+
+            Allocations.Amend  += CountAllocations([&]() { EXPECT_EQ(Status::Ok, m_pOrderBook->Modify(std::move(pReplace))); });
+
+            Allocations.Cancel += CountAllocations([&]() { EXPECT_EQ(Status::Ok, m_pOrderBook->Delete(AmendedID, 5_clientid, OrderWay::BUY)); });
+            Allocations.Cancel += CountAllocations([&]() { EXPECT_EQ(Status::Ok, m_pOrderBook->Delete(SellID, 6_clientid, OrderWay::SELL)); });
+
+            auto pResting    = CREATE_ORDER(OrderWay::SELL, 10_qty, 1000_price, NextOrderID(), 6_clientid);
+            auto pAggressive = CREATE_ORDER(OrderWay::BUY, 10_qty, 1000_price, NextOrderID(), 5_clientid);
+
+            Allocations.PassiveInsert    += CountAllocations([&]() { EXPECT_EQ(Status::Ok, m_pOrderBook->Insert(std::move(pResting))); });
+            Allocations.AggressiveInsert += CountAllocations([&]() { EXPECT_EQ(Status::Ok, m_pOrderBook->Insert(std::move(pAggressive))); });
+
+            auto pBid = CREATE_ORDER(OrderWay::BUY, 10_qty, 1000_price, NextOrderID(), 5_clientid);
+            const auto IOCOrderID = NextOrderID();
+
+            Allocations.PassiveInsert   += CountAllocations([&]() { EXPECT_EQ(Status::Ok, m_pOrderBook->Insert(std::move(pBid))); });
+            Allocations.ImmediateInsert += CountAllocations([&]()
+            {
+                EXPECT_EQ(Status::Ok, m_pOrderBook->ImmediateInsert(OrderType::LIMIT, OrderWay::SELL, 10_qty, 1000_price, IOCOrderID, 6_clientid, TimeQualifier::IOC));
+            });
+        }
+        return Allocations;
+    }
+
+    ClientOrderID NextOrderID() { return ClientOrderID(++m_LastOrderID); }
+
+protected:
+
+    Instrument<Order>                                    m_Instrument;
+    boost::property_tree::ptree                          m_Config;
+    std::unique_ptr<engine_type>                         m_pEngine;
+    std::unique_ptr<OrderBookType>                       m_pOrderBook;
+    std::uint32_t                                        m_LastOrderID = 0;
+};
+
+TEST_F(AllocationTest, Should_hook_count_the_allocations_of_the_calling_thread)
+{
+    ASSERT_TRUE(AllocationCounter::IsHookInstalled());
+
+    ScopedAllocationCounter Counter;
+    {
+        auto pValue = std::make_unique<std::uint64_t>(42);
+        ASSERT_EQ(1u, Counter.GetAllocations());
+    }
+
+    const auto Counters = Counter.GetCounters();
+    ASSERT_EQ(1u, Counters.Deallocations);
+    ASSERT_EQ(sizeof(std::uint64_t), Counters.Bytes);
+}
+
+TEST_F(AllocationTest, Should_node_allocator_recycle_released_nodes)
+{
+    std::list<std::uint64_t, NodeAllocator<std::uint64_t> > List;
+    List.resize(100);
+    List.clear();
+
+    ScopedAllocationCounter Counter;
+    List.resize(100);
+    List.clear();
+
+    ASSERT_EQ(0u, Counter.GetAllocations());
+}
+
+TEST_F(AllocationTest, Should_deferred_nodes_reach_the_free_list_of_the_owner)
+{
+    using node_type      = std::array<std::uint64_t, 5>;
+    using allocator_type = NodeAllocator<node_type>;
+
+    allocator_type Allocator;
+    std::vector<node_type *> Nodes;
+    for (int i = 0; i < 100; ++i)
+    {
+        Nodes.push_back(Allocator.allocate(1));
+    }
+
+    const auto OwnerFreeNodes = allocator_type::GetFreeCount();
+
+    DeferredNodes Deferred;
+    std::size_t   HelperFreeNodes = 0;
+    std::thread Helper([&Nodes, &Deferred, &HelperFreeNodes]()
+    {
+        allocator_type HelperAllocator;
+        DeferredNodes::GetCurrent() = &Deferred;
+        for (auto pNode : Nodes)
+        {
+            HelperAllocator.deallocate(pNode, 1);
+        }
+        DeferredNodes::GetCurrent() = nullptr;
+        HelperFreeNodes = allocator_type::GetFreeCount();
+    });
+    Helper.join();
+
+    ASSERT_EQ(0u, HelperFreeNodes);
+    ASSERT_EQ(100u, Deferred.GetCount());
+
+    Deferred.Release();
+    ASSERT_EQ(0u, Deferred.GetCount());
+    ASSERT_EQ(OwnerFreeNodes + 100, allocator_type::GetFreeCount());
+
+    ScopedAllocationCounter Counter;
+    for (auto && pNode : Nodes)
+    {
+        pNode = Allocator.allocate(1);
+    }
+    ASSERT_EQ(0u, Counter.GetAllocations());
+
+    for (auto pNode : Nodes)
+    {
+        Allocator.deallocate(pNode, 1);
+    }
+}
+
+TEST_F(AllocationTest, Should_steady_state_order_flow_never_allocate)
+{
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    m_pOrderBook->RehashOrderIndexes(64);
+    m_pOrderBook->ReserveDeals(2 * (WarmUpCycles + MeasuredCycles));
+
+    RunCycles(WarmUpCycles);
+    const auto Allocations = RunCycles(MeasuredCycles);
+
+    EXPECT_EQ(0u, Allocations.PassiveInsert);
+    EXPECT_EQ(0u, Allocations.Amend);
+    EXPECT_EQ(0u, Allocations.Cancel);
+    EXPECT_EQ(0u, Allocations.AggressiveInsert);
+    EXPECT_EQ(0u, Allocations.ImmediateInsert);
+
+    ASSERT_EQ(2u * (WarmUpCycles + MeasuredCycles), m_pOrderBook->GetDealCounter());
+    OrderBookMetrics Metrics;
+    m_pOrderBook->FillMetrics(Metrics);
+    ASSERT_EQ(0u, Metrics.BidOrders + Metrics.AskOrders);
+}
+
+int main(int argc, char ** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -6,6 +6,10 @@
 
 #include <Engine_Instrument.h>
 #include <Engine_Order.h>
+#include <Engine_ReferenceData.h>
+
+#include <cstddef>
+#include <fstream>
 
 using namespace exchange::engine;
 
@@ -117,6 +121,182 @@ TEST_F(InstrumentManagerTest, Should_load_return_the_same_instrument_as_the_inse
 	ASSERT_TRUE(InstrMgr.Load(instr_handler));
 }
 
+TEST_F(InstrumentManagerTest, Should_text_archived_instruments_be_migrated_on_read)
+{
+	using text_storage_type = exchange::common::NoSqlStorage<Instrument<Order>, exchange::common::LevelDBStorage,
+	                                                          exchange::common::TextArchiveSerializer<Instrument<Order> > >;
+
+	Instrument<Order> Michelin{ "Michelin", "ISINMICH", "EUR", 1, 1254_price };
+	Instrument<Order> Natixis{ "Natixis", "ISINATIX", "JPY", 2, 1255_price };
+	Michelin.SetPeaks(1500, 300);
+
+	{
+		text_storage_type TextStorage(m_DBFilePath);
+		ASSERT_TRUE(TextStorage.Write(Michelin, key_extractor));
+		ASSERT_TRUE(TextStorage.Write(Natixis, key_extractor));
+	}
+
+	std::vector<Instrument<Order> > Loaded;
+	auto instr_handler = [&Loaded](const Instrument<Order> & instr) { Loaded.push_back(instr); };
+	{
+		InstrumentManager<Order> InstrMgr(m_DBFilePath);
+		ASSERT_TRUE(InstrMgr.Load(instr_handler));
+		ASSERT_EQ(2u, InstrMgr.GetMigratedCounter());
+	}
+
+	ASSERT_EQ(2u, Loaded.size());
+	EXPECT_EQ(Michelin, Loaded[0]);
+	EXPECT_EQ(Natixis, Loaded[1]);
+
+	// The records are binary now
+	Loaded.clear();
+	InstrumentManager<Order> InstrMgr(m_DBFilePath);
+	ASSERT_TRUE(InstrMgr.Load(instr_handler));
+	EXPECT_EQ(0u, InstrMgr.GetMigratedCounter());
+	EXPECT_EQ(Michelin, Loaded[0]);
+
+	Instrument<Order> Instrument;
+	ASSERT_TRUE(InstrMgr.Get("Natixis", Instrument));
+	EXPECT_EQ(Natixis, Instrument);
+}
+
+TEST_F(InstrumentManagerTest, Should_batch_write_overwrite_every_instrument_at_once)
+{
+	InstrumentManager<Order> InstrMgr(m_DBFilePath);
+
+	Instrument<Order> Michelin{ "Michelin", "ISINMICH", "EUR", 1, 1254_price };
+	ASSERT_TRUE(InstrMgr.Write(Michelin, key_extractor));
+
+	Michelin.SetClosePrice(1300_price);
+	Michelin.SetPeaks(1500, 300);
+	std::vector<Instrument<Order> > Instruments{ Michelin, { "Natixis", "ISINATIX", "JPY", 2, 1255_price } };
+
+	ASSERT_TRUE(InstrMgr.WriteBatch(Instruments.begin(), Instruments.end(), key_extractor));
+
+	std::vector<Instrument<Order> > Loaded;
+	auto instr_handler = [&Loaded](const Instrument<Order> & instr) { Loaded.push_back(instr); };
+	ASSERT_TRUE(InstrMgr.Load(instr_handler));
+
+	ASSERT_EQ(2u, Loaded.size());
+	EXPECT_EQ(Michelin, Loaded[0]);
+	EXPECT_EQ(Instruments[1], Loaded[1]);
+	EXPECT_EQ(1300_price, Loaded[0].GetClosePrice());
+}
+
+TEST_F(InstrumentManagerTest, Should_parallel_load_return_every_instrument_in_key_order)
+{
+	std::vector<Instrument<Order> > Instruments;
+	for (int i = 0; i < 100; ++i)
+	{
+		Instruments.push_back({ "INSTR" + std::to_string(1000 + i), "ISIN", "EUR", i + 1, Price(1000 + i) });
+	}
+
+	std::vector<Instrument<Order> > Loaded;
+	{
+		InstrumentManager<Order> InstrMgr(m_DBFilePath);
+		ASSERT_TRUE(InstrMgr.WriteBatch(Instruments.begin(), Instruments.end(), key_extractor));
+		ASSERT_TRUE(InstrMgr.LoadAll(Loaded, 4));
+	}
+
+	ASSERT_EQ(Instruments, Loaded);
+}
+
+TEST_F(InstrumentManagerTest, Should_instrument_image_find_every_exported_instrument)
+{
+	const std::string ImagePath = "/tmp/InstrumentImage.bin";
+
+	Instrument<Order> Michelin{ "Michelin", "ISINMICH", "EUR", 1, 1254_price };
+	Instrument<Order> Natixis{ "Natixis", "ISINATIX", "EUR", 2, 1255_price };
+	Instrument<Order> Ibm{ "IBM", "ISINIBM", "USD", 5, 1256_price };
+	Ibm.SetPeaks(1500, 300);
+
+	ASSERT_TRUE(ReferenceDataImage::Export(ImagePath, { Ibm, Michelin, Natixis }, 0));
+
+	ReferenceDataImage Image(ImagePath);
+	ASSERT_TRUE(Image.IsValid());
+	ASSERT_EQ(3u, Image.GetInstrumentCount());
+
+	ASSERT_NE(nullptr, Image.Find(5));
+	EXPECT_EQ(Ibm, Image.ToInstrument(*Image.Find(5)));
+	EXPECT_STREQ("Natixis", Image.GetString(Image.Find(2)->Name));
+	EXPECT_EQ(nullptr, Image.Find(0));
+	EXPECT_EQ(nullptr, Image.Find(3));
+	EXPECT_EQ(nullptr, Image.Find(6));
+
+	std::vector<std::uint32_t> ProductIDs;
+	Image.VisitInstruments([&ProductIDs](const InstrumentRecord & iRecord) { ProductIDs.push_back(iRecord.ProductID); });
+	EXPECT_EQ((std::vector<std::uint32_t>{ 1, 2, 5 }), ProductIDs);
+
+	std::remove(ImagePath.c_str());
+}
+
+TEST_F(InstrumentManagerTest, Should_corrupted_instrument_image_be_refused)
+{
+	const std::string ImagePath = "/tmp/InstrumentImage.bin";
+
+	ASSERT_TRUE(ReferenceDataImage::Export(ImagePath, { { "Michelin", "ISINMICH", "EUR", 1, 1254_price } }, 0));
+	{
+		// Flip one byte of the string table
+		std::fstream Stream(ImagePath, std::ios::binary | std::ios::in | std::ios::out);
+		Stream.seekp(-2, std::ios::end);
+		Stream.put('X');
+	}
+
+	ReferenceDataImage Image(ImagePath);
+	ASSERT_TRUE(Image.IsOpen());
+	ASSERT_FALSE(Image.IsValid());
+
+	// String table larger than the records and the strings together
+	ASSERT_TRUE(ReferenceDataImage::Export(ImagePath, { { "Michelin", "ISINMICH", "EUR", 1, 1254_price } }, 0));
+	{
+		std::fstream Stream(ImagePath, std::ios::binary | std::ios::in | std::ios::out);
+		Stream.seekg(0, std::ios::end);
+		const std::uint64_t StringTableSize = static_cast<std::uint64_t>(Stream.tellg()) - 1;
+		Stream.seekp(offsetof(ReferenceDataHeader, StringTableSize));
+		Stream.write(reinterpret_cast<const char*>(&StringTableSize), sizeof(StringTableSize));
+	}
+	ASSERT_FALSE(ReferenceDataImage(ImagePath).IsValid());
+
+	// Product IDs must be dense enough to be indexed directly
+	ASSERT_FALSE(ReferenceDataImage::Export(ImagePath, { { "Michelin", "ISINMICH", "EUR", 1, 1254_price }, { "IBM", "ISINIBM", "USD", 1000, 1256_price } }, 0));
+
+	std::remove(ImagePath.c_str());
+}
+
+TEST_F(InstrumentManagerTest, Should_database_fingerprint_change_with_every_write)
+{
+	const std::string ImagePath = "/tmp/InstrumentImage.bin";
+
+	InstrumentManager<Order> InstrMgr(m_DBFilePath);
+	ASSERT_TRUE(InstrMgr.Write({ "Michelin", "ISINMICH", "EUR", 1, 1254_price }, key_extractor));
+
+	const auto Fingerprint = ReferenceDataImage::GetDatabaseFingerprint(m_DBFilePath);
+	EXPECT_EQ(Fingerprint, ReferenceDataImage::GetDatabaseFingerprint(m_DBFilePath));
+
+	ASSERT_TRUE(ReferenceDataImage::Export(ImagePath, { { "Michelin", "ISINMICH", "EUR", 1, 1254_price } }, Fingerprint));
+	EXPECT_EQ(Fingerprint, ReferenceDataImage(ImagePath).GetDatabaseFingerprint());
+
+	ASSERT_TRUE(InstrMgr.Write({ "Natixis", "ISINATIX", "EUR", 2, 1255_price }, key_extractor));
+	EXPECT_NE(Fingerprint, ReferenceDataImage::GetDatabaseFingerprint(m_DBFilePath));
+
+	EXPECT_EQ(0u, ReferenceDataImage::GetDatabaseFingerprint("/nonexistent/directory"));
+
+	std::remove(ImagePath.c_str());
+}
+
+TEST_F(InstrumentManagerTest, Should_quiet_writes_return_the_failure_reason)
+{
+	std::vector<Instrument<Order> > Instruments{ { "Michelin", "ISINMICH", "EUR", 1, 1254_price } };
+
+	std::string Error;
+	InstrumentManager<Order> InstrMgr(m_DBFilePath);
+	ASSERT_TRUE(InstrMgr.WriteBatch(Instruments.begin(), Instruments.end(), key_extractor, true, Error));
+	EXPECT_TRUE(Error.empty());
+
+	ASSERT_FALSE(ReferenceDataImage::Export("/nonexistent/directory/InstrumentImage.bin", Instruments, 0, Error));
+	EXPECT_NE(std::string::npos, Error.find("Unable to create"));
+}
+
 int main(int argc, char ** argv)
 {
 	auto & Logger = LoggerHolder::GetInstance();
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ini_parser.hpp>
+
+#include <Engine_Journal.h>
+#include <Logger.h>
+
+using namespace exchange::engine;
+
+namespace
+{
+    const std::string JournalFile = "test_journal_records.bin";
+
+    OrderFlowRecord MakeRecord(std::uint32_t iOrderID)
+    {
+        return MakeDeleteRecord(ClientOrderID(iOrderID), 5_clientid, OrderWay::BUY, 1);
+    }
+
+    std::uint64_t ReadAll(JournalReader & rReader)
+    {
+        std::uint64_t Count = 0;
+        OrderFlowRecord Record;
+        while (rReader.Next(Record))
+        {
+            EXPECT_EQ(++Count, Record.OrderID);
+        }
+        return Count;
+    }
+}
+
+TEST(JournalTest, Should_appended_records_be_read_back_in_sequence)
+{
+    std::remove(JournalFile.c_str());
+    {
+        JournalWriter Writer(JournalFile, 1, 0);
+        ASSERT_TRUE(Writer.IsOpen());
+
+        for (std::uint32_t i = 1; i <= 10000; ++i)
+        {
+            ASSERT_EQ(i, Writer.Append(MakeRecord(i)));
+        }
+        Writer.Sync();
+
+        ASSERT_EQ(10000u, Writer.GetDurableSequence());
+        ASSERT_FALSE(Writer.HasFailed());
+        // Group commit : far fewer syncs than records
+        ASSERT_LT(Writer.GetGroupCommitCounter(), 10000u);
+    }
+
+    JournalReader Reader(JournalFile);
+    ASSERT_TRUE(Reader.IsValid());
+    ASSERT_EQ(10000u, ReadAll(Reader));
+    ASSERT_EQ(10000u, Reader.GetLastSequence());
+    ASSERT_FALSE(Reader.HasCorruptedTail());
+
+    std::remove(JournalFile.c_str());
+}
+
+TEST(JournalTest, Should_torn_and_corrupted_tails_be_dropped)
+{
+    std::remove(JournalFile.c_str());
+    {
+        JournalWriter Writer(JournalFile, 1, 0);
+        for (std::uint32_t i = 1; i <= 100; ++i)
+        {
+            Writer.Append(MakeRecord(i));
+        }
+    }
+
+    std::uint64_t ValidSize = 0;
+    {
+        // Half written record
+        std::ofstream Stream(JournalFile, std::ios::binary | std::ios::app);
+        Stream.write("torn", 4);
+    }
+    {
+        JournalReader Reader(JournalFile);
+        ASSERT_EQ(100u, ReadAll(Reader));
+        ASSERT_TRUE(Reader.HasCorruptedTail());
+        ValidSize = Reader.GetValidSize();
+    }
+
+    // The writer resumes after the last valid record
+    {
+        JournalWriter Writer(JournalFile, 101, ValidSize);
+        ASSERT_TRUE(Writer.IsOpen());
+        Writer.Append(MakeRecord(101));
+    }
+    {
+        // Flip one byte of the last record
+        std::fstream Stream(JournalFile, std::ios::binary | std::ios::in | std::ios::out);
+        Stream.seekp(static_cast<std::streamoff>(ValidSize + 20));
+        Stream.put('X');
+    }
+
+    JournalReader Reader(JournalFile);
+    ASSERT_EQ(100u, ReadAll(Reader));
+    ASSERT_TRUE(Reader.HasCorruptedTail());
+    ASSERT_EQ(ValidSize, Reader.GetValidSize());
+
+    std::remove(JournalFile.c_str());
+}
+
+int main(int argc, char ** argv)
+{
+    auto & Logger = LoggerHolder::GetInstance();
+
+    if (boost::filesystem::exists("config.ini"))
+    {
+        boost::property_tree::ptree aConfig;
+
+        boost::property_tree::ini_parser::read_ini("config.ini", aConfig);
+        Logger.Init(aConfig);
+    }
+
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,296 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ini_parser.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <Engine_MarketData.h>
+#include <Engine_Order.h>
+#include <Logger.h>
+
+using namespace exchange::engine;
+
+namespace
+{
+    template <typename Predicate>
+    bool WaitFor(Predicate iPredicate)
+    {
+        const auto Deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!iPredicate())
+        {
+            if (std::chrono::steady_clock::now() > Deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    MarketDataEvent MakeLevel(std::uint32_t iProductID, OrderWay iWay, std::uint32_t iPrice, std::int64_t iQuantity, std::int32_t iOrders)
+    {
+        MarketDataEvent Event;
+        Event.ProductID = iProductID;
+        Event.Type      = MarketDataEventType::LEVEL;
+        Event.Way       = static_cast<std::uint8_t>(iWay);
+        Event.Price     = iPrice;
+        Event.Quantity  = iQuantity;
+        Event.Orders    = iOrders;
+        return Event;
+    }
+
+    /* Blocking client of the feed */
+    class FeedSubscriber
+    {
+        public:
+
+            explicit FeedSubscriber(std::uint16_t iPort)
+            {
+                m_Fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+                timeval Timeout { 5, 0 };
+                ::setsockopt(m_Fd, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+
+                sockaddr_in Address;
+                std::memset(&Address, 0, sizeof(Address));
+                Address.sin_family      = AF_INET;
+                Address.sin_port        = htons(iPort);
+                Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                m_Connected = ::connect(m_Fd, reinterpret_cast<sockaddr*>(&Address), sizeof(Address)) == 0;
+            }
+
+            ~FeedSubscriber()
+            {
+                ::close(m_Fd);
+            }
+
+            bool IsConnected() const { return m_Connected; }
+
+            bool Read(MarketDataHeader & oHeader, std::vector<MarketDataUpdate> & oUpdates)
+            {
+                if (!ReadExactly(&oHeader, sizeof(oHeader)))
+                {
+                    return false;
+                }
+                oUpdates.resize(oHeader.Updates);
+                return ReadExactly(oUpdates.data(), oUpdates.size() * sizeof(MarketDataUpdate));
+            }
+
+            /* Messages of the snapshot, without its end marker */
+            bool ReadSnapshot(std::vector<std::pair<MarketDataHeader, std::vector<MarketDataUpdate> > > & oMessages)
+            {
+                MarketDataHeader Header;
+                std::vector<MarketDataUpdate> Updates;
+                while (Read(Header, Updates))
+                {
+                    if (Header.Flags != MarketDataHeader::SnapshotFlag)
+                    {
+                        return false;
+                    }
+                    if (Header.ProductID == 0 && Header.Updates == 0)
+                    {
+                        return true;
+                    }
+                    oMessages.emplace_back(Header, Updates);
+                }
+                return false;
+            }
+
+        private:
+
+            bool ReadExactly(void * oData, std::size_t iSize)
+            {
+                auto pData = static_cast<char*>(oData);
+                while (iSize > 0)
+                {
+                    const auto Read = ::recv(m_Fd, pData, iSize, 0);
+                    if (Read <= 0)
+                    {
+                        return false;
+                    }
+                    pData += Read;
+                    iSize -= static_cast<std::size_t>(Read);
+                }
+                return true;
+            }
+
+        private:
+            int  m_Fd        = -1;
+            bool m_Connected = false;
+    };
+}
+
+TEST(MarketDataTest, Should_late_subscriber_receive_the_snapshot_then_the_increments)
+{
+    MarketDataPublisher Publisher(0, std::chrono::milliseconds(5));
+    ASSERT_TRUE(Publisher.IsOpen());
+
+    MarketDataEvent Phase;
+    Phase.ProductID = 7;
+    Phase.Type      = MarketDataEventType::PHASE;
+    Phase.Phase     = 1;
+    Publisher.Push(Phase);
+    Publisher.Push(MakeLevel(7, OrderWay::BUY, 100, 10, 1));
+    Publisher.Push(MakeLevel(7, OrderWay::BUY, 100, 5, 1));
+    Publisher.Push(MakeLevel(7, OrderWay::SELL, 105, 7, 1));
+
+    ASSERT_TRUE(WaitFor([&Publisher]() { return Publisher.GetSequence() > 0; }));
+
+    FeedSubscriber Subscriber(Publisher.GetPort());
+    ASSERT_TRUE(Subscriber.IsConnected());
+
+    std::vector<std::pair<MarketDataHeader, std::vector<MarketDataUpdate> > > Snapshot;
+    ASSERT_TRUE(Subscriber.ReadSnapshot(Snapshot));
+    ASSERT_EQ(1u, Snapshot.size());
+
+    const auto SnapshotSequence = Snapshot[0].first.Sequence;
+    ASSERT_EQ(7u, Snapshot[0].first.ProductID);
+
+    const auto & Updates = Snapshot[0].second;
+    ASSERT_EQ(3u, Updates.size());
+    ASSERT_EQ(MarketDataAction::PHASE, Updates[0].Action);
+    ASSERT_EQ(1u, Updates[0].Phase);
+    ASSERT_EQ(MarketDataAction::ADD, Updates[1].Action);
+    ASSERT_EQ(static_cast<std::uint8_t>(OrderWay::BUY), Updates[1].Way);
+    ASSERT_EQ(100u, Updates[1].Price);
+    ASSERT_EQ(2u, Updates[1].Orders);
+    ASSERT_EQ(15u, Updates[1].Quantity);
+    ASSERT_EQ(static_cast<std::uint8_t>(OrderWay::SELL), Updates[2].Way);
+    ASSERT_EQ(7u, Updates[2].Quantity);
+
+    // The next message follows the sequence of the snapshot
+    Publisher.Push(MakeLevel(7, OrderWay::SELL, 105, -7, -1));
+
+    MarketDataHeader Header;
+    std::vector<MarketDataUpdate> Increment;
+    ASSERT_TRUE(Subscriber.Read(Header, Increment));
+    ASSERT_EQ(0u, Header.Flags);
+    ASSERT_EQ(SnapshotSequence + 1, Header.Sequence);
+    ASSERT_EQ(1u, Increment.size());
+    ASSERT_EQ(MarketDataAction::DELETE, Increment[0].Action);
+    ASSERT_EQ(105u, Increment[0].Price);
+}
+
+TEST(MarketDataTest, Should_level_changes_be_conflated_within_an_interval)
+{
+    MarketDataPublisher Publisher(0, std::chrono::milliseconds(20));
+    ASSERT_TRUE(Publisher.IsOpen());
+
+    FeedSubscriber Subscriber(Publisher.GetPort());
+    ASSERT_TRUE(Subscriber.IsConnected());
+
+    std::vector<std::pair<MarketDataHeader, std::vector<MarketDataUpdate> > > Snapshot;
+    ASSERT_TRUE(Subscriber.ReadSnapshot(Snapshot));
+    ASSERT_TRUE(Snapshot.empty());
+
+    const std::int64_t Changes = 10000;
+    Publisher.Push(MakeLevel(3, OrderWay::BUY, 100, 1, 1));
+    for (std::int64_t i = 1; i < Changes; ++i)
+    {
+        Publisher.Push(MakeLevel(3, OrderWay::BUY, 100, 1, 0));
+    }
+
+    MarketDataEvent Trade;
+    Trade.ProductID = 3;
+    Trade.Type      = MarketDataEventType::TRADE;
+    Trade.Price     = 100;
+    Trade.Quantity  = 50;
+    Publisher.Push(Trade);
+
+    // Every message is one interval of the book, gap free
+    std::uint64_t Sequence   = Snapshot.empty() ? 0 : Snapshot.back().first.Sequence;
+    std::size_t   LevelCount = 0;
+    bool          bTraded    = false;
+    MarketDataUpdate Last;
+
+    MarketDataHeader Header;
+    std::vector<MarketDataUpdate> Updates;
+    while (!bTraded && Subscriber.Read(Header, Updates))
+    {
+        ASSERT_EQ(++Sequence, Header.Sequence);
+        ASSERT_EQ(3u, Header.ProductID);
+        for (auto && Update : Updates)
+        {
+            if (Update.Action == MarketDataAction::TRADE)
+            {
+                ASSERT_EQ(50u, Update.Quantity);
+                bTraded = true;
+                continue;
+            }
+            ++LevelCount;
+            Last = Update;
+        }
+    }
+
+    ASSERT_TRUE(bTraded);
+    ASSERT_LT(LevelCount, static_cast<std::size_t>(Changes));
+    ASSERT_EQ(100u, Last.Price);
+    ASSERT_EQ(1u, Last.Orders);
+    ASSERT_EQ(static_cast<std::uint64_t>(Changes), Last.Quantity);
+}
+
+TEST(MarketDataTest, Should_every_subscriber_receive_the_same_messages)
+{
+    MarketDataPublisher Publisher(0, std::chrono::milliseconds(5));
+    ASSERT_TRUE(Publisher.IsOpen());
+
+    std::vector<std::unique_ptr<FeedSubscriber> > Subscribers;
+    for (int i = 0; i < 4; ++i)
+    {
+        Subscribers.push_back(std::make_unique<FeedSubscriber>(Publisher.GetPort()));
+        ASSERT_TRUE(Subscribers.back()->IsConnected());
+    }
+    ASSERT_TRUE(WaitFor([&Publisher]() { return Publisher.GetSubscriberCounter() == 4; }));
+
+    for (auto && pSubscriber : Subscribers)
+    {
+        std::vector<std::pair<MarketDataHeader, std::vector<MarketDataUpdate> > > Snapshot;
+        ASSERT_TRUE(pSubscriber->ReadSnapshot(Snapshot));
+    }
+
+    for (std::uint32_t ProductID = 1; ProductID <= 50; ++ProductID)
+    {
+        Publisher.Push(MakeLevel(ProductID, OrderWay::SELL, 200 + ProductID, ProductID, 1));
+    }
+    ASSERT_TRUE(WaitFor([&Publisher]() { return Publisher.GetSequence() >= 50; }));
+
+    for (auto && pSubscriber : Subscribers)
+    {
+        MarketDataHeader Header;
+        std::vector<MarketDataUpdate> Updates;
+        for (std::uint32_t ProductID = 1; ProductID <= 50; ++ProductID)
+        {
+            ASSERT_TRUE(pSubscriber->Read(Header, Updates));
+            ASSERT_EQ(ProductID, Header.Sequence);
+            ASSERT_EQ(ProductID, Header.ProductID);
+            ASSERT_EQ(1u, Updates.size());
+            ASSERT_EQ(ProductID, Updates[0].Quantity);
+        }
+    }
+    ASSERT_EQ(0u, Publisher.GetSlowSubscriberCounter());
+}
+
+int main(int argc, char ** argv)
+{
+    auto & Logger = LoggerHolder::GetInstance();
+
+    if (boost::filesystem::exists("config.ini"))
+    {
+        boost::property_tree::ptree aConfig;
+
+        boost::property_tree::ini_parser::read_ini("config.ini", aConfig);
+        Logger.Init(aConfig);
+    }
+
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,11 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <fstream>
+
 #include <unistd.h>
 
 #include <Logger.h>
 
 #include <Engine_MatchingEngine.h>
 #include <Engine_Instrument.h>
+#include <Engine_OrderFlow.h>
 
 using namespace exchange::engine;
 
@@ -614,6 +617,665 @@ TEST_F(MatchingEngineTest, Should_close_price_be_saved_when_global_phase_switch_
     ASSERT_EQ(NewClosePrice, Instrument.GetClosePrice());
 }
 
+TEST_F(MatchingEngineTest, Should_close_price_be_saved_in_the_background_when_asynchronous)
+{
+    m_Config.put("Engine.async_close_prices", true);
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+
+    auto pOrderBook = m_pEngine->GetOrderBook(product_id);
+    ASSERT_NE(pOrderBook, nullptr);
+
+    auto NewClosePrice = pOrderBook->GetClosePrice() + 2_price;
+
+    auto ob = CREATE_ORDER(OrderWay::BUY, 1000_qty, NewClosePrice, 1_clorderid, 5_clientid);
+    auto os = CREATE_ORDER(OrderWay::SELL, 1000_qty, NewClosePrice, 1_clorderid, 6_clientid);
+
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CLOSING_AUCTION));
+
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, os, product_id));
+
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CLOSE));
+
+    // Polled by the engine loop, the outcome is collected once
+    const auto Deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!m_pEngine->PollClosePrices())
+    {
+        ASSERT_LT(std::chrono::steady_clock::now(), Deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(m_pEngine->PollClosePrices());
+
+    std::string  InstrumentDBPath = m_Config.get<std::string>("Engine.instrument_db_path");
+    InstrumentManager<Order> InstrMgr(InstrumentDBPath);
+
+    Instrument<Order> Instrument;
+    ASSERT_TRUE(InstrMgr.Get(pOrderBook->GetSecurityName(), Instrument));
+
+    ASSERT_EQ(NewClosePrice, Instrument.GetClosePrice());
+    ASSERT_EQ(1u, Instrument.GetPeakDeals());
+}
+
+TEST_F(MatchingEngineTest, Should_books_be_loaded_from_the_instrument_image_once_exported)
+{
+    const std::string ImagePath = "test_instrument_image.bin";
+    std::remove(ImagePath.c_str());
+    m_Config.put("Engine.instrument_image_path", ImagePath);
+
+    // First startup : read from the database, the image is exported
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    ASSERT_NE(nullptr, m_pEngine->GetReferenceData());
+
+    auto pOrderBook = m_pEngine->GetOrderBook(product_id);
+    ASSERT_NE(pOrderBook, nullptr);
+    auto NewClosePrice = pOrderBook->GetClosePrice() + 3_price;
+
+    auto ob = CREATE_ORDER(OrderWay::BUY, 1000_qty, NewClosePrice, 1_clorderid, 5_clientid);
+    auto os = CREATE_ORDER(OrderWay::SELL, 1000_qty, NewClosePrice, 1_clorderid, 6_clientid);
+
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CLOSING_AUCTION));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, os, product_id));
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CLOSE));
+
+    // Next startup : mapped image, exported again at the close
+    m_pEngine.reset(new engine_type());
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+
+    auto pImage = m_pEngine->GetReferenceData();
+    ASSERT_NE(nullptr, pImage);
+    ASSERT_EQ(3u, pImage->GetInstrumentCount());
+
+    auto pRecord = pImage->Find(product_id);
+    ASSERT_NE(nullptr, pRecord);
+    EXPECT_STREQ("Michelin", pImage->GetString(pRecord->Name));
+    EXPECT_EQ(static_cast<std::uint32_t>(NewClosePrice), pRecord->ClosePrice);
+
+    pOrderBook = m_pEngine->GetOrderBook(product_id);
+    ASSERT_NE(pOrderBook, nullptr);
+    EXPECT_EQ(NewClosePrice, pOrderBook->GetClosePrice());
+    EXPECT_EQ(1u, pOrderBook->GetPreviousPeakDeals());
+
+    // An instrument added to the database after the export is not hidden by the image
+    m_pEngine.reset(new engine_type());
+    {
+        InstrumentManager<Order> InstrMgr(m_Config.get<std::string>("Engine.instrument_db_path"));
+        Instrument<Order> Total{ "Total", "ISINTOTA", "EUR", 4, 1257_price };
+        ASSERT_TRUE(InstrMgr.Write(Total, [](const Instrument<Order> & Instrument) -> const std::string & { return Instrument.GetName(); }, true));
+    }
+
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    ASSERT_NE(nullptr, m_pEngine->GetOrderBook(4));
+    EXPECT_EQ(NewClosePrice, m_pEngine->GetOrderBook(product_id)->GetClosePrice());
+
+    // Exported again from the database
+    pImage = m_pEngine->GetReferenceData();
+    ASSERT_NE(nullptr, pImage);
+    EXPECT_EQ(4u, pImage->GetInstrumentCount());
+
+    // The next tests list the three instruments of the fixture only
+    m_pEngine.reset();
+    boost::filesystem::remove_all(m_Config.get<std::string>("Engine.instrument_db_path"));
+    std::remove(ImagePath.c_str());
+}
+
+TEST_F(MatchingEngineTest, Should_warm_up_size_the_books_from_the_peaks_saved_at_close)
+{
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+
+    auto pOrderBook = m_pEngine->GetOrderBook(product_id);
+    ASSERT_NE(pOrderBook, nullptr);
+
+    auto ClosePrice = pOrderBook->GetClosePrice();
+
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CLOSING_AUCTION));
+
+    auto ob1 = CREATE_ORDER(OrderWay::BUY, 1000_qty, ClosePrice, 1_clorderid, 5_clientid);
+    auto os1 = CREATE_ORDER(OrderWay::SELL, 1000_qty, ClosePrice, 2_clorderid, 6_clientid);
+    auto ob2 = CREATE_ORDER(OrderWay::BUY, 10_qty, ClosePrice - 1_price, 3_clorderid, 5_clientid);
+    auto os2 = CREATE_ORDER(OrderWay::SELL, 10_qty, ClosePrice + 1_price, 4_clorderid, 6_clientid);
+
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob1, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, os1, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob2, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, os2, product_id));
+
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CLOSE));
+
+    ASSERT_EQ(4u, pOrderBook->GetPeakOrders());
+    ASSERT_EQ(1u, pOrderBook->GetDealCounter());
+
+    // Next day
+    m_Config.put("Engine.warmup", true);
+    m_Config.put("Engine.warmup_iterations", 100);
+
+    std::uint64_t ObservedDeals = 0;
+    m_pEngine.reset(new engine_type());
+    m_pEngine->SetDealListener([&ObservedDeals](std::uint32_t, const Deal &) { ++ObservedDeals; });
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+
+    pOrderBook = m_pEngine->GetOrderBook(product_id);
+    ASSERT_NE(pOrderBook, nullptr);
+    ASSERT_EQ(4u, pOrderBook->GetPreviousPeakOrders());
+    ASSERT_EQ(1u, pOrderBook->GetPreviousPeakDeals());
+    ASSERT_TRUE(pOrderBook->IsMaterialized());
+
+    // A book which did not trade is not sized
+    ASSERT_NE(nullptr, m_pEngine->GetOrderBook(2));
+    ASSERT_EQ(0u, m_pEngine->GetOrderBook(2)->GetPreviousPeakOrders());
+    ASSERT_FALSE(m_pEngine->GetOrderBook(2)->IsMaterialized());
+
+    // The synthetic flow never reaches the loaded books nor the deal observer
+    ASSERT_EQ(0u, ObservedDeals);
+    ASSERT_EQ(0u, pOrderBook->GetDealCounter());
+    ASSERT_EQ(0u, pOrderBook->GetCounters().Inserts);
+    ASSERT_EQ(TradingPhase::CLOSE, pOrderBook->GetTradingPhase());
+}
+
+TEST_F(MatchingEngineTest, Should_batch_be_applied_per_product_in_arrival_order)
+{
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    std::vector<std::pair<std::uint32_t, Deal::client_id_type> > Deals;
+    m_pEngine->SetDealListener([&Deals](std::uint32_t iProductID, const Deal & iDeal)
+    {
+        Deals.emplace_back(iProductID, iDeal.GetSellerClientID());
+    });
+
+    engine_type::CommandBatch Commands;
+    Commands.push_back(OrderCommand::MakeInsert(CREATE_ORDER(OrderWay::BUY, 1000_qty, 1254_price, 1_clorderid, 5_clientid), 1));
+    Commands.push_back(OrderCommand::MakeInsert(CREATE_ORDER(OrderWay::BUY, 100_qty, 1255_price, 2_clorderid, 5_clientid), 2));
+    Commands.push_back(OrderCommand::MakeInsert(CREATE_ORDER(OrderWay::SELL, 100_qty, 1255_price, 3_clorderid, 6_clientid), 99));
+    Commands.push_back(OrderCommand::MakeInsert(CREATE_ORDER(OrderWay::SELL, 0_qty, 1254_price, 4_clorderid, 6_clientid), 1));
+    Commands.push_back(OrderCommand::MakeInsert(CREATE_ORDER(OrderWay::SELL, 100_qty, 1255_price, 5_clorderid, 6_clientid), 2));
+    Commands.push_back(OrderCommand::MakeImmediateInsert(OrderType::LIMIT, OrderWay::SELL, 400_qty, 1254_price, 6_clorderid, 7_clientid, TimeQualifier::IOC, 1));
+    Commands.push_back(OrderCommand::MakeDelete(1_clorderid, 5_clientid, OrderWay::BUY, 1));
+
+    std::vector<Status> Statuses;
+    m_pEngine->ProcessBatch(Commands, Statuses);
+
+    ASSERT_EQ(Commands.size(), Statuses.size());
+    EXPECT_EQ(Status::Ok, Statuses[0]);
+    EXPECT_EQ(Status::Ok, Statuses[1]);
+    EXPECT_EQ(Status::InstrumentNotFound, Statuses[2]);
+    EXPECT_EQ(Status::InvalidQuantity, Statuses[3]);
+    EXPECT_EQ(Status::Ok, Statuses[4]);
+    EXPECT_EQ(Status::Ok, Statuses[5]);
+    EXPECT_EQ(Status::Ok, Statuses[6]);
+
+    // Books are processed one after the other, the IOC hits the bid before it is deleted
+    ASSERT_EQ(2u, Deals.size());
+    EXPECT_EQ(1u, Deals[0].first);
+    EXPECT_EQ(7_clientid, Deals[0].second);
+    EXPECT_EQ(2u, Deals[1].first);
+    EXPECT_EQ(6_clientid, Deals[1].second);
+
+    auto pOrderBook = m_pEngine->GetOrderBook(1);
+    ASSERT_NE(pOrderBook, nullptr);
+    EXPECT_EQ(1, pOrderBook->GetDealCounter());
+    EXPECT_EQ(Status::OrderNotFound, m_pEngine->Delete(1_clorderid, 5_clientid, OrderWay::BUY, 1));
+}
+
+TEST_F(MatchingEngineTest, Should_books_be_recovered_from_the_journal_after_a_restart)
+{
+    const std::string JournalFile = "test_journal.bin";
+    boost::filesystem::remove(JournalFile);
+    m_Config.put("Engine.journal_path", JournalFile);
+
+    // Book state which must survive the restart, the reject counters are not journaled
+    const auto GetState = [](const engine_type & iEngine, std::uint32_t iProductID)
+    {
+        OrderBookMetrics Metrics;
+        iEngine.GetOrderBook(iProductID)->FillMetrics(Metrics);
+        return std::make_tuple(Metrics.Phase, Metrics.Deals, Metrics.Turnover, Metrics.DailyVolume, Metrics.LastPrice,
+                               Metrics.BidOrders, Metrics.AskOrders, Metrics.BidLevels, Metrics.AskLevels);
+    };
+
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    ASSERT_NE(nullptr, m_pEngine->GetJournal());
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    const auto ClosePrice = m_pEngine->GetOrderBook(product_id)->GetClosePrice();
+
+    auto ob = CREATE_ORDER(OrderWay::BUY, 1000_qty, ClosePrice, 1_clorderid, 5_clientid);
+    auto os = CREATE_ORDER(OrderWay::SELL, 400_qty, ClosePrice, 2_clorderid, 6_clientid);
+    auto oa = CREATE_ORDER(OrderWay::SELL, 300_qty, ClosePrice + 2_price, 3_clorderid, 7_clientid);
+    auto oz = CREATE_ORDER(OrderWay::SELL, 0_qty, ClosePrice + 2_price, 9_clorderid, 7_clientid);
+    auto rp = CREATE_REPLACE(OrderWay::SELL, 300_qty, ClosePrice + 3_price, 3_clorderid, 4_clorderid, 7_clientid);
+    auto o2 = CREATE_ORDER(OrderWay::BUY, 100_qty, m_pEngine->GetOrderBook(2)->GetClosePrice(), 1_clorderid, 5_clientid);
+
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, os, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, oa, product_id));
+    ASSERT_EQ(Status::InvalidQuantity, INSERT_ORDER(m_pEngine, oz, product_id));
+    ASSERT_EQ(Status::Ok, MODIFY_ORDER(m_pEngine, rp, product_id));
+    ASSERT_EQ(Status::OrderNotFound, m_pEngine->Delete(3_clorderid, 7_clientid, OrderWay::SELL, product_id));
+    ASSERT_EQ(Status::Ok, m_pEngine->ImmediateInsert(OrderType::LIMIT, OrderWay::BUY, 100_qty, ClosePrice + 3_price, 5_clorderid, 8_clientid,
+                                                     TimeQualifier::IOC, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, o2, 2));
+
+    m_pEngine->GetJournal()->Sync();
+    ASSERT_EQ(7u, m_pEngine->GetJournal()->GetDurableSequence());
+
+    const auto State  = GetState(*m_pEngine, product_id);
+    const auto State2 = GetState(*m_pEngine, 2);
+    ASSERT_EQ(2u, std::get<1>(State));
+
+    // Restart : the books are rebuilt from the journal only, their deals are not published again
+    std::uint64_t ObservedDeals = 0;
+    m_pEngine.reset(new engine_type());
+    m_pEngine->SetDealListener([&ObservedDeals](std::uint32_t, const Deal &) { ++ObservedDeals; });
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+
+    EXPECT_EQ(0u, ObservedDeals);
+    EXPECT_EQ(TradingPhase::CONTINUOUS_TRADING, m_pEngine->GetGlobalPhase());
+    EXPECT_EQ(State, GetState(*m_pEngine, product_id));
+    EXPECT_EQ(State2, GetState(*m_pEngine, 2));
+
+    // The recovered orders are live and the journal goes on after the recovered sequence
+    ASSERT_EQ(Status::Ok, m_pEngine->Delete(1_clorderid, 5_clientid, OrderWay::BUY, product_id));
+    m_pEngine->GetJournal()->Sync();
+    EXPECT_EQ(8u, m_pEngine->GetJournal()->GetDurableSequence());
+
+    m_pEngine.reset(new engine_type());
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    EXPECT_EQ(Status::OrderNotFound, m_pEngine->Delete(1_clorderid, 5_clientid, OrderWay::BUY, product_id));
+
+    m_pEngine.reset();
+    boost::filesystem::remove(JournalFile);
+}
+
+TEST_F(MatchingEngineTest, Should_duplicate_order_ID_be_rejected_before_matching_and_recovered_from_the_journal)
+{
+    const std::string JournalFile = "test_duplicate_journal.bin";
+    boost::filesystem::remove(JournalFile);
+    m_Config.put("Engine.journal_path", JournalFile);
+
+    const auto GetState = [](const engine_type & iEngine, std::uint32_t iProductID)
+    {
+        OrderBookMetrics Metrics;
+        iEngine.GetOrderBook(iProductID)->FillMetrics(Metrics);
+        return std::make_tuple(Metrics.Deals, Metrics.Turnover, Metrics.DailyVolume, Metrics.BidOrders, Metrics.AskOrders);
+    };
+
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    const auto ClosePrice = m_pEngine->GetOrderBook(product_id)->GetClosePrice();
+
+    auto ob = CREATE_ORDER(OrderWay::BUY, 100_qty, ClosePrice - 1_price, 1_clorderid, 5_clientid);
+    auto os = CREATE_ORDER(OrderWay::SELL, 300_qty, ClosePrice, 2_clorderid, 6_clientid);
+    auto od = CREATE_ORDER(OrderWay::BUY, 400_qty, ClosePrice, 1_clorderid, 5_clientid);
+
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, os, product_id));
+
+    // The aggressive order would trade the whole ask before its rest is found to be a duplicate
+    ASSERT_EQ(Status::DuplicateOrderID, INSERT_ORDER(m_pEngine, od, product_id));
+
+    m_pEngine->GetJournal()->Sync();
+    ASSERT_EQ(3u, m_pEngine->GetJournal()->GetDurableSequence());
+
+    const auto State = GetState(*m_pEngine, product_id);
+    ASSERT_EQ(0u, std::get<0>(State));
+    ASSERT_EQ(0u, std::get<2>(State));
+    ASSERT_EQ(1u, std::get<3>(State));
+    ASSERT_EQ(1u, std::get<4>(State));
+
+    // Crash and restart : the journal holds everything which changed the book
+    m_pEngine.reset(new engine_type());
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    EXPECT_EQ(State, GetState(*m_pEngine, product_id));
+
+    m_pEngine.reset();
+    boost::filesystem::remove(JournalFile);
+}
+
+TEST_F(MatchingEngineTest, Should_books_be_recovered_from_a_snapshot_and_the_journal_tail)
+{
+    const std::string JournalFile  = "test_snapshot_journal.bin";
+    const std::string SnapshotFile = "test_snapshot.bin";
+    boost::filesystem::remove(JournalFile);
+    boost::filesystem::remove(SnapshotFile);
+    m_Config.put("Engine.journal_path", JournalFile);
+    m_Config.put("Engine.snapshot_path", SnapshotFile);
+
+    // The deal counters are daily statistics which are not part of the snapshot
+    const auto GetState = [](const engine_type & iEngine, std::uint32_t iProductID)
+    {
+        OrderBookMetrics Metrics;
+        iEngine.GetOrderBook(iProductID)->FillMetrics(Metrics);
+        return std::make_tuple(Metrics.Phase, Metrics.Turnover, Metrics.DailyVolume, Metrics.LastPrice,
+                               Metrics.BidOrders, Metrics.AskOrders, Metrics.BidLevels, Metrics.AskLevels);
+    };
+
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    ASSERT_NE(nullptr, m_pEngine->GetSnapshotWriter());
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    const auto ClosePrice = m_pEngine->GetOrderBook(product_id)->GetClosePrice();
+
+    auto o1 = CREATE_ORDER(OrderWay::BUY, 1000_qty, ClosePrice, 1_clorderid, 5_clientid);
+    auto o2 = CREATE_ORDER(OrderWay::SELL, 400_qty, ClosePrice, 2_clorderid, 6_clientid);
+    auto o3 = CREATE_ORDER(OrderWay::BUY, 200_qty, ClosePrice, 3_clorderid, 7_clientid);
+    auto o4 = CREATE_ORDER(OrderWay::SELL, 300_qty, ClosePrice + 2_price, 4_clorderid, 8_clientid);
+    auto ob = CREATE_ORDER(OrderWay::BUY, 100_qty, m_pEngine->GetOrderBook(2)->GetClosePrice(), 1_clorderid, 5_clientid);
+
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, o1, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, o2, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, o3, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, o4, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob, 2));
+
+    // Phase and 5 inserts
+    ASSERT_TRUE(m_pEngine->TakeSnapshot());
+    m_pEngine->GetSnapshotWriter()->Wait();
+    ASSERT_EQ(6u, m_pEngine->GetSnapshotWriter()->GetLastSequence());
+
+    // Journal tail
+    auto o5 = CREATE_ORDER(OrderWay::BUY, 100_qty, ClosePrice - 1_price, 5_clorderid, 9_clientid);
+    ASSERT_EQ(Status::Ok, m_pEngine->Delete(4_clorderid, 8_clientid, OrderWay::SELL, product_id));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, o5, product_id));
+    m_pEngine->GetJournal()->Sync();
+
+    const auto State  = GetState(*m_pEngine, product_id);
+    const auto State2 = GetState(*m_pEngine, 2);
+
+    std::vector<std::uint32_t> Buyers;
+    m_pEngine.reset(new engine_type());
+    m_pEngine->SetDealListener([&Buyers](std::uint32_t, const Deal & iDeal) { Buyers.push_back(static_cast<std::uint32_t>(iDeal.GetBuyerOrderID())); });
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+
+    EXPECT_TRUE(Buyers.empty());
+    EXPECT_EQ(TradingPhase::CONTINUOUS_TRADING, m_pEngine->GetGlobalPhase());
+    EXPECT_EQ(State, GetState(*m_pEngine, product_id));
+    EXPECT_EQ(State2, GetState(*m_pEngine, 2));
+    // Only the tail is replayed
+    EXPECT_EQ(1u, m_pEngine->GetOrderBook(product_id)->GetCounters().Inserts);
+    EXPECT_EQ(1u, m_pEngine->GetOrderBook(product_id)->GetCounters().Deletes);
+
+    // The restored orders keep their time priority and their executed quantity
+    auto o6 = CREATE_ORDER(OrderWay::SELL, 700_qty, ClosePrice, 6_clorderid, 10_clientid);
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, o6, product_id));
+    EXPECT_EQ(std::vector<std::uint32_t>({ 1, 3 }), Buyers);
+    EXPECT_EQ(Status::OrderNotFound, m_pEngine->Delete(1_clorderid, 5_clientid, OrderWay::BUY, product_id));
+    m_pEngine->GetJournal()->Sync();
+
+    const auto FinalState = GetState(*m_pEngine, product_id);
+
+    {
+        // A damaged snapshot is ignored, the whole journal is replayed
+        std::fstream Stream(SnapshotFile, std::ios::binary | std::ios::in | std::ios::out);
+        Stream.seekp(static_cast<std::streamoff>(sizeof(SnapshotHeader) + 8));
+        Stream.put('X');
+    }
+
+    m_pEngine.reset(new engine_type());
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    EXPECT_EQ(FinalState, GetState(*m_pEngine, product_id));
+    EXPECT_EQ(6u, m_pEngine->GetOrderBook(product_id)->GetCounters().Inserts);
+
+    m_pEngine.reset();
+    boost::filesystem::remove(JournalFile);
+    boost::filesystem::remove(SnapshotFile);
+}
+
+TEST_F(MatchingEngineTest, Should_captured_order_flow_be_read_back_unchanged)
+{
+    const std::string CaptureFile = "test_capture.bin";
+
+    {
+        OrderFlowRecorder Recorder(CaptureFile);
+        ASSERT_TRUE(Recorder.IsOpen());
+
+        Recorder.RecordPhase(TradingPhase::CONTINUOUS_TRADING);
+        Recorder.RecordInsert(Order(OrderWay::BUY, 1000_qty, 1250_price, 1_clorderid, 5_clientid), product_id);
+        Recorder.RecordImmediateInsert(OrderType::MARKET, OrderWay::SELL, 10_qty, 0_price, 2_clorderid, 6_clientid, TimeQualifier::FOK, product_id);
+        Recorder.RecordModify(OrderReplace(OrderWay::BUY, 800_qty, 1251_price, 1_clorderid, 3_clorderid, 5_clientid), product_id);
+        Recorder.RecordDelete(3_clorderid, 5_clientid, OrderWay::BUY, product_id);
+
+        ASSERT_EQ(5u, Recorder.GetRecordCounter());
+    }
+
+    OrderFlowReader Reader(CaptureFile);
+    ASSERT_TRUE(Reader.IsValid());
+
+    std::vector<OrderFlowRecord> Records;
+    OrderFlowRecord Record;
+    while (Reader.Next(Record))
+    {
+        Records.push_back(Record);
+    }
+
+    ASSERT_EQ(5u, Records.size());
+
+    EXPECT_EQ(static_cast<std::uint8_t>(OrderFlowCommand::PHASE), Records[0].Command);
+    EXPECT_EQ(static_cast<std::uint8_t>(TradingPhase::CONTINUOUS_TRADING), Records[0].Type);
+
+    EXPECT_EQ(static_cast<std::uint8_t>(OrderFlowCommand::INSERT), Records[1].Command);
+    EXPECT_EQ(1u, Records[1].ProductID);
+    EXPECT_EQ(1000u, Records[1].Quantity);
+    EXPECT_EQ(1250u, Records[1].Price);
+    EXPECT_EQ(5u, Records[1].ClientID);
+
+    EXPECT_EQ(static_cast<std::uint8_t>(OrderFlowCommand::IMMEDIATE_INSERT), Records[2].Command);
+    EXPECT_EQ(static_cast<std::uint8_t>(OrderType::MARKET), Records[2].Type);
+    EXPECT_EQ(static_cast<std::uint8_t>(TimeQualifier::FOK), Records[2].Qualifier);
+
+    EXPECT_EQ(static_cast<std::uint8_t>(OrderFlowCommand::MODIFY), Records[3].Command);
+    EXPECT_EQ(1u, Records[3].OrderID);
+    EXPECT_EQ(3u, Records[3].NewOrderID);
+
+    EXPECT_EQ(static_cast<std::uint8_t>(OrderFlowCommand::DELETE), Records[4].Command);
+    EXPECT_EQ(static_cast<std::uint8_t>(OrderWay::BUY), Records[4].Way);
+
+    for (size_t i = 1; i < Records.size(); ++i)
+    {
+        EXPECT_LE(Records[i-1].Timestamp, Records[i].Timestamp);
+    }
+
+    boost::filesystem::remove(CaptureFile);
+}
+
+TEST_F(MatchingEngineTest, Should_replay_of_a_capture_produce_the_same_deal_stream)
+{
+    const std::string CaptureFile = "test_capture.bin";
+
+    {
+        OrderFlowRecorder Recorder(CaptureFile);
+        ASSERT_TRUE(Recorder.IsOpen());
+
+        Recorder.RecordPhase(TradingPhase::OPENING_AUCTION);
+        Recorder.RecordInsert(Order(OrderWay::BUY, 1000_qty, 1256_price, 1_clorderid, 5_clientid), product_id);
+        Recorder.RecordInsert(Order(OrderWay::SELL, 600_qty, 1254_price, 2_clorderid, 6_clientid), product_id);
+        Recorder.RecordPhase(TradingPhase::CONTINUOUS_TRADING);
+        Recorder.RecordInsert(Order(OrderWay::SELL, 200_qty, 1255_price, 3_clorderid, 7_clientid), product_id);
+        Recorder.RecordInsert(Order(OrderWay::SELL, 500_qty, 1258_price, 4_clorderid, 7_clientid), product_id);
+        Recorder.RecordModify(OrderReplace(OrderWay::SELL, 500_qty, 1257_price, 4_clorderid, 5_clorderid, 7_clientid), product_id);
+        Recorder.RecordImmediateInsert(OrderType::LIMIT, OrderWay::BUY, 300_qty, 1257_price, 6_clorderid, 8_clientid, TimeQualifier::IOC, product_id);
+        Recorder.RecordDelete(5_clorderid, 7_clientid, OrderWay::SELL, product_id);
+    }
+
+    const auto Replay = [&CaptureFile](engine_type & rEngine, std::vector<DealRecord> & oDeals)
+    {
+        rEngine.SetDealListener([&oDeals](std::uint32_t iProductID, const Deal & iDeal)
+        {
+            oDeals.push_back(MakeDealRecord(iProductID, iDeal));
+        });
+
+        OrderFlowReader Reader(CaptureFile);
+        ASSERT_TRUE(Reader.IsValid());
+
+        OrderFlowRecord Record;
+        while (Reader.Next(Record))
+        {
+            EXPECT_EQ(Status::Ok, ReplayRecord(rEngine, Record));
+        }
+    };
+
+    std::vector<DealRecord> ReferenceDeals;
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    Replay(*m_pEngine, ReferenceDeals);
+
+    std::vector<DealRecord> Deals;
+    engine_type Engine;
+    ASSERT_TRUE(Engine.Configure(m_Config));
+    Replay(Engine, Deals);
+
+    // Opening uncross of 600, the sell hitting the remaining bid @ 1256 and the IOC executing the modified order @ 1257
+    ASSERT_EQ(3u, ReferenceDeals.size());
+    EXPECT_EQ(1256u, ReferenceDeals[1].Price);
+    EXPECT_EQ(300u, ReferenceDeals[2].Quantity);
+    EXPECT_EQ(5u, ReferenceDeals[2].SellerOrderID);
+
+    ASSERT_EQ(ReferenceDeals.size(), Deals.size());
+    ASSERT_EQ(0, std::memcmp(ReferenceDeals.data(), Deals.data(), Deals.size() * sizeof(DealRecord)));
+
+    boost::filesystem::remove(CaptureFile);
+}
+
+TEST_F(MatchingEngineTest, Should_parallel_uncross_publish_the_sequential_deals_in_product_order)
+{
+    const auto Uncross = [this](unsigned iThreads, std::vector<DealRecord> & oDeals)
+    {
+        m_Config.put("Engine.uncross_threads", iThreads);
+        m_pEngine.reset(new engine_type());
+        ASSERT_TRUE(m_pEngine->Configure(m_Config));
+        ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::OPENING_AUCTION));
+
+        m_pEngine->SetDealListener([&oDeals](std::uint32_t iProductID, const Deal & iDeal)
+        {
+            oDeals.push_back(MakeDealRecord(iProductID, iDeal));
+        });
+
+        // Products 3 and 1 cross over several levels, product 2 has a single bid and nothing to match
+        std::uint32_t OrderID = 0;
+        for (std::uint32_t ProductID : { 3u, 1u })
+        {
+            for (std::uint32_t i = 0; i < 5; ++i)
+            {
+                auto ob = CREATE_ORDER(OrderWay::BUY, 100_qty, Price(1250 + i), ClientOrderID(++OrderID), 5_clientid);
+                auto os = CREATE_ORDER(OrderWay::SELL, 100_qty, Price(1248 + i), ClientOrderID(++OrderID), 6_clientid);
+                ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob, ProductID));
+                ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, os, ProductID));
+            }
+        }
+        auto ob = CREATE_ORDER(OrderWay::BUY, 100_qty, 1250_price, ClientOrderID(++OrderID), 5_clientid);
+        ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob, 2));
+
+        ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CONTINUOUS_TRADING));
+        EXPECT_EQ(TradingPhase::CONTINUOUS_TRADING, m_pEngine->GetOrderBook(2)->GetTradingPhase());
+    };
+
+    std::vector<DealRecord> SequentialDeals;
+    Uncross(1, SequentialDeals);
+
+    std::vector<DealRecord> Deals;
+    Uncross(4, Deals);
+
+    ASSERT_FALSE(Deals.empty());
+    ASSERT_TRUE(std::is_sorted(Deals.begin(), Deals.end(), [](const DealRecord & iLhs, const DealRecord & iRhs) { return iLhs.ProductID < iRhs.ProductID; }));
+    EXPECT_EQ(1u, Deals.front().ProductID);
+    EXPECT_EQ(3u, Deals.back().ProductID);
+
+    // The books are matched the same way, only the order between products may differ sequentially
+    std::stable_sort(SequentialDeals.begin(), SequentialDeals.end(), [](const DealRecord & iLhs, const DealRecord & iRhs) { return iLhs.ProductID < iRhs.ProductID; });
+    ASSERT_EQ(SequentialDeals.size(), Deals.size());
+    ASSERT_EQ(0, std::memcmp(SequentialDeals.data(), Deals.data(), Deals.size() * sizeof(DealRecord)));
+}
+
+TEST_F(MatchingEngineTest, Should_market_data_feed_only_start_when_configured)
+{
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    ASSERT_EQ(nullptr, m_pEngine->GetMarketData());
+
+    m_Config.put("Engine.market_data_port", 0);
+    m_Config.put("Engine.market_data_interval_ms", 1);
+    m_Config.put("Engine.uncross_threads", 4);
+    m_pEngine.reset(new engine_type());
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+
+    auto pMarketData = m_pEngine->GetMarketData();
+    ASSERT_NE(nullptr, pMarketData);
+    ASSERT_TRUE(pMarketData->IsOpen());
+    ASSERT_NE(0u, pMarketData->GetPort());
+
+    // The levels changed by the pool threads reach the feed through the engine thread
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::OPENING_AUCTION));
+    auto ob = CREATE_ORDER(OrderWay::BUY, 100_qty, 1250_price, 1_clorderid, 5_clientid);
+    auto os = CREATE_ORDER(OrderWay::SELL, 100_qty, 1250_price, 2_clorderid, 6_clientid);
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, ob, 1));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, os, 1));
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    const auto Deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pMarketData->GetSequence() == 0 && std::chrono::steady_clock::now() < Deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_NE(0u, pMarketData->GetSequence());
+    ASSERT_EQ(0u, pMarketData->GetStallCounter());
+}
+
+TEST_F(MatchingEngineTest, Should_metrics_be_published_in_shared_memory)
+{
+    const std::string SegmentName = "/exchange-test-metrics";
+    m_Config.put("Engine.metrics_segment", SegmentName);
+
+    ASSERT_TRUE(m_pEngine->Configure(m_Config));
+    ASSERT_TRUE(m_pEngine->IsPublishingMetrics());
+    ASSERT_TRUE(m_pEngine->SetGlobalPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    EXPECT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, CREATE_ORDER(OrderWay::BUY, 100_qty, 1250_price, 1_clorderid, 5_clientid), product_id));
+    EXPECT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, CREATE_ORDER(OrderWay::BUY, 100_qty, 1250_price, 2_clorderid, 5_clientid), product_id));
+    EXPECT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, CREATE_ORDER(OrderWay::BUY, 100_qty, 1251_price, 3_clorderid, 5_clientid), product_id));
+    EXPECT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, CREATE_ORDER(OrderWay::SELL, 40_qty, 1251_price, 4_clorderid, 6_clientid), product_id));
+    EXPECT_EQ(Status::Ok, INSERT_ORDER(m_pEngine, CREATE_ORDER(OrderWay::SELL, 50_qty, 1260_price, 5_clorderid, 6_clientid), product_id));
+    EXPECT_EQ(Status::InvalidQuantity, INSERT_ORDER(m_pEngine, CREATE_ORDER(OrderWay::SELL, 0_qty, 1260_price, 6_clorderid, 6_clientid), product_id));
+    EXPECT_EQ(Status::InstrumentNotFound, INSERT_ORDER(m_pEngine, CREATE_ORDER(OrderWay::SELL, 50_qty, 1260_price, 7_clorderid, 6_clientid), 42));
+
+    MetricsReader Reader(SegmentName);
+    ASSERT_TRUE(Reader.IsValid());
+    ASSERT_EQ(3u, Reader.GetOrderBookCount());
+
+    const auto Version = Reader.GetVersion();
+    m_pEngine->PublishMetrics();
+    ASSERT_EQ(Version + 1, Reader.GetVersion());
+
+    EngineMetrics Engine;
+    ASSERT_TRUE(Reader.ReadEngine(Engine));
+    EXPECT_EQ(7u, Engine.OrdersIn);
+    EXPECT_EQ(5u, Engine.OrdersAccepted);
+    EXPECT_EQ(2u, Engine.OrdersRejected);
+    EXPECT_EQ(1u, Engine.UnknownInstrument);
+    EXPECT_EQ(1u, Engine.Deals);
+    EXPECT_EQ(4u, Engine.RestingOrders);
+    EXPECT_EQ(40u, Engine.DailyVolume);
+    EXPECT_EQ(static_cast<std::uint32_t>(TradingPhase::CONTINUOUS_TRADING), Engine.GlobalPhase);
+
+    // Order books are published by product ID
+    OrderBookMetrics Book;
+    ASSERT_TRUE(Reader.ReadOrderBook(0, Book));
+    EXPECT_EQ(1u, Book.ProductID);
+    EXPECT_STREQ("Michelin", Book.SecurityName);
+    EXPECT_EQ(6u, Book.Counters.Inserts);
+    EXPECT_EQ(1u, Book.Counters.Rejects);
+    EXPECT_EQ(3u, Book.BidOrders);
+    EXPECT_EQ(1u, Book.AskOrders);
+    EXPECT_EQ(2u, Book.BidLevels);
+    EXPECT_EQ(1u, Book.AskLevels);
+    EXPECT_EQ(1251u, Book.LastPrice);
+    EXPECT_EQ(1u, Book.DealPoolUsed);
+
+    ASSERT_TRUE(Reader.ReadOrderBook(2, Book));
+    EXPECT_EQ(3u, Book.ProductID);
+    EXPECT_FALSE(Reader.ReadOrderBook(3, Book));
+
+    m_pEngine.reset();
+    EXPECT_FALSE(MetricsReader(SegmentName).IsValid());
+}
+
 int main(int argc, char ** argv)
 {
     auto & Logger = LoggerHolder::GetInstance();
@@ -49,7 +49,6 @@ protected:
 // ENH_TODO  : For later, orders must be rejected if the price is outside the reservation range
 // ENH_TODO  : Learn more about circuit breakers
 // ENH_TODO  : Add a history of orders modifications
-// ENH_TODO  : Add order types for hit ( IAC, FOK )
 
 TEST_F(OrderBookTest, Should_post_auction_price_be_the_previous_close_price_when_no_auctions_occurs)
 {
@@ -276,6 +275,30 @@ TEST_F(OrderBookTest, Should_phase_switch_to_intraday_aution_when_deal_price_is_
     ASSERT_EQ(TradingPhase::INTRADAY_AUCTION, m_pOrderBook->GetTradingPhase());
 }
 
+TEST_F(OrderBookTest, Should_no_deal_be_generated_outside_the_price_collars)
+{
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    auto MaxPriceDev = m_Config.get<unsigned int>("Engine.max_price_deviation");
+
+    auto ref_price = m_pOrderBook->GetPostAuctionPrice();
+    auto inside_price = ref_price;
+    auto outside_price = Price(ref_price * (1 + (MaxPriceDev + 1)*0.01));
+
+    auto OrderSell1 = CREATE_ORDER(OrderWay::SELL, 100_qty, inside_price, 1_clorderid, 6_clientid);
+    auto OrderSell2 = CREATE_ORDER(OrderWay::SELL, 100_qty, outside_price, 2_clorderid, 6_clientid);
+
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook,OrderSell1));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook,OrderSell2));
+
+    auto OrderBuy = CREATE_ORDER(OrderWay::BUY, 200_qty, outside_price, 1_clorderid, 5_clientid);
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook,OrderBuy));
+
+    ASSERT_EQ(1, m_pOrderBook->GetDealCounter());
+    ASSERT_EQ(inside_price, m_pOrderBook->GetLastPrice());
+    ASSERT_EQ(TradingPhase::INTRADAY_AUCTION, m_pOrderBook->GetTradingPhase());
+}
+
 TEST_F(OrderBookTest, Should_order_be_rejected_when_quantity_is_null)
 {
     ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::CONTINUOUS_TRADING));
@@ -352,6 +375,33 @@ TEST_F(OrderBookTest, Should_dailyvolume_be_updated_after_a_deal)
     ASSERT_EQ(new_dailyvolume, m_pOrderBook->GetDailyVolume());
 }
 
+TEST_F(OrderBookTest, Should_statistics_be_aggregated_when_an_order_sweeps_several_levels)
+{
+    const auto post_auction_price = m_pOrderBook->GetPostAuctionPrice();
+
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    auto OrderSell1 = CREATE_ORDER(OrderWay::SELL, 100_qty, post_auction_price, 1_clorderid, 6_clientid);
+    auto OrderSell2 = CREATE_ORDER(OrderWay::SELL, 50_qty, post_auction_price, 2_clorderid, 7_clientid);
+    auto OrderSell3 = CREATE_ORDER(OrderWay::SELL, 200_qty, post_auction_price + 1_price, 3_clorderid, 8_clientid);
+
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook,OrderSell1));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook,OrderSell2));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook,OrderSell3));
+
+    const auto current_turnover = m_pOrderBook->GetTurnover();
+    const auto current_volume   = m_pOrderBook->GetDailyVolume();
+
+    auto OrderBuy = CREATE_ORDER(OrderWay::BUY, 250_qty, post_auction_price + 1_price, 1_clorderid, 5_clientid);
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook,OrderBuy));
+
+    ASSERT_EQ(3, m_pOrderBook->GetDealCounter());
+    ASSERT_EQ(current_turnover + 150_qty * post_auction_price + 100_qty * (post_auction_price + 1_price), m_pOrderBook->GetTurnover());
+    ASSERT_EQ(current_volume + 250_qty, m_pOrderBook->GetDailyVolume());
+    ASSERT_EQ(post_auction_price + 1_price, m_pOrderBook->GetLastPrice());
+    ASSERT_EQ(TradingPhase::CONTINUOUS_TRADING, m_pOrderBook->GetTradingPhase());
+}
+
 TEST_F(OrderBookTest, Should_last_price_be_the_previous_close_price_when_no_auctions_occurs)
 {
     ASSERT_EQ(m_Instrument.GetClosePrice(), m_pOrderBook->GetLastPrice());
@@ -434,6 +484,100 @@ TEST_F(OrderBookTest, Should_orderbook_be_unmonitored_when_switching_from_intrad
     ASSERT_EQ(0, m_pEngine->GetMonitoredOrderBookCounter());
 }
 
+TEST_F(OrderBookTest, Should_market_order_be_executed_whatever_the_resting_price)
+{
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    auto OrderSell = CREATE_ORDER(OrderWay::SELL, 100_qty, 1001_price, 1_clorderid, 6_clientid);
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook, OrderSell));
+
+    ASSERT_EQ(Status::Ok, m_pOrderBook->ImmediateInsert(OrderType::MARKET, OrderWay::BUY, 150_qty, 0_price, 1_clorderid, 5_clientid, TimeQualifier::IOC));
+
+    ASSERT_EQ(1, m_pOrderBook->GetDealCounter());
+    ASSERT_EQ(1001_price, m_pOrderBook->GetLastPrice());
+    ASSERT_EQ(100_volume, m_pOrderBook->GetDailyVolume());
+
+    /* The remaining quantity has been discarded, nothing rest in the book */
+    ASSERT_EQ(Status::OrderNotFound, m_pOrderBook->Delete(1_clorderid, 5_clientid, OrderWay::BUY));
+}
+
+TEST_F(OrderBookTest, Should_immediate_order_be_rejected_outside_continuous_trading)
+{
+    ASSERT_EQ(Status::MarketNotOpened, m_pOrderBook->ImmediateInsert(OrderType::LIMIT, OrderWay::BUY, 100_qty, 1000_price, 1_clorderid, 5_clientid, TimeQualifier::IOC));
+
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::OPENING_AUCTION));
+
+    ASSERT_EQ(Status::InvalidTimeQualifier, m_pOrderBook->ImmediateInsert(OrderType::LIMIT, OrderWay::BUY, 100_qty, 1000_price, 1_clorderid, 5_clientid, TimeQualifier::IOC));
+    ASSERT_EQ(Status::InvalidTimeQualifier, m_pOrderBook->ImmediateInsert(OrderType::MARKET, OrderWay::SELL, 100_qty, 0_price, 1_clorderid, 5_clientid, TimeQualifier::FOK));
+}
+
+TEST_F(OrderBookTest, Should_immediate_order_be_rejected_when_invalid)
+{
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    ASSERT_EQ(Status::InvalidTimeQualifier, m_pOrderBook->ImmediateInsert(OrderType::LIMIT, OrderWay::BUY, 100_qty, 1000_price, 1_clorderid, 5_clientid, TimeQualifier::DAY));
+    ASSERT_EQ(Status::InvalidOrderType, m_pOrderBook->ImmediateInsert(OrderType::MAX_TYPE, OrderWay::BUY, 100_qty, 1000_price, 1_clorderid, 5_clientid, TimeQualifier::IOC));
+    ASSERT_EQ(Status::InvalidQuantity, m_pOrderBook->ImmediateInsert(OrderType::LIMIT, OrderWay::BUY, 0_qty, 1000_price, 1_clorderid, 5_clientid, TimeQualifier::IOC));
+    ASSERT_EQ(Status::InvalidPrice, m_pOrderBook->ImmediateInsert(OrderType::LIMIT, OrderWay::BUY, 100_qty, 0_price, 1_clorderid, 5_clientid, TimeQualifier::FOK));
+    ASSERT_EQ(Status::InvalidWay, m_pOrderBook->ImmediateInsert(OrderType::MARKET, OrderWay::MAX_WAY, 100_qty, 0_price, 1_clorderid, 5_clientid, TimeQualifier::IOC));
+}
+
+TEST_F(OrderBookTest, Should_book_internals_be_allocated_with_the_first_order)
+{
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::OPENING_AUCTION));
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    // Phase changes and reads do not need the orders
+    ASSERT_FALSE(m_pOrderBook->IsMaterialized());
+    ASSERT_EQ(0u, m_pOrderBook->GetDealCounter());
+
+    OrderBookMetrics Metrics;
+    m_pOrderBook->FillMetrics(Metrics);
+    ASSERT_EQ(0u, Metrics.BidOrders + Metrics.AskOrders);
+
+    auto OrderBuy = CREATE_ORDER(OrderWay::BUY, 100_qty, 1000_price, 1_clorderid, 5_clientid);
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook, OrderBuy));
+
+    ASSERT_TRUE(m_pOrderBook->IsMaterialized());
+    m_pOrderBook->FillMetrics(Metrics);
+    ASSERT_EQ(1u, Metrics.BidOrders);
+}
+
+TEST_F(OrderBookTest, Should_depth_be_published_at_the_end_of_each_command)
+{
+    BookDepth Depth;
+    ASSERT_TRUE(m_pOrderBook->LoadDepth(Depth));
+    ASSERT_EQ(0u, Depth.BidLevels + Depth.AskLevels);
+
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::OPENING_AUCTION));
+    ASSERT_TRUE(m_pOrderBook->SetTradingPhase(TradingPhase::CONTINUOUS_TRADING));
+
+    auto OrderBuy1 = CREATE_ORDER(OrderWay::BUY, 100_qty, 1000_price, 1_clorderid, 5_clientid);
+    auto OrderBuy2 = CREATE_ORDER(OrderWay::BUY, 50_qty, 1000_price, 2_clorderid, 5_clientid);
+    auto OrderSell = CREATE_ORDER(OrderWay::SELL, 120_qty, 1000_price, 3_clorderid, 6_clientid);
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook, OrderBuy1));
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook, OrderBuy2));
+
+    ASSERT_TRUE(m_pOrderBook->LoadDepth(Depth));
+    ASSERT_EQ(1u, Depth.BidLevels);
+    ASSERT_EQ(1000u, Depth.Bids[0].Price);
+    ASSERT_EQ(2u, Depth.Bids[0].Orders);
+    ASSERT_EQ(150u, Depth.Bids[0].Quantity);
+
+    // The first bid is filled, the second one partially
+    ASSERT_EQ(Status::Ok, INSERT_ORDER(m_pOrderBook, OrderSell));
+
+    ASSERT_TRUE(m_pOrderBook->LoadDepth(Depth));
+    ASSERT_EQ(1u, Depth.BidLevels);
+    ASSERT_EQ(0u, Depth.AskLevels);
+    ASSERT_EQ(1u, Depth.Bids[0].Orders);
+    ASSERT_EQ(30u, Depth.Bids[0].Quantity);
+
+    m_pOrderBook->CancelAllOrders();
+    ASSERT_TRUE(m_pOrderBook->LoadDepth(Depth));
+    ASSERT_EQ(0u, Depth.BidLevels + Depth.AskLevels);
+}
+
 int main(int argc, char ** argv)
 {
     auto & Logger = LoggerHolder::GetInstance();
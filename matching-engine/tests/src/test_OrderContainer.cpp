@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 
-#include <vector>
+#include <atomic>
+#include <cstring>
 #include <map>
+#include <random>
+#include <thread>
+#include <vector>
 
 #include <Engine_Order.h>
 #include <Engine_OrderContainer.h>
@@ -21,21 +25,50 @@ class EventHandler
         typedef std::map<std::uint32_t, std::unique_ptr<Deal> > DealContainerType;
 
         using deal_ptr_type = std::unique_ptr<Deal>;
+        using deal_span_type = std::vector<const Deal *>;
 
     public:
         EventHandler()
         {}
 
-        void OnDeal(std::unique_ptr<Deal> ipDeal)
+        const Deal * RecordDeal(std::unique_ptr<Deal> ipDeal)
         {
-            m_Deals.emplace(m_Deals.size(), std::move(ipDeal));
+            auto insertion = m_Deals.emplace(m_Deals.size(), std::move(ipDeal));
+            return insertion.first->second.get();
+        }
 
-            ASSERT_EQ(*ipDeal, *ipDeal);
+        void OnDeals(const deal_span_type & iDeals)
+        {
+            if (!iDeals.empty())
+            {
+                m_Sweeps.push_back(iDeals.size());
+            }
         }
 
         /**/
-        void OnUnsolicitedCancelledOrder(const Order * /* order*/ )
-        {}
+        void OnUnsolicitedCancelledOrders(const std::vector<const Order *> & iOrders)
+        {
+            m_CancelBatches.push_back(iOrders.size());
+            m_Levels.clear();
+        }
+
+        /**/
+        void OnPriceCollarBreach()
+        {
+            m_CollarBreaches++;
+        }
+
+        /* Net open quantity and order count of every level, from the changes */
+        void OnLevelChange(OrderWay iWay, Price iPrice, std::int64_t iQuantity, std::int32_t iOrders)
+        {
+            auto & Level = m_Levels[std::make_pair(iWay, static_cast<std::uint32_t>(iPrice))];
+            Level.first  += iQuantity;
+            Level.second += iOrders;
+            if (Level.second == 0)
+            {
+                m_Levels.erase(std::make_pair(iWay, static_cast<std::uint32_t>(iPrice)));
+            }
+        }
 
         template <typename... Args>
         deal_ptr_type CreateDeal(Args &&... args)
@@ -46,12 +79,24 @@ class EventHandler
         void Reset()
         {
             m_Deals.clear();
+            m_Sweeps.clear();
+            m_CancelBatches.clear();
+            m_Levels.clear();
+            m_CollarBreaches = 0;
         }
 
         const DealContainerType & GetDealContainer() const { return m_Deals; }
+        const std::vector<size_t> & GetSweeps() const { return m_Sweeps; }
+        size_t GetCollarBreaches() const { return m_CollarBreaches; }
+        const std::vector<size_t> & GetCancelBatches() const { return m_CancelBatches; }
+        const std::map<std::pair<OrderWay, std::uint32_t>, std::pair<std::int64_t, std::int32_t> > & GetLevels() const { return m_Levels; }
 
     private:
         DealContainerType       m_Deals;
+        std::vector<size_t>     m_Sweeps;
+        std::vector<size_t>     m_CancelBatches;
+        std::map<std::pair<OrderWay, std::uint32_t>, std::pair<std::int64_t, std::int32_t> > m_Levels;
+        size_t                  m_CollarBreaches = 0;
 };
 
 #define CREATE_ORDER(Way, Qty, Price, OrderID, ClientID) ( std::make_unique<Order>(Way, Qty, Price, OrderID, ClientID) ) 
@@ -573,6 +618,428 @@ TEST_F(OrderContainerTest, Orders_should_loses_their_prority_when_modified)
     ASSERT_EQ(*ByOrderAskContainer[3], Order(OrderWay::SELL, 400_qty, 12_price, 20_clorderid, 9_clientid));
 }
 
+TEST_F(OrderContainerTest, Orders_should_keep_their_priority_when_quantity_is_decreased)
+{
+    InsertOrders();
+
+    auto BuyReplace = CREATE_REPLACE(OrderWay::BUY, 4000_qty, 2185_price, 1_clorderid, 3_clorderid, 9_clientid);
+    auto SellReplace = CREATE_REPLACE(OrderWay::SELL, 6000_qty, 4321_price, 2_clorderid, 4_clorderid, 1_clientid);
+
+    ASSERT_EQ(Status::Ok, MODIFY_MATCHING_ORDER(m_Container, BuyReplace));
+    ASSERT_EQ(Status::Ok, MODIFY_MATCHING_ORDER(m_Container, SellReplace));
+
+    std::vector<Order*> ByOrderBidContainer;
+    std::vector<Order*> ByOrderAskContainer;
+
+    m_Container.ByOrderView(ByOrderBidContainer, ByOrderAskContainer);
+
+    ASSERT_EQ(*ByOrderBidContainer[0], Order(OrderWay::BUY, 4000_qty, 2185_price, 3_clorderid, 9_clientid));
+    ASSERT_EQ(*ByOrderBidContainer[1], Order(OrderWay::BUY, 6000_qty, 2185_price, 1_clorderid, 10_clientid));
+
+    ASSERT_EQ(*ByOrderAskContainer[0], Order(OrderWay::SELL, 6000_qty, 4321_price, 4_clorderid, 1_clientid));
+    ASSERT_EQ(*ByOrderAskContainer[1], Order(OrderWay::SELL, 7000_qty, 4321_price, 2_clorderid, 2_clientid));
+
+    m_BidContainerReference = {
+                                    LimiteType(2, 10000_qty, 2185_price), LimiteType(1, 4000_qty, 1325_price),
+                                    LimiteType(1, 3000_qty, 1321_price), LimiteType(2, 3000_qty, 1234_price)
+                              };
+
+    m_AskContainerReference = {
+                                    LimiteType(2, 13000_qty, 4321_price), LimiteType(1, 6000_qty, 4526_price),
+                                    LimiteType(1, 5000_qty, 4580_price), LimiteType(2, 7000_qty, 8526_price)
+                              };
+
+    OrderContainerType::LimitContainer BidContainer;
+    OrderContainerType::LimitContainer AskContainer;
+
+    m_Container.AggregatedView(BidContainer, AskContainer);
+
+    ASSERT_EQ(m_BidContainerReference, BidContainer);
+    ASSERT_EQ(m_AskContainerReference, AskContainer);
+
+    /* The amended order must be reachable with its new ID only */
+    ASSERT_EQ(Status::OrderNotFound, m_Container.Delete(1_clorderid, 9_clientid, OrderWay::BUY));
+    ASSERT_EQ(Status::Ok, m_Container.Delete(3_clorderid, 9_clientid, OrderWay::BUY));
+}
+
+TEST_F(OrderContainerTest, Orders_should_loses_their_priority_when_quantity_is_increased)
+{
+    InsertOrders();
+
+    auto BuyReplace = CREATE_REPLACE(OrderWay::BUY, 5001_qty, 2185_price, 1_clorderid, 3_clorderid, 9_clientid);
+
+    ASSERT_EQ(Status::Ok, MODIFY_MATCHING_ORDER(m_Container, BuyReplace));
+
+    std::vector<Order*> ByOrderBidContainer;
+    std::vector<Order*> ByOrderAskContainer;
+
+    m_Container.ByOrderView(ByOrderBidContainer, ByOrderAskContainer);
+
+    ASSERT_EQ(*ByOrderBidContainer[0], Order(OrderWay::BUY, 6000_qty, 2185_price, 1_clorderid, 10_clientid));
+    ASSERT_EQ(*ByOrderBidContainer[1], Order(OrderWay::BUY, 5001_qty, 2185_price, 3_clorderid, 9_clientid));
+}
+
+TEST_F(OrderContainerTest, Amend_down_should_be_rejected_when_quantity_is_lower_than_the_executed_quantity)
+{
+    m_Container.CancelAllOrders();
+
+    m_BidOrders = { CREATE_RAW_ORDER(OrderWay::BUY, 1000_qty, 100_price, 1_clorderid, 5_clientid) };
+    m_AskOrders = {};
+
+    InsertOrders();
+
+    auto SellOrder = CREATE_ORDER(OrderWay::SELL, 600_qty, 100_price, 1_clorderid, 6_clientid);
+    ASSERT_EQ(Status::Ok, INSERT_MATCHING_ORDER(m_Container, SellOrder));
+
+    auto BuyReplace = CREATE_REPLACE(OrderWay::BUY, 600_qty, 100_price, 1_clorderid, 2_clorderid, 5_clientid);
+    ASSERT_EQ(Status::InvalidQuantity, MODIFY_MATCHING_ORDER(m_Container, BuyReplace));
+
+    BuyReplace = CREATE_REPLACE(OrderWay::BUY, 700_qty, 100_price, 1_clorderid, 2_clorderid, 5_clientid);
+    ASSERT_EQ(Status::Ok, MODIFY_MATCHING_ORDER(m_Container, BuyReplace));
+
+    m_BidContainerReference = { LimiteType(1, 100_qty, 100_price) };
+    m_AskContainerReference = {};
+
+    OrderContainerType::LimitContainer BidContainer;
+    OrderContainerType::LimitContainer AskContainer;
+
+    m_Container.AggregatedView(BidContainer, AskContainer);
+
+    ASSERT_EQ(m_BidContainerReference, BidContainer);
+    ASSERT_EQ(m_AskContainerReference, AskContainer);
+
+    m_EventHandler.Reset();
+}
+
+TEST_F(OrderContainerTest, Modify_should_be_rejected_when_the_new_order_ID_is_already_used)
+{
+    m_Container.CancelAllOrders();
+    m_EventHandler.Reset();
+
+    m_BidOrders = {
+        CREATE_RAW_ORDER(OrderWay::BUY, 100_qty, 10_price, 1_clorderid, 5_clientid), CREATE_RAW_ORDER(OrderWay::BUY, 200_qty, 11_price, 2_clorderid, 5_clientid)
+                  };
+    m_AskOrders = { CREATE_RAW_ORDER(OrderWay::SELL, 50_qty, 12_price, 1_clorderid, 6_clientid) };
+
+    InsertOrders();
+
+    // The new price would trade with the resting sell order
+    auto BuyReplace = CREATE_REPLACE(OrderWay::BUY, 100_qty, 12_price, 1_clorderid, 2_clorderid, 5_clientid);
+    ASSERT_EQ(Status::DuplicateOrderID, MODIFY_MATCHING_ORDER(m_Container, BuyReplace));
+
+    // The same at the same price, amended in place
+    BuyReplace = CREATE_REPLACE(OrderWay::BUY, 50_qty, 10_price, 1_clorderid, 2_clorderid, 5_clientid);
+    ASSERT_EQ(Status::DuplicateOrderID, MODIFY_MATCHING_ORDER(m_Container, BuyReplace));
+
+    ASSERT_TRUE(m_EventHandler.GetDealContainer().empty());
+
+    m_BidContainerReference = { LimiteType(1, 200_qty, 11_price), LimiteType(1, 100_qty, 10_price) };
+    m_AskContainerReference = { LimiteType(1, 50_qty, 12_price) };
+
+    OrderContainerType::LimitContainer BidContainer;
+    OrderContainerType::LimitContainer AskContainer;
+
+    m_Container.AggregatedView(BidContainer, AskContainer);
+
+    ASSERT_EQ(m_BidContainerReference, BidContainer);
+    ASSERT_EQ(m_AskContainerReference, AskContainer);
+
+    // Neither the depth nor the level changes lost the original order
+    const auto & Depth = m_Container.GetDepth();
+    ASSERT_EQ(2u, Depth.BidLevels);
+    ASSERT_EQ(10u, Depth.Bids[1].Price);
+    ASSERT_EQ(100u, Depth.Bids[1].Quantity);
+    ASSERT_EQ(1u, Depth.Bids[1].Orders);
+    ASSERT_EQ(3u, m_EventHandler.GetLevels().size());
+
+    // The original order still rests with its own ID
+    ASSERT_EQ(Status::Ok, m_Container.Delete(1_clorderid, 5_clientid, OrderWay::BUY));
+    ASSERT_EQ(Status::Ok, m_Container.Delete(2_clorderid, 5_clientid, OrderWay::BUY));
+}
+
+TEST_F(OrderContainerTest, IOC_remaining_quantity_should_be_discarded)
+{
+    auto & DealContainer = m_EventHandler.GetDealContainer();
+
+    InsertOrders();
+
+    ASSERT_EQ(Status::Ok, m_Container.ImmediateInsert(OrderWay::BUY, 20000_qty, 4321_price, 3_clorderid, 11_clientid, TimeQualifier::IOC));
+
+    ASSERT_EQ(DealContainer.size(), 2);
+    ASSERT_EQ(*DealContainer.at(0), Deal(4321_price, 8000_qty, 11_clientid, 3_clorderid, 1_clientid, 2_clorderid));
+    ASSERT_EQ(*DealContainer.at(1), Deal(4321_price, 7000_qty, 11_clientid, 3_clorderid, 2_clientid, 2_clorderid));
+
+    /* Both fills are notified in a single sweep event */
+    ASSERT_EQ(std::vector<size_t>({ 2 }), m_EventHandler.GetSweeps());
+
+    m_AskContainerReference = {
+                                    LimiteType(1, 6000_qty, 4526_price), LimiteType(1, 5000_qty, 4580_price),
+                                    LimiteType(2, 7000_qty, 8526_price)
+                              };
+
+    OrderContainerType::LimitContainer BidContainer;
+    OrderContainerType::LimitContainer AskContainer;
+
+    m_Container.AggregatedView(BidContainer, AskContainer);
+
+    ASSERT_EQ(m_BidContainerReference, BidContainer);
+    ASSERT_EQ(m_AskContainerReference, AskContainer);
+
+    ASSERT_EQ(Status::OrderNotFound, m_Container.Delete(3_clorderid, 11_clientid, OrderWay::BUY));
+
+    m_EventHandler.Reset();
+}
+
+TEST_F(OrderContainerTest, FOK_should_be_rejected_without_modifying_the_book_when_not_fully_executable)
+{
+    auto & DealContainer = m_EventHandler.GetDealContainer();
+
+    InsertOrders();
+
+    ASSERT_EQ(Status::NotFullyExecutable, m_Container.ImmediateInsert(OrderWay::SELL, 11001_qty, 2185_price, 3_clorderid, 11_clientid, TimeQualifier::FOK));
+
+    ASSERT_EQ(DealContainer.size(), 0);
+
+    OrderContainerType::LimitContainer BidContainer;
+    OrderContainerType::LimitContainer AskContainer;
+
+    m_Container.AggregatedView(BidContainer, AskContainer);
+
+    ASSERT_EQ(m_BidContainerReference, BidContainer);
+    ASSERT_EQ(m_AskContainerReference, AskContainer);
+
+    ASSERT_EQ(Status::Ok, m_Container.ImmediateInsert(OrderWay::SELL, 11000_qty, 2185_price, 3_clorderid, 11_clientid, TimeQualifier::FOK));
+
+    ASSERT_EQ(DealContainer.size(), 2);
+    ASSERT_EQ(*DealContainer.at(0), Deal(2185_price, 5000_qty, 9_clientid, 1_clorderid, 11_clientid, 3_clorderid));
+    ASSERT_EQ(*DealContainer.at(1), Deal(2185_price, 6000_qty, 10_clientid, 1_clorderid, 11_clientid, 3_clorderid));
+
+    m_EventHandler.Reset();
+}
+
+TEST_F(OrderContainerTest, Matching_should_stop_at_the_price_collar)
+{
+    auto & DealContainer = m_EventHandler.GetDealContainer();
+
+    InsertOrders();
+
+    m_Container.SetPriceCollars(1000_price, 4526_price);
+
+    auto pOrder = CREATE_ORDER(OrderWay::BUY, 25000_qty, 5000_price, 3_clorderid, 11_clientid);
+    ASSERT_EQ(Status::Ok, INSERT_MATCHING_ORDER(m_Container, pOrder));
+
+    /* No deal is generated at 4580, the first price outside the collars */
+    ASSERT_EQ(DealContainer.size(), 3);
+    ASSERT_EQ(*DealContainer.at(0), Deal(4321_price, 8000_qty, 11_clientid, 3_clorderid, 1_clientid, 2_clorderid));
+    ASSERT_EQ(*DealContainer.at(1), Deal(4321_price, 7000_qty, 11_clientid, 3_clorderid, 2_clientid, 2_clorderid));
+    ASSERT_EQ(*DealContainer.at(2), Deal(4526_price, 6000_qty, 11_clientid, 3_clorderid, 3_clientid, 2_clorderid));
+
+    ASSERT_EQ(1, m_EventHandler.GetCollarBreaches());
+
+    /* The remaining quantity rests in the book */
+    ASSERT_EQ(Status::Ok, m_Container.Delete(3_clorderid, 11_clientid, OrderWay::BUY));
+
+    m_EventHandler.Reset();
+}
+
+TEST_F(OrderContainerTest, Resting_orders_outside_the_price_collar_should_not_be_executed)
+{
+    auto & DealContainer = m_EventHandler.GetDealContainer();
+
+    InsertOrders();
+
+    m_Container.SetPriceCollars(4400_price, 9000_price);
+
+    ASSERT_EQ(Status::Ok, m_Container.ImmediateInsert(OrderWay::BUY, 100_qty, 5000_price, 3_clorderid, 11_clientid, TimeQualifier::IOC));
+
+    ASSERT_EQ(DealContainer.size(), 0);
+    ASSERT_EQ(1, m_EventHandler.GetCollarBreaches());
+
+    m_EventHandler.Reset();
+}
+
+TEST_F(OrderContainerTest, Cancel_all_orders_should_notify_a_single_batch)
+{
+    InsertOrders();
+
+    const auto Orders = m_Container.GetBidOrderCount() + m_Container.GetAskOrderCount();
+    ASSERT_GT(Orders, 0u);
+
+    m_Container.CancelAllOrders();
+
+    ASSERT_EQ(std::vector<size_t>{ Orders }, m_EventHandler.GetCancelBatches());
+    ASSERT_EQ(0u, m_Container.GetBidOrderCount());
+    ASSERT_EQ(0u, m_Container.GetAskOrderCount());
+
+    // The emptied book is still usable, an empty book is not notified
+    ASSERT_EQ(Status::Ok, m_Container.Insert(CREATE_ORDER(OrderWay::BUY, 100_qty, 5000_price, 1_clorderid, 5_clientid)));
+    ASSERT_EQ(1u, m_Container.GetBidOrderCount());
+    ASSERT_EQ(Status::Ok, m_Container.Delete(1_clorderid, 5_clientid, OrderWay::BUY));
+
+    m_Container.CancelAllOrders();
+    ASSERT_EQ(1u, m_EventHandler.GetCancelBatches().size());
+
+    m_EventHandler.Reset();
+}
+
+TEST_F(OrderContainerTest, Depth_should_follow_the_aggregated_view)
+{
+    auto CheckSide = [](const LimitContainerType & iLimits, const DepthLevel * iLevels, std::uint32_t iCount)
+    {
+        ASSERT_EQ((std::min)(iLimits.size(), std::size_t(BookDepth::MaxLevels)), iCount);
+        for (std::uint32_t i = 0; i < iCount; ++i)
+        {
+            ASSERT_EQ(std::get<0>(iLimits[i]), iLevels[i].Orders);
+            ASSERT_EQ(static_cast<std::uint32_t>(std::get<1>(iLimits[i])), iLevels[i].Quantity);
+            ASSERT_EQ(static_cast<std::uint32_t>(std::get<2>(iLimits[i])), iLevels[i].Price);
+        }
+    };
+
+    auto CheckDepth = [&]()
+    {
+        LimitContainerType Bids;
+        LimitContainerType Asks;
+        m_Container.AggregatedView(Bids, Asks);
+
+        const auto & Depth = m_Container.GetDepth();
+        CheckSide(Bids, Depth.Bids, Depth.BidLevels);
+        CheckSide(Asks, Depth.Asks, Depth.AskLevels);
+
+        // Level counts are maintained beyond the depth
+        ASSERT_EQ(Bids.size(), m_Container.GetBidLevelCount());
+        ASSERT_EQ(Asks.size(), m_Container.GetAskLevelCount());
+
+        // The level changes add up to every level of the book, not only the depth
+        ASSERT_EQ(Bids.size() + Asks.size(), m_EventHandler.GetLevels().size());
+        for (auto Way : { OrderWay::BUY, OrderWay::SELL })
+        {
+            for (auto && Limit : (Way == OrderWay::BUY) ? Bids : Asks)
+            {
+                auto It = m_EventHandler.GetLevels().find(std::make_pair(Way, static_cast<std::uint32_t>(std::get<2>(Limit))));
+                ASSERT_TRUE(It != m_EventHandler.GetLevels().end());
+                ASSERT_EQ(static_cast<std::uint32_t>(std::get<1>(Limit)), It->second.first);
+                ASSERT_EQ(std::get<0>(Limit), static_cast<std::uint32_t>(It->second.second));
+            }
+        }
+
+        // Every command publishes its changes
+        BookDepth Published;
+        ASSERT_TRUE(m_Container.GetPublishedDepth().TryLoad(Published));
+        ASSERT_EQ(0, std::memcmp(&Published, &Depth, sizeof(BookDepth)));
+    };
+
+    // Many more levels than the depth, both sides overlap so that inserts and modifies trade
+    std::mt19937 Generator(42);
+    auto Draw = [&Generator](std::uint32_t iMin, std::uint32_t iMax) { return std::uniform_int_distribution<std::uint32_t>(iMin, iMax)(Generator); };
+
+    std::vector<std::pair<std::uint32_t, OrderWay> > Orders;
+    std::uint32_t NextID = 1;
+
+    for (int i = 0; i < 5000; ++i)
+    {
+        const auto Action = Draw(0, 9);
+        if (Action < 5 || Orders.empty())
+        {
+            const auto Way   = Draw(0, 1) ? OrderWay::BUY : OrderWay::SELL;
+            const auto Price = Way == OrderWay::BUY ? Draw(1000, 1030) : Draw(1025, 1055);
+            m_Container.Insert(CREATE_ORDER(Way, Order::qty_type(Draw(1, 50)), Order::price_type(Price), Order::client_orderid_type(NextID), 1_clientid), true);
+            Orders.emplace_back(NextID++, Way);
+        }
+        else
+        {
+            const auto Index = Draw(0, static_cast<std::uint32_t>(Orders.size() - 1));
+            const auto Entry = Orders[Index];
+            if (Action < 8)
+            {
+                m_Container.Delete(Order::client_orderid_type(Entry.first), 1_clientid, Entry.second);
+                Orders.erase(Orders.begin() + Index);
+            }
+            else
+            {
+                // Amend down in place or move to another level
+                const auto Price = Entry.second == OrderWay::BUY ? Draw(1000, 1030) : Draw(1025, 1055);
+                m_Container.Modify(CREATE_REPLACE(Entry.second, Order::qty_type(Draw(1, 50)), Order::price_type(Price),
+                                                  Order::client_orderid_type(Entry.first), Order::client_orderid_type(NextID), 1_clientid), true);
+                Orders[Index].first = NextID++;
+            }
+        }
+        CheckDepth();
+    }
+
+    // Auction : crossed orders rest until the book is uncrossed
+    for (std::uint32_t i = 0; i < 20; ++i)
+    {
+        m_Container.Insert(CREATE_ORDER(OrderWay::BUY, 10_qty, Order::price_type(1060 - i), Order::client_orderid_type(NextID++), 2_clientid));
+        CheckDepth();
+    }
+    m_Container.MatchOrders();
+    CheckDepth();
+
+    m_Container.CancelAllOrders();
+    CheckDepth();
+    ASSERT_EQ(0u, m_Container.GetDepth().BidLevels);
+    ASSERT_EQ(0u, m_Container.GetDepth().AskLevels);
+
+    m_EventHandler.Reset();
+}
+
+TEST_F(OrderContainerTest, Published_depth_should_never_be_torn)
+{
+    // A round inserts one order per level, bid then ask, all of them with the quantity of the round
+    std::atomic<bool> Stop(false);
+    std::atomic<std::uint64_t> Loads(0);
+    std::atomic<std::uint64_t> TornLoads(0);
+
+    std::thread Reader([&]()
+    {
+        BookDepth Depth;
+        while (!Stop.load())
+        {
+            if (!m_Container.GetPublishedDepth().TryLoad(Depth))
+            {
+                continue;
+            }
+            ++Loads;
+
+            bool Consistent = Depth.AskLevels <= Depth.BidLevels && Depth.BidLevels <= Depth.AskLevels + 1;
+            for (std::uint32_t i = 0; Consistent && i < Depth.BidLevels; ++i)
+            {
+                Consistent = Depth.Bids[i].Price == 1000 - i && Depth.Bids[i].Quantity == Depth.Bids[0].Quantity && Depth.Bids[i].Orders == 1;
+            }
+            for (std::uint32_t i = 0; Consistent && i < Depth.AskLevels; ++i)
+            {
+                Consistent = Depth.Asks[i].Price == 2000 + i && Depth.Asks[i].Quantity == Depth.Bids[0].Quantity && Depth.Asks[i].Orders == 1;
+            }
+            if (!Consistent)
+            {
+                ++TornLoads;
+            }
+        }
+    });
+
+    while (Loads.load() == 0)
+    {
+        std::this_thread::yield();
+    }
+
+    for (std::uint32_t Round = 1; Round <= 2000; ++Round)
+    {
+        for (std::uint32_t Level = 0; Level < BookDepth::MaxLevels; ++Level)
+        {
+            m_Container.Insert(CREATE_ORDER(OrderWay::BUY, Order::qty_type(Round), Order::price_type(1000 - Level), Order::client_orderid_type(Level), 1_clientid));
+            m_Container.Insert(CREATE_ORDER(OrderWay::SELL, Order::qty_type(Round), Order::price_type(2000 + Level), Order::client_orderid_type(Level), 1_clientid));
+        }
+        m_Container.CancelAllOrders();
+    }
+
+    Stop.store(true);
+    Reader.join();
+
+    EXPECT_EQ(0u, TornLoads.load());
+
+    m_EventHandler.Reset();
+}
+
 int main(int argc, char ** argv)
 {
     auto & Logger = LoggerHolder::GetInstance();
@@ -5,6 +5,7 @@
 
 #include <Engine_Order.h>
 #include <Engine_Instrument.h>
+#include <Engine_ReferenceData.h>
 
 namespace py = pybind11;
 using namespace pybind11::literals;
@@ -16,7 +17,7 @@ class InstrumentManager : public exchange::engine::InstrumentManager<Order>
 public:
 
     InstrumentManager(const std::string & sDBPath):
-        exchange::engine::InstrumentManager<Order>(sDBPath)
+        exchange::engine::InstrumentManager<Order>(sDBPath), m_DBPath(sDBPath)
     {}
 
     bool LoadInstruments()
@@ -39,6 +40,15 @@ public:
         return Write(rInstrument, key_extractor);
     }
 
+    /* Compile the database into the image mapped by the engine, run after editing */
+    bool ExportImage(const std::string & sImagePath)
+    {
+        std::vector<Instrument<Order>> Instruments;
+        return LoadAll(Instruments, 1) && ReferenceDataImage::Export(sImagePath, Instruments, ReferenceDataImage::GetDatabaseFingerprint(m_DBPath));
+    }
+
+    std::string m_DBPath;
+
     std::unordered_map<std::uint32_t, Instrument<Order>> m_Instruments;
 };
 
@@ -70,6 +80,7 @@ void bind_InstrumentManager(py::module &m)
             .def(py::init<const std::string &>())
             .def("LoadInstruments", &::InstrumentManager::LoadInstruments)
             .def("WriteInstrument", &::InstrumentManager::WriteInstrument)
+            .def("ExportImage", &::InstrumentManager::ExportImage)
             .def_readonly("instruments", &::InstrumentManager::m_Instruments);
 }
 
@@ -18,6 +18,10 @@ def display_all_instruments(instrument_manager):
 def write_instrument(instrument_manager, name, isin, product_id, currency="EUR", close_price=0):
 	Instr = Instrument(name, isin, currency, product_id, close_price)
 	instrument_manager.WriteInstrument(Instr)
+
+def export_image(instrument_manager, image_path):
+	if not instrument_manager.ExportImage(image_path):
+		print "Error : Unable to export the instrument image %s"%(image_path)
 	
 if __name__ == "__main__":
 	if len(sys.argv) != 2:
@@ -14,9 +14,10 @@ namespace exchange
         class TCPServer
         {
         public:
-            TCPServer(engine::MatchingEngine<> & rMatchinEngine, boost::asio::io_service& io_service, std::uint32_t service)
+            TCPServer(engine::MatchingEngine<> & rMatchinEngine, boost::asio::io_service& io_service, std::uint32_t service,
+                      engine::OrderFlowRecorder * pRecorder = nullptr, common::LatencyTracer * pTracer = nullptr)
                     : m_acceptor(io_service, tcp::endpoint(tcp::v4(), service)),
-                      m_socket(io_service), m_matching_engine(rMatchinEngine)
+                      m_socket(io_service), m_matching_engine(rMatchinEngine), m_pRecorder(pRecorder), m_pTracer(pTracer)
             {}
 
             void start()
@@ -32,7 +33,7 @@ namespace exchange
                                        {
                                            if (!ec)
                                            {
-                                               std::make_shared<Session>(std::move(m_socket), m_matching_engine)->start();
+                                               std::make_shared<Session>(std::move(m_socket), m_matching_engine, m_pRecorder, m_pTracer)->start();
                                            }
 
                                            do_accept();
@@ -43,6 +44,8 @@ namespace exchange
             tcp::acceptor              m_acceptor;
             tcp::socket                m_socket;
             engine::MatchingEngine<> & m_matching_engine;
+            engine::OrderFlowRecorder * m_pRecorder;
+            common::LatencyTracer *     m_pTracer;
         };
     }
 }
@@ -8,6 +8,8 @@
 #include <protocol.pb.h>
 
 #include <Engine_MatchingEngine.h>
+#include <Engine_OrderFlow.h>
+#include <LatencyTrace.h>
 
 using boost::asio::ip::tcp;
 
@@ -18,8 +20,9 @@ namespace exchange
         class Session : public std::enable_shared_from_this<Session>
         {
         public:
-            Session(tcp::socket socket, engine::MatchingEngine<> & rMatchinEngine):
-                    m_socket(std::move(socket)), m_matching_engine(rMatchinEngine)
+            Session(tcp::socket socket, engine::MatchingEngine<> & rMatchinEngine, engine::OrderFlowRecorder * pRecorder = nullptr,
+                    common::LatencyTracer * pTracer = nullptr):
+                    m_socket(std::move(socket)), m_matching_engine(rMatchinEngine), m_pRecorder(pRecorder), m_pTracer(pTracer)
             {}
 
             void start()
@@ -45,11 +48,17 @@ namespace exchange
         private:
 
             bool decode_order_way(const protocol::NewOrder & rNewOrder, engine::OrderWay & rWay);
+            bool decode_order_type(const protocol::NewOrder & rNewOrder, engine::OrderType & rType);
+            bool decode_time_qualifier(const protocol::NewOrder & rNewOrder, engine::TimeQualifier & rQualifier);
 
         private:
             tcp::socket                m_socket;
             Message                    m_read_msg;
             engine::MatchingEngine<> & m_matching_engine;
+            /* Order flow capture, disabled when null */
+            engine::OrderFlowRecorder * m_pRecorder;
+            /* Per stage latency tracing of sampled orders, disabled when null */
+            common::LatencyTracer *     m_pTracer;
         };
     }
 }
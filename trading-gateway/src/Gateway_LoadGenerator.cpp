@@ -0,0 +1,742 @@
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/ini_parser.hpp>
+
+#include <LatencyHistogram.h>
+
+#include <Gateway_Message.h>
+#include <protocol.pb.h>
+
+using boost::asio::ip::tcp;
+using exchange::common::LatencyHistogram;
+using exchange::gateway::Message;
+
+using ClockType = std::chrono::steady_clock;
+
+/*
+    Load generator of the trading gateway.
+
+    Opens many sessions over the gateway framing ( 4 bytes length + OneMessage ), logs them on and streams
+    NewOrder / ModOrder / CanOrder at a target rate. The gateway only answers Logon and Heartbeat messages,
+    so a Heartbeat probe follows every probe_every orders : sessions are processed in order, the probe round trip
+    covers the orders sent before it.
+*/
+
+struct InstrumentProfile
+{
+    std::uint64_t ProductID      = 0;
+    std::uint32_t ReferencePrice = 0;
+    double        Weight         = 1.0;
+};
+
+/*
+    Load generator settings, read from the [LoadGenerator] section of the configuration file
+*/
+struct LoadGeneratorSettings
+{
+    std::string                     Host              = "127.0.0.1";
+    unsigned short                  Port              = 5001;
+    int                             Sessions          = 1000;
+    int                             Threads           = 1;
+    double                          Rate              = 10000;
+    int                             Duration          = 30;
+    int                             NewRatio          = 80;
+    int                             ModRatio          = 10;
+    int                             CanRatio          = 10;
+    std::vector<InstrumentProfile>  Instruments       = { { 1, 1254, 1.0 } };
+    std::string                     PriceDistribution = "uniform";
+    int                             PriceRange        = 20;
+    int                             MinQuantity       = 1;
+    int                             MaxQuantity       = 1000;
+    int                             ProbeEvery        = 1;
+    int                             MaxLiveOrders     = 1000;
+    unsigned                        Seed              = 42;
+    std::string                     UserName          = "loadgen";
+    std::string                     Password          = "loadgen";
+    std::string                     OutputFile        = "load_generator.json";
+};
+
+bool ParseInstruments(const std::string & iValue, std::vector<InstrumentProfile> & oInstruments)
+{
+    // instruments=ProductID:ReferencePrice:Weight,...
+    std::vector<std::string> Entries;
+    boost::split(Entries, iValue, boost::is_any_of(","));
+
+    oInstruments.clear();
+    for (auto & Entry : Entries)
+    {
+        boost::trim(Entry);
+
+        std::vector<std::string> Fields;
+        boost::split(Fields, Entry, boost::is_any_of(":"));
+        if (Fields.size() < 2 || Fields.size() > 3)
+        {
+            return false;
+        }
+
+        InstrumentProfile Profile;
+        Profile.ProductID      = std::stoull(Fields[0]);
+        Profile.ReferencePrice = static_cast<std::uint32_t>(std::stoul(Fields[1]));
+        Profile.Weight         = Fields.size() == 3 ? std::stod(Fields[2]) : 1.0;
+        oInstruments.push_back(Profile);
+    }
+    return !oInstruments.empty();
+}
+
+bool LoadSettings(const boost::property_tree::ptree & iConfig, LoadGeneratorSettings & oSettings)
+{
+    try
+    {
+        oSettings.Host              = iConfig.get<std::string>("LoadGenerator.host", oSettings.Host);
+        oSettings.Port              = iConfig.get<unsigned short>("LoadGenerator.port", oSettings.Port);
+        oSettings.Sessions          = iConfig.get<int>("LoadGenerator.sessions", oSettings.Sessions);
+        oSettings.Threads           = iConfig.get<int>("LoadGenerator.threads", oSettings.Threads);
+        oSettings.Rate              = iConfig.get<double>("LoadGenerator.rate", oSettings.Rate);
+        oSettings.Duration          = iConfig.get<int>("LoadGenerator.duration", oSettings.Duration);
+        oSettings.NewRatio          = iConfig.get<int>("LoadGenerator.new_ratio", oSettings.NewRatio);
+        oSettings.ModRatio          = iConfig.get<int>("LoadGenerator.mod_ratio", oSettings.ModRatio);
+        oSettings.CanRatio          = iConfig.get<int>("LoadGenerator.can_ratio", oSettings.CanRatio);
+        oSettings.PriceDistribution = iConfig.get<std::string>("LoadGenerator.price_distribution", oSettings.PriceDistribution);
+        oSettings.PriceRange        = iConfig.get<int>("LoadGenerator.price_range", oSettings.PriceRange);
+        oSettings.MinQuantity       = iConfig.get<int>("LoadGenerator.min_quantity", oSettings.MinQuantity);
+        oSettings.MaxQuantity       = iConfig.get<int>("LoadGenerator.max_quantity", oSettings.MaxQuantity);
+        oSettings.ProbeEvery        = iConfig.get<int>("LoadGenerator.probe_every", oSettings.ProbeEvery);
+        oSettings.MaxLiveOrders     = iConfig.get<int>("LoadGenerator.max_live_orders", oSettings.MaxLiveOrders);
+        oSettings.Seed              = iConfig.get<unsigned>("LoadGenerator.seed", oSettings.Seed);
+        oSettings.UserName          = iConfig.get<std::string>("LoadGenerator.user_name", oSettings.UserName);
+        oSettings.Password          = iConfig.get<std::string>("LoadGenerator.password", oSettings.Password);
+        oSettings.OutputFile        = iConfig.get<std::string>("LoadGenerator.output_file", oSettings.OutputFile);
+
+        if (auto Instruments = iConfig.get_optional<std::string>("LoadGenerator.instruments"))
+        {
+            if (!ParseInstruments(*Instruments, oSettings.Instruments))
+            {
+                std::cerr << "Invalid instruments [" << *Instruments << "], expected ProductID:ReferencePrice[:Weight],..." << std::endl;
+                return false;
+            }
+        }
+    }
+    catch (const std::exception & Error)
+    {
+        std::cerr << "Invalid load generator configuration : " << Error.what() << std::endl;
+        return false;
+    }
+
+    if (oSettings.PriceDistribution != "uniform" && oSettings.PriceDistribution != "normal")
+    {
+        std::cerr << "Invalid price_distribution [" << oSettings.PriceDistribution << "], expected uniform or normal" << std::endl;
+        return false;
+    }
+
+    if (oSettings.Sessions <= 0 || oSettings.Threads <= 0 || oSettings.Rate <= 0 || oSettings.Duration <= 0 || oSettings.ProbeEvery <= 0 ||
+        oSettings.MaxLiveOrders <= 0 || oSettings.MinQuantity <= 0 || oSettings.MaxQuantity < oSettings.MinQuantity || oSettings.PriceRange < 0)
+    {
+        std::cerr << "Invalid load generator configuration : counts must be positive" << std::endl;
+        return false;
+    }
+
+    if (oSettings.NewRatio <= 0 || oSettings.ModRatio < 0 || oSettings.CanRatio < 0)
+    {
+        std::cerr << "Invalid load generator configuration : new_ratio must be positive, mod_ratio and can_ratio not negative" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+    Statistics of one worker thread, merged once the run is over
+*/
+struct WorkerStats
+{
+    LatencyHistogram RoundTrips;
+    std::uint64_t    NewOrders   = 0;
+    std::uint64_t    ModOrders   = 0;
+    std::uint64_t    CanOrders   = 0;
+    std::uint64_t    Probes      = 0;
+    std::uint64_t    Unanswered  = 0;
+    std::uint64_t    Connected   = 0;
+    std::uint64_t    LoggedOn    = 0;
+    std::uint64_t    Errors      = 0;
+
+    void Merge(const WorkerStats & iOther)
+    {
+        RoundTrips.Merge(iOther.RoundTrips);
+        NewOrders  += iOther.NewOrders;
+        ModOrders  += iOther.ModOrders;
+        CanOrders  += iOther.CanOrders;
+        Probes     += iOther.Probes;
+        Unanswered += iOther.Unanswered;
+        Connected  += iOther.Connected;
+        LoggedOn   += iOther.LoggedOn;
+        Errors     += iOther.Errors;
+    }
+};
+
+/*
+    One io_service run by one thread, its sessions share the random generator and the statistics without locking
+*/
+struct Worker
+{
+    Worker(const LoadGeneratorSettings & iSettings, unsigned iSeed)
+        :Generator(iSeed)
+    {
+        std::vector<double> Weights;
+        for (auto && Instrument : iSettings.Instruments)
+        {
+            Weights.push_back(Instrument.Weight);
+        }
+        InstrumentChooser = std::discrete_distribution<size_t>(Weights.begin(), Weights.end());
+    }
+
+    boost::asio::io_service                  Service;
+    std::mt19937                             Generator;
+    std::discrete_distribution<size_t>       InstrumentChooser;
+    WorkerStats                              Stats;
+};
+
+/* Client order IDs are unique across all sessions, the gateway uses the same client ID for everybody */
+std::atomic<std::uint64_t> NextClientOrderID(1);
+
+class LoadSession : public std::enable_shared_from_this<LoadSession>
+{
+    public:
+
+        LoadSession(Worker & rWorker, const LoadGeneratorSettings & iSettings)
+            :m_rWorker(rWorker), m_Settings(iSettings), m_Socket(rWorker.Service), m_Timer(rWorker.Service),
+             m_SessionRate(iSettings.Rate / iSettings.Sessions)
+        {}
+
+        void Start(const tcp::endpoint & iEndPoint)
+        {
+            auto self(shared_from_this());
+            m_Socket.async_connect(iEndPoint, [this, self](boost::system::error_code ec)
+            {
+                if (ec)
+                {
+                    ++m_rWorker.Stats.Errors;
+                    return;
+                }
+
+                ++m_rWorker.Stats.Connected;
+                m_Socket.set_option(tcp::no_delay(true));
+
+                SendLogon();
+                DoReadHeader();
+            });
+        }
+
+    private:
+
+        struct LiveOrder
+        {
+            std::uint64_t ClientOrderID;
+            std::uint64_t ProductID;
+            std::uint32_t ReferencePrice;
+        };
+
+        void SendLogon()
+        {
+            protocol::OneMessage Msg;
+            Msg.set_type(protocol::OneMessage::LOGON);
+
+            auto * pLogon = Msg.mutable_logon_msg();
+            pLogon->set_user_name(m_Settings.UserName);
+            pLogon->set_password(m_Settings.Password);
+
+            Send(Msg);
+            DoWrite();
+        }
+
+        void SendLogout()
+        {
+            protocol::OneMessage Msg;
+            Msg.set_type(protocol::OneMessage::LOGOUT);
+            Msg.mutable_logout_msg()->set_reason("end of load");
+
+            Send(Msg);
+        }
+
+        void SendProbe()
+        {
+            protocol::OneMessage Msg;
+            Msg.set_type(protocol::OneMessage::HEARTBEAT);
+            Msg.mutable_heartbeat_msg();
+
+            m_Probes.push_back(ClockType::now());
+            ++m_rWorker.Stats.Probes;
+
+            Send(Msg);
+        }
+
+        std::uint32_t GeneratePrice(std::uint32_t iReferencePrice)
+        {
+            int Offset = 0;
+            if (m_Settings.PriceDistribution == "normal")
+            {
+                // Concentrated near the reference price, 3 sigmas cover the range
+                std::normal_distribution<double> Distribution(0.0, m_Settings.PriceRange / 3.0 + 1e-9);
+                Offset = static_cast<int>(std::lround(Distribution(m_rWorker.Generator)));
+                Offset = std::max(-m_Settings.PriceRange, std::min(m_Settings.PriceRange, Offset));
+            }
+            else
+            {
+                std::uniform_int_distribution<int> Distribution(-m_Settings.PriceRange, m_Settings.PriceRange);
+                Offset = Distribution(m_rWorker.Generator);
+            }
+            return static_cast<std::uint32_t>(std::max<std::int64_t>(1, static_cast<std::int64_t>(iReferencePrice) + Offset));
+        }
+
+        std::uint32_t GenerateQuantity()
+        {
+            std::uniform_int_distribution<int> Distribution(m_Settings.MinQuantity, m_Settings.MaxQuantity);
+            return static_cast<std::uint32_t>(Distribution(m_rWorker.Generator));
+        }
+
+        void SendNewOrder()
+        {
+            const auto & Instrument = m_Settings.Instruments[m_rWorker.InstrumentChooser(m_rWorker.Generator)];
+            const auto   OrderID    = NextClientOrderID++;
+
+            protocol::OneMessage Msg;
+            Msg.set_type(protocol::OneMessage::NEW_ORDER);
+
+            auto * pOrder = Msg.mutable_new_order_msg();
+            pOrder->set_client_order_id(OrderID);
+            pOrder->set_instrument_id(Instrument.ProductID);
+            pOrder->set_side(std::bernoulli_distribution()(m_rWorker.Generator) ? protocol::NewOrder::BUY : protocol::NewOrder::SELL);
+            pOrder->set_order_quantity(GenerateQuantity());
+            pOrder->set_limit_price(GeneratePrice(Instrument.ReferencePrice));
+
+            Send(Msg);
+            ++m_rWorker.Stats.NewOrders;
+
+            if (m_LiveOrders.size() < static_cast<size_t>(m_Settings.MaxLiveOrders))
+            {
+                m_LiveOrders.push_back( LiveOrder{ OrderID, Instrument.ProductID, Instrument.ReferencePrice } );
+            }
+        }
+
+        void SendModOrder(size_t iIndex)
+        {
+            auto & Order = m_LiveOrders[iIndex];
+
+            protocol::OneMessage Msg;
+            Msg.set_type(protocol::OneMessage::MOD_ORDER);
+
+            auto * pModify = Msg.mutable_mod_order_msg();
+            pModify->set_client_order_id(NextClientOrderID++);
+            pModify->set_order_id(Order.ClientOrderID);
+            pModify->set_instrument_id(Order.ProductID);
+            pModify->set_order_quantity(GenerateQuantity());
+            pModify->set_limit_price(GeneratePrice(Order.ReferencePrice));
+
+            Order.ClientOrderID = pModify->client_order_id();
+
+            Send(Msg);
+            ++m_rWorker.Stats.ModOrders;
+        }
+
+        void SendCanOrder(size_t iIndex)
+        {
+            auto & Order = m_LiveOrders[iIndex];
+
+            protocol::OneMessage Msg;
+            Msg.set_type(protocol::OneMessage::CAN_ORDER);
+
+            auto * pCancel = Msg.mutable_can_order_msg();
+            pCancel->set_client_order_id(NextClientOrderID++);
+            pCancel->set_order_id(Order.ClientOrderID);
+            pCancel->set_instrument_id(Order.ProductID);
+
+            std::swap(Order, m_LiveOrders.back());
+            m_LiveOrders.pop_back();
+
+            Send(Msg);
+            ++m_rWorker.Stats.CanOrders;
+        }
+
+        void SendOrderFlow()
+        {
+            const int Total  = m_Settings.NewRatio + m_Settings.ModRatio + m_Settings.CanRatio;
+            const int Choice = std::uniform_int_distribution<int>(0, Total - 1)(m_rWorker.Generator);
+
+            if (Choice < m_Settings.NewRatio || m_LiveOrders.empty())
+            {
+                SendNewOrder();
+            }
+            else
+            {
+                const auto Index = std::uniform_int_distribution<size_t>(0, m_LiveOrders.size() - 1)(m_rWorker.Generator);
+                if (Choice < m_Settings.NewRatio + m_Settings.ModRatio)
+                {
+                    SendModOrder(Index);
+                }
+                else
+                {
+                    SendCanOrder(Index);
+                }
+            }
+
+            if (++m_Sent % m_Settings.ProbeEvery == 0)
+            {
+                SendProbe();
+            }
+        }
+
+        void ScheduleTick()
+        {
+            // Next message due date, the session keeps its average rate even when a tick is late
+            const auto NextDue = m_Start + std::chrono::duration_cast<ClockType::duration>(std::chrono::duration<double>(m_Sent / m_SessionRate));
+
+            auto self(shared_from_this());
+            m_Timer.expires_at(NextDue);
+            m_Timer.async_wait([this, self](boost::system::error_code ec)
+            {
+                if (!ec)
+                {
+                    OnTick();
+                }
+            });
+        }
+
+        void OnTick()
+        {
+            static constexpr std::uint64_t MaxBurst = 1000;
+
+            const auto Now     = ClockType::now();
+            const auto Elapsed = std::chrono::duration<double>(Now - m_Start).count();
+
+            if (Elapsed >= m_Settings.Duration)
+            {
+                Drain();
+                return;
+            }
+
+            const auto Due = static_cast<std::uint64_t>(Elapsed * m_SessionRate) + 1;
+            for (std::uint64_t Burst = 0; m_Sent < Due && Burst < MaxBurst; ++Burst)
+            {
+                SendOrderFlow();
+            }
+
+            DoWrite();
+            ScheduleTick();
+        }
+
+        /* Wait for the outstanding probes, at most DrainTimeout, before logging out */
+        void Drain()
+        {
+            static constexpr auto DrainTimeout = std::chrono::seconds(2);
+
+            m_bDraining = true;
+            if (m_Probes.empty())
+            {
+                Close();
+                return;
+            }
+
+            auto self(shared_from_this());
+            m_Timer.expires_from_now(DrainTimeout);
+            m_Timer.async_wait([this, self](boost::system::error_code ec)
+            {
+                if (!ec)
+                {
+                    Close();
+                }
+            });
+        }
+
+        void Close()
+        {
+            if (m_bClosing)
+            {
+                return;
+            }
+
+            m_bClosing = true;
+            m_rWorker.Stats.Unanswered += m_Probes.size();
+            m_Timer.cancel();
+
+            SendLogout();
+            DoWrite();
+        }
+
+        void OnMessage(const protocol::OneMessage & iMsg)
+        {
+            switch (iMsg.type())
+            {
+                case protocol::OneMessage_Type_LOGON_REPLY:
+                    if (iMsg.has_logon_reply_msg() && iMsg.logon_reply_msg().reject_code() == 0)
+                    {
+                        ++m_rWorker.Stats.LoggedOn;
+
+                        // Spread the sessions over one message period to avoid synchronized bursts
+                        const auto Period = std::chrono::duration<double>(1.0 / m_SessionRate);
+                        const auto Jitter = std::uniform_real_distribution<double>(0.0, Period.count())(m_rWorker.Generator);
+                        m_Start = ClockType::now() + std::chrono::duration_cast<ClockType::duration>(std::chrono::duration<double>(Jitter));
+
+                        ScheduleTick();
+                    }
+                    else
+                    {
+                        ++m_rWorker.Stats.Errors;
+                        m_Socket.close();
+                    }
+                    break;
+                case protocol::OneMessage_Type_HEARTBEAT:
+                    if (!m_Probes.empty() && !m_bClosing)
+                    {
+                        const auto RoundTrip = std::chrono::duration_cast<std::chrono::nanoseconds>(ClockType::now() - m_Probes.front()).count();
+                        m_rWorker.Stats.RoundTrips.Record(static_cast<std::uint64_t>(RoundTrip));
+                        m_Probes.pop_front();
+
+                        if (m_bDraining && m_Probes.empty())
+                        {
+                            Close();
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        void DoReadHeader()
+        {
+            auto self(shared_from_this());
+            boost::asio::async_read(m_Socket, boost::asio::buffer(m_ReadMsg.header(), Message::header_length),
+                                    [this, self](boost::system::error_code ec, std::size_t /*length*/)
+                                    {
+                                        if (!ec && m_ReadMsg.decode_header())
+                                        {
+                                            DoReadBody();
+                                        }
+                                    });
+        }
+
+        void DoReadBody()
+        {
+            auto self(shared_from_this());
+            boost::asio::async_read(m_Socket, boost::asio::buffer(m_ReadMsg.body(), m_ReadMsg.body_length()),
+                                    [this, self](boost::system::error_code ec, std::size_t /*length*/)
+                                    {
+                                        if (ec)
+                                        {
+                                            return;
+                                        }
+
+                                        protocol::OneMessage Msg;
+                                        if (Msg.ParseFromArray(m_ReadMsg.body(), static_cast<int>(m_ReadMsg.body_length())))
+                                        {
+                                            OnMessage(Msg);
+                                        }
+                                        else
+                                        {
+                                            ++m_rWorker.Stats.Errors;
+                                        }
+
+                                        if (m_Socket.is_open())
+                                        {
+                                            DoReadHeader();
+                                        }
+                                    });
+        }
+
+        /* Frame the message in the pending buffer, flushed by DoWrite */
+        void Send(const protocol::OneMessage & iMsg)
+        {
+            const auto Body = iMsg.SerializeAsString();
+
+            Message::Header Header;
+            Header.m_BodyLength = static_cast<std::uint32_t>(Body.size());
+
+            m_Pending.append(reinterpret_cast<const char*>(Header.m_Buffer), Message::header_length);
+            m_Pending.append(Body);
+        }
+
+        void DoWrite()
+        {
+            if (m_bWriting || m_Pending.empty())
+            {
+                return;
+            }
+
+            m_bWriting = true;
+            m_Writing.swap(m_Pending);
+
+            auto self(shared_from_this());
+            boost::asio::async_write(m_Socket, boost::asio::buffer(m_Writing),
+                                     [this, self](boost::system::error_code ec, std::size_t /*length*/)
+                                     {
+                                         m_bWriting = false;
+                                         m_Writing.clear();
+
+                                         if (ec)
+                                         {
+                                             ++m_rWorker.Stats.Errors;
+                                             m_Socket.close();
+                                             m_Timer.cancel();
+                                         }
+                                         else if (!m_Pending.empty())
+                                         {
+                                             DoWrite();
+                                         }
+                                         else if (m_bClosing)
+                                         {
+                                             boost::system::error_code ignored;
+                                             m_Socket.shutdown(tcp::socket::shutdown_both, ignored);
+                                             m_Socket.close();
+                                         }
+                                     });
+        }
+
+    private:
+        Worker &                            m_rWorker;
+        const LoadGeneratorSettings &       m_Settings;
+        tcp::socket                         m_Socket;
+        boost::asio::steady_timer           m_Timer;
+        Message                             m_ReadMsg;
+        std::string                         m_Pending;
+        std::string                         m_Writing;
+        bool                                m_bWriting   = false;
+        bool                                m_bDraining  = false;
+        bool                                m_bClosing   = false;
+        double                              m_SessionRate;
+        ClockType::time_point               m_Start;
+        std::uint64_t                       m_Sent       = 0;
+        std::deque<ClockType::time_point>   m_Probes;
+        std::vector<LiveOrder>              m_LiveOrders;
+};
+
+void WriteJson(std::ostream & oss, const LoadGeneratorSettings & iSettings, const WorkerStats & iStats, double iSeconds)
+{
+    const auto & RoundTrips = iStats.RoundTrips;
+    const auto   Sent       = iStats.NewOrders + iStats.ModOrders + iStats.CanOrders;
+
+    oss << "{" << std::endl;
+    oss << "  \"sessions\": " << iSettings.Sessions << "," << std::endl;
+    oss << "  \"threads\": " << iSettings.Threads << "," << std::endl;
+    oss << "  \"target_rate\": " << iSettings.Rate << "," << std::endl;
+    oss << "  \"duration_s\": " << std::fixed << std::setprecision(3) << iSeconds << "," << std::endl;
+    oss << "  \"connected\": " << iStats.Connected << "," << std::endl;
+    oss << "  \"logged_on\": " << iStats.LoggedOn << "," << std::endl;
+    oss << "  \"errors\": " << iStats.Errors << "," << std::endl;
+    oss << "  \"new_orders\": " << iStats.NewOrders << "," << std::endl;
+    oss << "  \"mod_orders\": " << iStats.ModOrders << "," << std::endl;
+    oss << "  \"can_orders\": " << iStats.CanOrders << "," << std::endl;
+    oss << "  \"achieved_rate\": " << std::setprecision(1) << (iSeconds > 0 ? Sent / iSeconds : 0.0) << "," << std::endl;
+    oss << "  \"probes\": " << iStats.Probes << "," << std::endl;
+    oss << "  \"unanswered_probes\": " << iStats.Unanswered << "," << std::endl;
+    oss << "  \"round_trip_ns\": { \"count\": " << RoundTrips.GetCount() << ", \"min\": " << RoundTrips.GetMin()
+        << ", \"mean\": " << RoundTrips.GetMean() << ", \"p50\": " << RoundTrips.GetValueAtPercentile(50.0)
+        << ", \"p90\": " << RoundTrips.GetValueAtPercentile(90.0) << ", \"p99\": " << RoundTrips.GetValueAtPercentile(99.0)
+        << ", \"p99_9\": " << RoundTrips.GetValueAtPercentile(99.9) << ", \"max\": " << RoundTrips.GetMax() << " }" << std::endl;
+    oss << "}" << std::endl;
+}
+
+void PrintSummary(std::ostream & oss, const WorkerStats & iStats, double iSeconds)
+{
+    const auto & RoundTrips = iStats.RoundTrips;
+    const auto   Sent       = iStats.NewOrders + iStats.ModOrders + iStats.CanOrders;
+
+    oss << "sessions connected " << iStats.Connected << " ; logged on " << iStats.LoggedOn << " ; errors " << iStats.Errors << std::endl;
+    oss << "new " << iStats.NewOrders << " ; mod " << iStats.ModOrders << " ; can " << iStats.CanOrders << " in "
+        << std::fixed << std::setprecision(3) << iSeconds << "s ; " << std::setprecision(0) << (iSeconds > 0 ? Sent / iSeconds : 0.0) << " orders/s" << std::endl;
+    oss << "probes " << iStats.Probes << " ; unanswered " << iStats.Unanswered << std::endl;
+    oss << "round trip p50 " << RoundTrips.GetValueAtPercentile(50.0) << " ; p99 " << RoundTrips.GetValueAtPercentile(99.0)
+        << " ; p99.9 " << RoundTrips.GetValueAtPercentile(99.9) << " ; max " << RoundTrips.GetMax() << " ( nanoseconds )" << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    const std::string ConfigFile = argc > 1 ? argv[1] : "load_generator.ini";
+
+    boost::property_tree::ptree Config;
+
+    if (boost::filesystem::exists(ConfigFile))
+    {
+        boost::property_tree::ini_parser::read_ini(ConfigFile, Config);
+    }
+    else
+    {
+        std::cerr << "Usage : " << argv[0] << " [load_generator.ini]" << std::endl;
+        std::cerr << "No such file or directory : " << ConfigFile << std::endl;
+        return 1;
+    }
+
+    LoadGeneratorSettings Settings;
+    if (!LoadSettings(Config, Settings))
+    {
+        return 2;
+    }
+
+    boost::system::error_code ec;
+    const tcp::endpoint EndPoint(boost::asio::ip::address::from_string(Settings.Host, ec), Settings.Port);
+    if (ec)
+    {
+        std::cerr << "Invalid host address : " << Settings.Host << std::endl;
+        return 2;
+    }
+
+    std::vector<std::unique_ptr<Worker>> Workers;
+    for (int i = 0; i < Settings.Threads; ++i)
+    {
+        Workers.push_back(std::make_unique<Worker>(Settings, Settings.Seed + i));
+    }
+
+    for (int i = 0; i < Settings.Sessions; ++i)
+    {
+        auto & rWorker = *Workers[i % Workers.size()];
+        std::make_shared<LoadSession>(rWorker, Settings)->Start(EndPoint);
+    }
+
+    const auto Start = ClockType::now();
+
+    // Each session holds its own asynchronous operations, a worker returns once all its sessions are closed
+    std::vector<std::thread> Threads;
+    for (auto & pWorker : Workers)
+    {
+        auto * pService = &pWorker->Service;
+        Threads.emplace_back([pService]() { pService->run(); });
+    }
+
+    for (auto & Thread : Threads)
+    {
+        Thread.join();
+    }
+
+    const auto Seconds = std::chrono::duration<double>(ClockType::now() - Start).count();
+
+    WorkerStats Stats;
+    for (auto & pWorker : Workers)
+    {
+        Stats.Merge(pWorker->Stats);
+    }
+
+    PrintSummary(std::cout, Stats, Seconds);
+
+    std::ofstream Output(Settings.OutputFile);
+    if (!Output)
+    {
+        std::cerr << "Failed to open " << Settings.OutputFile << std::endl;
+        return 3;
+    }
+    WriteJson(Output, Settings, Stats, Seconds);
+
+    std::cout << "results written to " << Settings.OutputFile << std::endl;
+    return Stats.LoggedOn == static_cast<std::uint64_t>(Settings.Sessions) ? 0 : 4;
+}
@@ -49,10 +49,20 @@ namespace exchange
                                     {
                                         if (!ec)
                                         {
+                                            const auto ReadStamp = m_pTracer ? common::ReadTimestampCounter() : 0;
+
                                             protocol::OneMessage msg;
                                             if (msg.ParseFromArray(m_read_msg.body(), m_read_msg.body_length()))
                                             {
+                                                const bool bTraced = m_pTracer && msg.type() == protocol::OneMessage_Type_NEW_ORDER && m_pTracer->Begin(ReadStamp);
+                                                common::LatencyTracer::Stamp(common::TraceStage::PARSED);
+
                                                 self->process_message(msg);
+
+                                                if (bTraced)
+                                                {
+                                                    m_pTracer->End();
+                                                }
                                             }
                                             else
                                             {
@@ -179,14 +189,58 @@ namespace exchange
                 return;
             }
 
+            engine::OrderType eType = engine::OrderType::MAX_TYPE;
+            if( !decode_order_type(rNewOrder, eType) )
+            {
+                EXERR("Session::process_new_order : Invalid order type : " << rNewOrder.order_type());
+                return;
+            }
+
+            engine::TimeQualifier eQualifier = engine::TimeQualifier::MAX_QUALIFIER;
+            if( !decode_time_qualifier(rNewOrder, eQualifier) )
+            {
+                EXERR("Session::process_new_order : Invalid time qualifier : " << rNewOrder.time_qualifier());
+                return;
+            }
+
             const auto nQuantity = engine::Order::qty_type(rNewOrder.order_quantity());
             const auto nPrice = engine::Order::price_type(rNewOrder.limit_price());
             const auto nClientOrderID = engine::Order::client_orderid_type(rNewOrder.client_order_id());
             const auto nClientID = engine::Order::client_id_type(0);
 
-            auto pOrder = std::make_unique<engine::Order>(eWay, nQuantity, nPrice, nClientOrderID, nClientID);
+            auto result = engine::Status::Ok;
+
+            if (eType == engine::OrderType::LIMIT && eQualifier == engine::TimeQualifier::DAY)
+            {
+                auto pOrder = std::make_unique<engine::Order>(eWay, nQuantity, nPrice, nClientOrderID, nClientID);
+
+                if (m_pRecorder)
+                {
+                    m_pRecorder->RecordInsert(*pOrder, rNewOrder.instrument_id());
+                }
+
+                common::LatencyTracer::Stamp(common::TraceStage::ENGINE_ENTRY);
+                result = m_matching_engine.Insert( std::move(pOrder), rNewOrder.instrument_id());
+                common::LatencyTracer::Stamp(common::TraceStage::ENGINE_EXIT);
+            }
+            else
+            {
+                // Market orders never rest in the book, they are handled as IOC unless FOK is requested
+                if (eQualifier == engine::TimeQualifier::DAY)
+                {
+                    eQualifier = engine::TimeQualifier::IOC;
+                }
+
+                if (m_pRecorder)
+                {
+                    m_pRecorder->RecordImmediateInsert(eType, eWay, nQuantity, nPrice, nClientOrderID, nClientID, eQualifier, rNewOrder.instrument_id());
+                }
+
+                common::LatencyTracer::Stamp(common::TraceStage::ENGINE_ENTRY);
+                result = m_matching_engine.ImmediateInsert(eType, eWay, nQuantity, nPrice, nClientOrderID, nClientID, eQualifier, rNewOrder.instrument_id());
+                common::LatencyTracer::Stamp(common::TraceStage::ENGINE_EXIT);
+            }
 
-            const auto result = m_matching_engine.Insert( std::move(pOrder), rNewOrder.instrument_id());
             if (result  == engine::Status::Ok )
             {
                 // Ack the order
@@ -236,7 +290,40 @@ namespace exchange
             }
             return rWay != engine::OrderWay::MAX_WAY;
         }
-    }
-}
 
+        bool Session::decode_order_type(const protocol::NewOrder & rNewOrder, engine::OrderType & rType)
+        {
+            switch(rNewOrder.order_type())
+            {
+                case protocol::NewOrder::LIMIT:
+                    rType = engine::OrderType::LIMIT;
+                    break;
+                case protocol::NewOrder::MARKET:
+                    rType = engine::OrderType::MARKET;
+                    break;
+                default:
+                    rType = engine::OrderType::MAX_TYPE;
+            }
+            return rType != engine::OrderType::MAX_TYPE;
+        }
 
+        bool Session::decode_time_qualifier(const protocol::NewOrder & rNewOrder, engine::TimeQualifier & rQualifier)
+        {
+            switch(rNewOrder.time_qualifier())
+            {
+                case protocol::NewOrder::DAY:
+                    rQualifier = engine::TimeQualifier::DAY;
+                    break;
+                case protocol::NewOrder::IOC:
+                    rQualifier = engine::TimeQualifier::IOC;
+                    break;
+                case protocol::NewOrder::FOK:
+                    rQualifier = engine::TimeQualifier::FOK;
+                    break;
+                default:
+                    rQualifier = engine::TimeQualifier::MAX_QUALIFIER;
+            }
+            return rQualifier != engine::TimeQualifier::MAX_QUALIFIER;
+        }
+    }
+}
@@ -10,6 +10,9 @@ using boost::asio::ip::tcp;
 
 bool term_received(false);
 
+/* Per stage latencies are dumped on SIGUSR1 when the tracing is enabled */
+exchange::common::LatencyTraceAggregator * pTraceAggregator = nullptr;
+
 void sig_handler(int sig)
 {
     switch (sig)
@@ -19,6 +22,13 @@ void sig_handler(int sig)
             term_received = true;
             signal(sig, sig_handler);
             break;
+        case SIGUSR1:
+            if (pTraceAggregator)
+            {
+                pTraceAggregator->RequestDump();
+            }
+            signal(sig, sig_handler);
+            break;
         default:
             std::cerr << sig << std::endl;
             break;
@@ -55,11 +65,38 @@ int main( int argc, char** argv )
         return 3;
     }
 
+    /* Sampled per stage latency tracing, aggregated off the engine thread */
+    std::unique_ptr<exchange::common::LatencyTracer>          pTracer;
+    std::unique_ptr<exchange::common::LatencyTraceAggregator> pAggregator;
+    if (auto SampleRate = aConfig.get<std::uint32_t>("Trace.sample_rate", 0))
+    {
+        pTracer     = std::make_unique<exchange::common::LatencyTracer>(SampleRate);
+        pAggregator = std::make_unique<exchange::common::LatencyTraceAggregator>(*pTracer,
+                                                                                 aConfig.get<std::string>("Trace.dump_file", "latency_trace.txt"),
+                                                                                 std::chrono::seconds(aConfig.get<int>("Trace.dump_interval", 10)));
+        pAggregator->Start();
+        pTraceAggregator = pAggregator.get();
+    }
+
     signal(SIGTERM, sig_handler);
     signal(SIGINT, sig_handler);
+    signal(SIGUSR1, sig_handler);
+
+    /* Optional capture of the inbound order flow, replayed by bin/replay */
+    std::unique_ptr<exchange::engine::OrderFlowRecorder> pRecorder;
+    if (auto CaptureFile = aConfig.get_optional<std::string>("GATEWAY.capture_file"))
+    {
+        pRecorder = std::make_unique<exchange::engine::OrderFlowRecorder>(*CaptureFile);
+        if (!pRecorder->IsOpen())
+        {
+            std::cerr << "Could not open capture file " << *CaptureFile << std::endl;
+            return 5;
+        }
+        pRecorder->RecordPhase(_MatchingEngine.GetGlobalPhase());
+    }
 
     boost::asio::io_service service;
-    exchange::gateway::TCPServer server(_MatchingEngine, service, 5001);
+    exchange::gateway::TCPServer server(_MatchingEngine, service, 5001, pRecorder.get(), pTracer.get());
 
     try
     {
@@ -67,7 +104,15 @@ int main( int argc, char** argv )
 
         while ( !term_received )
         {
+            const auto PreviousPhase = _MatchingEngine.GetGlobalPhase();
+
             _MatchingEngine.EngineListen();
+
+            if (pRecorder && PreviousPhase != _MatchingEngine.GetGlobalPhase())
+            {
+                pRecorder->RecordPhase(_MatchingEngine.GetGlobalPhase());
+            }
+
             service.poll();
         }
         return 0;